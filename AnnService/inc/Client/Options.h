@@ -29,6 +29,9 @@ public:
     // in milliseconds.
     std::uint32_t m_searchTimeout;
 
+    // in milliseconds, 0 for none.
+    std::uint32_t m_searchDeadline;
+
     std::uint32_t m_threadNum;
 
     std::uint32_t m_socketThreadNum;
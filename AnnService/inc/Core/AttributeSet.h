@@ -0,0 +1,170 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _SPTAG_ATTRIBUTESET_H_
+#define _SPTAG_ATTRIBUTESET_H_
+
+#include "SearchFilter.h"
+
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+namespace SPTAG
+{
+
+// Named string attributes of the indexed vectors (market, language, tenant...), one dictionary coded
+// column each, so searches can be filtered on them without the caller building allow-lists.
+class AttributeSet
+{
+public:
+    bool Empty() const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_columns.empty();
+    }
+
+    ErrorCode SetAttribute(const std::string& p_column, SizeType p_vectorID, const std::string& p_value)
+    {
+        if (p_column.empty() || p_vectorID < 0) return ErrorCode::Fail;
+
+        std::lock_guard<std::mutex> lock(m_lock);
+        Column& column = m_columns[p_column];
+        if (column.m_codes == nullptr)
+        {
+            column.m_codes.reset(new AttributeColumn);
+            column.m_codes->SetName("Attribute " + p_column);
+        }
+
+        auto iter = column.m_dictionary.find(p_value);
+        std::uint32_t code;
+        if (iter != column.m_dictionary.end())
+        {
+            code = iter->second;
+        }
+        else
+        {
+            code = (std::uint32_t)column.m_values.size();
+            if (code == AttributeColumn::c_unset) return ErrorCode::MemoryOverFlow;
+            column.m_dictionary.emplace(p_value, code);
+            column.m_values.push_back(p_value);
+        }
+
+        ErrorCode ret;
+        if (p_vectorID >= column.m_codes->R() && (ret = column.m_codes->AddBatch(p_vectorID + 1 - column.m_codes->R())) != ErrorCode::Success) return ret;
+        *((*column.m_codes)[p_vectorID]) = code;
+        return ErrorCode::Success;
+    }
+
+    // Empty when the vector has no value in p_column.
+    std::string GetAttribute(const std::string& p_column, SizeType p_vectorID) const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        auto iter = m_columns.find(p_column);
+        if (iter == m_columns.end() || p_vectorID < 0) return std::string();
+
+        std::uint32_t code = iter->second.m_codes->Code(p_vectorID);
+        return code == AttributeColumn::c_unset ? std::string() : iter->second.m_values[code];
+    }
+
+    // Restricts p_filter to vectors whose p_column is one of p_values. Values never set match nothing.
+    ErrorCode AddFilter(SearchFilter& p_filter, const std::string& p_column, const std::vector<std::string>& p_values) const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        auto iter = m_columns.find(p_column);
+        if (iter == m_columns.end())
+        {
+            LOG(Helper::LogLevel::LL_Error, "No attribute %s to filter on!\n", p_column.c_str());
+            return ErrorCode::Fail;
+        }
+
+        std::vector<std::uint32_t> codes;
+        for (const std::string& value : p_values)
+        {
+            auto code = iter->second.m_dictionary.find(value);
+            if (code != iter->second.m_dictionary.end()) codes.push_back(code->second);
+        }
+        p_filter.AddAttributeClause(iter->second.m_codes, codes);
+        return ErrorCode::Success;
+    }
+
+    ErrorCode Save(std::shared_ptr<Helper::DiskPriorityIO> p_out) const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        std::uint32_t columns = (std::uint32_t)m_columns.size();
+        IOBINARY(p_out, WriteBinary, sizeof(columns), (char*)&columns);
+        for (const auto& column : m_columns)
+        {
+            ErrorCode ret;
+            if ((ret = SaveString(p_out, column.first)) != ErrorCode::Success) return ret;
+            std::uint32_t values = (std::uint32_t)column.second.m_values.size();
+            IOBINARY(p_out, WriteBinary, sizeof(values), (char*)&values);
+            for (const std::string& value : column.second.m_values)
+            {
+                if ((ret = SaveString(p_out, value)) != ErrorCode::Success) return ret;
+            }
+            if ((ret = column.second.m_codes->Save(p_out)) != ErrorCode::Success) return ret;
+        }
+        return ErrorCode::Success;
+    }
+
+    ErrorCode Load(std::shared_ptr<Helper::DiskPriorityIO> p_input)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_columns.clear();
+        std::uint32_t columns;
+        IOBINARY(p_input, ReadBinary, sizeof(columns), (char*)&columns);
+        for (std::uint32_t i = 0; i < columns; i++)
+        {
+            ErrorCode ret;
+            std::string name;
+            if ((ret = LoadString(p_input, name)) != ErrorCode::Success) return ret;
+
+            Column& column = m_columns[name];
+            std::uint32_t values;
+            IOBINARY(p_input, ReadBinary, sizeof(values), (char*)&values);
+            column.m_values.resize(values);
+            for (std::uint32_t j = 0; j < values; j++)
+            {
+                if ((ret = LoadString(p_input, column.m_values[j])) != ErrorCode::Success) return ret;
+                column.m_dictionary.emplace(column.m_values[j], j);
+            }
+            column.m_codes.reset(new AttributeColumn);
+            column.m_codes->SetName("Attribute " + name);
+            if ((ret = column.m_codes->Load(p_input)) != ErrorCode::Success) return ret;
+        }
+        return ErrorCode::Success;
+    }
+
+private:
+    static ErrorCode SaveString(std::shared_ptr<Helper::DiskPriorityIO> p_out, const std::string& p_value)
+    {
+        std::uint32_t length = (std::uint32_t)p_value.size();
+        IOBINARY(p_out, WriteBinary, sizeof(length), (char*)&length);
+        if (length > 0) IOBINARY(p_out, WriteBinary, length, p_value.data());
+        return ErrorCode::Success;
+    }
+
+    static ErrorCode LoadString(std::shared_ptr<Helper::DiskPriorityIO> p_input, std::string& p_value)
+    {
+        std::uint32_t length;
+        IOBINARY(p_input, ReadBinary, sizeof(length), (char*)&length);
+        p_value.resize(length);
+        if (length > 0) IOBINARY(p_input, ReadBinary, length, &p_value[0]);
+        return ErrorCode::Success;
+    }
+
+    struct Column
+    {
+        std::shared_ptr<AttributeColumn> m_codes;
+        std::vector<std::string> m_values;
+        std::unordered_map<std::string, std::uint32_t> m_dictionary;
+    };
+
+    std::map<std::string, Column> m_columns;
+    mutable std::mutex m_lock;
+};
+
+} // namespace SPTAG
+
+#endif // _SPTAG_ATTRIBUTESET_H_
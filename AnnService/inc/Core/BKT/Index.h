@@ -6,6 +6,7 @@
 
 #include "../Common.h"
 #include "../VectorIndex.h"
+#include "../SearchFilter.h"
 
 #include "../Common/CommonUtils.h"
 #include "../Common/DistanceUtils.h"
@@ -16,6 +17,8 @@
 #include "../Common/RelativeNeighborhoodGraph.h"
 #include "../Common/BKTree.h"
 #include "../Common/Labelset.h"
+#include "../Common/PQQuantizer.h"
+#include "../Common/SQ8Quantizer.h"
 #include "inc/Helper/SimpleIniReader.h"
 #include "inc/Helper/StringConvert.h"
 #include "inc/Helper/ThreadPool.h"
@@ -60,10 +63,21 @@ namespace SPTAG
             // Graph structure
             COMMON::RelativeNeighborhoodGraph m_pGraph;
 
+            // Product quantization codes, searched through per-query lookup tables before the exact rerank
+            COMMON::PQQuantizer m_pQuantizer;
+            COMMON::Dataset<std::uint8_t> m_pPQCodes;
+
+            // 8-bit scalar quantization codes, searched with the uint8 kernels against the quantized query
+            COMMON::SQ8Quantizer m_pSQ8Quantizer;
+            COMMON::Dataset<std::uint8_t> m_pSQ8Codes;
+            bool m_bQuantizedOnly; // loaded without m_pSamples, so only SQ8 search is possible
+
             std::string m_sBKTFilename;
             std::string m_sGraphFilename;
             std::string m_sDataPointsFilename;
             std::string m_sDeleteDataPointsFilename;
+            std::string m_sPQFilename;
+            std::string m_sSQ8Filename;
 
             int m_addCountForRebuild;
             float m_fDeletePercentageForRefine;
@@ -71,19 +85,51 @@ namespace SPTAG
             std::shared_timed_mutex m_dataDeleteLock;
             COMMON::Labelset m_deletedID;
 
-            std::unique_ptr<COMMON::WorkSpacePool> m_workSpacePool;
+            std::shared_ptr<COMMON::WorkSpacePool> m_workSpacePool;
             Helper::ThreadPool m_threadPool;
             int m_iNumberOfThreads;
 
             DistCalcMethod m_iDistCalcMethod;
             float(*m_fComputeDistance)(const T* pX, const T* pY, DimensionType length);
+            void(*m_fComputeDistanceBatch)(const T* pQuery, const T* const* pCandidates, int count, DimensionType length, float* pOut);
+            float(*m_fComputePartialDistance)(const T* pX, const T* pY, DimensionType length); // any length, for chunked scoring
             int m_iBaseSquare;
+            float m_fMaxNormSquare; // largest squared norm in the data, used by InnerProduct
+            COMMON::Dataset<float> m_pNorms; // squared norm of every sample, kept for Cosine and InnerProduct
 
             int m_iMaxCheck;        
             int m_iThresholdOfNumberOfContinuousNoBetterPropagation;
             int m_iNumberOfInitialDynamicPivots;
             int m_iNumberOfOtherDynamicPivots;
             int m_iHashTableExp;
+            bool m_bEpochVisitedSet;
+            int m_iSearchGroupSize;
+            int m_iIteratorTimeout;
+            std::string m_sAdaptiveModel;
+            float m_fAdaptiveThreshold;
+            COMMON::TerminationPredictor m_termination;
+            DimensionType m_iEarlyAbandonDimension;
+            DimensionType m_iPQSubvectors;
+            int m_iPQRerankNumber;
+            bool m_bSQ8;
+            int m_iSQ8RerankNumber;
+
+            // Representation scored during the traversal: the full vectors, PQ codes through the per-query
+            // lookup table, or SQ8 codes against the quantized query.
+            enum class ScoreMode { Full, PQ, SQ8 };
+
+            // One query of an interleaved batch search, with the node it popped and the neighbors it gathered.
+            struct InterleavedQuery
+            {
+                COMMON::QueryResultSet<T>* m_query;
+                COMMON::WorkSpace* m_space;
+                COMMON::HeapCell m_node;
+                int m_batchCount;
+                bool m_active;
+            };
+
+            // Resumable traversal behind BeginSearch.
+            class SearchIterator;
 
         public:
             Index()
@@ -95,15 +141,19 @@ namespace SPTAG
 #undef DefineBKTParameter
 
                 m_pSamples.SetName("Vector");
-                m_fComputeDistance = COMMON::DistanceCalcSelector<T>(m_iDistCalcMethod);
-                m_iBaseSquare = (m_iDistCalcMethod == DistCalcMethod::Cosine) ? COMMON::Utils::GetBase<T>() * COMMON::Utils::GetBase<T>() : 1;
+                m_pPQCodes.SetName("PQCodes");
+                m_pSQ8Codes.SetName("SQ8Codes");
+                m_pNorms.SetName("Norms");
+                m_bQuantizedOnly = false;
+                SelectDistanceKernels();
+                m_fMaxNormSquare = 0;
             }
 
             ~Index() {}
 
-            inline SizeType GetNumSamples() const { return m_pSamples.R(); }
+            inline SizeType GetNumSamples() const { return m_bQuantizedOnly ? m_pSQ8Codes.R() : m_pSamples.R(); }
             inline SizeType GetNumDeleted() const { return (SizeType)m_deletedID.Count(); }
-            inline DimensionType GetFeatureDim() const { return m_pSamples.C(); }
+            inline DimensionType GetFeatureDim() const { return m_bQuantizedOnly ? m_pSQ8Quantizer.GetFeatureDim() : m_pSamples.C(); }
         
             inline int GetCurrMaxCheck() const { return m_iMaxCheck; }
             inline int GetNumThreads() const { return m_iNumberOfThreads; }
@@ -112,15 +162,33 @@ namespace SPTAG
             inline VectorValueType GetVectorValueType() const { return GetEnumValueType<T>(); }
             
             inline float AccurateDistance(const void* pX, const void* pY) const { 
-                if (m_iDistCalcMethod == DistCalcMethod::L2) return m_fComputeDistance((const T*)pX, (const T*)pY, m_pSamples.C());
+                if (m_iDistCalcMethod != DistCalcMethod::Cosine) return m_fComputeDistance((const T*)pX, (const T*)pY, GetFeatureDim());
 
-                float xy = m_iBaseSquare - m_fComputeDistance((const T*)pX, (const T*)pY, m_pSamples.C());
-                float xx = m_iBaseSquare - m_fComputeDistance((const T*)pX, (const T*)pX, m_pSamples.C());
-                float yy = m_iBaseSquare - m_fComputeDistance((const T*)pY, (const T*)pY, m_pSamples.C());
+                float xy = m_iBaseSquare - m_fComputeDistance((const T*)pX, (const T*)pY, GetFeatureDim());
+                float xx = m_iBaseSquare - m_fComputeDistance((const T*)pX, (const T*)pX, GetFeatureDim());
+                float yy = m_iBaseSquare - m_fComputeDistance((const T*)pY, (const T*)pY, GetFeatureDim());
                 return 1.0f - xy / (sqrt(xx) * sqrt(yy));
             }
-            inline float ComputeDistance(const void* pX, const void* pY) const { return m_fComputeDistance((const T*)pX, (const T*)pY, m_pSamples.C()); }
-            inline const void* GetSample(const SizeType idx) const { return (void*)m_pSamples[idx]; }
+            // Distance between two data vectors as used for graph construction; for InnerProduct this is the norm-augmented L2.
+            inline float ComputeDistance(const void* pX, const void* pY) const {
+                if (m_iDistCalcMethod == DistCalcMethod::InnerProduct)
+                    return COMMON::DistanceUtils::ComputeNormAugmentedDistance((const T*)pX, (const T*)pY, GetFeatureDim(), m_fMaxNormSquare, m_fComputeDistance);
+                return m_fComputeDistance((const T*)pX, (const T*)pY, GetFeatureDim());
+            }
+            // Same as above for two samples, with their squared norms read from m_pNorms instead of recomputed.
+            inline float AccurateDistance(const SizeType p_x, const SizeType p_y) const {
+                float dist = m_fComputeDistance(m_pSamples[p_x], m_pSamples[p_y], GetFeatureDim());
+                if (m_iDistCalcMethod != DistCalcMethod::Cosine) return dist;
+
+                return 1.0f - (m_iBaseSquare - dist) / (sqrt(*m_pNorms[p_x]) * sqrt(*m_pNorms[p_y]));
+            }
+            inline float ComputeDistance(const SizeType p_x, const SizeType p_y) const {
+                float dist = m_fComputeDistance(m_pSamples[p_x], m_pSamples[p_y], GetFeatureDim());
+                if (m_iDistCalcMethod != DistCalcMethod::InnerProduct) return dist;
+
+                return COMMON::DistanceUtils::ComputeNormAugmentedDistance(dist, *m_pNorms[p_x], *m_pNorms[p_y], m_fMaxNormSquare);
+            }
+            inline const void* GetSample(const SizeType idx) const { return m_bQuantizedOnly ? nullptr : (void*)m_pSamples[idx]; }
             inline bool ContainSample(const SizeType idx) const { return !m_deletedID.Contains(idx); }
             inline bool NeedRefine() const { return m_deletedID.Count() > (size_t)(GetNumSamples() * m_fDeletePercentageForRefine); }
             std::shared_ptr<std::vector<std::uint64_t>> BufferSize() const
@@ -130,6 +198,8 @@ namespace SPTAG
                 buffersize->push_back(m_pTrees.BufferSize());
                 buffersize->push_back(m_pGraph.BufferSize());
                 buffersize->push_back(m_deletedID.BufferSize());
+                if (m_iPQSubvectors > 0) buffersize->push_back(PQBufferSize());
+                if (m_bSQ8) buffersize->push_back(SQ8BufferSize());
                 return std::move(buffersize);
             }
 
@@ -140,6 +210,8 @@ namespace SPTAG
                 files->push_back(m_sBKTFilename);
                 files->push_back(m_sGraphFilename);
                 files->push_back(m_sDeleteDataPointsFilename);
+                if (m_iPQSubvectors > 0) files->push_back(m_sPQFilename);
+                if (m_bSQ8) files->push_back(m_sSQ8Filename);
                 return std::move(files);
             }
 
@@ -152,6 +224,11 @@ namespace SPTAG
 
             ErrorCode BuildIndex(const void* p_data, SizeType p_vectorNum, DimensionType p_dimension);
             ErrorCode SearchIndex(QueryResult &p_query, bool p_searchDeleted = false) const;
+            ErrorCode SearchIndexBatch(QueryResult* p_queries, int p_count, bool p_searchDeleted = false) const;
+            ErrorCode SearchIndexTrace(QueryResult &p_query, std::vector<COMMON::TerminationTracePoint>& p_trace) const;
+            ErrorCode SearchIndexRange(QueryResult &p_query, float p_radius, int p_maxResults, bool p_searchDeleted = false) const;
+            ErrorCode SearchIndexFiltered(QueryResult &p_query, const SearchFilter& p_filter, bool p_searchDeleted = false) const;
+            ErrorCode BeginSearch(const void* p_target, std::shared_ptr<ResultIterator>& p_iterator, bool p_searchDeleted = false) const;
             ErrorCode RefineSearchIndex(QueryResult &p_query, bool p_searchDeleted = false) const;
             ErrorCode SearchTree(QueryResult &p_query) const;
             ErrorCode AddIndex(const void* p_data, SizeType p_vectorNum, DimensionType p_dimension, std::shared_ptr<MetadataSet> p_metadataSet, bool p_withMetaIndex = false);
@@ -166,7 +243,45 @@ namespace SPTAG
             ErrorCode RefineIndex(std::shared_ptr<VectorIndex>& p_newIndex);
 
         private:
-            void SearchIndex(COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space, bool p_searchDeleted, bool p_searchDuplicated) const;
+            void SearchIndex(COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space, bool p_searchDeleted, bool p_searchDuplicated, ScoreMode p_mode = ScoreMode::Full) const;
+            void SearchIndexQuantized(COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space, bool p_searchDeleted, ScoreMode p_mode, int p_rerankNumber) const;
+            void SearchIndexInterleaved(std::vector<InterleavedQuery>& p_group, bool p_searchDeleted, ScoreMode p_mode) const;
+            void PrepareQuantizedQuery(const COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space, ScoreMode p_mode) const;
+            int RerankCandidates(COMMON::QueryResultSet<T> &p_candidates, COMMON::QueryResultSet<T> &p_query) const;
+            ErrorCode SearchQuery(QueryResult &p_query, bool p_searchDeleted, const SearchFilter* p_filter, bool p_adaptive, std::vector<COMMON::TerminationTracePoint>* p_trace) const;
+            void SetResultMetadata(QueryResult &p_query) const;
+            float ScoreVector(const COMMON::QueryResultSet<T> &p_query, const COMMON::WorkSpace &p_space, SizeType p_id, ScoreMode p_mode) const;
+            const void* ScoredVector(SizeType p_id, ScoreMode p_mode) const;
+            size_t ScoredVectorSize(ScoreMode p_mode) const;
+            void ScoreBatch(const COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space, int p_count, ScoreMode p_mode) const;
+            float ScoreVectorBounded(const COMMON::QueryResultSet<T> &p_query, const COMMON::WorkSpace &p_space, SizeType p_id, float p_bound) const;
+            inline bool EarlyAbandonEnabled() const { return m_iEarlyAbandonDimension > 0 && GetFeatureDim() >= m_iEarlyAbandonDimension; }
+            inline float ChunkBase() const { return (m_iDistCalcMethod == DistCalcMethod::Cosine) ? (float)m_iBaseSquare : 0; }
+            void UpdateNorms(SizeType p_start, SizeType p_end);
+            // Kernels for the distance method, specialized for the dimension once the data is there.
+            inline void SelectDistanceKernels()
+            {
+                m_fComputeDistance = COMMON::DistanceCalcSelector<T>(m_iDistCalcMethod, GetFeatureDim());
+                m_fComputeDistanceBatch = COMMON::DistanceBatchCalcSelector<T>(m_iDistCalcMethod, GetFeatureDim());
+                m_fComputePartialDistance = COMMON::DistanceCalcSelector<T>(m_iDistCalcMethod);
+                m_iBaseSquare = (m_iDistCalcMethod == DistCalcMethod::Cosine) ? COMMON::Utils::GetBase<T>() * COMMON::Utils::GetBase<T>() : 1;
+            }
+            inline bool NormsCached() const { return m_iDistCalcMethod == DistCalcMethod::Cosine || m_iDistCalcMethod == DistCalcMethod::InnerProduct; }
+
+            void EncodePQ(SizeType p_start, SizeType p_end);
+            std::uint64_t PQBufferSize() const;
+            ErrorCode SavePQ(std::shared_ptr<Helper::DiskPriorityIO> p_out) const;
+            ErrorCode LoadPQ(std::shared_ptr<Helper::DiskPriorityIO> p_input);
+            ErrorCode LoadPQ(char* p_pqMemFile);
+
+            void EncodeSQ8(SizeType p_start, SizeType p_end);
+            std::uint64_t SQ8BufferSize() const;
+            ErrorCode SaveSQ8(std::shared_ptr<Helper::DiskPriorityIO> p_out) const;
+            ErrorCode LoadSQ8(std::shared_ptr<Helper::DiskPriorityIO> p_input);
+            ErrorCode LoadSQ8(char* p_sq8MemFile);
+            bool CheckFullVectors() const;
+            inline bool SQ8Enabled() const { return m_bSQ8 && m_iPQSubvectors <= 0 && m_iDistCalcMethod != DistCalcMethod::Hamming && std::is_same<T, float>::value; }
+            inline size_t SQ8Stream() const { return (m_iPQSubvectors > 0) ? 5 : 4; }
         };
     } // namespace BKT
 } // namespace SPTAG
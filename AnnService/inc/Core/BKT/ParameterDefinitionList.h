@@ -8,6 +8,8 @@ DefineBKTParameter(m_sBKTFilename, std::string, std::string("tree.bin"), "TreeFi
 DefineBKTParameter(m_sGraphFilename, std::string, std::string("graph.bin"), "GraphFilePath")
 DefineBKTParameter(m_sDataPointsFilename, std::string, std::string("vectors.bin"), "VectorFilePath")
 DefineBKTParameter(m_sDeleteDataPointsFilename, std::string, std::string("deletes.bin"), "DeleteVectorFilePath")
+DefineBKTParameter(m_sPQFilename, std::string, std::string("pq.bin"), "PQFilePath")
+DefineBKTParameter(m_sSQ8Filename, std::string, std::string("sq8.bin"), "SQ8FilePath")
 
 DefineBKTParameter(m_pTrees.m_iTreeNumber, int, 1L, "BKTNumber")
 DefineBKTParameter(m_pTrees.m_iBKTKmeansK, int, 32L, "BKTKmeansK")
@@ -44,5 +46,16 @@ DefineBKTParameter(m_iThresholdOfNumberOfContinuousNoBetterPropagation, int, 3L,
 DefineBKTParameter(m_iNumberOfInitialDynamicPivots, int, 50L, "NumberOfInitialDynamicPivots")
 DefineBKTParameter(m_iNumberOfOtherDynamicPivots, int, 4L, "NumberOfOtherDynamicPivots")
 DefineBKTParameter(m_iHashTableExp, int, 4L, "HashTableExponent")
+DefineBKTParameter(m_bEpochVisitedSet, bool, false, "EpochVisitedSet") // visited flags as a per-vector epoch array instead of a hash table: no per-query clear and no overflow, 2 bytes per vector per workspace
+DefineBKTParameter(m_iSearchGroupSize, int, 8L, "SearchGroupSize") // queries whose traversals a batch search interleaves; 1 searches them one after another
+DefineBKTParameter(m_iIteratorTimeout, int, 60L, "IteratorTimeout") // seconds a search iterator may sit idle before its workspace goes back to other searches
+DefineBKTParameter(m_sAdaptiveModel, std::string, std::string(""), "AdaptiveModel") // termination model fitted by indexsearcher --calibrate; empty searches to MaxCheck
+DefineBKTParameter(m_fAdaptiveThreshold, float, 0.9F, "AdaptiveThreshold") // predicted convergence probability at which AdaptiveModel stops a search
+DefineBKTParameter(m_iEarlyAbandonDimension, DimensionType, 512L, "EarlyAbandonDimension") // smallest dimension whose graph expansion stops scoring candidates beyond the worst result; 0 disables
+
+DefineBKTParameter(m_iPQSubvectors, DimensionType, 0L, "PQSubvectors") // 0 keeps full precision search, otherwise must divide the dimension
+DefineBKTParameter(m_iPQRerankNumber, int, 64L, "PQRerankNumber") // PQ candidates rescored with the full vectors
+DefineBKTParameter(m_bSQ8, bool, false, "SQ8") // 8-bit scalar quantized search, Float indexes only
+DefineBKTParameter(m_iSQ8RerankNumber, int, 0L, "SQ8RerankNumber") // SQ8 candidates rescored with the full vectors; 0 loads the index without them
 
 #endif
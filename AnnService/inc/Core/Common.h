@@ -13,6 +13,8 @@
 #include <cmath>
 #include "inc/Helper/Logging.h"
 #include "inc/Helper/DiskIO.h"
+#include "inc/Core/Float16.h"
+#include "inc/Core/PackedBits.h"
 
 #ifndef _MSC_VER
 #include <sys/stat.h>
@@ -151,6 +153,16 @@ enum class TruthFileType : std::uint8_t
 };
 static_assert(static_cast<std::uint8_t>(TruthFileType::Undefined) != 0, "Empty TruthFileType!");
 
+enum class TerminationReason : std::uint8_t
+{
+#define DefineTerminationReason(Name) Name,
+#include "DefinitionList.h"
+#undef DefineTerminationReason
+
+    Undefined
+};
+static_assert(static_cast<std::uint8_t>(TerminationReason::Undefined) != 0, "Empty TerminationReason!");
+
 template<typename T>
 constexpr VectorValueType GetEnumValueType()
 {
@@ -38,6 +38,7 @@ namespace SPTAG
             DimensionType _D;
             int _T;
             DistCalcMethod _M;
+            int _B; // accumulators per value: one per bit for bitwise (Hamming/PackedBits) clustering, else 1
             T* centers;
             T* newTCenters;
             SizeType* counts;
@@ -48,20 +49,31 @@ namespace SPTAG
             float* clusterDist;
             float* weightedCounts;
             float* newWeightedCounts;
+            // InnerProduct clusters in the norm-augmented space: each point carries the extra
+            // coordinate sqrt(M - |x|^2) in augment (indexed by data id) and so does each center.
+            const float* augment;
+            float* centerAugment;
+            float* newTCenterAugment;
+            float* newCenterAugment;
             float(*fComputeDistance)(const T* pX, const T* pY, DimensionType length);
 
             KmeansArgs(int k, DimensionType dim, SizeType datasize, int threadnum, DistCalcMethod distMethod) : _K(k), _DK(k), _D(dim), _T(threadnum), _M(distMethod) {
+                _B = (distMethod == DistCalcMethod::Hamming || std::is_same<T, PackedBits>::value) ? 8 * sizeof(T) : 1;
                 centers = (T*)aligned_malloc(sizeof(T) * k * dim, ALIGN);
                 newTCenters = (T*)aligned_malloc(sizeof(T) * k * dim, ALIGN);
                 counts = new SizeType[k];
-                newCenters = new float[threadnum * k * dim];
+                newCenters = new float[((size_t)threadnum) * k * dim * _B];
                 newCounts = new SizeType[threadnum * k];
                 label = new int[datasize];
                 clusterIdx = new SizeType[threadnum * k];
                 clusterDist = new float[threadnum * k];
                 weightedCounts = new float[k];
                 newWeightedCounts = new float[threadnum * k];
-                fComputeDistance = COMMON::DistanceCalcSelector<T>(distMethod);
+                augment = nullptr;
+                centerAugment = new float[k];
+                newTCenterAugment = new float[k];
+                newCenterAugment = new float[threadnum * k];
+                fComputeDistance = COMMON::DistanceCalcSelector<T>((distMethod == DistCalcMethod::InnerProduct) ? DistCalcMethod::L2 : distMethod);
             }
 
             ~KmeansArgs() {
@@ -75,6 +87,9 @@ namespace SPTAG
                 delete[] clusterDist;
                 delete[] weightedCounts;
                 delete[] newWeightedCounts;
+                delete[] centerAugment;
+                delete[] newTCenterAugment;
+                delete[] newCenterAugment;
             }
 
             inline void ClearCounts() {
@@ -83,7 +98,36 @@ namespace SPTAG
             }
 
             inline void ClearCenters() {
-                memset(newCenters, 0, sizeof(float) * _T * _K * _D);
+                memset(newCenters, 0, sizeof(float) * _T * _K * _D * _B);
+                memset(newCenterAugment, 0, sizeof(float) * _T * _K);
+            }
+
+            inline void AddToCenter(float* center, const T* v) const {
+                if (_B == 1) {
+                    for (DimensionType j = 0; j < _D; j++) center[j] += v[j];
+                    return;
+                }
+                const std::uint8_t* bytes = (const std::uint8_t*)v;
+                for (size_t j = 0; j < sizeof(T) * _D; j++, center += 8) {
+                    for (int b = 0; b < 8; b++) center[b] += (bytes[j] >> b) & 1;
+                }
+            }
+
+            // Bitwise clusters take the majority value of every bit, which minimizes the summed Hamming distance.
+            inline void MajorityCenter(const float* bitCounts, SizeType count, T* center) const {
+                std::uint8_t* bytes = (std::uint8_t*)center;
+                for (size_t j = 0; j < sizeof(T) * _D; j++, bitCounts += 8) {
+                    std::uint8_t byte = 0;
+                    for (int b = 0; b < 8; b++) {
+                        if (bitCounts[b] * 2 > count) byte |= (std::uint8_t)(1 << b);
+                    }
+                    bytes[j] = byte;
+                }
+            }
+
+            inline float AugmentDistance(float pointAugment, int k) const {
+                float diff = pointAugment - centerAugment[k];
+                return diff * diff;
             }
 
             inline void ClearDists(float dist) {
@@ -139,14 +183,20 @@ namespace SPTAG
                         //while (args.label[nextid] != maxcluster) nextid = Utils::rand_int(last, first);
                         SizeType nextid = args.clusterIdx[maxcluster];
                         std::memcpy(TCenter, data[nextid], sizeof(T)*args._D);
+                        if (args.augment != nullptr) args.newTCenterAugment[k] = args.augment[nextid];
                     }
                     else {
                         std::memcpy(TCenter, args.centers + k * args._D, sizeof(T)*args._D);
+                        if (args.augment != nullptr) args.newTCenterAugment[k] = args.centerAugment[k];
                     }
                 }
+                else if (args._B > 1) {
+                    args.MajorityCenter(args.newCenters + ((size_t)k) * args._D * args._B, args.counts[k], TCenter);
+                }
                 else {
                     float* currCenters = args.newCenters + k * args._D;
                     for (DimensionType j = 0; j < args._D; j++) currCenters[j] /= args.counts[k];
+                    if (args.augment != nullptr) args.newTCenterAugment[k] = args.newCenterAugment[k] / args.counts[k];
 
                     if (args._M == DistCalcMethod::Cosine) {
                         COMMON::Utils::Normalize(currCenters, args._D, COMMON::Utils::GetBase<T>());
@@ -154,6 +204,7 @@ namespace SPTAG
                     for (DimensionType j = 0; j < args._D; j++) TCenter[j] = (T)(currCenters[j]);
                 }
                 diff += args.fComputeDistance(args.centers + k*args._D, TCenter, args._D);
+                if (args.augment != nullptr) diff += args.AugmentDistance(args.newTCenterAugment[k], k);
             }
             return diff;
         }
@@ -172,15 +223,18 @@ namespace SPTAG
                 SizeType istart = first + tid * subsize;
                 SizeType iend = min(first + (tid + 1) * subsize, last);
                 SizeType *inewCounts = args.newCounts + tid * args._K;
-                float *inewCenters = args.newCenters + tid * args._K * args._D;
+                float *inewCenters = args.newCenters + ((size_t)tid) * args._K * args._D * args._B;
                 SizeType * iclusterIdx = args.clusterIdx + tid * args._K;
                 float * iclusterDist = args.clusterDist + tid * args._K;
+                float * inewCenterAugment = args.newCenterAugment + tid * args._K;
                 float idist = 0;
                 for (SizeType i = istart; i < iend; i++) {
                     int clusterid = 0;
                     float smallestDist = MaxDist;
+                    float pointAugment = (args.augment == nullptr) ? 0 : args.augment[indices[i]];
                     for (int k = 0; k < args._DK; k++) {
                         float dist = args.fComputeDistance(data[indices[i]], args.centers + k*args._D, args._D) + lambda*args.counts[k];
+                        if (args.augment != nullptr) dist += args.AugmentDistance(pointAugment, k);
                         if (dist > -MaxDist && dist < smallestDist) {
                             clusterid = k; smallestDist = dist;
                         }
@@ -190,8 +244,8 @@ namespace SPTAG
                     idist += smallestDist;
                     if (updateCenters) {
                         const T* v = (const T*)data[indices[i]];
-                        float* center = inewCenters + clusterid*args._D;
-                        for (DimensionType j = 0; j < args._D; j++) center[j] += v[j];
+                        args.AddToCenter(inewCenters + ((size_t)clusterid) * args._D * args._B, v);
+                        inewCenterAugment[clusterid] += pointAugment;
                         if (smallestDist > iclusterDist[clusterid]) {
                             iclusterDist[clusterid] = smallestDist;
                             iclusterIdx[clusterid] = indices[i];
@@ -214,8 +268,9 @@ namespace SPTAG
 
             if (updateCenters) {
                 for (int i = 1; i < args._T; i++) {
-                    float* currCenter = args.newCenters + i*args._K*args._D;
-                    for (size_t j = 0; j < ((size_t)args._DK) * args._D; j++) args.newCenters[j] += currCenter[j];
+                    float* currCenter = args.newCenters + ((size_t)i) * args._K * args._D * args._B;
+                    for (size_t j = 0; j < ((size_t)args._DK) * args._D * args._B; j++) args.newCenters[j] += currCenter[j];
+                    for (int k = 0; k < args._DK; k++) args.newCenterAugment[k] += args.newCenterAugment[i*args._K + k];
 
                     for (int k = 0; k < args._DK; k++) {
                         if (args.clusterIdx[i*args._K + k] != -1 && args.clusterDist[i*args._K + k] > args.clusterDist[k]) {
@@ -248,6 +303,7 @@ namespace SPTAG
                 for (int k = 0; k < args._DK; k++) {
                     SizeType randid = COMMON::Utils::rand(last, first);
                     std::memcpy(args.centers + k*args._D, data[indices[randid]], sizeof(T)*args._D);
+                    if (args.augment != nullptr) args.centerAugment[k] = args.augment[indices[randid]];
                 }
                 args.ClearCounts();
                 args.ClearDists(MaxDist);
@@ -255,6 +311,7 @@ namespace SPTAG
                 if (currDist < minClusterDist) {
                     minClusterDist = currDist;
                     memcpy(args.newTCenters, args.centers, sizeof(T)*args._K*args._D);
+                    memcpy(args.newTCenterAugment, args.centerAugment, sizeof(float) * args._K);
                     memcpy(args.counts, args.newCounts, sizeof(SizeType) * args._K);
                 }
             }
@@ -272,6 +329,7 @@ namespace SPTAG
             int noImprovement = 0;
             for (int iter = 0; iter < 100; iter++) {
                 std::memcpy(args.centers, args.newTCenters, sizeof(T)*args._K*args._D);
+                std::memcpy(args.centerAugment, args.newTCenterAugment, sizeof(float) * args._K);
                 std::random_shuffle(indices.begin() + first, indices.begin() + last);
 
                 args.ClearCenters();
@@ -362,6 +420,19 @@ namespace SPTAG
                 }
                 KmeansArgs<T> args(m_iBKTKmeansK, data.C(), (SizeType)localindices.size(), numOfThreads, distMethod);
 
+                std::vector<float> augment;
+                if (distMethod == DistCalcMethod::InnerProduct) {
+                    auto fComputeInnerProduct = COMMON::DistanceCalcSelector<T>(DistCalcMethod::InnerProduct);
+                    float maxNormSquare = 0;
+                    augment.resize(data.R());
+                    for (SizeType id : localindices) {
+                        augment[id] = -fComputeInnerProduct(data[id], data[id], data.C());
+                        maxNormSquare = max(maxNormSquare, augment[id]);
+                    }
+                    for (SizeType id : localindices) augment[id] = DistanceUtils::ComputeNormAugmentation(augment[id], maxNormSquare);
+                    args.augment = augment.data();
+                }
+
                 m_pSampleCenterMap.clear();
                 for (char i = 0; i < m_iTreeNumber; i++)
                 {
@@ -487,29 +558,45 @@ namespace SPTAG
 
             template <typename T>
             void InitSearchTrees(const Dataset<T>& data, float(*fComputeDistance)(const T* pX, const T* pY, DimensionType length), const COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space) const
+            {
+                InitSearchTrees([&](SizeType index) { return fComputeDistance(p_query.GetTarget(), data[index], data.C()); }, p_space);
+            }
+
+            template <typename T>
+            void SearchTrees(const Dataset<T>& data, float(*fComputeDistance)(const T* pX, const T* pY, DimensionType length), const COMMON::QueryResultSet<T> &p_query,
+                COMMON::WorkSpace &p_space, const int p_limits) const
+            {
+                SearchTrees([&](SizeType index) { return fComputeDistance(p_query.GetTarget(), data[index], data.C()); }, p_space, p_limits);
+            }
+
+            // fDistanceToCenter(centerid) scores a tree center against the query, e.g. through a PQ lookup table.
+            template <typename F>
+            void InitSearchTrees(F fDistanceToCenter, COMMON::WorkSpace &p_space) const
             {
                 for (char i = 0; i < m_iTreeNumber; i++) {
                     const BKTNode& node = m_pTreeRoots[m_pTreeStart[i]];
                     if (node.childStart < 0) {
-                        p_space.m_SPTQueue.insert(COMMON::HeapCell(m_pTreeStart[i], fComputeDistance(p_query.GetTarget(), data[node.centerid], data.C())));
+                        p_space.m_SPTQueue.insert(COMMON::HeapCell(m_pTreeStart[i], fDistanceToCenter(node.centerid)));
+                        p_space.m_iNumberOfDistanceEvaluations++;
                     } 
                     else {
                         for (SizeType begin = node.childStart; begin < node.childEnd; begin++) {
                             SizeType index = m_pTreeRoots[begin].centerid;
-                            p_space.m_SPTQueue.insert(COMMON::HeapCell(begin, fComputeDistance(p_query.GetTarget(), data[index], data.C())));
+                            p_space.m_SPTQueue.insert(COMMON::HeapCell(begin, fDistanceToCenter(index)));
                         }
+                        p_space.m_iNumberOfDistanceEvaluations += node.childEnd - node.childStart;
                     } 
                 }
             }
 
-            template <typename T>
-            void SearchTrees(const Dataset<T>& data, float(*fComputeDistance)(const T* pX, const T* pY, DimensionType length), const COMMON::QueryResultSet<T> &p_query,
-                COMMON::WorkSpace &p_space, const int p_limits) const
+            template <typename F>
+            void SearchTrees(F fDistanceToCenter, COMMON::WorkSpace &p_space, const int p_limits) const
             {
                 while (!p_space.m_SPTQueue.empty())
                 {
                     COMMON::HeapCell bcell = p_space.m_SPTQueue.pop();
                     const BKTNode& tnode = m_pTreeRoots[bcell.node];
+                    p_space.m_iNumberOfTreeNodes++;
                     if (tnode.childStart < 0) {
                         if (!p_space.CheckAndSet(tnode.centerid)) {
                             p_space.m_iNumberOfCheckedLeaves++;
@@ -523,8 +610,9 @@ namespace SPTAG
                         }
                         for (SizeType begin = tnode.childStart; begin < tnode.childEnd; begin++) {
                             SizeType index = m_pTreeRoots[begin].centerid;
-                            p_space.m_SPTQueue.insert(COMMON::HeapCell(begin, fComputeDistance(p_query.GetTarget(), data[index], data.C())));
+                            p_space.m_SPTQueue.insert(COMMON::HeapCell(begin, fDistanceToCenter(index)));
                         } 
+                        p_space.m_iNumberOfDistanceEvaluations += tnode.childEnd - tnode.childStart;
                     }
                 }
             }
@@ -14,6 +14,7 @@
 #include <time.h>
 #include <omp.h>
 #include <string.h>
+#include <xmmintrin.h>
 
 #define PREFETCH
 
@@ -62,7 +63,8 @@ namespace SPTAG
 
             template<typename T>
             static inline int GetBase() {
-                if (GetEnumValueType<T>() != VectorValueType::Float) {
+                VectorValueType type = GetEnumValueType<T>();
+                if (type != VectorValueType::Float && type != VectorValueType::Float16 && type != VectorValueType::BFloat16 && type != VectorValueType::PackedBits) {
                     return (int)(std::numeric_limits<T>::max)();
                 }
                 return 1;
@@ -85,6 +87,9 @@ namespace SPTAG
                 }
             }
 
+            // Bit vectors have no length to scale, so Cosine leaves them as they are.
+            static void Normalize(PackedBits* arr, DimensionType col, int base) {}
+
             template <typename T>
             static void BatchNormalize(T* data, SizeType row, DimensionType col, int base, int threads) {
 #pragma omp parallel for num_threads(threads)
@@ -94,6 +99,14 @@ namespace SPTAG
                 }
             }
 
+            // Prefetches every cache line of [p_data, p_data + p_bytes).
+            static inline void PrefetchRange(const void* p_data, size_t p_bytes)
+            {
+                const char* end = (const char*)p_data + p_bytes;
+                for (const char* line = (const char*)((std::uintptr_t)p_data & ~(std::uintptr_t)63); line < end; line += 64)
+                    _mm_prefetch(line, _MM_HINT_T0);
+            }
+
             static inline void AddNeighbor(SizeType idx, float dist, SizeType *neighbors, float *dists, DimensionType size)
             {
                 size--;
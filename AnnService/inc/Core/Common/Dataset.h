@@ -173,6 +173,25 @@ namespace SPTAG
                 return ErrorCode::Success;
             }
 
+            // Reads past a saved dataset without keeping it, for streams that cannot seek.
+            static ErrorCode Skip(std::shared_ptr<Helper::DiskPriorityIO> p_input)
+            {
+                SizeType R;
+                DimensionType C;
+                IOBINARY(p_input, ReadBinary, sizeof(SizeType), (char*)&R);
+                IOBINARY(p_input, ReadBinary, sizeof(DimensionType), (char*)&C);
+
+                std::vector<char> buffer(1 << 20);
+                std::uint64_t remaining = sizeof(T) * ((std::uint64_t)R) * C;
+                while (remaining > 0) {
+                    std::uint64_t chunk = min(remaining, (std::uint64_t)buffer.size());
+                    IOBINARY(p_input, ReadBinary, chunk, buffer.data());
+                    remaining -= chunk;
+                }
+                LOG(Helper::LogLevel::LL_Info, "Skip (%d,%d) Finish!\n", R, C);
+                return ErrorCode::Success;
+            }
+
             ErrorCode Load(std::string sDataPointsFileName)
             {
                 LOG(Helper::LogLevel::LL_Info, "Load %s From %s\n", name.c_str(), sDataPointsFileName.c_str());
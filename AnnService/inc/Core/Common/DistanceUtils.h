@@ -5,7 +5,9 @@
 #define _SPTAG_COMMON_DISTANCEUTILS_H_
 
 #include <immintrin.h>
+#include <cmath>
 #include <functional>
+#include <type_traits>
 
 #include "CommonUtils.h"
 #include "InstructionUtils.h"
@@ -13,11 +15,16 @@
 #ifndef _MSC_VER
 #define DIFF128 diff128
 #define DIFF256 diff256
+#define UNROLL_FULLY _Pragma("GCC unroll 64")
 #else
 #define DIFF128 diff128.m128_f32
 #define DIFF256 diff256.m256_f32
+#define UNROLL_FULLY
 #endif
 
+// Dimensions with compile-time kernels, see FixedDimensionKernels
+#define FIXED_DIMENSIONS(Apply) Apply(64) Apply(96) Apply(100) Apply(128) Apply(256) Apply(384) Apply(512) Apply(768) Apply(1024)
+
 namespace SPTAG
 {
     namespace COMMON
@@ -25,6 +32,15 @@ namespace SPTAG
         template<typename T>
         float (*DistanceCalcSelector(SPTAG::DistCalcMethod p_method)) (const T*, const T*, DimensionType);
 
+        template<typename T>
+        void (*DistanceBatchCalcSelector(SPTAG::DistCalcMethod p_method)) (const T*, const T* const*, int, DimensionType, float*);
+
+        template<typename T>
+        float (*DistanceCalcSelector(SPTAG::DistCalcMethod p_method, DimensionType p_dimension)) (const T*, const T*, DimensionType);
+
+        template<typename T>
+        void (*DistanceBatchCalcSelector(SPTAG::DistCalcMethod p_method, DimensionType p_dimension)) (const T*, const T* const*, int, DimensionType, float*);
+
         class DistanceUtils
         {
         public:
@@ -198,6 +214,23 @@ namespace SPTAG
                 return _mm256_mul_ps(d, d);
             }
 
+            // Half precision loads widen to float lanes: bfloat16 is the upper half of a float,
+            // IEEE half needs F16C.
+            static inline __m128 _mm_loadu_bf16(const BFloat16* p)
+            {
+                return _mm_castsi128_ps(_mm_unpacklo_epi16(_mm_setzero_si128(), _mm_loadl_epi64((const __m128i*)p)));
+            }
+
+            static inline __m256 _mm256_loadu_bf16(const BFloat16* p)
+            {
+                return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)p)), 16));
+            }
+
+            static inline __m256 _mm256_loadu_fp16(const Float16* p)
+            {
+                return _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)p));
+            }
+
 #define REPEAT(type, ctype, delta, load, exec, acc, result) \
             { \
                 type c1 = load((ctype *)(pX)); \
@@ -453,8 +486,90 @@ namespace SPTAG
                 return diff;
             }
 
+            // Without F16C there is no vector conversion for IEEE halves, the SSE level reuses the scalar kernel.
+            static float ComputeL2Distance_SSE(const Float16* pX, const Float16* pY, DimensionType length)
+            {
+                return ComputeL2Distance(pX, pY, length);
+            }
+
+            static float ComputeL2Distance_AVX(const Float16* pX, const Float16* pY, DimensionType length)
+            {
+                const Float16* pEnd16 = pX + ((length >> 4) << 4);
+                const Float16* pEnd8 = pX + ((length >> 3) << 3);
+                const Float16* pEnd1 = pX + length;
+
+                __m256 diff256 = _mm256_setzero_ps();
+                while (pX < pEnd16)
+                {
+                    REPEAT(__m256, const Float16, 8, _mm256_loadu_fp16, _mm256_sqdf_ps, _mm256_add_ps, diff256)
+                        REPEAT(__m256, const Float16, 8, _mm256_loadu_fp16, _mm256_sqdf_ps, _mm256_add_ps, diff256)
+                }
+                while (pX < pEnd8)
+                {
+                    REPEAT(__m256, const Float16, 8, _mm256_loadu_fp16, _mm256_sqdf_ps, _mm256_add_ps, diff256)
+                }
+                __m128 diff128 = _mm_add_ps(_mm256_castps256_ps128(diff256), _mm256_extractf128_ps(diff256, 1));
+                float diff = DIFF128[0] + DIFF128[1] + DIFF128[2] + DIFF128[3];
+
+                while (pX < pEnd1) {
+                    float c1 = ((float)(*pX++) - (float)(*pY++)); diff += c1 * c1;
+                }
+                return diff;
+            }
+
+            static float ComputeL2Distance_SSE(const BFloat16* pX, const BFloat16* pY, DimensionType length)
+            {
+                const BFloat16* pEnd16 = pX + ((length >> 4) << 4);
+                const BFloat16* pEnd4 = pX + ((length >> 2) << 2);
+                const BFloat16* pEnd1 = pX + length;
+
+                __m128 diff128 = _mm_setzero_ps();
+                while (pX < pEnd16)
+                {
+                    REPEAT(__m128, const BFloat16, 4, _mm_loadu_bf16, _mm_sqdf_ps, _mm_add_ps, diff128)
+                        REPEAT(__m128, const BFloat16, 4, _mm_loadu_bf16, _mm_sqdf_ps, _mm_add_ps, diff128)
+                        REPEAT(__m128, const BFloat16, 4, _mm_loadu_bf16, _mm_sqdf_ps, _mm_add_ps, diff128)
+                        REPEAT(__m128, const BFloat16, 4, _mm_loadu_bf16, _mm_sqdf_ps, _mm_add_ps, diff128)
+                }
+                while (pX < pEnd4)
+                {
+                    REPEAT(__m128, const BFloat16, 4, _mm_loadu_bf16, _mm_sqdf_ps, _mm_add_ps, diff128)
+                }
+                float diff = DIFF128[0] + DIFF128[1] + DIFF128[2] + DIFF128[3];
+
+                while (pX < pEnd1) {
+                    float c1 = ((float)(*pX++) - (float)(*pY++)); diff += c1 * c1;
+                }
+                return diff;
+            }
+
+            static float ComputeL2Distance_AVX(const BFloat16* pX, const BFloat16* pY, DimensionType length)
+            {
+                const BFloat16* pEnd16 = pX + ((length >> 4) << 4);
+                const BFloat16* pEnd8 = pX + ((length >> 3) << 3);
+                const BFloat16* pEnd1 = pX + length;
+
+                __m256 diff256 = _mm256_setzero_ps();
+                while (pX < pEnd16)
+                {
+                    REPEAT(__m256, const BFloat16, 8, _mm256_loadu_bf16, _mm256_sqdf_ps, _mm256_add_ps, diff256)
+                        REPEAT(__m256, const BFloat16, 8, _mm256_loadu_bf16, _mm256_sqdf_ps, _mm256_add_ps, diff256)
+                }
+                while (pX < pEnd8)
+                {
+                    REPEAT(__m256, const BFloat16, 8, _mm256_loadu_bf16, _mm256_sqdf_ps, _mm256_add_ps, diff256)
+                }
+                __m128 diff128 = _mm_add_ps(_mm256_castps256_ps128(diff256), _mm256_extractf128_ps(diff256, 1));
+                float diff = DIFF128[0] + DIFF128[1] + DIFF128[2] + DIFF128[3];
+
+                while (pX < pEnd1) {
+                    float c1 = ((float)(*pX++) - (float)(*pY++)); diff += c1 * c1;
+                }
+                return diff;
+            }
+
             template <typename T>
-            static float ComputeCosineDistance(const T* pX, const T* pY, DimensionType length)
+            static float ComputeDotProduct(const T* pX, const T* pY, DimensionType length)
             {
                 const T* pEnd4 = pX + ((length >> 2) << 2);
                 const T* pEnd1 = pX + length;
@@ -469,11 +584,10 @@ namespace SPTAG
                     c1 = ((float)(*pX++) * (float)(*pY++)); diff += c1;
                 }
                 while (pX < pEnd1) diff += ((float)(*pX++) * (float)(*pY++));
-                int base = Utils::GetBase<T>();
-                return base * base - diff;
+                return diff;
             }
 
-            static float ComputeCosineDistance_SSE(const std::int8_t* pX, const std::int8_t* pY, DimensionType length)
+            static float ComputeDotProduct_SSE(const std::int8_t* pX, const std::int8_t* pY, DimensionType length)
             {
                 const std::int8_t* pEnd32 = pX + ((length >> 5) << 5);
                 const std::int8_t* pEnd16 = pX + ((length >> 4) << 4);
@@ -498,10 +612,10 @@ namespace SPTAG
                     c1 = ((float)(*pX++) * (float)(*pY++)); diff += c1;
                 }
                 while (pX < pEnd1) diff += ((float)(*pX++) * (float)(*pY++));
-                return 16129 - diff;
+                return diff;
             }
 
-            static float ComputeCosineDistance_AVX(const std::int8_t* pX, const std::int8_t* pY, DimensionType length)
+            static float ComputeDotProduct_AVX(const std::int8_t* pX, const std::int8_t* pY, DimensionType length)
             {
                 const std::int8_t* pEnd32 = pX + ((length >> 5) << 5);
                 const std::int8_t* pEnd16 = pX + ((length >> 4) << 4);
@@ -526,10 +640,10 @@ namespace SPTAG
                     c1 = ((float)(*pX++) * (float)(*pY++)); diff += c1;
                 }
                 while (pX < pEnd1) diff += ((float)(*pX++) * (float)(*pY++));
-                return 16129 - diff;
+                return diff;
             }
 
-            static float ComputeCosineDistance_SSE(const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length)
+            static float ComputeDotProduct_SSE(const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length)
             {
                 const std::uint8_t* pEnd32 = pX + ((length >> 5) << 5);
                 const std::uint8_t* pEnd16 = pX + ((length >> 4) << 4);
@@ -554,10 +668,10 @@ namespace SPTAG
                     c1 = ((float)(*pX++) * (float)(*pY++)); diff += c1;
                 }
                 while (pX < pEnd1) diff += ((float)(*pX++) * (float)(*pY++));
-                return 65025 - diff;
+                return diff;
             }
 
-            static float ComputeCosineDistance_AVX(const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length)
+            static float ComputeDotProduct_AVX(const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length)
             {
                 const std::uint8_t* pEnd32 = pX + ((length >> 5) << 5);
                 const std::uint8_t* pEnd16 = pX + ((length >> 4) << 4);
@@ -582,10 +696,10 @@ namespace SPTAG
                     c1 = ((float)(*pX++) * (float)(*pY++)); diff += c1;
                 }
                 while (pX < pEnd1) diff += ((float)(*pX++) * (float)(*pY++));
-                return 65025 - diff;
+                return diff;
             }
 
-            static float ComputeCosineDistance_SSE(const std::int16_t* pX, const std::int16_t* pY, DimensionType length)
+            static float ComputeDotProduct_SSE(const std::int16_t* pX, const std::int16_t* pY, DimensionType length)
             {
                 const std::int16_t* pEnd16 = pX + ((length >> 4) << 4);
                 const std::int16_t* pEnd8 = pX + ((length >> 3) << 3);
@@ -611,10 +725,10 @@ namespace SPTAG
                 }
 
                 while (pX < pEnd1) diff += ((float)(*pX++) * (float)(*pY++));
-                return  1073676289 - diff;
+                return diff;
             }
 
-            static float ComputeCosineDistance_AVX(const std::int16_t* pX, const std::int16_t* pY, DimensionType length)
+            static float ComputeDotProduct_AVX(const std::int16_t* pX, const std::int16_t* pY, DimensionType length)
             {
                 const std::int16_t* pEnd16 = pX + ((length >> 4) << 4);
                 const std::int16_t* pEnd8 = pX + ((length >> 3) << 3);
@@ -640,10 +754,10 @@ namespace SPTAG
                 }
 
                 while (pX < pEnd1) diff += ((float)(*pX++) * (float)(*pY++));
-                return  1073676289 - diff;
+                return diff;
             }
 
-            static float ComputeCosineDistance_SSE(const float* pX, const float* pY, DimensionType length)
+            static float ComputeDotProduct_SSE(const float* pX, const float* pY, DimensionType length)
             {
                 const float* pEnd16 = pX + ((length >> 4) << 4);
                 const float* pEnd4 = pX + ((length >> 2) << 2);
@@ -664,10 +778,10 @@ namespace SPTAG
                 float diff = DIFF128[0] + DIFF128[1] + DIFF128[2] + DIFF128[3];
 
                 while (pX < pEnd1) diff += (*pX++) * (*pY++);
-                return 1 - diff;
+                return diff;
             }
 
-            static float ComputeCosineDistance_AVX(const float* pX, const float* pY, DimensionType length)
+            static float ComputeDotProduct_AVX(const float* pX, const float* pY, DimensionType length)
             {
                 const float* pEnd16 = pX + ((length >> 4) << 4);
                 const float* pEnd4 = pX + ((length >> 2) << 2);
@@ -687,66 +801,1036 @@ namespace SPTAG
                 float diff = DIFF128[0] + DIFF128[1] + DIFF128[2] + DIFF128[3];
 
                 while (pX < pEnd1) diff += (*pX++) * (*pY++);
-                return 1 - diff;
+                return diff;
             }
 
-            template<typename T>
-            static inline float ComputeDistance(const T* p1, const T* p2, DimensionType length, SPTAG::DistCalcMethod distCalcMethod)
+            static float ComputeDotProduct_SSE(const Float16* pX, const Float16* pY, DimensionType length)
             {
-                auto func = DistanceCalcSelector<T>(distCalcMethod);
-                return func(p1, p2, length);
+                return ComputeDotProduct(pX, pY, length);
             }
 
-            static inline float ConvertCosineSimilarityToDistance(float cs)
+            static float ComputeDotProduct_AVX(const Float16* pX, const Float16* pY, DimensionType length)
             {
-                // Cosine similarity is in [-1, 1], the higher the value, the closer are the two vectors. 
-                // However, the tree is built and searched based on "distance" between two vectors, that's >=0. The smaller the value, the closer are the two vectors.
-                // So we do a linear conversion from a cosine similarity to a distance value.
-                return 1 - cs; //[1, 3]
-            }
+                const Float16* pEnd16 = pX + ((length >> 4) << 4);
+                const Float16* pEnd8 = pX + ((length >> 3) << 3);
+                const Float16* pEnd1 = pX + length;
 
-            static inline float ConvertDistanceBackToCosineSimilarity(float d)
-            {
-                return 1 - d;
+                __m256 diff256 = _mm256_setzero_ps();
+                while (pX < pEnd16)
+                {
+                    REPEAT(__m256, const Float16, 8, _mm256_loadu_fp16, _mm256_mul_ps, _mm256_add_ps, diff256)
+                        REPEAT(__m256, const Float16, 8, _mm256_loadu_fp16, _mm256_mul_ps, _mm256_add_ps, diff256)
+                }
+                while (pX < pEnd8)
+                {
+                    REPEAT(__m256, const Float16, 8, _mm256_loadu_fp16, _mm256_mul_ps, _mm256_add_ps, diff256)
+                }
+                __m128 diff128 = _mm_add_ps(_mm256_castps256_ps128(diff256), _mm256_extractf128_ps(diff256, 1));
+                float diff = DIFF128[0] + DIFF128[1] + DIFF128[2] + DIFF128[3];
+
+                while (pX < pEnd1) {
+                    diff += ((float)(*pX++) * (float)(*pY++));
+                }
+                return diff;
             }
-        };
 
-        template<typename T>
-        float (*DistanceCalcSelector(SPTAG::DistCalcMethod p_method)) (const T*, const T*, DimensionType)
-        {
-            bool isSize4 = (sizeof(T) == 4);
-            switch (p_method)
+            static float ComputeDotProduct_SSE(const BFloat16* pX, const BFloat16* pY, DimensionType length)
             {
-            case SPTAG::DistCalcMethod::Cosine:
-                if (InstructionSet::AVX2() || (isSize4 && InstructionSet::AVX()))
+                const BFloat16* pEnd16 = pX + ((length >> 4) << 4);
+                const BFloat16* pEnd4 = pX + ((length >> 2) << 2);
+                const BFloat16* pEnd1 = pX + length;
+
+                __m128 diff128 = _mm_setzero_ps();
+                while (pX < pEnd16)
                 {
-                    return &(DistanceUtils::ComputeCosineDistance_AVX);
+                    REPEAT(__m128, const BFloat16, 4, _mm_loadu_bf16, _mm_mul_ps, _mm_add_ps, diff128)
+                        REPEAT(__m128, const BFloat16, 4, _mm_loadu_bf16, _mm_mul_ps, _mm_add_ps, diff128)
+                        REPEAT(__m128, const BFloat16, 4, _mm_loadu_bf16, _mm_mul_ps, _mm_add_ps, diff128)
+                        REPEAT(__m128, const BFloat16, 4, _mm_loadu_bf16, _mm_mul_ps, _mm_add_ps, diff128)
                 }
-                else if (InstructionSet::SSE2() || (isSize4 && InstructionSet::SSE()))
+                while (pX < pEnd4)
                 {
-                    return &(DistanceUtils::ComputeCosineDistance_SSE);
+                    REPEAT(__m128, const BFloat16, 4, _mm_loadu_bf16, _mm_mul_ps, _mm_add_ps, diff128)
                 }
-                else {
-                    return &(DistanceUtils::ComputeCosineDistance);
+                float diff = DIFF128[0] + DIFF128[1] + DIFF128[2] + DIFF128[3];
+
+                while (pX < pEnd1) {
+                    diff += ((float)(*pX++) * (float)(*pY++));
                 }
+                return diff;
+            }
 
-            case SPTAG::DistCalcMethod::L2:
-                if (InstructionSet::AVX2() || (isSize4 && InstructionSet::AVX()))
+            static float ComputeDotProduct_AVX(const BFloat16* pX, const BFloat16* pY, DimensionType length)
+            {
+                const BFloat16* pEnd16 = pX + ((length >> 4) << 4);
+                const BFloat16* pEnd8 = pX + ((length >> 3) << 3);
+                const BFloat16* pEnd1 = pX + length;
+
+                __m256 diff256 = _mm256_setzero_ps();
+                while (pX < pEnd16)
                 {
-                    return &(DistanceUtils::ComputeL2Distance_AVX);
+                    REPEAT(__m256, const BFloat16, 8, _mm256_loadu_bf16, _mm256_mul_ps, _mm256_add_ps, diff256)
+                        REPEAT(__m256, const BFloat16, 8, _mm256_loadu_bf16, _mm256_mul_ps, _mm256_add_ps, diff256)
                 }
-                else if (InstructionSet::SSE2() || (isSize4 && InstructionSet::SSE()))
+                while (pX < pEnd8)
                 {
-                    return &(DistanceUtils::ComputeL2Distance_SSE);
+                    REPEAT(__m256, const BFloat16, 8, _mm256_loadu_bf16, _mm256_mul_ps, _mm256_add_ps, diff256)
                 }
-                else {
-                    return &(DistanceUtils::ComputeL2Distance);
+                __m128 diff128 = _mm_add_ps(_mm256_castps256_ps128(diff256), _mm256_extractf128_ps(diff256, 1));
+                float diff = DIFF128[0] + DIFF128[1] + DIFF128[2] + DIFF128[3];
+
+                while (pX < pEnd1) {
+                    diff += ((float)(*pX++) * (float)(*pY++));
                 }
-  
-            default:
-                break;
+                return diff;
             }
-            return nullptr;
+
+            // Bit kernels over the raw bytes of two vectors: CountBits<true> counts the set bits of x ^ y (the
+            // Hamming distance), CountBits<false> those of x & y (the dot product of two bit vectors).
+            template <bool IsXor>
+            static inline std::uint64_t CombineBits(std::uint64_t x, std::uint64_t y)
+            {
+                return IsXor ? (x ^ y) : (x & y);
+            }
+
+            static inline std::uint64_t Popcount64(std::uint64_t x)
+            {
+                x = x - ((x >> 1) & 0x5555555555555555ULL);
+                x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+                x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+                return (x * 0x0101010101010101ULL) >> 56;
+            }
+
+            template <bool IsXor>
+            static std::uint64_t CountBits(const std::uint8_t* pX, const std::uint8_t* pY, std::size_t bytes)
+            {
+                std::uint64_t count = 0;
+                std::size_t i = 0;
+                for (; i + 8 <= bytes; i += 8) {
+                    std::uint64_t x, y;
+                    std::memcpy(&x, pX + i, 8);
+                    std::memcpy(&y, pY + i, 8);
+                    count += Popcount64(CombineBits<IsXor>(x, y));
+                }
+                for (; i < bytes; i++) count += Popcount64(CombineBits<IsXor>(pX[i], pY[i]));
+                return count;
+            }
+
+            // every AVX capable CPU has popcnt
+            template <bool IsXor>
+            static std::uint64_t CountBits_AVX(const std::uint8_t* pX, const std::uint8_t* pY, std::size_t bytes)
+            {
+                std::uint64_t c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+                std::size_t i = 0;
+                for (; i + 32 <= bytes; i += 32) {
+                    std::uint64_t x[4], y[4];
+                    std::memcpy(x, pX + i, 32);
+                    std::memcpy(y, pY + i, 32);
+                    c0 += _mm_popcnt_u64(CombineBits<IsXor>(x[0], y[0]));
+                    c1 += _mm_popcnt_u64(CombineBits<IsXor>(x[1], y[1]));
+                    c2 += _mm_popcnt_u64(CombineBits<IsXor>(x[2], y[2]));
+                    c3 += _mm_popcnt_u64(CombineBits<IsXor>(x[3], y[3]));
+                }
+                for (; i + 8 <= bytes; i += 8) {
+                    std::uint64_t x, y;
+                    std::memcpy(&x, pX + i, 8);
+                    std::memcpy(&y, pY + i, 8);
+                    c0 += _mm_popcnt_u64(CombineBits<IsXor>(x, y));
+                }
+                for (; i < bytes; i++) c1 += _mm_popcnt_u32((unsigned int)CombineBits<IsXor>(pX[i], pY[i]));
+                return c0 + c1 + c2 + c3;
+            }
+
+            template <typename T>
+            static float ComputeHammingDistance(const T* pX, const T* pY, DimensionType length)
+            {
+                return (float)CountBits<true>((const std::uint8_t*)pX, (const std::uint8_t*)pY, sizeof(T) * length);
+            }
+
+            template <typename T>
+            static float ComputeHammingDistance_AVX(const T* pX, const T* pY, DimensionType length)
+            {
+                return (float)CountBits_AVX<true>((const std::uint8_t*)pX, (const std::uint8_t*)pY, sizeof(T) * length);
+            }
+
+            // PackedBits: the squared L2 distance between 0/1 vectors is their Hamming distance. SSE2 does not
+            // guarantee popcnt, so that level keeps the portable count.
+            static float ComputeL2Distance(const PackedBits* pX, const PackedBits* pY, DimensionType length) { return ComputeHammingDistance(pX, pY, length); }
+            static float ComputeL2Distance_SSE(const PackedBits* pX, const PackedBits* pY, DimensionType length) { return ComputeHammingDistance(pX, pY, length); }
+            static float ComputeL2Distance_AVX(const PackedBits* pX, const PackedBits* pY, DimensionType length) { return ComputeHammingDistance_AVX(pX, pY, length); }
+
+            static float ComputeDotProduct(const PackedBits* pX, const PackedBits* pY, DimensionType length)
+            {
+                return (float)CountBits<false>((const std::uint8_t*)pX, (const std::uint8_t*)pY, length);
+            }
+            static float ComputeDotProduct_SSE(const PackedBits* pX, const PackedBits* pY, DimensionType length) { return ComputeDotProduct(pX, pY, length); }
+            static float ComputeDotProduct_AVX(const PackedBits* pX, const PackedBits* pY, DimensionType length)
+            {
+                return (float)CountBits_AVX<false>((const std::uint8_t*)pX, (const std::uint8_t*)pY, length);
+            }
+
+            // Cosine distances are base^2 - x.y on vectors normalized to GetBase<T>(), inner product distances are -x.y.
+            template <typename T>
+            static float ComputeCosineDistance(const T* pX, const T* pY, DimensionType length)
+            {
+                int base = Utils::GetBase<T>();
+                return base * base - ComputeDotProduct(pX, pY, length);
+            }
+
+            template <typename T>
+            static float ComputeCosineDistance_SSE(const T* pX, const T* pY, DimensionType length)
+            {
+                int base = Utils::GetBase<T>();
+                return base * base - ComputeDotProduct_SSE(pX, pY, length);
+            }
+
+            template <typename T>
+            static float ComputeCosineDistance_AVX(const T* pX, const T* pY, DimensionType length)
+            {
+                int base = Utils::GetBase<T>();
+                return base * base - ComputeDotProduct_AVX(pX, pY, length);
+            }
+
+            template <typename T>
+            static float ComputeInnerProductDistance(const T* pX, const T* pY, DimensionType length)
+            {
+                return -ComputeDotProduct(pX, pY, length);
+            }
+
+            template <typename T>
+            static float ComputeInnerProductDistance_SSE(const T* pX, const T* pY, DimensionType length)
+            {
+                return -ComputeDotProduct_SSE(pX, pY, length);
+            }
+
+            template <typename T>
+            static float ComputeInnerProductDistance_AVX(const T* pX, const T* pY, DimensionType length)
+            {
+                return -ComputeDotProduct_AVX(pX, pY, length);
+            }
+
+            // AVX-512 kernels live in DistanceUtils.cpp, which is the only file compiled with AVX-512 enabled.
+            static float ComputeL2Distance_AVX512(const std::int8_t* pX, const std::int8_t* pY, DimensionType length);
+            static float ComputeL2Distance_AVX512(const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length);
+            static float ComputeL2Distance_AVX512(const std::int16_t* pX, const std::int16_t* pY, DimensionType length);
+            static float ComputeL2Distance_AVX512(const float* pX, const float* pY, DimensionType length);
+            static float ComputeL2Distance_AVX512(const Float16* pX, const Float16* pY, DimensionType length);
+            static float ComputeL2Distance_AVX512(const BFloat16* pX, const BFloat16* pY, DimensionType length);
+
+            static float ComputeDotProduct_AVX512(const std::int8_t* pX, const std::int8_t* pY, DimensionType length);
+            static float ComputeDotProduct_AVX512(const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length);
+            static float ComputeDotProduct_AVX512(const std::int16_t* pX, const std::int16_t* pY, DimensionType length);
+            static float ComputeDotProduct_AVX512(const float* pX, const float* pY, DimensionType length);
+            static float ComputeDotProduct_AVX512(const Float16* pX, const Float16* pY, DimensionType length);
+            static float ComputeDotProduct_AVX512(const BFloat16* pX, const BFloat16* pY, DimensionType length);
+
+            // AVX-512 bit counts: the BW version looks nibbles up with vpshufb, the VPOPCNTDQ one counts 64-bit lanes directly.
+            template <bool IsXor>
+            static std::uint64_t CountBits_AVX512(const std::uint8_t* pX, const std::uint8_t* pY, std::size_t bytes);
+            template <bool IsXor>
+            static std::uint64_t CountBits_AVX512VPOPCNTDQ(const std::uint8_t* pX, const std::uint8_t* pY, std::size_t bytes);
+
+            template <typename T>
+            static float ComputeHammingDistance_AVX512(const T* pX, const T* pY, DimensionType length)
+            {
+                return (float)CountBits_AVX512<true>((const std::uint8_t*)pX, (const std::uint8_t*)pY, sizeof(T) * length);
+            }
+
+            template <typename T>
+            static float ComputeHammingDistance_AVX512VPOPCNTDQ(const T* pX, const T* pY, DimensionType length)
+            {
+                return (float)CountBits_AVX512VPOPCNTDQ<true>((const std::uint8_t*)pX, (const std::uint8_t*)pY, sizeof(T) * length);
+            }
+
+            static float ComputeL2Distance_AVX512(const PackedBits* pX, const PackedBits* pY, DimensionType length) { return ComputeHammingDistance_AVX512(pX, pY, length); }
+            static float ComputeDotProduct_AVX512(const PackedBits* pX, const PackedBits* pY, DimensionType length)
+            {
+                return (float)CountBits_AVX512<false>((const std::uint8_t*)pX, (const std::uint8_t*)pY, length);
+            }
+
+            // Only PackedBits has VPOPCNTDQ L2 and dot product kernels, other types fall back to the AVX512 ones.
+            template <typename T>
+            static float ComputeL2Distance_AVX512VPOPCNTDQ(const T* pX, const T* pY, DimensionType length)
+            {
+                return ComputeL2Distance_AVX512(pX, pY, length);
+            }
+            static float ComputeL2Distance_AVX512VPOPCNTDQ(const PackedBits* pX, const PackedBits* pY, DimensionType length) { return ComputeHammingDistance_AVX512VPOPCNTDQ(pX, pY, length); }
+
+            template <typename T>
+            static float ComputeDotProduct_AVX512VPOPCNTDQ(const T* pX, const T* pY, DimensionType length)
+            {
+                return ComputeDotProduct_AVX512(pX, pY, length);
+            }
+            static float ComputeDotProduct_AVX512VPOPCNTDQ(const PackedBits* pX, const PackedBits* pY, DimensionType length)
+            {
+                return (float)CountBits_AVX512VPOPCNTDQ<false>((const std::uint8_t*)pX, (const std::uint8_t*)pY, length);
+            }
+
+            template <typename T>
+            static float ComputeCosineDistance_AVX512VPOPCNTDQ(const T* pX, const T* pY, DimensionType length)
+            {
+                int base = Utils::GetBase<T>();
+                return base * base - ComputeDotProduct_AVX512VPOPCNTDQ(pX, pY, length);
+            }
+
+            template <typename T>
+            static float ComputeInnerProductDistance_AVX512VPOPCNTDQ(const T* pX, const T* pY, DimensionType length)
+            {
+                return -ComputeDotProduct_AVX512VPOPCNTDQ(pX, pY, length);
+            }
+
+            // VNNI (vpdpbusd/vpdpwssd) variants exist for 8-bit values only, other types fall back to the AVX512 kernels.
+            template <typename T>
+            static float ComputeL2Distance_AVX512VNNI(const T* pX, const T* pY, DimensionType length)
+            {
+                return ComputeL2Distance_AVX512(pX, pY, length);
+            }
+            static float ComputeL2Distance_AVX512VNNI(const std::int8_t* pX, const std::int8_t* pY, DimensionType length);
+            static float ComputeL2Distance_AVX512VNNI(const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length);
+
+            template <typename T>
+            static float ComputeDotProduct_AVX512VNNI(const T* pX, const T* pY, DimensionType length)
+            {
+                return ComputeDotProduct_AVX512(pX, pY, length);
+            }
+            static float ComputeDotProduct_AVX512VNNI(const std::int8_t* pX, const std::int8_t* pY, DimensionType length);
+            static float ComputeDotProduct_AVX512VNNI(const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length);
+
+            template <typename T>
+            static float ComputeCosineDistance_AVX512(const T* pX, const T* pY, DimensionType length)
+            {
+                int base = Utils::GetBase<T>();
+                return base * base - ComputeDotProduct_AVX512(pX, pY, length);
+            }
+
+            template <typename T>
+            static float ComputeCosineDistance_AVX512VNNI(const T* pX, const T* pY, DimensionType length)
+            {
+                int base = Utils::GetBase<T>();
+                return base * base - ComputeDotProduct_AVX512VNNI(pX, pY, length);
+            }
+
+            template <typename T>
+            static float ComputeInnerProductDistance_AVX512(const T* pX, const T* pY, DimensionType length)
+            {
+                return -ComputeDotProduct_AVX512(pX, pY, length);
+            }
+
+            template <typename T>
+            static float ComputeInnerProductDistance_AVX512VNNI(const T* pX, const T* pY, DimensionType length)
+            {
+                return -ComputeDotProduct_AVX512VNNI(pX, pY, length);
+            }
+
+            // vdpbf16ps multiplies bfloat16 pairs directly, so only the BFloat16 dot product has a BF16 kernel.
+            template <typename T>
+            static float ComputeDotProduct_AVX512BF16(const T* pX, const T* pY, DimensionType length)
+            {
+                return ComputeDotProduct_AVX512(pX, pY, length);
+            }
+            static float ComputeDotProduct_AVX512BF16(const BFloat16* pX, const BFloat16* pY, DimensionType length);
+
+            template <typename T>
+            static float ComputeCosineDistance_AVX512BF16(const T* pX, const T* pY, DimensionType length)
+            {
+                int base = Utils::GetBase<T>();
+                return base * base - ComputeDotProduct_AVX512BF16(pX, pY, length);
+            }
+
+            template <typename T>
+            static float ComputeInnerProductDistance_AVX512BF16(const T* pX, const T* pY, DimensionType length)
+            {
+                return -ComputeDotProduct_AVX512BF16(pX, pY, length);
+            }
+
+            // One-to-many kernels: compute the distances from pQuery to count candidates into pOut.
+            // The AVX-512 versions keep each query chunk in registers while it is scored against
+            // four candidates at once and prefetch the candidates of the next pass.
+            static void ComputeL2DistanceBatch_AVX512(const std::int8_t* pQuery, const std::int8_t* const* pCandidates, int count, DimensionType length, float* pOut);
+            static void ComputeL2DistanceBatch_AVX512(const std::uint8_t* pQuery, const std::uint8_t* const* pCandidates, int count, DimensionType length, float* pOut);
+            static void ComputeL2DistanceBatch_AVX512(const std::int16_t* pQuery, const std::int16_t* const* pCandidates, int count, DimensionType length, float* pOut);
+            static void ComputeL2DistanceBatch_AVX512(const float* pQuery, const float* const* pCandidates, int count, DimensionType length, float* pOut);
+            static void ComputeL2DistanceBatch_AVX512(const Float16* pQuery, const Float16* const* pCandidates, int count, DimensionType length, float* pOut);
+            static void ComputeL2DistanceBatch_AVX512(const BFloat16* pQuery, const BFloat16* const* pCandidates, int count, DimensionType length, float* pOut);
+
+            static void ComputeDotProductBatch_AVX512(const std::int8_t* pQuery, const std::int8_t* const* pCandidates, int count, DimensionType length, float* pOut);
+            static void ComputeDotProductBatch_AVX512(const std::uint8_t* pQuery, const std::uint8_t* const* pCandidates, int count, DimensionType length, float* pOut);
+            static void ComputeDotProductBatch_AVX512(const std::int16_t* pQuery, const std::int16_t* const* pCandidates, int count, DimensionType length, float* pOut);
+            static void ComputeDotProductBatch_AVX512(const float* pQuery, const float* const* pCandidates, int count, DimensionType length, float* pOut);
+            static void ComputeDotProductBatch_AVX512(const Float16* pQuery, const Float16* const* pCandidates, int count, DimensionType length, float* pOut);
+            static void ComputeDotProductBatch_AVX512(const BFloat16* pQuery, const BFloat16* const* pCandidates, int count, DimensionType length, float* pOut);
+            static void ComputeL2DistanceBatch_AVX512(const PackedBits* pQuery, const PackedBits* const* pCandidates, int count, DimensionType length, float* pOut)
+            {
+                ComputeDistanceBatch_Loop<PackedBits, &ComputeL2Distance_AVX512>(pQuery, pCandidates, count, length, pOut);
+            }
+            static void ComputeDotProductBatch_AVX512(const PackedBits* pQuery, const PackedBits* const* pCandidates, int count, DimensionType length, float* pOut)
+            {
+                ComputeDistanceBatch_Loop<PackedBits, &ComputeDotProduct_AVX512>(pQuery, pCandidates, count, length, pOut);
+            }
+
+            template <typename T>
+            static void ComputeL2DistanceBatch_AVX512VNNI(const T* pQuery, const T* const* pCandidates, int count, DimensionType length, float* pOut)
+            {
+                ComputeL2DistanceBatch_AVX512(pQuery, pCandidates, count, length, pOut);
+            }
+            static void ComputeL2DistanceBatch_AVX512VNNI(const std::int8_t* pQuery, const std::int8_t* const* pCandidates, int count, DimensionType length, float* pOut);
+            static void ComputeL2DistanceBatch_AVX512VNNI(const std::uint8_t* pQuery, const std::uint8_t* const* pCandidates, int count, DimensionType length, float* pOut);
+
+            template <typename T>
+            static void ComputeDotProductBatch_AVX512VNNI(const T* pQuery, const T* const* pCandidates, int count, DimensionType length, float* pOut)
+            {
+                ComputeDotProductBatch_AVX512(pQuery, pCandidates, count, length, pOut);
+            }
+            static void ComputeDotProductBatch_AVX512VNNI(const std::int8_t* pQuery, const std::int8_t* const* pCandidates, int count, DimensionType length, float* pOut);
+            static void ComputeDotProductBatch_AVX512VNNI(const std::uint8_t* pQuery, const std::uint8_t* const* pCandidates, int count, DimensionType length, float* pOut);
+
+            template <typename T>
+            static void ComputeCosineDistanceBatch_AVX512(const T* pQuery, const T* const* pCandidates, int count, DimensionType length, float* pOut)
+            {
+                ComputeDotProductBatch_AVX512(pQuery, pCandidates, count, length, pOut);
+                int base = Utils::GetBase<T>();
+                for (int i = 0; i < count; i++) pOut[i] = base * base - pOut[i];
+            }
+
+            template <typename T>
+            static void ComputeCosineDistanceBatch_AVX512VNNI(const T* pQuery, const T* const* pCandidates, int count, DimensionType length, float* pOut)
+            {
+                ComputeDotProductBatch_AVX512VNNI(pQuery, pCandidates, count, length, pOut);
+                int base = Utils::GetBase<T>();
+                for (int i = 0; i < count; i++) pOut[i] = base * base - pOut[i];
+            }
+
+            template <typename T>
+            static void ComputeInnerProductDistanceBatch_AVX512(const T* pQuery, const T* const* pCandidates, int count, DimensionType length, float* pOut)
+            {
+                ComputeDotProductBatch_AVX512(pQuery, pCandidates, count, length, pOut);
+                for (int i = 0; i < count; i++) pOut[i] = -pOut[i];
+            }
+
+            template <typename T>
+            static void ComputeInnerProductDistanceBatch_AVX512VNNI(const T* pQuery, const T* const* pCandidates, int count, DimensionType length, float* pOut)
+            {
+                ComputeDotProductBatch_AVX512VNNI(pQuery, pCandidates, count, length, pOut);
+                for (int i = 0; i < count; i++) pOut[i] = -pOut[i];
+            }
+
+            template <typename T>
+            static void ComputeDotProductBatch_AVX512BF16(const T* pQuery, const T* const* pCandidates, int count, DimensionType length, float* pOut)
+            {
+                ComputeDotProductBatch_AVX512(pQuery, pCandidates, count, length, pOut);
+            }
+            static void ComputeDotProductBatch_AVX512BF16(const BFloat16* pQuery, const BFloat16* const* pCandidates, int count, DimensionType length, float* pOut);
+
+            template <typename T>
+            static void ComputeCosineDistanceBatch_AVX512BF16(const T* pQuery, const T* const* pCandidates, int count, DimensionType length, float* pOut)
+            {
+                ComputeDotProductBatch_AVX512BF16(pQuery, pCandidates, count, length, pOut);
+                int base = Utils::GetBase<T>();
+                for (int i = 0; i < count; i++) pOut[i] = base * base - pOut[i];
+            }
+
+            template <typename T>
+            static void ComputeInnerProductDistanceBatch_AVX512BF16(const T* pQuery, const T* const* pCandidates, int count, DimensionType length, float* pOut)
+            {
+                ComputeDotProductBatch_AVX512BF16(pQuery, pCandidates, count, length, pOut);
+                for (int i = 0; i < count; i++) pOut[i] = -pOut[i];
+            }
+
+            // Asymmetric distance of a product-quantized code: pTable holds, for every subvector, the distances
+            // from the query slice to the PQADCTableWidth centroids of that subspace, and the code scores as the
+            // sum of the entries it selects.
+            static const int PQADCTableWidth = 256;
+
+            static float ComputeADCDistance(const float* pTable, const std::uint8_t* pCode, DimensionType subvectors)
+            {
+                float diff = 0;
+                for (DimensionType m = 0; m < subvectors; m++, pTable += PQADCTableWidth) diff += pTable[pCode[m]];
+                return diff;
+            }
+
+            // vgatherdps fetches the entries of eight subvectors at once.
+            static float ComputeADCDistance_AVX2(const float* pTable, const std::uint8_t* pCode, DimensionType subvectors)
+            {
+                const __m256i offsets = _mm256_setr_epi32(0, PQADCTableWidth, 2 * PQADCTableWidth, 3 * PQADCTableWidth,
+                    4 * PQADCTableWidth, 5 * PQADCTableWidth, 6 * PQADCTableWidth, 7 * PQADCTableWidth);
+                const std::uint8_t* pEnd8 = pCode + ((subvectors >> 3) << 3);
+                const std::uint8_t* pEnd1 = pCode + subvectors;
+
+                __m256 diff256 = _mm256_setzero_ps();
+                while (pCode < pEnd8)
+                {
+                    __m256i idx = _mm256_add_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)pCode)), offsets);
+                    diff256 = _mm256_add_ps(diff256, _mm256_i32gather_ps(pTable, idx, 4));
+                    pCode += 8;
+                    pTable += 8 * PQADCTableWidth;
+                }
+                __m128 diff128 = _mm_add_ps(_mm256_castps256_ps128(diff256), _mm256_extractf128_ps(diff256, 1));
+                float diff = DIFF128[0] + DIFF128[1] + DIFF128[2] + DIFF128[3];
+
+                while (pCode < pEnd1) {
+                    diff += pTable[*pCode++];
+                    pTable += PQADCTableWidth;
+                }
+                return diff;
+            }
+
+            static float ComputeADCDistance_AVX512(const float* pTable, const std::uint8_t* pCode, DimensionType subvectors);
+
+            template <float(*ComputeADCFunc)(const float*, const std::uint8_t*, DimensionType)>
+            static void ComputeADCDistanceBatch_Loop(const float* pTable, const std::uint8_t* const* pCodes, int count, DimensionType subvectors, float* pOut)
+            {
+                for (int i = 0; i < count; i++)
+                {
+                    if (i + 2 < count) _mm_prefetch((const char*)pCodes[i + 2], _MM_HINT_T0);
+                    pOut[i] = ComputeADCFunc(pTable, pCodes[i], subvectors);
+                }
+            }
+
+            // Batch fallback for the narrower instruction sets: one kernel call per candidate,
+            // with the candidate after next prefetched while the current one is scored.
+            template <typename T, float(*ComputeDistanceFunc)(const T*, const T*, DimensionType)>
+            static void ComputeDistanceBatch_Loop(const T* pQuery, const T* const* pCandidates, int count, DimensionType length, float* pOut)
+            {
+                for (int i = 0; i < count; i++)
+                {
+                    if (i + 2 < count) _mm_prefetch((const char*)pCandidates[i + 2], _MM_HINT_T0);
+                    pOut[i] = ComputeDistanceFunc(pQuery, pCandidates[i], length);
+                }
+            }
+
+            template<typename T>
+            static inline float ComputeDistance(const T* p1, const T* p2, DimensionType length, SPTAG::DistCalcMethod distCalcMethod)
+            {
+                auto func = DistanceCalcSelector<T>(distCalcMethod);
+                return func(p1, p2, length);
+            }
+
+            template<typename T>
+            static inline void ComputeDistanceBatch(const T* pQuery, const T* const* pCandidates, int count, DimensionType length, float* pOut, SPTAG::DistCalcMethod distCalcMethod)
+            {
+                auto func = DistanceBatchCalcSelector<T>(distCalcMethod);
+                func(pQuery, pCandidates, count, length, pOut);
+            }
+
+            // Float kernels for a dimension D fixed at compile time: the loops have constant trip counts and are
+            // fully unrolled, the remainder steps are resolved at compile time and the length argument is ignored.
+            template <DimensionType D>
+            static float ComputeL2DistanceFixed_AVX(const float* pX, const float* pY, DimensionType /*length*/)
+            {
+                __m256 diff256 = _mm256_setzero_ps();
+                __m256 diff256b = _mm256_setzero_ps();
+                UNROLL_FULLY
+                for (DimensionType i = 0; i < D / 16; i++)
+                {
+                    REPEAT(__m256, const float, 8, _mm256_loadu_ps, _mm256_sqdf_ps, _mm256_add_ps, diff256)
+                    REPEAT(__m256, const float, 8, _mm256_loadu_ps, _mm256_sqdf_ps, _mm256_add_ps, diff256b)
+                }
+                diff256 = _mm256_add_ps(diff256, diff256b);
+                if (D % 16 >= 8) REPEAT(__m256, const float, 8, _mm256_loadu_ps, _mm256_sqdf_ps, _mm256_add_ps, diff256)
+                __m128 diff128 = _mm_add_ps(_mm256_castps256_ps128(diff256), _mm256_extractf128_ps(diff256, 1));
+                if (D % 8 >= 4) REPEAT(__m128, const float, 4, _mm_loadu_ps, _mm_sqdf_ps, _mm_add_ps, diff128)
+                float diff = DIFF128[0] + DIFF128[1] + DIFF128[2] + DIFF128[3];
+                for (DimensionType i = 0; i < D % 4; i++) {
+                    float c1 = pX[i] - pY[i]; diff += c1 * c1;
+                }
+                return diff;
+            }
+
+            template <DimensionType D>
+            static float ComputeDotProductFixed_AVX(const float* pX, const float* pY, DimensionType /*length*/)
+            {
+                __m256 diff256 = _mm256_setzero_ps();
+                __m256 diff256b = _mm256_setzero_ps();
+                UNROLL_FULLY
+                for (DimensionType i = 0; i < D / 16; i++)
+                {
+                    REPEAT(__m256, const float, 8, _mm256_loadu_ps, _mm256_mul_ps, _mm256_add_ps, diff256)
+                    REPEAT(__m256, const float, 8, _mm256_loadu_ps, _mm256_mul_ps, _mm256_add_ps, diff256b)
+                }
+                diff256 = _mm256_add_ps(diff256, diff256b);
+                if (D % 16 >= 8) REPEAT(__m256, const float, 8, _mm256_loadu_ps, _mm256_mul_ps, _mm256_add_ps, diff256)
+                __m128 diff128 = _mm_add_ps(_mm256_castps256_ps128(diff256), _mm256_extractf128_ps(diff256, 1));
+                if (D % 8 >= 4) REPEAT(__m128, const float, 4, _mm_loadu_ps, _mm_mul_ps, _mm_add_ps, diff128)
+                float diff = DIFF128[0] + DIFF128[1] + DIFF128[2] + DIFF128[3];
+                for (DimensionType i = 0; i < D % 4; i++) diff += pX[i] * pY[i];
+                return diff;
+            }
+
+            template <DimensionType D>
+            static float ComputeL2DistanceFixed_AVX512(const float* pX, const float* pY, DimensionType length);
+
+            template <DimensionType D>
+            static float ComputeDotProductFixed_AVX512(const float* pX, const float* pY, DimensionType length);
+
+            template <DimensionType D>
+            static void ComputeL2DistanceBatchFixed_AVX512(const float* pQuery, const float* const* pCandidates, int count, DimensionType length, float* pOut);
+
+            template <DimensionType D>
+            static void ComputeDotProductBatchFixed_AVX512(const float* pQuery, const float* const* pCandidates, int count, DimensionType length, float* pOut);
+
+            template <float(*ComputeDotProductFunc)(const float*, const float*, DimensionType)>
+            static float ComputeCosineDistanceFixed(const float* pX, const float* pY, DimensionType length)
+            {
+                return 1 - ComputeDotProductFunc(pX, pY, length);
+            }
+
+            template <float(*ComputeDotProductFunc)(const float*, const float*, DimensionType)>
+            static float ComputeInnerProductDistanceFixed(const float* pX, const float* pY, DimensionType length)
+            {
+                return -ComputeDotProductFunc(pX, pY, length);
+            }
+
+            template <void(*ComputeDotProductBatchFunc)(const float*, const float* const*, int, DimensionType, float*)>
+            static void ComputeCosineDistanceBatchFixed(const float* pQuery, const float* const* pCandidates, int count, DimensionType length, float* pOut)
+            {
+                ComputeDotProductBatchFunc(pQuery, pCandidates, count, length, pOut);
+                for (int i = 0; i < count; i++) pOut[i] = 1 - pOut[i];
+            }
+
+            template <void(*ComputeDotProductBatchFunc)(const float*, const float* const*, int, DimensionType, float*)>
+            static void ComputeInnerProductDistanceBatchFixed(const float* pQuery, const float* const* pCandidates, int count, DimensionType length, float* pOut)
+            {
+                ComputeDotProductBatchFunc(pQuery, pCandidates, count, length, pOut);
+                for (int i = 0; i < count; i++) pOut[i] = -pOut[i];
+            }
+
+            // Early-abandoning distances for the graph expansion, where candidates beyond the current worst result
+            // are only queued. fComputeDistance (the index's kernel) runs EarlyAbandonChunk dimensions at a time
+            // and the loop stops once the distance is known to exceed bound; the lower bound reached is returned.
+            static const DimensionType EarlyAbandonChunk = 64;
+
+            // L2 and Hamming partial sums only grow.
+            template<typename T>
+            static inline float ComputeMonotoneDistanceBounded(const T* pX, const T* pY, DimensionType length, float bound,
+                float(*fComputeDistance)(const T*, const T*, DimensionType))
+            {
+                float dist = 0;
+                for (DimensionType i = 0; i < length && dist <= bound; i += EarlyAbandonChunk) {
+                    dist += fComputeDistance(pX + i, pY + i, min(EarlyAbandonChunk, length - i));
+                }
+                return dist;
+            }
+
+            // Cosine (chunkBase = base^2) and InnerProduct (chunkBase = 0) distances are chunkBase - x.y. After a chunk
+            // the rest of the dot product lowers the distance by at most |x rest| * |y| (Cauchy-Schwarz), where
+            // pXRestNorms[c] is the norm of x past chunk c, see ComputeRestNorms.
+            template<typename T>
+            static inline float ComputeDotDistanceBounded(const T* pX, const T* pY, DimensionType length, float bound, float chunkBase,
+                const float* pXRestNorms, float yNorm, float(*fComputeDistance)(const T*, const T*, DimensionType))
+            {
+                float dist = chunkBase;
+                for (DimensionType i = 0, c = 0; i < length; i += EarlyAbandonChunk, c++) {
+                    dist += fComputeDistance(pX + i, pY + i, min(EarlyAbandonChunk, length - i)) - chunkBase;
+                    float lowerBound = dist - pXRestNorms[c] * yNorm;
+                    if (lowerBound > bound) return lowerBound;
+                }
+                return dist;
+            }
+
+            // Fills pRestNorms[c] with the norm of the dimensions of pX past chunk c, for ComputeDotDistanceBounded.
+            template<typename T>
+            static inline void ComputeRestNorms(const T* pX, DimensionType length, float chunkBase,
+                float(*fComputeDistance)(const T*, const T*, DimensionType), std::vector<float>& pRestNorms)
+            {
+                DimensionType chunks = (length + EarlyAbandonChunk - 1) / EarlyAbandonChunk;
+                pRestNorms.resize(chunks);
+                float rest = 0;
+                for (DimensionType c = chunks - 1; c >= 0; c--) {
+                    pRestNorms[c] = std::sqrt(max(rest, 0.0f));
+                    DimensionType i = c * EarlyAbandonChunk;
+                    rest += chunkBase - fComputeDistance(pX + i, pX + i, min(EarlyAbandonChunk, length - i));
+                }
+            }
+
+            // InnerProduct graphs and trees are built in the norm-augmented space x' = [x, sqrt(M - |x|^2)],
+            // where M bounds the squared norms of the data. There L2 ranks the data the way the inner
+            // product ranks a query [q, 0], and it is a proper metric for k-means and RNG pruning.
+            static inline float ComputeNormAugmentation(float normSquare, float maxNormSquare)
+            {
+                return (normSquare < maxNormSquare) ? std::sqrt(maxNormSquare - normSquare) : 0;
+            }
+
+            // Returns |x' - y'|^2 / 2 = M - x.y - sqrt(M - |x|^2) * sqrt(M - |y|^2) from the InnerProduct distance -x.y
+            // and the squared norms, for callers that keep the norms around.
+            static inline float ComputeNormAugmentedDistance(float innerProductDistance, float xx, float yy, float maxNormSquare)
+            {
+                return maxNormSquare + innerProductDistance -
+                    ComputeNormAugmentation(xx, maxNormSquare) * ComputeNormAugmentation(yy, maxNormSquare);
+            }
+
+            template<typename T>
+            static inline float ComputeNormAugmentedDistance(const T* pX, const T* pY, DimensionType length, float maxNormSquare,
+                float(*fComputeInnerProduct)(const T*, const T*, DimensionType))
+            {
+                float xx = -fComputeInnerProduct(pX, pX, length);
+                float yy = -fComputeInnerProduct(pY, pY, length);
+                return ComputeNormAugmentedDistance(fComputeInnerProduct(pX, pY, length), xx, yy, maxNormSquare);
+            }
+
+            static inline float ConvertCosineSimilarityToDistance(float cs)
+            {
+                // Cosine similarity is in [-1, 1], the higher the value, the closer are the two vectors. 
+                // However, the tree is built and searched based on "distance" between two vectors, that's >=0. The smaller the value, the closer are the two vectors.
+                // So we do a linear conversion from a cosine similarity to a distance value.
+                return 1 - cs; //[1, 3]
+            }
+
+            static inline float ConvertDistanceBackToCosineSimilarity(float d)
+            {
+                return 1 - d;
+            }
+        };
+
+        template<typename T>
+        float (*DistanceCalcSelector(SPTAG::DistCalcMethod p_method)) (const T*, const T*, DimensionType)
+        {
+            bool isSize4 = (sizeof(T) == 4);
+            bool isSize1 = (sizeof(T) == 1);
+            bool isBFloat16 = std::is_same<T, BFloat16>::value;
+            bool isPackedBits = std::is_same<T, PackedBits>::value;
+            // the Float16 AVX kernels need F16C for the conversion but no AVX2 integer instructions
+            bool useAVX = std::is_same<T, Float16>::value ? InstructionSet::F16C() : (InstructionSet::AVX2() || (isSize4 && InstructionSet::AVX()));
+            switch (p_method)
+            {
+            case SPTAG::DistCalcMethod::Cosine:
+                if (isPackedBits && InstructionSet::AVX512VPOPCNTDQ())
+                {
+                    return &(DistanceUtils::ComputeCosineDistance_AVX512VPOPCNTDQ);
+                }
+                else if (isBFloat16 && InstructionSet::AVX512BF16())
+                {
+                    return &(DistanceUtils::ComputeCosineDistance_AVX512BF16);
+                }
+                else if (isSize1 && InstructionSet::AVX512VNNI())
+                {
+                    return &(DistanceUtils::ComputeCosineDistance_AVX512VNNI);
+                }
+                else if (InstructionSet::AVX512())
+                {
+                    return &(DistanceUtils::ComputeCosineDistance_AVX512);
+                }
+                else if (useAVX)
+                {
+                    return &(DistanceUtils::ComputeCosineDistance_AVX);
+                }
+                else if (InstructionSet::SSE2() || (isSize4 && InstructionSet::SSE()))
+                {
+                    return &(DistanceUtils::ComputeCosineDistance_SSE);
+                }
+                else {
+                    return &(DistanceUtils::ComputeCosineDistance);
+                }
+
+            case SPTAG::DistCalcMethod::L2:
+                if (isPackedBits && InstructionSet::AVX512VPOPCNTDQ())
+                {
+                    return &(DistanceUtils::ComputeL2Distance_AVX512VPOPCNTDQ);
+                }
+                else if (isSize1 && InstructionSet::AVX512VNNI())
+                {
+                    return &(DistanceUtils::ComputeL2Distance_AVX512VNNI);
+                }
+                else if (InstructionSet::AVX512())
+                {
+                    return &(DistanceUtils::ComputeL2Distance_AVX512);
+                }
+                else if (useAVX)
+                {
+                    return &(DistanceUtils::ComputeL2Distance_AVX);
+                }
+                else if (InstructionSet::SSE2() || (isSize4 && InstructionSet::SSE()))
+                {
+                    return &(DistanceUtils::ComputeL2Distance_SSE);
+                }
+                else {
+                    return &(DistanceUtils::ComputeL2Distance);
+                }
+  
+            case SPTAG::DistCalcMethod::InnerProduct:
+                if (isPackedBits && InstructionSet::AVX512VPOPCNTDQ())
+                {
+                    return &(DistanceUtils::ComputeInnerProductDistance_AVX512VPOPCNTDQ);
+                }
+                else if (isBFloat16 && InstructionSet::AVX512BF16())
+                {
+                    return &(DistanceUtils::ComputeInnerProductDistance_AVX512BF16);
+                }
+                else if (isSize1 && InstructionSet::AVX512VNNI())
+                {
+                    return &(DistanceUtils::ComputeInnerProductDistance_AVX512VNNI);
+                }
+                else if (InstructionSet::AVX512())
+                {
+                    return &(DistanceUtils::ComputeInnerProductDistance_AVX512);
+                }
+                else if (useAVX)
+                {
+                    return &(DistanceUtils::ComputeInnerProductDistance_AVX);
+                }
+                else if (InstructionSet::SSE2() || (isSize4 && InstructionSet::SSE()))
+                {
+                    return &(DistanceUtils::ComputeInnerProductDistance_SSE);
+                }
+                else {
+                    return &(DistanceUtils::ComputeInnerProductDistance);
+                }
+
+            case SPTAG::DistCalcMethod::Hamming:
+                if (InstructionSet::AVX512VPOPCNTDQ())
+                {
+                    return &(DistanceUtils::ComputeHammingDistance_AVX512VPOPCNTDQ);
+                }
+                else if (InstructionSet::AVX512())
+                {
+                    return &(DistanceUtils::ComputeHammingDistance_AVX512);
+                }
+                else if (InstructionSet::AVX())
+                {
+                    return &(DistanceUtils::ComputeHammingDistance_AVX);
+                }
+                else {
+                    return &(DistanceUtils::ComputeHammingDistance);
+                }
+
+            default:
+                break;
+            }
+            return nullptr;
+        }
+
+        template<typename T>
+        void (*DistanceBatchCalcSelector(SPTAG::DistCalcMethod p_method)) (const T*, const T* const*, int, DimensionType, float*)
+        {
+            bool isSize4 = (sizeof(T) == 4);
+            bool isSize1 = (sizeof(T) == 1);
+            bool isBFloat16 = std::is_same<T, BFloat16>::value;
+            bool isPackedBits = std::is_same<T, PackedBits>::value;
+            bool useAVX = std::is_same<T, Float16>::value ? InstructionSet::F16C() : (InstructionSet::AVX2() || (isSize4 && InstructionSet::AVX()));
+            switch (p_method)
+            {
+            case SPTAG::DistCalcMethod::Cosine:
+                if (isPackedBits && InstructionSet::AVX512VPOPCNTDQ())
+                {
+                    return &(DistanceUtils::ComputeDistanceBatch_Loop<T, &DistanceUtils::ComputeCosineDistance_AVX512VPOPCNTDQ>);
+                }
+                else if (isBFloat16 && InstructionSet::AVX512BF16())
+                {
+                    return &(DistanceUtils::ComputeCosineDistanceBatch_AVX512BF16);
+                }
+                else if (isSize1 && InstructionSet::AVX512VNNI())
+                {
+                    return &(DistanceUtils::ComputeCosineDistanceBatch_AVX512VNNI);
+                }
+                else if (InstructionSet::AVX512())
+                {
+                    return &(DistanceUtils::ComputeCosineDistanceBatch_AVX512);
+                }
+                else if (useAVX)
+                {
+                    return &(DistanceUtils::ComputeDistanceBatch_Loop<T, &DistanceUtils::ComputeCosineDistance_AVX>);
+                }
+                else if (InstructionSet::SSE2() || (isSize4 && InstructionSet::SSE()))
+                {
+                    return &(DistanceUtils::ComputeDistanceBatch_Loop<T, &DistanceUtils::ComputeCosineDistance_SSE>);
+                }
+                else {
+                    return &(DistanceUtils::ComputeDistanceBatch_Loop<T, &DistanceUtils::ComputeCosineDistance>);
+                }
+
+            case SPTAG::DistCalcMethod::L2:
+                if (isPackedBits && InstructionSet::AVX512VPOPCNTDQ())
+                {
+                    return &(DistanceUtils::ComputeDistanceBatch_Loop<T, &DistanceUtils::ComputeL2Distance_AVX512VPOPCNTDQ>);
+                }
+                else if (isSize1 && InstructionSet::AVX512VNNI())
+                {
+                    return &(DistanceUtils::ComputeL2DistanceBatch_AVX512VNNI);
+                }
+                else if (InstructionSet::AVX512())
+                {
+                    return &(DistanceUtils::ComputeL2DistanceBatch_AVX512);
+                }
+                else if (useAVX)
+                {
+                    return &(DistanceUtils::ComputeDistanceBatch_Loop<T, &DistanceUtils::ComputeL2Distance_AVX>);
+                }
+                else if (InstructionSet::SSE2() || (isSize4 && InstructionSet::SSE()))
+                {
+                    return &(DistanceUtils::ComputeDistanceBatch_Loop<T, &DistanceUtils::ComputeL2Distance_SSE>);
+                }
+                else {
+                    return &(DistanceUtils::ComputeDistanceBatch_Loop<T, &DistanceUtils::ComputeL2Distance>);
+                }
+
+            case SPTAG::DistCalcMethod::InnerProduct:
+                if (isPackedBits && InstructionSet::AVX512VPOPCNTDQ())
+                {
+                    return &(DistanceUtils::ComputeDistanceBatch_Loop<T, &DistanceUtils::ComputeInnerProductDistance_AVX512VPOPCNTDQ>);
+                }
+                else if (isBFloat16 && InstructionSet::AVX512BF16())
+                {
+                    return &(DistanceUtils::ComputeInnerProductDistanceBatch_AVX512BF16);
+                }
+                else if (isSize1 && InstructionSet::AVX512VNNI())
+                {
+                    return &(DistanceUtils::ComputeInnerProductDistanceBatch_AVX512VNNI);
+                }
+                else if (InstructionSet::AVX512())
+                {
+                    return &(DistanceUtils::ComputeInnerProductDistanceBatch_AVX512);
+                }
+                else if (useAVX)
+                {
+                    return &(DistanceUtils::ComputeDistanceBatch_Loop<T, &DistanceUtils::ComputeInnerProductDistance_AVX>);
+                }
+                else if (InstructionSet::SSE2() || (isSize4 && InstructionSet::SSE()))
+                {
+                    return &(DistanceUtils::ComputeDistanceBatch_Loop<T, &DistanceUtils::ComputeInnerProductDistance_SSE>);
+                }
+                else {
+                    return &(DistanceUtils::ComputeDistanceBatch_Loop<T, &DistanceUtils::ComputeInnerProductDistance>);
+                }
+
+            case SPTAG::DistCalcMethod::Hamming:
+                if (InstructionSet::AVX512VPOPCNTDQ())
+                {
+                    return &(DistanceUtils::ComputeDistanceBatch_Loop<T, &DistanceUtils::ComputeHammingDistance_AVX512VPOPCNTDQ>);
+                }
+                else if (InstructionSet::AVX512())
+                {
+                    return &(DistanceUtils::ComputeDistanceBatch_Loop<T, &DistanceUtils::ComputeHammingDistance_AVX512>);
+                }
+                else if (InstructionSet::AVX())
+                {
+                    return &(DistanceUtils::ComputeDistanceBatch_Loop<T, &DistanceUtils::ComputeHammingDistance_AVX>);
+                }
+                else {
+                    return &(DistanceUtils::ComputeDistanceBatch_Loop<T, &DistanceUtils::ComputeHammingDistance>);
+                }
+
+            default:
+                break;
+            }
+            return nullptr;
+        }
+
+        inline float (*ADCCalcSelector()) (const float*, const std::uint8_t*, DimensionType)
+        {
+            if (InstructionSet::AVX512())
+            {
+                return &(DistanceUtils::ComputeADCDistance_AVX512);
+            }
+            else if (InstructionSet::AVX2())
+            {
+                return &(DistanceUtils::ComputeADCDistance_AVX2);
+            }
+            return &(DistanceUtils::ComputeADCDistance);
+        }
+
+        inline void (*ADCBatchCalcSelector()) (const float*, const std::uint8_t* const*, int, DimensionType, float*)
+        {
+            if (InstructionSet::AVX512())
+            {
+                return &(DistanceUtils::ComputeADCDistanceBatch_Loop<&DistanceUtils::ComputeADCDistance_AVX512>);
+            }
+            else if (InstructionSet::AVX2())
+            {
+                return &(DistanceUtils::ComputeADCDistanceBatch_Loop<&DistanceUtils::ComputeADCDistance_AVX2>);
+            }
+            return &(DistanceUtils::ComputeADCDistanceBatch_Loop<&DistanceUtils::ComputeADCDistance>);
+        }
+
+        // Compile-time dimension kernels for the L2, Cosine and InnerProduct methods of Float vectors at the AVX
+        // and AVX-512 levels; nullptr for anything else, which keeps the generic kernels.
+        template<typename T>
+        struct FixedDimensionKernels
+        {
+            static float (*Distance(SPTAG::DistCalcMethod, DimensionType)) (const T*, const T*, DimensionType) { return nullptr; }
+            static void (*Batch(SPTAG::DistCalcMethod, DimensionType)) (const T*, const T* const*, int, DimensionType, float*) { return nullptr; }
+        };
+
+        template<>
+        struct FixedDimensionKernels<float>
+        {
+            template <DimensionType D>
+            static float (*Distance(SPTAG::DistCalcMethod p_method)) (const float*, const float*, DimensionType)
+            {
+                bool avx512 = InstructionSet::AVX512();
+                switch (p_method)
+                {
+                case SPTAG::DistCalcMethod::L2:
+                    return avx512 ? &DistanceUtils::ComputeL2DistanceFixed_AVX512<D> : &DistanceUtils::ComputeL2DistanceFixed_AVX<D>;
+                case SPTAG::DistCalcMethod::Cosine:
+                    return avx512 ? &DistanceUtils::ComputeCosineDistanceFixed<&DistanceUtils::ComputeDotProductFixed_AVX512<D>> :
+                        &DistanceUtils::ComputeCosineDistanceFixed<&DistanceUtils::ComputeDotProductFixed_AVX<D>>;
+                case SPTAG::DistCalcMethod::InnerProduct:
+                    return avx512 ? &DistanceUtils::ComputeInnerProductDistanceFixed<&DistanceUtils::ComputeDotProductFixed_AVX512<D>> :
+                        &DistanceUtils::ComputeInnerProductDistanceFixed<&DistanceUtils::ComputeDotProductFixed_AVX<D>>;
+                default:
+                    return nullptr;
+                }
+            }
+
+            template <DimensionType D>
+            static void (*Batch(SPTAG::DistCalcMethod p_method)) (const float*, const float* const*, int, DimensionType, float*)
+            {
+                bool avx512 = InstructionSet::AVX512();
+                switch (p_method)
+                {
+                case SPTAG::DistCalcMethod::L2:
+                    return avx512 ? &DistanceUtils::ComputeL2DistanceBatchFixed_AVX512<D> :
+                        &DistanceUtils::ComputeDistanceBatch_Loop<float, &DistanceUtils::ComputeL2DistanceFixed_AVX<D>>;
+                case SPTAG::DistCalcMethod::Cosine:
+                    return avx512 ? &DistanceUtils::ComputeCosineDistanceBatchFixed<&DistanceUtils::ComputeDotProductBatchFixed_AVX512<D>> :
+                        &DistanceUtils::ComputeDistanceBatch_Loop<float, &DistanceUtils::ComputeCosineDistanceFixed<&DistanceUtils::ComputeDotProductFixed_AVX<D>>>;
+                case SPTAG::DistCalcMethod::InnerProduct:
+                    return avx512 ? &DistanceUtils::ComputeInnerProductDistanceBatchFixed<&DistanceUtils::ComputeDotProductBatchFixed_AVX512<D>> :
+                        &DistanceUtils::ComputeDistanceBatch_Loop<float, &DistanceUtils::ComputeInnerProductDistanceFixed<&DistanceUtils::ComputeDotProductFixed_AVX<D>>>;
+                default:
+                    return nullptr;
+                }
+            }
+
+            static float (*Distance(SPTAG::DistCalcMethod p_method, DimensionType p_dimension)) (const float*, const float*, DimensionType)
+            {
+                if (!InstructionSet::AVX()) return nullptr;
+                switch (p_dimension)
+                {
+#define DefineFixedDimension(D) case D: return Distance<D>(p_method);
+                FIXED_DIMENSIONS(DefineFixedDimension)
+#undef DefineFixedDimension
+                default:
+                    return nullptr;
+                }
+            }
+
+            static void (*Batch(SPTAG::DistCalcMethod p_method, DimensionType p_dimension)) (const float*, const float* const*, int, DimensionType, float*)
+            {
+                if (!InstructionSet::AVX()) return nullptr;
+                switch (p_dimension)
+                {
+#define DefineFixedDimension(D) case D: return Batch<D>(p_method);
+                FIXED_DIMENSIONS(DefineFixedDimension)
+#undef DefineFixedDimension
+                default:
+                    return nullptr;
+                }
+            }
+        };
+
+        // Kernels for vectors of p_dimension values: a compile-time kernel when there is one, else the generic selection.
+        template<typename T>
+        float (*DistanceCalcSelector(SPTAG::DistCalcMethod p_method, DimensionType p_dimension)) (const T*, const T*, DimensionType)
+        {
+            auto func = FixedDimensionKernels<T>::Distance(p_method, p_dimension);
+            return (func != nullptr) ? func : DistanceCalcSelector<T>(p_method);
+        }
+
+        template<typename T>
+        void (*DistanceBatchCalcSelector(SPTAG::DistCalcMethod p_method, DimensionType p_dimension)) (const T*, const T* const*, int, DimensionType, float*)
+        {
+            auto func = FixedDimensionKernels<T>::Batch(p_method, p_dimension);
+            return (func != nullptr) ? func : DistanceBatchCalcSelector<T>(p_method);
         }
     }
 }
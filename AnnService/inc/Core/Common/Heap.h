@@ -99,6 +99,180 @@ namespace SPTAG
                 if (next == count && heap[next] < heap[parent]) std::swap(heap[parent], heap[next]);
             }
         };
+
+        // Bounded priority queue for search candidates. It is a plain binary min-heap until it fills up; then it is
+        // rebuilt in O(n) into a min-max heap (even levels no larger than their descendants, odd levels no smaller),
+        // so evicting the largest element is O(log n) instead of a scan. clear() returns it to a binary heap.
+        template <typename T>
+        class MinMaxHeap {
+        public:
+            MinMaxHeap() : heap(nullptr), length(0), count(0), minmax(false) {}
+
+            MinMaxHeap(int size) { Resize(size); }
+
+            void Resize(int size)
+            {
+                length = size;
+                heap.reset(new T[length + 1]);  // heap uses 1-based indexing
+                count = 0;
+                minmax = false;
+            }
+            ~MinMaxHeap() {}
+            inline int size() { return count; }
+            inline bool empty() { return count == 0; }
+            inline void clear() { count = 0; minmax = false; }
+            inline T& Top() { if (count == 0) return heap[0]; else return heap[1]; }
+
+            // Insert a new element; when full it replaces the largest one unless it is larger itself.
+            void insert(const T& value)
+            {
+                if (count == length) {
+                    if (length == 0) return;
+                    if (!minmax) {
+                        for (int i = count >> 1; i >= 1; i--) TrickleDown(i);
+                        minmax = true;
+                    }
+                    int maxi = MaxIndex();
+                    if (heap[maxi] < value) return;
+                    /* Overwrite the largest: the root is the only smaller-level node above it. */
+                    heap[maxi] = value;
+                    if (maxi > 1) {
+                        if (heap[maxi] < heap[1]) std::swap(heap[1], heap[maxi]);
+                        TrickleDownLevel<true>(maxi);
+                    }
+                    return;
+                }
+                if (minmax) BubbleUp(++count, value);
+                else BubbleUpLevel<false, 1>(++count, value);
+            }
+            // Returns the node of minimum value from the heap (top of the heap).
+            bool pop(T& value)
+            {
+                if (count == 0) return false;
+                value = pop();
+                return true;
+            }
+            T& pop()
+            {
+                if (count == 0) return heap[0];
+                std::swap(heap[1], heap[count]);
+                count--;
+                if (count > 1) {
+                    if (minmax) TrickleDownLevel<false>(1);
+                    else SiftDown();
+                }
+                return heap[count + 1];  /* Return old min, parked past the end. */
+            }
+        private:
+            std::unique_ptr<T[]> heap;
+            int length;
+            int count;
+            bool minmax;
+
+            // Level of i is even iff its highest set bit is, which then outweighs all odd bits below it.
+            static inline bool IsMinLevel(int i)
+            {
+                return (i & 0x55555555) > (i & 0x2AAAAAAA);
+            }
+
+            inline int MaxIndex() const
+            {
+                if (count <= 2) return count;
+                return (heap[2] < heap[3]) ? 3 : 2;
+            }
+
+            // Binary heap: sinks the root into place.
+            void SiftDown()
+            {
+                T value = heap[1];
+                int parent = 1, next = 2;
+                while (next <= count) {
+                    if (next < count && heap[next + 1] < heap[next]) next++;
+                    if (!(heap[next] < value)) break;
+                    heap[parent] = heap[next];
+                    parent = next;
+                    next <<= 1;
+                }
+                heap[parent] = value;
+            }
+
+            // Min-max heap: places value, sitting in the hole at the end, on its path to the root.
+            void BubbleUp(int i, const T& value)
+            {
+                int parent = i >> 1;
+                if (i == 1) heap[i] = value;
+                else if (IsMinLevel(i)) {
+                    if (heap[parent] < value) {
+                        heap[i] = heap[parent];
+                        BubbleUpLevel<true, 2>(parent, value);
+                    }
+                    else BubbleUpLevel<false, 2>(i, value);
+                }
+                else {
+                    if (value < heap[parent]) {
+                        heap[i] = heap[parent];
+                        BubbleUpLevel<false, 2>(parent, value);
+                    }
+                    else BubbleUpLevel<true, 2>(i, value);
+                }
+            }
+
+            // Moves the hole at i up Step levels at a time (1 for the binary heap, 2 to stay on the max or min levels).
+            template <bool IsMax, int Step>
+            void BubbleUpLevel(int i, const T& value)
+            {
+                while (i >= (1 << Step) && Before<IsMax>(value, heap[i >> Step])) {
+                    heap[i] = heap[i >> Step];
+                    i >>= Step;
+                }
+                heap[i] = value;
+            }
+
+            void TrickleDown(int i)
+            {
+                if (IsMinLevel(i)) TrickleDownLevel<false>(i);
+                else TrickleDownLevel<true>(i);
+            }
+
+            template <bool IsMax>
+            void TrickleDownLevel(int i)
+            {
+                /* While all four grandchildren exist the best candidate is one of them, as each child bounds
+                   its own subtree from the other side; carry the sinking value in a hole instead of swapping. */
+                T value = heap[i];
+                int grandchild;
+                while ((grandchild = i << 2) + 3 <= count) {
+                    int a = Before<IsMax>(heap[grandchild + 1], heap[grandchild]) ? grandchild + 1 : grandchild;
+                    int b = Before<IsMax>(heap[grandchild + 3], heap[grandchild + 2]) ? grandchild + 3 : grandchild + 2;
+                    int m = Before<IsMax>(heap[b], heap[a]) ? b : a;
+                    if (!Before<IsMax>(heap[m], value)) break;
+                    heap[i] = heap[m];
+                    if (Before<IsMax>(heap[m >> 1], value)) std::swap(heap[m >> 1], value);
+                    i = m;
+                }
+                heap[i] = value;
+
+                while (true) {
+                    int m = i << 1;
+                    if (m > count) return;
+                    if (m < count && Before<IsMax>(heap[m + 1], heap[m])) m++;
+                    grandchild = i << 2;
+                    int end = min(grandchild + 3, count);
+                    for (int g = grandchild; g <= end; g++)
+                        if (Before<IsMax>(heap[g], heap[m])) m = g;
+
+                    if (!Before<IsMax>(heap[m], heap[i])) return;
+                    std::swap(heap[m], heap[i]);
+                    if (m < grandchild) return;
+                    if (Before<IsMax>(heap[m >> 1], heap[m])) std::swap(heap[m], heap[m >> 1]);
+                    i = m;
+                }
+            }
+
+            // Whether a belongs above b on a max level (IsMax) or a min level.
+            template <bool IsMax>
+            static inline bool Before(const T& a, const T& b) { return IsMax ? b < a : a < b; }
+        };
     }
 }
 
@@ -24,14 +24,42 @@ namespace SPTAG {
             class InstructionSet_Internal;
 
         public:
+            // Instruction set levels in ascending order, used to cap the kernels picked by DistanceCalcSelector.
+            enum class Level : int
+            {
+                NONE = 0,
+                SSE,
+                SSE2,
+                AVX,
+                AVX2,
+                AVX512,
+                AVX512VNNI,
+                AVX512BF16
+            };
+
             // getters
             static bool AVX(void);
             static bool SSE(void);
             static bool SSE2(void);
             static bool AVX2(void);
+            static bool AVX512(void);
+            static bool AVX512VNNI(void);
+            static bool AVX512BF16(void);
+            // F16C is a separate CPUID bit but is only used by the AVX kernels, so it is capped at the AVX level.
+            static bool F16C(void);
+            // VPOPCNTDQ is a separate CPUID bit that first shipped next to VNNI, so it is capped at the AVX512VNNI level.
+            static bool AVX512VPOPCNTDQ(void);
+
+            // Force distance kernels to use at most p_level even if the CPU supports more.
+            // Only affects selectors called afterwards, so set it before creating or loading indexes.
+            // The environment variable SPTAG_INSTRUCTION_SET (e.g. "AVX2") sets the initial value.
+            static void SetMaxLevel(Level p_level);
+            static Level GetMaxLevel(void);
+            static bool ParseLevel(const char* p_str, Level& p_level);
 
         private:
             static const InstructionSet_Internal CPU_Rep;
+            static Level s_maxLevel;
 
             class InstructionSet_Internal
             {
@@ -41,6 +69,11 @@ namespace SPTAG {
                 bool HW_SSE2;
                 bool HW_AVX;
                 bool HW_AVX2;
+                bool HW_AVX512;
+                bool HW_AVX512VNNI;
+                bool HW_AVX512BF16;
+                bool HW_F16C;
+                bool HW_AVX512VPOPCNTDQ;
             };
         };
     }
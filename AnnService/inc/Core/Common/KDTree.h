@@ -189,11 +189,13 @@ namespace SPTAG
 
                     ++p_space.m_iNumberOfTreeCheckedLeaves;
                     ++p_space.m_iNumberOfCheckedLeaves;
+                    ++p_space.m_iNumberOfDistanceEvaluations;
                     p_space.m_NGQueue.insert(COMMON::HeapCell(index, fComputeDistance(p_query.GetTarget(), data, p_data.C())));
                     return;
                 }
 
                 auto& tnode = m_pTreeRoots[node];
+                ++p_space.m_iNumberOfTreeNodes;
 
                 float diff = (p_query.GetTarget())[tnode.split_dim] - tnode.split_value;
                 float distanceBound = distBound + diff * diff;
@@ -70,7 +70,7 @@ namespace SPTAG
                     for (SizeType y = 0; y < m_iGraphSize; y++)
                     {
                         if ((idmap != nullptr && idmap->find(y) != idmap->end())) continue;
-                        float dist = index->ComputeDistance(index->GetSample(x), index->GetSample(y));
+                        float dist = index->ComputeDistance(x, y);
                         query.AddPoint(y, dist);
                     }
                     query.SortResult();
@@ -295,7 +295,7 @@ namespace SPTAG
                             {
                                 SizeType p1 = TptreeDataIndices[i][x];
                                 SizeType p2 = TptreeDataIndices[i][y];
-                                float dist = index->ComputeDistance(index->GetSample(p1), index->GetSample(p2));
+                                float dist = index->ComputeDistance(p1, p2);
                                 if (idmap != nullptr) {
                                     p1 = (idmap->find(p1) == idmap->end()) ? p1 : idmap->at(p1);
                                     p2 = (idmap->find(p2) == idmap->end()) ? p2 : idmap->at(p2);
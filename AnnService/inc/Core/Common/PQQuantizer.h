@@ -0,0 +1,237 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _SPTAG_COMMON_PQQUANTIZER_H_
+#define _SPTAG_COMMON_PQQUANTIZER_H_
+
+#include "CommonUtils.h"
+#include "DistanceUtils.h"
+#include "Dataset.h"
+
+#include <vector>
+
+namespace SPTAG
+{
+    namespace COMMON
+    {
+        // Product quantizer: a vector is cut into m_iSubvectors equal slices and each slice is replaced by
+        // the one-byte id of its nearest centroid, trained with k-means on that slice. Queries stay at full
+        // precision and score codes through a per-query table (asymmetric distance computation).
+        class PQQuantizer
+        {
+        public:
+            static const int KsPerSubvector = DistanceUtils::PQADCTableWidth;
+            static const SizeType TrainSamples = 64 * KsPerSubvector;
+            static const int TrainIterations = 16;
+
+            PQQuantizer() : m_iSubvectors(0), m_iSubDim(0)
+            {
+                m_fComputeADC = ADCCalcSelector();
+                m_fComputeADCBatch = ADCBatchCalcSelector();
+            }
+
+            inline bool Available() const { return m_iSubvectors > 0; }
+            inline DimensionType GetNumSubvectors() const { return m_iSubvectors; }
+            inline DimensionType GetFeatureDim() const { return m_iSubvectors * m_iSubDim; }
+            inline size_t ADCTableSize() const { return ((size_t)m_iSubvectors) * KsPerSubvector; }
+
+            template <typename T>
+            bool Train(const Dataset<T>& p_data, DimensionType p_subvectors)
+            {
+                DimensionType dim = p_data.C();
+                if (p_subvectors <= 0 || dim % p_subvectors != 0) {
+                    LOG(Helper::LogLevel::LL_Error, "Cannot split dimension %d into %d PQ subvectors!\n", dim, p_subvectors);
+                    m_iSubvectors = m_iSubDim = 0;
+                    m_codebooks.clear();
+                    return false;
+                }
+                m_iSubvectors = p_subvectors;
+                m_iSubDim = dim / p_subvectors;
+                m_codebooks.assign(ADCTableSize() * m_iSubDim, 0);
+
+                // draw the training sample without replacement, converted to float once
+                SizeType n = min(p_data.R(), TrainSamples);
+                std::vector<SizeType> ids(p_data.R());
+                for (SizeType i = 0; i < p_data.R(); i++) ids[i] = i;
+                for (SizeType i = 0; i < n; i++) std::swap(ids[i], ids[Utils::rand(p_data.R(), i)]);
+
+                std::vector<float> train(((size_t)n) * dim);
+                for (SizeType i = 0; i < n; i++) {
+                    const T* v = p_data[ids[i]];
+                    for (DimensionType j = 0; j < dim; j++) train[((size_t)i) * dim + j] = (float)v[j];
+                }
+
+#pragma omp parallel for schedule(dynamic)
+                for (DimensionType m = 0; m < m_iSubvectors; m++) {
+                    TrainSubspace(train.data(), n, dim, m);
+                }
+                LOG(Helper::LogLevel::LL_Info, "Train PQ (%d subvectors x %d dims) on %d samples Finish!\n", m_iSubvectors, m_iSubDim, n);
+                return true;
+            }
+
+            template <typename T>
+            void Encode(const T* p_vector, std::uint8_t* p_code) const
+            {
+                for (DimensionType m = 0; m < m_iSubvectors; m++) {
+                    const T* x = p_vector + m * m_iSubDim;
+                    const float* center = Codeword(m, 0);
+                    int best = 0;
+                    float bestDist = MaxDist;
+                    for (int k = 0; k < KsPerSubvector; k++, center += m_iSubDim) {
+                        float dist = 0;
+                        for (DimensionType j = 0; j < m_iSubDim; j++) {
+                            float diff = (float)x[j] - center[j];
+                            dist += diff * diff;
+                        }
+                        if (dist < bestDist) {
+                            bestDist = dist;
+                            best = k;
+                        }
+                    }
+                    p_code[m] = (std::uint8_t)best;
+                }
+            }
+
+            // Fills p_table (ADCTableSize() floats) so that ComputeDistance approximates the p_method distance
+            // from p_query. Cosine and InnerProduct entries are negated partial dot products; the base^2 of
+            // the cosine distance is folded into the first subvector.
+            template <typename T>
+            void BuildADCTable(const T* p_query, DistCalcMethod p_method, float* p_table) const
+            {
+                for (DimensionType m = 0; m < m_iSubvectors; m++) {
+                    const T* q = p_query + m * m_iSubDim;
+                    const float* center = Codeword(m, 0);
+                    float* row = p_table + ((size_t)m) * KsPerSubvector;
+                    for (int k = 0; k < KsPerSubvector; k++, center += m_iSubDim) {
+                        float dist = 0;
+                        if (p_method == DistCalcMethod::L2) {
+                            for (DimensionType j = 0; j < m_iSubDim; j++) {
+                                float diff = (float)q[j] - center[j];
+                                dist += diff * diff;
+                            }
+                        }
+                        else {
+                            for (DimensionType j = 0; j < m_iSubDim; j++) dist -= (float)q[j] * center[j];
+                        }
+                        row[k] = dist;
+                    }
+                }
+                if (p_method == DistCalcMethod::Cosine && m_iSubvectors > 0) {
+                    float baseSquare = (float)Utils::GetBase<T>() * Utils::GetBase<T>();
+                    for (int k = 0; k < KsPerSubvector; k++) p_table[k] += baseSquare;
+                }
+            }
+
+            inline float ComputeDistance(const float* p_table, const std::uint8_t* p_code) const
+            {
+                return m_fComputeADC(p_table, p_code, m_iSubvectors);
+            }
+
+            inline void ComputeDistanceBatch(const float* p_table, const std::uint8_t* const* p_codes, int p_count, float* p_out) const
+            {
+                m_fComputeADCBatch(p_table, p_codes, p_count, m_iSubvectors, p_out);
+            }
+
+            inline std::uint64_t BufferSize() const
+            {
+                return sizeof(DimensionType) * 2 + sizeof(float) * m_codebooks.size();
+            }
+
+            ErrorCode SaveQuantizer(std::shared_ptr<Helper::DiskPriorityIO> p_out) const
+            {
+                IOBINARY(p_out, WriteBinary, sizeof(DimensionType), (char*)&m_iSubvectors);
+                IOBINARY(p_out, WriteBinary, sizeof(DimensionType), (char*)&m_iSubDim);
+                IOBINARY(p_out, WriteBinary, sizeof(float) * m_codebooks.size(), (char*)m_codebooks.data());
+                LOG(Helper::LogLevel::LL_Info, "Save PQ codebooks (%d,%d) Finish!\n", m_iSubvectors, m_iSubDim);
+                return ErrorCode::Success;
+            }
+
+            ErrorCode LoadQuantizer(std::shared_ptr<Helper::DiskPriorityIO> p_input)
+            {
+                IOBINARY(p_input, ReadBinary, sizeof(DimensionType), (char*)&m_iSubvectors);
+                IOBINARY(p_input, ReadBinary, sizeof(DimensionType), (char*)&m_iSubDim);
+                m_codebooks.resize(ADCTableSize() * m_iSubDim);
+                IOBINARY(p_input, ReadBinary, sizeof(float) * m_codebooks.size(), (char*)m_codebooks.data());
+                LOG(Helper::LogLevel::LL_Info, "Load PQ codebooks (%d,%d) Finish!\n", m_iSubvectors, m_iSubDim);
+                return ErrorCode::Success;
+            }
+
+            ErrorCode LoadQuantizer(char* p_quantizerMemFile)
+            {
+                m_iSubvectors = *((DimensionType*)p_quantizerMemFile);
+                p_quantizerMemFile += sizeof(DimensionType);
+                m_iSubDim = *((DimensionType*)p_quantizerMemFile);
+                p_quantizerMemFile += sizeof(DimensionType);
+                m_codebooks.resize(ADCTableSize() * m_iSubDim);
+                std::memcpy(m_codebooks.data(), p_quantizerMemFile, sizeof(float) * m_codebooks.size());
+                LOG(Helper::LogLevel::LL_Info, "Load PQ codebooks (%d,%d) Finish!\n", m_iSubvectors, m_iSubDim);
+                return ErrorCode::Success;
+            }
+
+        private:
+            inline const float* Codeword(DimensionType p_subvector, int p_centroid) const
+            {
+                return m_codebooks.data() + (((size_t)p_subvector) * KsPerSubvector + p_centroid) * m_iSubDim;
+            }
+
+            // Lloyd iterations on one slice of the (already shuffled) training sample. With fewer samples
+            // than centroids the spare centroids repeat earlier ones and are never the unique nearest.
+            void TrainSubspace(const float* p_train, SizeType p_n, DimensionType p_dim, DimensionType p_subvector)
+            {
+                DimensionType offset = p_subvector * m_iSubDim;
+                float* centers = m_codebooks.data() + ((size_t)p_subvector) * KsPerSubvector * m_iSubDim;
+                int k = (int)min((SizeType)KsPerSubvector, p_n);
+                for (int c = 0; c < KsPerSubvector; c++) {
+                    std::memcpy(centers + ((size_t)c) * m_iSubDim, p_train + ((size_t)(c % k)) * p_dim + offset, sizeof(float) * m_iSubDim);
+                }
+
+                std::vector<float> sums(((size_t)k) * m_iSubDim);
+                std::vector<SizeType> counts(k);
+                for (int iter = 0; iter < TrainIterations; iter++) {
+                    std::fill(sums.begin(), sums.end(), 0.0f);
+                    std::fill(counts.begin(), counts.end(), 0);
+                    for (SizeType i = 0; i < p_n; i++) {
+                        const float* x = p_train + ((size_t)i) * p_dim + offset;
+                        int best = 0;
+                        float bestDist = MaxDist;
+                        for (int c = 0; c < k; c++) {
+                            const float* center = centers + ((size_t)c) * m_iSubDim;
+                            float dist = 0;
+                            for (DimensionType j = 0; j < m_iSubDim; j++) {
+                                float diff = x[j] - center[j];
+                                dist += diff * diff;
+                            }
+                            if (dist < bestDist) {
+                                bestDist = dist;
+                                best = c;
+                            }
+                        }
+                        counts[best]++;
+                        for (DimensionType j = 0; j < m_iSubDim; j++) sums[((size_t)best) * m_iSubDim + j] += x[j];
+                    }
+                    for (int c = 0; c < k; c++) {
+                        float* center = centers + ((size_t)c) * m_iSubDim;
+                        if (counts[c] == 0) {
+                            // reseed an empty cluster from a random sample
+                            std::memcpy(center, p_train + ((size_t)Utils::rand(p_n)) * p_dim + offset, sizeof(float) * m_iSubDim);
+                            continue;
+                        }
+                        for (DimensionType j = 0; j < m_iSubDim; j++) center[j] = sums[((size_t)c) * m_iSubDim + j] / counts[c];
+                    }
+                }
+                for (int c = k; c < KsPerSubvector; c++) {
+                    std::memcpy(centers + ((size_t)c) * m_iSubDim, centers + ((size_t)(c % k)) * m_iSubDim, sizeof(float) * m_iSubDim);
+                }
+            }
+
+            DimensionType m_iSubvectors;
+            DimensionType m_iSubDim;
+            std::vector<float> m_codebooks; // [subvector][centroid][dimension in slice]
+
+            float(*m_fComputeADC)(const float* pTable, const std::uint8_t* pCode, DimensionType subvectors);
+            void(*m_fComputeADCBatch)(const float* pTable, const std::uint8_t* const* pCodes, int count, DimensionType subvectors, float* pOut);
+        };
+    }
+}
+
+#endif // _SPTAG_COMMON_PQQUANTIZER_H_
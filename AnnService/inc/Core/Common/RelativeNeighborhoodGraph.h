@@ -24,7 +24,7 @@ namespace SPTAG
 
                     bool good = true;
                     for (DimensionType k = 0; k < count; k++) {
-                        if (index->ComputeDistance(index->GetSample(nodes[k]), index->GetSample(item.VID)) <= item.Dist) {
+                        if (index->ComputeDistance(nodes[k], item.VID) <= item.Dist) {
                             good = false;
                             break;
                         }
@@ -46,12 +46,12 @@ namespace SPTAG
                     tmpNode = nodes[k];
                     if (tmpNode < -1) break;
 
-                    if (tmpNode < 0 || (tmpDist = index->ComputeDistance(index->GetSample(node), index->GetSample(tmpNode))) > insertDist
+                    if (tmpNode < 0 || (tmpDist = index->ComputeDistance(node, tmpNode)) > insertDist
                         || (insertDist == tmpDist && insertNode < tmpNode))
                     {
                         bool good = true;
                         for (DimensionType t = 0; t < k; t++) {
-                            if (index->ComputeDistance(index->GetSample(insertNode), index->GetSample(nodes[t])) < insertDist) {
+                            if (index->ComputeDistance(insertNode, nodes[t]) < insertDist) {
                                 good = false;
                                 break;
                             }
@@ -59,8 +59,8 @@ namespace SPTAG
                         if (good) {
                             nodes[k] = insertNode;
                             while (tmpNode >= 0 && ++k < m_iNeighborhoodSize && nodes[k] >= -1 &&
-                                index->ComputeDistance(index->GetSample(tmpNode), index->GetSample(insertNode)) >=
-                                index->ComputeDistance(index->GetSample(node), index->GetSample(tmpNode)))
+                                index->ComputeDistance(tmpNode, insertNode) >=
+                                index->ComputeDistance(node, tmpNode))
                             {
                                 std::swap(tmpNode, nodes[k]);
                             }
@@ -0,0 +1,157 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _SPTAG_COMMON_SQ8QUANTIZER_H_
+#define _SPTAG_COMMON_SQ8QUANTIZER_H_
+
+#include "CommonUtils.h"
+#include "DistanceUtils.h"
+#include "Dataset.h"
+
+#include <vector>
+
+namespace SPTAG
+{
+    namespace COMMON
+    {
+        // 8-bit scalar quantizer: x[d] ~ m_mins[d] + m_fStep * code[d]. The offsets are trained per dimension
+        // while the step is shared, so the uint8 L2 and dot product kernels score two codes without any
+        // per-dimension weights. A code row is the m_iDimension code bytes followed by the float
+        // sum(m_mins[d] * code[d]), which corrects the code dot product for the offsets.
+        // Cosine distances assume vectors normalized to 1, which holds for the Float indexes this is meant for.
+        class SQ8Quantizer
+        {
+        public:
+            SQ8Quantizer() : m_iDimension(0), m_fStep(1), m_fMinNormSquare(0), m_iDistCalcMethod(DistCalcMethod::L2)
+            {
+                SetDistCalcMethod(m_iDistCalcMethod);
+            }
+
+            inline bool Available() const { return m_iDimension > 0; }
+            inline DimensionType GetFeatureDim() const { return m_iDimension; }
+            inline DimensionType CodeSize() const { return m_iDimension + (DimensionType)sizeof(float); }
+
+            void SetDistCalcMethod(DistCalcMethod p_method)
+            {
+                m_iDistCalcMethod = p_method;
+                DistCalcMethod codeMethod = (p_method == DistCalcMethod::L2) ? DistCalcMethod::L2 : DistCalcMethod::InnerProduct;
+                m_fComputeDistance = DistanceCalcSelector<std::uint8_t>(codeMethod);
+                m_fComputeDistanceBatch = DistanceBatchCalcSelector<std::uint8_t>(codeMethod);
+            }
+
+            template <typename T>
+            void Train(const Dataset<T>& p_data)
+            {
+                m_iDimension = p_data.C();
+                m_mins.assign(m_iDimension, MaxDist);
+                std::vector<float> maxs(m_iDimension, -MaxDist);
+                for (SizeType i = 0; i < p_data.R(); i++) {
+                    const T* v = p_data[i];
+                    for (DimensionType j = 0; j < m_iDimension; j++) {
+                        m_mins[j] = min(m_mins[j], (float)v[j]);
+                        maxs[j] = max(maxs[j], (float)v[j]);
+                    }
+                }
+
+                float range = 0;
+                m_fMinNormSquare = 0;
+                for (DimensionType j = 0; j < m_iDimension; j++) {
+                    range = max(range, maxs[j] - m_mins[j]);
+                    m_fMinNormSquare += m_mins[j] * m_mins[j];
+                }
+                m_fStep = (range > 0) ? range / 255 : 1;
+                LOG(Helper::LogLevel::LL_Info, "Train SQ8 (%d dims, step %f) on %d vectors Finish!\n", m_iDimension, m_fStep, p_data.R());
+            }
+
+            template <typename T>
+            void Encode(const T* p_vector, std::uint8_t* p_code) const
+            {
+                float offset = 0;
+                for (DimensionType j = 0; j < m_iDimension; j++) {
+                    float c = std::round(((float)p_vector[j] - m_mins[j]) / m_fStep);
+                    c = min(max(c, 0.0f), 255.0f);
+                    p_code[j] = (std::uint8_t)c;
+                    offset += m_mins[j] * c;
+                }
+                std::memcpy(p_code + m_iDimension, &offset, sizeof(float));
+            }
+
+            // Distance between two code rows in the units of the original vectors, for the method given to SetDistCalcMethod.
+            inline float ComputeDistance(const std::uint8_t* p_query, const std::uint8_t* p_code) const
+            {
+                return Finish(m_fComputeDistance(p_query, p_code, m_iDimension), p_query, p_code);
+            }
+
+            inline void ComputeDistanceBatch(const std::uint8_t* p_query, const std::uint8_t* const* p_codes, int p_count, float* p_out) const
+            {
+                m_fComputeDistanceBatch(p_query, p_codes, p_count, m_iDimension, p_out);
+                for (int i = 0; i < p_count; i++) p_out[i] = Finish(p_out[i], p_query, p_codes[i]);
+            }
+
+            inline std::uint64_t BufferSize() const
+            {
+                return sizeof(DimensionType) + sizeof(float) * (2 + m_mins.size());
+            }
+
+            ErrorCode SaveQuantizer(std::shared_ptr<Helper::DiskPriorityIO> p_out) const
+            {
+                IOBINARY(p_out, WriteBinary, sizeof(DimensionType), (char*)&m_iDimension);
+                IOBINARY(p_out, WriteBinary, sizeof(float), (char*)&m_fStep);
+                IOBINARY(p_out, WriteBinary, sizeof(float), (char*)&m_fMinNormSquare);
+                IOBINARY(p_out, WriteBinary, sizeof(float) * m_mins.size(), (char*)m_mins.data());
+                LOG(Helper::LogLevel::LL_Info, "Save SQ8 scales (%d) Finish!\n", m_iDimension);
+                return ErrorCode::Success;
+            }
+
+            ErrorCode LoadQuantizer(std::shared_ptr<Helper::DiskPriorityIO> p_input)
+            {
+                IOBINARY(p_input, ReadBinary, sizeof(DimensionType), (char*)&m_iDimension);
+                IOBINARY(p_input, ReadBinary, sizeof(float), (char*)&m_fStep);
+                IOBINARY(p_input, ReadBinary, sizeof(float), (char*)&m_fMinNormSquare);
+                m_mins.resize(m_iDimension);
+                IOBINARY(p_input, ReadBinary, sizeof(float) * m_mins.size(), (char*)m_mins.data());
+                LOG(Helper::LogLevel::LL_Info, "Load SQ8 scales (%d) Finish!\n", m_iDimension);
+                return ErrorCode::Success;
+            }
+
+            ErrorCode LoadQuantizer(char* p_quantizerMemFile)
+            {
+                m_iDimension = *((DimensionType*)p_quantizerMemFile);
+                p_quantizerMemFile += sizeof(DimensionType);
+                m_fStep = *((float*)p_quantizerMemFile);
+                p_quantizerMemFile += sizeof(float);
+                m_fMinNormSquare = *((float*)p_quantizerMemFile);
+                p_quantizerMemFile += sizeof(float);
+                m_mins.resize(m_iDimension);
+                std::memcpy(m_mins.data(), p_quantizerMemFile, sizeof(float) * m_mins.size());
+                LOG(Helper::LogLevel::LL_Info, "Load SQ8 scales (%d) Finish!\n", m_iDimension);
+                return ErrorCode::Success;
+            }
+
+        private:
+            // p_raw is the uint8 L2 distance, or the negated code dot product for Cosine and InnerProduct.
+            // x.y = sum(mins^2) + step * (offset(x) + offset(y)) + step^2 * code(x).code(y)
+            inline float Finish(float p_raw, const std::uint8_t* p_query, const std::uint8_t* p_code) const
+            {
+                if (m_iDistCalcMethod == DistCalcMethod::L2) return m_fStep * m_fStep * p_raw;
+
+                float queryOffset, codeOffset;
+                std::memcpy(&queryOffset, p_query + m_iDimension, sizeof(float));
+                std::memcpy(&codeOffset, p_code + m_iDimension, sizeof(float));
+                float dot = m_fMinNormSquare + m_fStep * (queryOffset + codeOffset) - m_fStep * m_fStep * p_raw;
+                return (m_iDistCalcMethod == DistCalcMethod::Cosine) ? 1 - dot : -dot;
+            }
+
+            DimensionType m_iDimension;
+            float m_fStep;
+            float m_fMinNormSquare;
+            std::vector<float> m_mins;
+
+            DistCalcMethod m_iDistCalcMethod;
+            float(*m_fComputeDistance)(const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length);
+            void(*m_fComputeDistanceBatch)(const std::uint8_t* pQuery, const std::uint8_t* const* pCandidates, int count, DimensionType length, float* pOut);
+        };
+    }
+}
+
+#endif // _SPTAG_COMMON_SQ8QUANTIZER_H_
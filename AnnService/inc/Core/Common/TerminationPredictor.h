@@ -0,0 +1,244 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _SPTAG_COMMON_TERMINATIONPREDICTOR_H_
+#define _SPTAG_COMMON_TERMINATIONPREDICTOR_H_
+
+#include "QueryResultSet.h"
+#include "inc/Helper/CommonHelper.h"
+#include "inc/Helper/StringConvert.h"
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace SPTAG
+{
+    namespace COMMON
+    {
+        static const int c_terminationFeatureCount = 4;
+
+        // A search's progress at one evaluation of the termination features.
+        struct TerminationTracePoint
+        {
+            float m_features[c_terminationFeatureCount];
+            int m_checked;
+            std::vector<SizeType> m_results;
+            // Recall of m_results, filled in by the caller from the ground truth.
+            float m_recall = 0;
+        };
+
+        // Per search state of the predictor, kept in the WorkSpace.
+        struct TerminationState
+        {
+            bool m_active = false;
+            int m_nextCheck = 0;
+            float m_firstDist = MaxDist;
+            float m_lastWorst = MaxDist;
+            int m_stale = 0;
+            std::vector<TerminationTracePoint>* m_trace = nullptr;
+
+            void Reset(bool p_active, std::vector<TerminationTracePoint>* p_trace = nullptr)
+            {
+                m_active = p_active || p_trace != nullptr;
+                m_nextCheck = 0;
+                m_firstDist = MaxDist;
+                m_lastWorst = MaxDist;
+                m_stale = 0;
+                m_trace = p_trace;
+            }
+        };
+
+        // Logistic model predicting from a search's progress whether its results have stopped improving, so the
+        // search can end before MaxCheck. It is evaluated every c_interval checked vectors once the result set is
+        // full, on: log2 of the vectors checked, the improvement of the worst result over the first candidate
+        // popped and over the previous evaluation (both relative), and the evaluations since it last improved.
+        class TerminationPredictor
+        {
+        public:
+            static const int c_interval = 64;
+
+            inline bool Enabled() const { return m_enabled; }
+
+            // p_model is "bias,w0,w1,w2,w3", empty to disable; p_threshold is the probability to stop at.
+            bool Load(const std::string& p_model, float p_threshold)
+            {
+                m_enabled = false;
+                if (p_model.empty()) return true;
+
+                std::vector<std::string> items = Helper::StrUtils::SplitString(p_model, ",");
+                if (items.size() != c_terminationFeatureCount + 1 || p_threshold <= 0 || p_threshold >= 1) return false;
+                for (int i = 0; i <= c_terminationFeatureCount; i++)
+                {
+                    if (!Helper::Convert::ConvertStringTo<float>(items[i].c_str(), m_weights[i])) return false;
+                }
+                m_logitThreshold = std::log(p_threshold / (1 - p_threshold));
+                m_enabled = true;
+                return true;
+            }
+
+            // Call for every popped candidate; true once the search should stop. Traced searches never stop early.
+            template <typename T>
+            inline bool ShouldStop(TerminationState& p_state, int p_checked, float p_distance, const QueryResultSet<T>& p_query) const
+            {
+                if (p_state.m_firstDist == MaxDist) p_state.m_firstDist = p_distance;
+                if (p_checked < p_state.m_nextCheck) return false;
+
+                p_state.m_nextCheck = p_checked + c_interval;
+                float worst = p_query.worstDist();
+                if (worst == MaxDist) return false;
+
+                float features[c_terminationFeatureCount];
+                Evaluate(p_state, worst, p_checked, features);
+                if (p_state.m_trace != nullptr)
+                {
+                    Record(p_state, p_checked, features, p_query);
+                    return false;
+                }
+                return Score(m_weights, features) >= m_logitThreshold;
+            }
+
+            // Appends the final state of a traced search.
+            template <typename T>
+            static void Finish(TerminationState& p_state, int p_checked, const QueryResultSet<T>& p_query)
+            {
+                float features[c_terminationFeatureCount];
+                Evaluate(p_state, p_query.worstDist(), p_checked, features);
+                Record(p_state, p_checked, features, p_query);
+            }
+
+            // Fits the model to one trace per query, each ending with its full search, then picks the threshold
+            // with the fewest checked vectors whose simulated mean recall reaches p_targetRecall.
+            static bool Calibrate(const std::vector<std::vector<TerminationTracePoint>>& p_traces, float p_targetRecall,
+                std::string& p_model, float& p_threshold, float& p_recall, float& p_checked)
+            {
+                std::vector<const TerminationTracePoint*> samples;
+                std::vector<float> labels;
+                for (const auto& trace : p_traces)
+                {
+                    if (trace.empty()) continue;
+                    for (size_t i = 0; i + 1 < trace.size(); i++)
+                    {
+                        samples.push_back(&trace[i]);
+                        labels.push_back(trace[i].m_recall >= trace.back().m_recall ? 1.0f : 0.0f);
+                    }
+                }
+                if (samples.empty()) return false;
+
+                // Logistic regression by gradient descent on standardized features.
+                float mean[c_terminationFeatureCount] = { 0 }, scale[c_terminationFeatureCount] = { 0 };
+                for (const TerminationTracePoint* sample : samples)
+                    for (int j = 0; j < c_terminationFeatureCount; j++) mean[j] += sample->m_features[j];
+                for (int j = 0; j < c_terminationFeatureCount; j++) mean[j] /= samples.size();
+                for (const TerminationTracePoint* sample : samples)
+                    for (int j = 0; j < c_terminationFeatureCount; j++) scale[j] += (sample->m_features[j] - mean[j]) * (sample->m_features[j] - mean[j]);
+                for (int j = 0; j < c_terminationFeatureCount; j++)
+                {
+                    scale[j] = std::sqrt(scale[j] / samples.size());
+                    if (scale[j] < 1e-6f) scale[j] = 1;
+                }
+
+                double weights[c_terminationFeatureCount + 1] = { 0 };
+                for (int epoch = 0; epoch < 500; epoch++)
+                {
+                    double gradient[c_terminationFeatureCount + 1] = { 0 };
+                    for (size_t i = 0; i < samples.size(); i++)
+                    {
+                        double z = weights[0];
+                        for (int j = 0; j < c_terminationFeatureCount; j++) z += weights[j + 1] * (samples[i]->m_features[j] - mean[j]) / scale[j];
+                        double error = 1 / (1 + std::exp(-z)) - labels[i];
+                        gradient[0] += error;
+                        for (int j = 0; j < c_terminationFeatureCount; j++) gradient[j + 1] += error * (samples[i]->m_features[j] - mean[j]) / scale[j];
+                    }
+                    for (int j = 0; j <= c_terminationFeatureCount; j++) weights[j] -= 0.5 * gradient[j] / samples.size();
+                }
+
+                float model[c_terminationFeatureCount + 1];
+                model[0] = (float)weights[0];
+                for (int j = 0; j < c_terminationFeatureCount; j++)
+                {
+                    model[j + 1] = (float)(weights[j + 1] / scale[j]);
+                    model[0] -= model[j + 1] * mean[j];
+                }
+
+                // Replays each trace to its first point scoring above the threshold.
+                bool found = false;
+                for (int step = 0; step < 100; step++)
+                {
+                    float threshold = 0.5f + 0.005f * step;
+                    float logit = std::log(threshold / (1 - threshold)), recall = 0, checked = 0;
+                    int count = 0;
+                    for (const auto& trace : p_traces)
+                    {
+                        if (trace.empty()) continue;
+                        size_t stop = 0;
+                        while (stop + 1 < trace.size() && Score(model, trace[stop].m_features) < logit) stop++;
+                        recall += trace[stop].m_recall;
+                        checked += trace[stop].m_checked;
+                        count++;
+                    }
+                    recall /= count;
+                    checked /= count;
+                    if (recall >= p_targetRecall && (!found || checked < p_checked))
+                    {
+                        found = true;
+                        p_threshold = threshold;
+                        p_recall = recall;
+                        p_checked = checked;
+                    }
+                }
+                if (!found) return false;
+
+                // Full precision, std::to_string would round small weights away.
+                p_model.clear();
+                char buffer[32];
+                for (int j = 0; j <= c_terminationFeatureCount; j++)
+                {
+                    std::snprintf(buffer, sizeof(buffer), j > 0 ? ",%.9g" : "%.9g", model[j]);
+                    p_model += buffer;
+                }
+                return true;
+            }
+
+        private:
+            static void Evaluate(TerminationState& p_state, float p_worst, int p_checked, float* p_features)
+            {
+                if (p_worst < p_state.m_lastWorst) p_state.m_stale = 0;
+                else p_state.m_stale++;
+
+                p_features[0] = std::log2(1.0f + p_checked);
+                p_features[1] = (p_state.m_firstDist - p_worst) / (std::fabs(p_state.m_firstDist) + 1e-6f);
+                p_features[2] = (p_state.m_lastWorst == MaxDist) ? 1.0f : (p_state.m_lastWorst - p_worst) / (std::fabs(p_state.m_lastWorst) + 1e-6f);
+                p_features[3] = (float)p_state.m_stale;
+                p_state.m_lastWorst = p_worst;
+            }
+
+            template <typename T>
+            static void Record(TerminationState& p_state, int p_checked, const float* p_features, const QueryResultSet<T>& p_query)
+            {
+                p_state.m_trace->emplace_back();
+                TerminationTracePoint& point = p_state.m_trace->back();
+                for (int j = 0; j < c_terminationFeatureCount; j++) point.m_features[j] = p_features[j];
+                point.m_checked = p_checked;
+                for (int i = 0; i < p_query.GetResultNum(); i++)
+                {
+                    if (p_query.GetResult(i)->VID >= 0) point.m_results.push_back(p_query.GetResult(i)->VID);
+                }
+            }
+
+            static inline float Score(const float* p_weights, const float* p_features)
+            {
+                float score = p_weights[0];
+                for (int j = 0; j < c_terminationFeatureCount; j++) score += p_weights[j + 1] * p_features[j];
+                return score;
+            }
+
+            bool m_enabled = false;
+            float m_weights[c_terminationFeatureCount + 1] = { 0 };
+            float m_logitThreshold = 0;
+        };
+    }
+}
+
+#endif // _SPTAG_COMMON_TERMINATIONPREDICTOR_H_
@@ -6,9 +6,15 @@
 
 #include "CommonUtils.h"
 #include "Heap.h"
+#include "TerminationPredictor.h"
+#include "../SearchQuery.h"
+
+#include <vector>
 
 namespace SPTAG
 {
+    class SearchFilter;
+
     namespace COMMON
     {
         // node type in the priority queue
@@ -94,6 +100,11 @@ namespace SPTAG
             }
 
 
+            inline SizeType Capacity() const
+            {
+                return (m_poolSize + 1) * 2;
+            }
+
             inline bool CheckAndSet(SizeType idx)
             {
                 // Inner Index is begin from 1
@@ -133,6 +144,41 @@ namespace SPTAG
                 return -1;
             }
         };
+
+        // Visited set with one epoch stamp per vector: clear() only advances the epoch and the
+        // stamps are wiped when it wraps. Costs 2 bytes per vector and grows with the index.
+        class OptEpochPosVector
+        {
+        protected:
+            std::vector<std::uint16_t> m_stamps;
+
+            std::uint16_t m_epoch = 1;
+
+        public:
+            void Init(SizeType size)
+            {
+                m_stamps.assign(size, 0);
+                m_epoch = 1;
+            }
+
+            void clear()
+            {
+                if (++m_epoch == 0)
+                {
+                    std::fill(m_stamps.begin(), m_stamps.end(), (std::uint16_t)0);
+                    m_epoch = 1;
+                }
+            }
+
+            inline bool CheckAndSet(SizeType idx)
+            {
+                if ((size_t)idx >= m_stamps.size()) m_stamps.resize(max((size_t)idx + 1, m_stamps.size() * 2), 0);
+
+                if (m_stamps[idx] == m_epoch) return true;
+                m_stamps[idx] = m_epoch;
+                return false;
+            }
+        };
 /*
         class DistPriorityQueue {
             float* data;
@@ -179,9 +225,11 @@ namespace SPTAG
         // Variables for each single NN search
         struct WorkSpace
         {
-            void Initialize(int maxCheck, SizeType dataSize, int hashexp)
+            void Initialize(int maxCheck, SizeType dataSize, int hashexp, bool epochVisited = false)
             {
-                nodeCheckStatus.Init(maxCheck, hashexp);
+                m_bEpochVisited = epochVisited;
+                if (m_bEpochVisited) nodeEpochStatus.Init(dataSize);
+                else nodeCheckStatus.Init(maxCheck, hashexp);
                 m_SPTQueue.Resize(maxCheck * 10);
                 m_NGQueue.Resize(maxCheck * 30);
                 //m_Results.Resize(maxCheck / 16);
@@ -191,11 +239,19 @@ namespace SPTAG
                 m_iContinuousLimit = maxCheck / 64;
                 m_iMaxCheck = maxCheck;
                 m_iNumOfContinuousNoBetterPropagation = 0;
+                m_iNumberOfDistanceEvaluations = 0;
+                m_iNumberOfHops = 0;
+                m_iNumberOfTreeNodes = 0;
+                m_terminationReason = TerminationReason::Undefined;
+                m_deadline = (std::chrono::steady_clock::time_point::max)();
             }
 
             void Reset(int maxCheck)
             {
-                nodeCheckStatus.clear();
+                m_termination.Reset(false);
+                m_filter = nullptr;
+                if (m_bEpochVisited) nodeEpochStatus.clear();
+                else nodeCheckStatus.clear();
                 m_SPTQueue.clear();
                 m_NGQueue.clear();
                 //m_Results.clear(maxCheck / 16);
@@ -205,15 +261,68 @@ namespace SPTAG
                 m_iNumberOfTreeCheckedLeaves = 0;
                 m_iNumberOfCheckedLeaves = 0;
                 m_iMaxCheck = maxCheck;
+                m_iNumberOfDistanceEvaluations = 0;
+                m_iNumberOfHops = 0;
+                m_iNumberOfTreeNodes = 0;
+                m_terminationReason = TerminationReason::Undefined;
+                m_deadline = (std::chrono::steady_clock::time_point::max)();
+            }
+
+            // Reads the clock only every c_deadlineCheckHops graph hops.
+            inline bool DeadlinePassed() const
+            {
+                return (m_iNumberOfHops & (c_deadlineCheckHops - 1)) == 0
+                    && m_deadline != (std::chrono::steady_clock::time_point::max)()
+                    && std::chrono::steady_clock::now() >= m_deadline;
+            }
+
+            // Statistics of the search since the last Reset, without its wall time.
+            inline SearchStats Stats() const
+            {
+                SearchStats stats;
+                stats.m_distanceEvaluations = m_iNumberOfDistanceEvaluations;
+                stats.m_graphHops = m_iNumberOfHops;
+                stats.m_treeNodesVisited = m_iNumberOfTreeNodes;
+                stats.m_termination = m_terminationReason;
+                return stats;
+            }
+
+            // Vectors a search can mark visited while the hash set stays sparse enough not to overflow.
+            inline SizeType VisitLimit() const
+            {
+                return m_bEpochVisited ? MaxSize : nodeCheckStatus.Capacity() / 4;
             }
 
             inline bool CheckAndSet(SizeType idx)
             {
-                return nodeCheckStatus.CheckAndSet(idx);
+                return m_bEpochVisited ? nodeEpochStatus.CheckAndSet(idx) : nodeCheckStatus.CheckAndSet(idx);
+            }
+
+            inline void ReserveBatch(DimensionType size)
+            {
+                if ((DimensionType)m_batchNodes.size() < size)
+                {
+                    m_batchNodes.resize(size);
+                    m_batchVectors.resize(size);
+                    m_batchDists.resize(size);
+                }
             }
 
             OptHashPosVector nodeCheckStatus;
 
+            OptEpochPosVector nodeEpochStatus;
+
+            bool m_bEpochVisited = false;
+
+            // id of the WorkSpacePool that created this workspace
+            std::uint64_t m_poolId = 0;
+
+            // adaptive termination of the current search
+            TerminationState m_termination;
+
+            // vectors the current search may return, nullptr for all
+            const SearchFilter* m_filter = nullptr;
+
             // counter for dynamic pivoting
             int m_iNumOfContinuousNoBetterPropagation;
             int m_iContinuousLimit;
@@ -221,11 +330,35 @@ namespace SPTAG
             int m_iNumberOfCheckedLeaves;
             int m_iMaxCheck;
 
+            // per query statistics, see Stats()
+            int m_iNumberOfDistanceEvaluations;
+            int m_iNumberOfHops;
+            int m_iNumberOfTreeNodes;
+            TerminationReason m_terminationReason;
+
+            // the search returns what it has found once this passes, see DeadlinePassed()
+            static const int c_deadlineCheckHops = 16;
+            std::chrono::steady_clock::time_point m_deadline;
+
             // Prioriy queue used for neighborhood graph
-            Heap<HeapCell> m_NGQueue;
+            MinMaxHeap<HeapCell> m_NGQueue;
 
             // Priority queue Used for Tree
-            Heap<HeapCell> m_SPTQueue;
+            MinMaxHeap<HeapCell> m_SPTQueue;
+
+            // Unvisited neighbors of the current node, scored together by the batch distance kernel
+            std::vector<SizeType> m_batchNodes;
+            std::vector<const void*> m_batchVectors;
+            std::vector<float> m_batchDists;
+
+            // Per-query product quantization lookup table, see PQQuantizer::BuildADCTable
+            std::vector<float> m_adcTable;
+
+            // Per-query SQ8 code row, see SQ8Quantizer::Encode
+            std::vector<std::uint8_t> m_quantizedQuery;
+
+            // Per-query norms of the query past each chunk, see DistanceUtils::ComputeRestNorms
+            std::vector<float> m_queryRestNorms;
 
             //DistPriorityQueue m_Results;
         };
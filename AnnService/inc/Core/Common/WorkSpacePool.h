@@ -6,6 +6,8 @@
 
 #include "WorkSpace.h"
 
+#include <atomic>
+#include <chrono>
 #include <list>
 #include <mutex>
 
@@ -14,31 +16,74 @@ namespace SPTAG
 namespace COMMON
 {
 
+// A workspace held across calls, e.g. by a search iterator between pages. Lock m_lock while using it:
+// m_workSpace becomes nullptr once the lease is released, or reclaimed after m_timeout without use.
+struct WorkSpaceLease
+{
+    std::mutex m_lock;
+    std::unique_ptr<WorkSpace> m_workSpace;
+    std::chrono::steady_clock::time_point m_lastUse;
+    std::chrono::seconds m_timeout;
+};
+
+// Hands out the workspaces of one index. Each thread caches the last workspace it returned, so a thread
+// searching one index rents and returns without touching shared state; other workspaces wait in a lock-free
+// free list. Workspaces only go back to the pool that created them, so a pool rebuilt for a new MaxCheck
+// drops the ones rented from its predecessor instead of reusing them.
 class WorkSpacePool
 {
 public:
-    WorkSpacePool(int p_maxCheck, SizeType p_vectorCount, int p_hashExp);
+    WorkSpacePool(int p_maxCheck, SizeType p_vectorCount, int p_hashExp, bool p_epochVisited = false);
 
     virtual ~WorkSpacePool();
 
-    std::shared_ptr<WorkSpace> Rent();
+    std::unique_ptr<WorkSpace> Rent();
+
+    void Return(std::unique_ptr<WorkSpace> p_workSpace);
 
-    void Return(const std::shared_ptr<WorkSpace>& p_workSpace);
+    std::shared_ptr<WorkSpaceLease> Lease(int p_timeoutSeconds);
 
+    void Release(WorkSpaceLease& p_lease);
+
+    // Creates size workspaces up front; call once, before the pool is shared.
     void Init(int size);
 
     inline int GetMaxCheck() const { return m_maxCheck; }
 
 private:
-    std::list<std::shared_ptr<WorkSpace>> m_workSpacePool;
+    std::unique_ptr<WorkSpace> Create() const;
+
+    WorkSpace* Pop();
+
+    // Deletes p_workSpace when the free list is full.
+    void Push(WorkSpace* p_workSpace);
+
+    // Puts the workspaces of idle leases back into the free list, returning whether any came back.
+    bool ReclaimLeases();
 
-    std::mutex m_workSpacePoolMutex;
+    // Never reused, so a thread cache can tell the workspaces of a rebuilt pool apart.
+    const std::uint64_t m_id;
+
+    // Expires with the pool, letting thread caches drop the workspaces of a destroyed pool.
+    std::shared_ptr<char> m_liveness;
+
+    std::unique_ptr<std::atomic<WorkSpace*>[]> m_freeList;
+
+    int m_freeListSize = 0;
+
+    std::list<std::weak_ptr<WorkSpaceLease>> m_leases;
+
+    std::atomic<int> m_leaseCount;
+
+    std::mutex m_leaseMutex;
 
     int m_maxCheck;
 
     SizeType m_vectorCount;
 
     int m_hashExp;
+
+    bool m_epochVisited;
 };
 
 }
@@ -7,6 +7,9 @@ DefineVectorValueType(Int8, std::int8_t)
 DefineVectorValueType(UInt8, std::uint8_t)
 DefineVectorValueType(Int16, std::int16_t)
 DefineVectorValueType(Float, float)
+DefineVectorValueType(Float16, SPTAG::Float16)
+DefineVectorValueType(BFloat16, SPTAG::BFloat16)
+DefineVectorValueType(PackedBits, SPTAG::PackedBits)
 
 #endif // DefineVectorValueType
 
@@ -15,6 +18,8 @@ DefineVectorValueType(Float, float)
 
 DefineDistCalcMethod(L2)
 DefineDistCalcMethod(Cosine)
+DefineDistCalcMethod(InnerProduct)
+DefineDistCalcMethod(Hamming)
 
 #endif // DefineDistCalcMethod
 
@@ -41,6 +46,7 @@ DefineErrorCode(DiskIOFail, 0x0020)
 // 0x1000 ~ 0x1FFF  Index Build Status
 
 // 0x2000 ~ 0x2FFF  Index Serve Status
+DefineErrorCode(SearchExpired, 0x2000)
 
 // 0x3000 ~ 0x3FFF  Helper Function Status
 DefineErrorCode(ReadIni_FailedParseSection, 0x3000)
@@ -95,4 +101,19 @@ DefineTruthFileType(XVEC)
 // row(int32_t), column(int32_t), data...
 DefineTruthFileType(DEFAULT)
 
-#endif // DefineTruthFileType
\ No newline at end of file
+#endif // DefineTruthFileType
+
+#ifdef DefineTerminationReason
+
+// the candidate queue ran out
+DefineTerminationReason(QueueEmpty)
+// more vectors than MaxCheck were scored
+DefineTerminationReason(MaxCheck)
+// too many expansions in a row found nothing better than the current results
+DefineTerminationReason(NoBetterPropagation)
+// the termination predictor judged the results complete
+DefineTerminationReason(Adaptive)
+// the caller's deadline passed, leaving the best results found so far
+DefineTerminationReason(Deadline)
+
+#endif // DefineTerminationReason
\ No newline at end of file
@@ -0,0 +1,112 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _SPTAG_CORE_FLOAT16_H_
+#define _SPTAG_CORE_FLOAT16_H_
+
+#include <cstdint>
+#include <cstring>
+
+namespace SPTAG
+{
+
+// 16-bit storage types for vector values. Both convert implicitly to and from float, so the
+// generic code paths compute in float while m_pSamples keeps the 2-byte representation.
+// Conversions round to nearest even, matching vcvtps2ph and the AVX-512 BF16 instructions.
+
+// IEEE 754 binary16: 1 sign bit, 5 exponent bits, 10 mantissa bits.
+struct Float16
+{
+    std::uint16_t m_bits;
+
+    Float16() = default;
+    Float16(float p_value) : m_bits(FromFloat(p_value)) {}
+    operator float() const { return ToFloat(m_bits); }
+
+    static inline std::uint16_t FromFloat(float p_value)
+    {
+        std::uint32_t f;
+        std::memcpy(&f, &p_value, sizeof(f));
+        std::uint32_t sign = (f >> 16) & 0x8000;
+        f &= 0x7FFFFFFF;
+
+        std::uint16_t h;
+        if (f >= ((127 + 16) << 23)) // too large for a half: Inf, or NaN kept quiet
+        {
+            h = (f > (255U << 23)) ? 0x7E00 : 0x7C00;
+        }
+        else if (f < (113 << 23)) // subnormal half or zero
+        {
+            // adding 0.5f aligns the 10 mantissa bits at the bottom of the float, rounding them in the FPU
+            float v;
+            std::memcpy(&v, &f, sizeof(v));
+            v += 0.5f;
+            std::memcpy(&f, &v, sizeof(f));
+            h = (std::uint16_t)(f - (126U << 23));
+        }
+        else
+        {
+            std::uint32_t mantOdd = (f >> 13) & 1;
+            f += ((std::uint32_t)(15 - 127) << 23) + 0xFFF + mantOdd;
+            h = (std::uint16_t)(f >> 13);
+        }
+        return (std::uint16_t)(h | sign);
+    }
+
+    static inline float ToFloat(std::uint16_t p_bits)
+    {
+        std::uint32_t f = ((std::uint32_t)(p_bits & 0x7FFF)) << 13;
+        std::uint32_t exp = f & (0x7C00 << 13);
+        f += (127 - 15) << 23;
+        if (exp == (0x7C00 << 13)) // Inf or NaN
+        {
+            f += (128 - 16) << 23;
+        }
+        else if (exp == 0) // zero or subnormal, renormalized through the FPU
+        {
+            f += 1 << 23;
+            float v;
+            std::memcpy(&v, &f, sizeof(v));
+            v -= 6.103515625e-05f; // 2^-14
+            std::memcpy(&f, &v, sizeof(f));
+        }
+        f |= ((std::uint32_t)(p_bits & 0x8000)) << 16;
+
+        float value;
+        std::memcpy(&value, &f, sizeof(value));
+        return value;
+    }
+};
+
+// bfloat16: the upper half of a float, 1 sign bit, 8 exponent bits, 7 mantissa bits.
+struct BFloat16
+{
+    std::uint16_t m_bits;
+
+    BFloat16() = default;
+    BFloat16(float p_value) : m_bits(FromFloat(p_value)) {}
+    operator float() const { return ToFloat(m_bits); }
+
+    static inline std::uint16_t FromFloat(float p_value)
+    {
+        std::uint32_t f;
+        std::memcpy(&f, &p_value, sizeof(f));
+        if ((f & 0x7FFFFFFF) > 0x7F800000) return (std::uint16_t)((f >> 16) | 0x40);
+        f += 0x7FFF + ((f >> 16) & 1);
+        return (std::uint16_t)(f >> 16);
+    }
+
+    static inline float ToFloat(std::uint16_t p_bits)
+    {
+        std::uint32_t f = ((std::uint32_t)p_bits) << 16;
+        float value;
+        std::memcpy(&value, &f, sizeof(value));
+        return value;
+    }
+};
+
+static_assert(sizeof(Float16) == 2 && sizeof(BFloat16) == 2, "half precision types must be 2 bytes");
+
+} // namespace SPTAG
+
+#endif // _SPTAG_CORE_FLOAT16_H_
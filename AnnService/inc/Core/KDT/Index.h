@@ -6,6 +6,7 @@
 
 #include "../Common.h"
 #include "../VectorIndex.h"
+#include "../SearchFilter.h"
 
 #include "../Common/CommonUtils.h"
 #include "../Common/DistanceUtils.h"
@@ -69,19 +70,40 @@ namespace SPTAG
             std::shared_timed_mutex m_dataDeleteLock;
             COMMON::Labelset m_deletedID;
             
-            std::unique_ptr<COMMON::WorkSpacePool> m_workSpacePool;
+            std::shared_ptr<COMMON::WorkSpacePool> m_workSpacePool;
             Helper::ThreadPool m_threadPool;
             int m_iNumberOfThreads;
 
             DistCalcMethod m_iDistCalcMethod;
             float(*m_fComputeDistance)(const T* pX, const T* pY, DimensionType length);
+            void(*m_fComputeDistanceBatch)(const T* pQuery, const T* const* pCandidates, int count, DimensionType length, float* pOut);
             int m_iBaseSquare;
+            float m_fMaxNormSquare; // largest squared norm in the data, used by InnerProduct
  
             int m_iMaxCheck;
             int m_iThresholdOfNumberOfContinuousNoBetterPropagation;
             int m_iNumberOfInitialDynamicPivots;
             int m_iNumberOfOtherDynamicPivots;
             int m_iHashTableExp;
+            bool m_bEpochVisitedSet;
+            int m_iSearchGroupSize;
+            int m_iIteratorTimeout;
+            std::string m_sAdaptiveModel;
+            float m_fAdaptiveThreshold;
+            COMMON::TerminationPredictor m_termination;
+
+            // One query of an interleaved batch search, with the node it popped and the neighbors it gathered.
+            struct InterleavedQuery
+            {
+                COMMON::QueryResultSet<T>* m_query;
+                COMMON::WorkSpace* m_space;
+                COMMON::HeapCell m_node;
+                int m_batchCount;
+                bool m_active;
+            };
+
+            // Resumable traversal behind BeginSearch.
+            class SearchIterator;
 
         public:
             Index()
@@ -93,8 +115,8 @@ namespace SPTAG
 #undef DefineKDTParameter
 
                 m_pSamples.SetName("Vector");
-                m_fComputeDistance = COMMON::DistanceCalcSelector<T>(m_iDistCalcMethod);
-                m_iBaseSquare = (m_iDistCalcMethod == DistCalcMethod::Cosine) ? COMMON::Utils::GetBase<T>() * COMMON::Utils::GetBase<T>() : 1;
+                SelectDistanceKernels();
+                m_fMaxNormSquare = 0;
             }
 
             ~Index() {}
@@ -110,14 +132,21 @@ namespace SPTAG
             inline VectorValueType GetVectorValueType() const { return GetEnumValueType<T>(); }
             
             inline float AccurateDistance(const void* pX, const void* pY) const {
-                if (m_iDistCalcMethod == DistCalcMethod::L2) return m_fComputeDistance((const T*)pX, (const T*)pY, m_pSamples.C());
+                if (m_iDistCalcMethod != DistCalcMethod::Cosine) return m_fComputeDistance((const T*)pX, (const T*)pY, m_pSamples.C());
 
                 float xy = m_iBaseSquare - m_fComputeDistance((const T*)pX, (const T*)pY, m_pSamples.C());
                 float xx = m_iBaseSquare - m_fComputeDistance((const T*)pX, (const T*)pX, m_pSamples.C());
                 float yy = m_iBaseSquare - m_fComputeDistance((const T*)pY, (const T*)pY, m_pSamples.C());
                 return 1.0f - xy / (sqrt(xx) * sqrt(yy));
             }
-            inline float ComputeDistance(const void* pX, const void* pY) const { return m_fComputeDistance((const T*)pX, (const T*)pY, m_pSamples.C()); }
+            // Distance between two data vectors as used for graph construction; for InnerProduct this is the norm-augmented L2.
+            inline float ComputeDistance(const void* pX, const void* pY) const {
+                if (m_iDistCalcMethod == DistCalcMethod::InnerProduct)
+                    return COMMON::DistanceUtils::ComputeNormAugmentedDistance((const T*)pX, (const T*)pY, m_pSamples.C(), m_fMaxNormSquare, m_fComputeDistance);
+                return m_fComputeDistance((const T*)pX, (const T*)pY, m_pSamples.C());
+            }
+            inline float AccurateDistance(const SizeType p_x, const SizeType p_y) const { return AccurateDistance(m_pSamples[p_x], m_pSamples[p_y]); }
+            inline float ComputeDistance(const SizeType p_x, const SizeType p_y) const { return ComputeDistance(m_pSamples[p_x], m_pSamples[p_y]); }
             inline const void* GetSample(const SizeType idx) const { return (void*)m_pSamples[idx]; }
             inline bool ContainSample(const SizeType idx) const { return !m_deletedID.Contains(idx); }
             inline bool NeedRefine() const { return m_deletedID.Count() > (size_t)(GetNumSamples() * m_fDeletePercentageForRefine); }
@@ -150,6 +179,11 @@ namespace SPTAG
 
             ErrorCode BuildIndex(const void* p_data, SizeType p_vectorNum, DimensionType p_dimension);
             ErrorCode SearchIndex(QueryResult &p_query, bool p_searchDeleted = false) const;
+            ErrorCode SearchIndexBatch(QueryResult* p_queries, int p_count, bool p_searchDeleted = false) const;
+            ErrorCode SearchIndexTrace(QueryResult &p_query, std::vector<COMMON::TerminationTracePoint>& p_trace) const;
+            ErrorCode SearchIndexRange(QueryResult &p_query, float p_radius, int p_maxResults, bool p_searchDeleted = false) const;
+            ErrorCode SearchIndexFiltered(QueryResult &p_query, const SearchFilter& p_filter, bool p_searchDeleted = false) const;
+            ErrorCode BeginSearch(const void* p_target, std::shared_ptr<ResultIterator>& p_iterator, bool p_searchDeleted = false) const;
             ErrorCode RefineSearchIndex(QueryResult &p_query, bool p_searchDeleted = false) const;
             ErrorCode SearchTree(QueryResult &p_query) const;
             ErrorCode AddIndex(const void* p_data, SizeType p_vectorNum, DimensionType p_dimension, std::shared_ptr<MetadataSet> p_metadataSet, bool p_withMetaIndex = false);
@@ -166,6 +200,19 @@ namespace SPTAG
         private:
             void SearchIndexWithDeleted(COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space) const;
             void SearchIndexWithoutDeleted(COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space) const;
+            void SearchIndexWithFilter(COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space, bool p_searchDeleted) const;
+            void SearchIndexInterleaved(std::vector<InterleavedQuery>& p_group, bool p_searchDeleted) const;
+            ErrorCode SearchQuery(QueryResult &p_query, bool p_searchDeleted, const SearchFilter* p_filter, bool p_adaptive, std::vector<COMMON::TerminationTracePoint>* p_trace) const;
+            void SetResultMetadata(QueryResult &p_query) const;
+            void UpdateMaxNormSquare(SizeType p_start, SizeType p_end);
+
+            // Kernels for the distance method, specialized for the dimension once the data is there.
+            inline void SelectDistanceKernels()
+            {
+                m_fComputeDistance = COMMON::DistanceCalcSelector<T>(m_iDistCalcMethod, GetFeatureDim());
+                m_fComputeDistanceBatch = COMMON::DistanceBatchCalcSelector<T>(m_iDistCalcMethod, GetFeatureDim());
+                m_iBaseSquare = (m_iDistCalcMethod == DistCalcMethod::Cosine) ? COMMON::Utils::GetBase<T>() * COMMON::Utils::GetBase<T>() : 1;
+            }
         };
     } // namespace KDT
 } // namespace SPTAG
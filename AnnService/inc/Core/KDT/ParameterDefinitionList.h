@@ -42,5 +42,10 @@ DefineKDTParameter(m_iThresholdOfNumberOfContinuousNoBetterPropagation, int, 3L,
 DefineKDTParameter(m_iNumberOfInitialDynamicPivots, int, 50L, "NumberOfInitialDynamicPivots")
 DefineKDTParameter(m_iNumberOfOtherDynamicPivots, int, 4L, "NumberOfOtherDynamicPivots")
 DefineKDTParameter(m_iHashTableExp, int, 4L, "HashTableExponent")
+DefineKDTParameter(m_bEpochVisitedSet, bool, false, "EpochVisitedSet") // visited flags as a per-vector epoch array instead of a hash table: no per-query clear and no overflow, 2 bytes per vector per workspace
+DefineKDTParameter(m_iSearchGroupSize, int, 8L, "SearchGroupSize") // queries whose traversals a batch search interleaves; 1 searches them one after another
+DefineKDTParameter(m_iIteratorTimeout, int, 60L, "IteratorTimeout") // seconds a search iterator may sit idle before its workspace goes back to other searches
+DefineKDTParameter(m_sAdaptiveModel, std::string, std::string(""), "AdaptiveModel") // termination model fitted by indexsearcher --calibrate; empty searches to MaxCheck
+DefineKDTParameter(m_fAdaptiveThreshold, float, 0.9F, "AdaptiveThreshold") // predicted convergence probability at which AdaptiveModel stops a search
 
 #endif
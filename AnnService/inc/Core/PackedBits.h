@@ -0,0 +1,29 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _SPTAG_CORE_PACKEDBITS_H_
+#define _SPTAG_CORE_PACKEDBITS_H_
+
+#include <cstdint>
+
+namespace SPTAG
+{
+
+// Eight bits of a binary vector, so the dimension of a PackedBits vector counts bytes (bits / 8).
+// Distances work on the bits: L2 equals the Hamming distance, the dot product counts common set bits.
+// The float conversion exposes the byte value, which is what the generic code paths (KDT splits,
+// text parsing) see; it carries no geometric meaning.
+struct PackedBits
+{
+    std::uint8_t m_bits;
+
+    PackedBits() = default;
+    PackedBits(float p_value) : m_bits((std::uint8_t)((p_value <= 0) ? 0 : ((p_value >= 255) ? 255 : p_value + 0.5f))) {}
+    operator float() const { return m_bits; }
+};
+
+static_assert(sizeof(PackedBits) == 1, "PackedBits must be 1 byte");
+
+} // namespace SPTAG
+
+#endif // _SPTAG_CORE_PACKEDBITS_H_
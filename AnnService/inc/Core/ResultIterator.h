@@ -0,0 +1,30 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _SPTAG_RESULTITERATOR_H_
+#define _SPTAG_RESULTITERATOR_H_
+
+#include "SearchQuery.h"
+
+namespace SPTAG
+{
+
+// Pages through the neighbors of one query, closest first, continuing the traversal where the previous page
+// stopped instead of searching again with a larger k. Holds a workspace of its index between pages, so it
+// must not outlive the index; an iterator left idle for IteratorTimeout seconds loses it.
+class ResultIterator
+{
+public:
+    virtual ~ResultIterator() {}
+
+    // Fills p_results with the next p_results.GetResultNum() neighbors; slots past the last one get VID -1.
+    // Fails with SearchExpired once the workspace was reclaimed.
+    virtual ErrorCode Next(QueryResult& p_results) = 0;
+
+    // Gives the workspace back before the iterator is destroyed; Next fails afterwards.
+    virtual void Close() = 0;
+};
+
+} // namespace SPTAG
+
+#endif // _SPTAG_RESULTITERATOR_H_
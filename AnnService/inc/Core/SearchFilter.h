@@ -0,0 +1,94 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _SPTAG_SEARCHFILTER_H_
+#define _SPTAG_SEARCHFILTER_H_
+
+#include "Common.h"
+#include "Common/Dataset.h"
+
+#include <functional>
+
+namespace SPTAG
+{
+
+// One attribute value per vector, stored as its code in the column's dictionary; unset rows hold c_unset.
+class AttributeColumn : public COMMON::Dataset<std::uint32_t>
+{
+public:
+    static const std::uint32_t c_unset = 0xffffffff;
+
+    inline std::uint32_t Code(SizeType p_id) const
+    {
+        return p_id < R() ? *At(p_id) : c_unset;
+    }
+};
+
+
+// Restricts a search to the vectors it allows: an allow-list of ids, attribute values and a predicate, all of
+// which must pass. Vectors it rejects are still used to navigate the graph but never enter the results.
+// An empty filter allows every vector.
+class SearchFilter
+{
+public:
+    // Once any id is allowed, vectors off the list are rejected.
+    void Allow(SizeType p_id)
+    {
+        std::size_t word = ((std::size_t)p_id) >> 6;
+        if (word >= m_allowList.size()) m_allowList.resize(word + 1, 0);
+        m_allowList[word] |= ((std::uint64_t)1) << (p_id & 63);
+        m_useAllowList = true;
+    }
+
+    void SetPredicate(std::function<bool(SizeType)> p_predicate)
+    {
+        m_predicate = std::move(p_predicate);
+    }
+
+    // Rejects vectors whose p_column code is not in p_codes. Built by VectorIndex::AddAttributeFilter.
+    void AddAttributeClause(std::shared_ptr<const AttributeColumn> p_column, const std::vector<std::uint32_t>& p_codes)
+    {
+        AttributeClause clause;
+        clause.m_column = std::move(p_column);
+        for (std::uint32_t code : p_codes)
+        {
+            if (code == AttributeColumn::c_unset) continue;
+            std::size_t word = code >> 6;
+            if (word >= clause.m_codes.size()) clause.m_codes.resize(word + 1, 0);
+            clause.m_codes[word] |= ((std::uint64_t)1) << (code & 63);
+        }
+        m_clauses.push_back(std::move(clause));
+    }
+
+    inline bool Allows(SizeType p_id) const
+    {
+        if (m_useAllowList)
+        {
+            std::size_t word = ((std::size_t)p_id) >> 6;
+            if (word >= m_allowList.size() || !(m_allowList[word] & (((std::uint64_t)1) << (p_id & 63)))) return false;
+        }
+        for (const AttributeClause& clause : m_clauses)
+        {
+            std::uint32_t code = clause.m_column->Code(p_id);
+            std::size_t word = code >> 6;
+            if (word >= clause.m_codes.size() || !(clause.m_codes[word] & (((std::uint64_t)1) << (code & 63)))) return false;
+        }
+        return !m_predicate || m_predicate(p_id);
+    }
+
+private:
+    struct AttributeClause
+    {
+        std::shared_ptr<const AttributeColumn> m_column;
+        std::vector<std::uint64_t> m_codes;
+    };
+
+    bool m_useAllowList = false;
+    std::vector<std::uint64_t> m_allowList;
+    std::vector<AttributeClause> m_clauses;
+    std::function<bool(SizeType)> m_predicate;
+};
+
+} // namespace SPTAG
+
+#endif // _SPTAG_SEARCHFILTER_H_
@@ -6,11 +6,39 @@
 
 #include "SearchResult.h"
 
+#include <chrono>
 #include <cstring>
 
 namespace SPTAG
 {
 
+// What one search cost and why it stopped.
+struct SearchStats
+{
+    // vectors and tree centers scored against the query, exact reranking included
+    std::int32_t m_distanceEvaluations = 0;
+
+    // graph nodes expanded
+    std::int32_t m_graphHops = 0;
+
+    // tree nodes taken off the tree queue (BKT) or descended through (KDT)
+    std::int32_t m_treeNodesVisited = 0;
+
+    TerminationReason m_termination = TerminationReason::Undefined;
+
+    float m_wallTimeMs = 0;
+
+    // Folds in a further search run for the same query, whose termination reason wins.
+    void Accumulate(const SearchStats& p_other)
+    {
+        m_distanceEvaluations += p_other.m_distanceEvaluations;
+        m_graphHops += p_other.m_graphHops;
+        m_treeNodesVisited += p_other.m_treeNodesVisited;
+        m_termination = p_other.m_termination;
+        m_wallTimeMs += p_other.m_wallTimeMs;
+    }
+};
+
 // Space to save temporary answer, similar with TopKCache
 class QueryResult
 {
@@ -48,6 +76,8 @@ public:
         {
             std::copy(p_other.m_results.Data(), p_other.m_results.Data() + m_resultNum, m_results.Data());
         }
+        m_stats = p_other.m_stats;
+        m_deadline = p_other.m_deadline;
     }
 
 
@@ -58,6 +88,8 @@ public:
         {
             std::copy(p_other.m_results.Data(), p_other.m_results.Data() + m_resultNum, m_results.Data());
         }
+        m_stats = p_other.m_stats;
+        m_deadline = p_other.m_deadline;
 
         return *this;
     }
@@ -75,6 +107,7 @@ public:
         m_withMeta = p_withMeta;
 
         m_results = Array<BasicResult>::Alloc(p_resultNum);
+        m_stats = SearchStats();
     }
 
 
@@ -152,6 +185,39 @@ public:
             m_results[i].Dist = MaxDist;
             m_results[i].Meta.Clear();
         }
+        m_stats = SearchStats();
+    }
+
+
+    inline const SearchStats& GetStats() const
+    {
+        return m_stats;
+    }
+
+
+    inline void SetStats(const SearchStats& p_stats)
+    {
+        m_stats = p_stats;
+    }
+
+
+    // The search stops soon after p_deadline with the best results found so far; see IsTruncated.
+    inline void SetDeadline(std::chrono::steady_clock::time_point p_deadline)
+    {
+        m_deadline = p_deadline;
+    }
+
+
+    inline std::chrono::steady_clock::time_point GetDeadline() const
+    {
+        return m_deadline;
+    }
+
+
+    // Whether the last search ran out of time before it was done.
+    inline bool IsTruncated() const
+    {
+        return m_stats.m_termination == TerminationReason::Deadline;
     }
 
 
@@ -187,6 +253,10 @@ protected:
     bool m_withMeta;
 
     Array<BasicResult> m_results;
+
+    SearchStats m_stats;
+
+    std::chrono::steady_clock::time_point m_deadline = (std::chrono::steady_clock::time_point::max)();
 };
 } // namespace SPTAG
 
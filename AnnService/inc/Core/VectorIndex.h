@@ -6,12 +6,21 @@
 
 #include "Common.h"
 #include "SearchQuery.h"
+#include "ResultIterator.h"
 #include "VectorSet.h"
 #include "MetadataSet.h"
 #include "inc/Helper/SimpleIniReader.h"
 
 namespace SPTAG
 {
+namespace COMMON
+{
+struct TerminationTracePoint;
+}
+
+class SearchFilter;
+class AttributeSet;
+
 class IAbortOperation
 {
 public:
@@ -41,6 +50,8 @@ public:
 
     virtual float AccurateDistance(const void* pX, const void* pY) const = 0;
     virtual float ComputeDistance(const void* pX, const void* pY) const = 0;
+    virtual float AccurateDistance(const SizeType p_x, const SizeType p_y) const = 0;
+    virtual float ComputeDistance(const SizeType p_x, const SizeType p_y) const = 0;
     virtual const void* GetSample(const SizeType idx) const = 0;
     virtual bool ContainSample(const SizeType idx) const = 0;
     virtual bool NeedRefine() const = 0;
@@ -79,6 +90,31 @@ public:
 
     virtual ErrorCode SearchIndex(const void* p_vector, int p_vectorCount, int p_neighborCount, bool p_withMeta, BasicResult* p_results) const;
 
+    // Searches p_count queries on the calling thread. Indexes that support it advance the queries
+    // together so the memory stalls of one overlap with the work of the others.
+    virtual ErrorCode SearchIndexBatch(QueryResult* p_queries, int p_count, bool p_searchDeleted = false) const;
+
+    // Searches p_query to MaxCheck, recording the adaptive termination features along the way; the last point
+    // holds the final results. Used to fit AdaptiveModel. Indexes without adaptive termination return Undefined.
+    virtual ErrorCode SearchIndexTrace(QueryResult& p_query, std::vector<COMMON::TerminationTracePoint>& p_trace) const;
+
+    // Finds the vectors within p_radius of p_query's target, closest first, keeping at most p_maxResults.
+    // p_query is resized to the number found; its initial size is only the first guess for the buffer.
+    virtual ErrorCode SearchIndexRange(QueryResult& p_query, float p_radius, int p_maxResults, bool p_searchDeleted = false) const;
+
+    // Searches for the nearest vectors p_filter allows. Raise MaxCheck for filters that pass few vectors.
+    virtual ErrorCode SearchIndexFiltered(QueryResult& p_query, const SearchFilter& p_filter, bool p_searchDeleted = false) const;
+
+    // Starts a search for p_target whose neighbors are read page by page from p_iterator, which copies p_target.
+    virtual ErrorCode BeginSearch(const void* p_target, std::shared_ptr<ResultIterator>& p_iterator, bool p_searchDeleted = false) const;
+
+    // Named string attributes of the vectors, to filter searches on with AddAttributeFilter.
+    virtual ErrorCode SetAttribute(SizeType p_vectorID, const std::string& p_column, const std::string& p_value);
+    virtual std::string GetAttribute(SizeType p_vectorID, const std::string& p_column) const;
+
+    // Restricts p_filter to the vectors whose p_column is one of p_values.
+    virtual ErrorCode AddAttributeFilter(SearchFilter& p_filter, const std::string& p_column, const std::vector<std::string>& p_values) const;
+
     virtual std::string GetParameter(const std::string& p_param) const;
     virtual ErrorCode SetParameter(const std::string& p_param, const std::string& p_value);
 
@@ -138,11 +174,15 @@ private:
     ErrorCode SaveIndexConfig(std::shared_ptr<Helper::DiskPriorityIO> p_configOut);
 
 protected:
+    static const int c_rangeSearchInitialResults = 64;
+
     bool m_bReady = false;
     std::string m_sIndexName = "";
     std::string m_sMetadataFile = "metadata.bin";
     std::string m_sMetadataIndexFile = "metadataIndex.bin";
+    std::string m_sAttributesFile = "attributes.bin";
     std::shared_ptr<MetadataSet> m_pMetadata;
+    std::shared_ptr<AttributeSet> m_pAttributes;
     std::shared_ptr<void> m_pMetaToVec;
 };
 
@@ -133,6 +133,35 @@ inline bool ConvertStringTo<float>(const char* p_str, float& p_value)
 }
 
 
+template <>
+inline bool ConvertStringTo<Float16>(const char* p_str, Float16& p_value)
+{
+    float value;
+    if (!ConvertStringTo<float>(p_str, value)) return false;
+
+    p_value = value;
+    return true;
+}
+
+
+template <>
+inline bool ConvertStringTo<BFloat16>(const char* p_str, BFloat16& p_value)
+{
+    float value;
+    if (!ConvertStringTo<float>(p_str, value)) return false;
+
+    p_value = value;
+    return true;
+}
+
+
+template <>
+inline bool ConvertStringTo<PackedBits>(const char* p_str, PackedBits& p_value)
+{
+    return ConvertStringToUnsignedInt(p_str, p_value.m_bits);
+}
+
+
 template <>
 inline bool ConvertStringTo<double>(const char* p_str, double& p_value)
 {
@@ -342,6 +371,27 @@ inline std::string ConvertToString<std::string>(const std::string& p_value)
 }
 
 
+template<>
+inline std::string ConvertToString<Float16>(const Float16& p_value)
+{
+    return std::to_string((float)p_value);
+}
+
+
+template<>
+inline std::string ConvertToString<BFloat16>(const BFloat16& p_value)
+{
+    return std::to_string((float)p_value);
+}
+
+
+template<>
+inline std::string ConvertToString<PackedBits>(const PackedBits& p_value)
+{
+    return std::to_string((int)p_value.m_bits);
+}
+
+
 template<>
 inline std::string ConvertToString<bool>(const bool& p_value)
 {
@@ -446,6 +496,25 @@ inline std::string ConvertToString<TruthFileType>(const TruthFileType& p_value)
     return "Undefined";
 }
 
+template <>
+inline std::string ConvertToString<TerminationReason>(const TerminationReason& p_value)
+{
+    switch (p_value)
+    {
+#define DefineTerminationReason(Name) \
+    case TerminationReason::Name: \
+        return #Name; \
+
+#include "inc/Core/DefinitionList.h"
+#undef DefineTerminationReason
+
+    default:
+        break;
+    }
+
+    return "Undefined";
+}
+
 } // namespace Convert
 } // namespace Helper
 } // namespace SPTAG
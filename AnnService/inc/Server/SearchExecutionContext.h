@@ -53,6 +53,10 @@ public:
 
     const bool GetExtractMetadata() const;
 
+    const bool IsRangeSearch() const;
+
+    const float GetRadius() const;
+
 private:
     const std::shared_ptr<const ServiceSettings> c_serviceSettings;
 
@@ -71,6 +75,10 @@ private:
     bool m_extractMetadata;
 
     SizeType m_resultNum;
+
+    bool m_rangeSearch;
+
+    float m_radius;
 };
 
 } // namespace Server
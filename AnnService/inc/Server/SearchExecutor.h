@@ -9,6 +9,7 @@
 #include "SearchExecutionContext.h"
 #include "QueryParser.h"
 
+#include <chrono>
 #include <functional>
 #include <memory>
 #include <vector>
@@ -23,9 +24,11 @@ class SearchExecutor
 public:
     typedef std::function<void(std::shared_ptr<SearchExecutionContext>)> CallBack;
 
+    // Every index searched stops at p_deadline with the results it has found so far.
     SearchExecutor(std::string p_queryString,
                    std::shared_ptr<ServiceContext> p_serviceContext,
-                   const CallBack& p_callback);
+                   const CallBack& p_callback,
+                   std::chrono::steady_clock::time_point p_deadline = (std::chrono::steady_clock::time_point::max)());
 
     ~SearchExecutor();
 
@@ -45,6 +48,8 @@ private:
 
     std::string m_queryString;
 
+    std::chrono::steady_clock::time_point m_deadline;
+
     std::vector<std::shared_ptr<VectorIndex>> m_selectedIndex;
 };
 
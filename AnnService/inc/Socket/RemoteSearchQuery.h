@@ -22,8 +22,9 @@ namespace Socket
 
 struct RemoteQuery
 {
+    // Mirror version 1 appends the search deadline, which older readers ignore.
     static constexpr std::uint16_t MajorVersion() { return 1; }
-    static constexpr std::uint16_t MirrorVersion() { return 0; }
+    static constexpr std::uint16_t MirrorVersion() { return 1; }
 
     enum class QueryType : std::uint8_t
     {
@@ -42,6 +43,9 @@ struct RemoteQuery
     QueryType m_type;
 
     std::string m_queryString;
+
+    // Time the server may spend searching, counted from when it reads the query; 0 for no limit.
+    std::uint32_t m_deadlineMilliseconds;
 };
 
 
@@ -55,8 +59,9 @@ struct IndexSearchResult
 
 struct RemoteSearchResult
 {
+    // Mirror version 1 appends the search stats of every index result, which older readers ignore.
     static constexpr std::uint16_t MajorVersion() { return 1; }
-    static constexpr std::uint16_t MirrorVersion() { return 0; }
+    static constexpr std::uint16_t MirrorVersion() { return 1; }
 
     enum class ResultStatus : std::uint8_t
     {
@@ -11,12 +11,14 @@ using namespace SPTAG::Client;
 
 ClientOptions::ClientOptions()
     : m_searchTimeout(9000),
+      m_searchDeadline(0),
       m_threadNum(1),
       m_socketThreadNum(2)
 {
     AddRequiredOption(m_serverAddr, "-s", "--server", "Server address.");
     AddRequiredOption(m_serverPort, "-p", "--port", "Server port.");
     AddOptionalOption(m_searchTimeout, "-t", "", "Search timeout.");
+    AddOptionalOption(m_searchDeadline, "-dl", "", "Search deadline on the server, 0 for none.");
     AddOptionalOption(m_threadNum, "-cth", "", "Client Thread Number.");
     AddOptionalOption(m_socketThreadNum, "-sth", "", "Socket Thread Number.");
 }
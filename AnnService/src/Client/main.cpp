@@ -39,6 +39,7 @@ int main(int argc, char** argv)
         SPTAG::Socket::RemoteQuery query;
         query.m_type = SPTAG::Socket::RemoteQuery::QueryType::String;
         query.m_queryString = std::move(line);
+        query.m_deadlineMilliseconds = options.m_searchDeadline;
 
         SPTAG::Socket::RemoteSearchResult result;
         auto callback = [&result](SPTAG::Socket::RemoteSearchResult p_result)
@@ -53,7 +54,12 @@ int main(int argc, char** argv)
 
         for (const auto& indexRes : result.m_allIndexResults)
         {
-            std::cout << "Index: " << indexRes.m_indexName << std::endl;
+            std::cout << "Index: " << indexRes.m_indexName;
+            if (indexRes.m_results.IsTruncated())
+            {
+                std::cout << " (truncated at deadline)";
+            }
+            std::cout << std::endl;
 
             int idx = 0;
             for (const auto& res : indexRes.m_results)
@@ -3,6 +3,7 @@
 
 #include "inc/Core/BKT/Index.h"
 #include <chrono>
+#include <queue>
 
 #pragma warning(disable:4242)  // '=' : conversion from 'int' to 'short', possible loss of data
 #pragma warning(disable:4244)  // '=' : conversion from 'int' to 'short', possible loss of data
@@ -31,13 +32,19 @@ namespace SPTAG
         {
             if (p_indexBlobs.size() < 3) return ErrorCode::LackOfInputs;
 
-            if (m_pSamples.Load((char*)p_indexBlobs[0].Data()) != ErrorCode::Success) return ErrorCode::FailedParseValue;
+            // without SQ8 rescoring the full vectors are never read, so they are not mapped at all
+            m_bQuantizedOnly = SQ8Enabled() && m_iSQ8RerankNumber <= 0;
+            if (!m_bQuantizedOnly && m_pSamples.Load((char*)p_indexBlobs[0].Data()) != ErrorCode::Success) return ErrorCode::FailedParseValue;
             if (m_pTrees.LoadTrees((char*)p_indexBlobs[1].Data()) != ErrorCode::Success) return ErrorCode::FailedParseValue;
             if (m_pGraph.LoadGraph((char*)p_indexBlobs[2].Data()) != ErrorCode::Success) return ErrorCode::FailedParseValue;
             if (p_indexBlobs.size() > 3 && m_deletedID.Load((char*)p_indexBlobs[3].Data()) != ErrorCode::Success) return ErrorCode::FailedParseValue;
+            if (m_iPQSubvectors > 0 && (p_indexBlobs.size() <= 4 || LoadPQ((char*)p_indexBlobs[4].Data()) != ErrorCode::Success)) return ErrorCode::FailedParseValue;
+            if (m_bSQ8 && (p_indexBlobs.size() <= SQ8Stream() || LoadSQ8((char*)p_indexBlobs[SQ8Stream()].Data()) != ErrorCode::Success)) return ErrorCode::FailedParseValue;
 
+            SelectDistanceKernels();
+            UpdateNorms(0, GetNumSamples());
             omp_set_num_threads(m_iNumberOfThreads);
-            m_workSpacePool.reset(new COMMON::WorkSpacePool(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), GetNumSamples(), m_iHashTableExp));
+            m_workSpacePool.reset(new COMMON::WorkSpacePool(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), GetNumSamples(), m_iHashTableExp, m_bEpochVisitedSet));
             m_workSpacePool->Init(m_iNumberOfThreads);
             m_threadPool.init();
             return ErrorCode::Success;
@@ -49,13 +56,27 @@ namespace SPTAG
             if (p_indexStreams.size() < 3) return ErrorCode::LackOfInputs;
 
             ErrorCode ret = ErrorCode::Success;
-            if ((ret = m_pSamples.Load(p_indexStreams[0])) != ErrorCode::Success) return ret;
+            m_bQuantizedOnly = SQ8Enabled() && m_iSQ8RerankNumber <= 0;
+            if (m_bQuantizedOnly) {
+                if ((ret = COMMON::Dataset<T>::Skip(p_indexStreams[0])) != ErrorCode::Success) return ret;
+            }
+            else if ((ret = m_pSamples.Load(p_indexStreams[0])) != ErrorCode::Success) return ret;
             if ((ret = m_pTrees.LoadTrees(p_indexStreams[1])) != ErrorCode::Success) return ret;
             if ((ret = m_pGraph.LoadGraph(p_indexStreams[2])) != ErrorCode::Success) return ret;
             if (p_indexStreams.size() > 3 && (ret = m_deletedID.Load(p_indexStreams[3])) != ErrorCode::Success) return ret;
+            if (m_iPQSubvectors > 0) {
+                if (p_indexStreams.size() <= 4) return ErrorCode::LackOfInputs;
+                if ((ret = LoadPQ(p_indexStreams[4])) != ErrorCode::Success) return ret;
+            }
+            if (m_bSQ8) {
+                if (p_indexStreams.size() <= SQ8Stream()) return ErrorCode::LackOfInputs;
+                if ((ret = LoadSQ8(p_indexStreams[SQ8Stream()])) != ErrorCode::Success) return ret;
+            }
 
+            SelectDistanceKernels();
+            UpdateNorms(0, GetNumSamples());
             omp_set_num_threads(m_iNumberOfThreads);
-            m_workSpacePool.reset(new COMMON::WorkSpacePool(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), GetNumSamples(), m_iHashTableExp));
+            m_workSpacePool.reset(new COMMON::WorkSpacePool(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), GetNumSamples(), m_iHashTableExp, m_bEpochVisitedSet));
             m_workSpacePool->Init(m_iNumberOfThreads);
             m_threadPool.init();
             return ret;
@@ -78,7 +99,8 @@ namespace SPTAG
         ErrorCode Index<T>::SaveIndexData(const std::vector<std::shared_ptr<Helper::DiskPriorityIO>>& p_indexStreams)
         {
             if (p_indexStreams.size() < 4) return ErrorCode::LackOfInputs;
-            
+            if (!CheckFullVectors()) return ErrorCode::Fail;
+
             std::lock_guard<std::mutex> lock(m_dataAddLock);
             std::unique_lock<std::shared_timed_mutex> uniquelock(m_dataDeleteLock);
 
@@ -87,22 +109,40 @@ namespace SPTAG
             if ((ret = m_pTrees.SaveTrees(p_indexStreams[1])) != ErrorCode::Success) return ret;
             if ((ret = m_pGraph.SaveGraph(p_indexStreams[2])) != ErrorCode::Success) return ret;
             if ((ret = m_deletedID.Save(p_indexStreams[3])) != ErrorCode::Success) return ret;
+            if (m_iPQSubvectors > 0) {
+                if (p_indexStreams.size() <= 4) return ErrorCode::LackOfInputs;
+                if ((ret = SavePQ(p_indexStreams[4])) != ErrorCode::Success) return ret;
+            }
+            if (m_bSQ8) {
+                if (p_indexStreams.size() <= SQ8Stream()) return ErrorCode::LackOfInputs;
+                if ((ret = SaveSQ8(p_indexStreams[SQ8Stream()])) != ErrorCode::Success) return ret;
+            }
             return ret;
         }
 
 #pragma region K-NN search
 #define Search(CheckDeleted, CheckDuplicated) \
         std::shared_lock<std::shared_timed_mutex> lock(*(m_pTrees.m_lock)); \
-        m_pTrees.InitSearchTrees(m_pSamples, m_fComputeDistance, p_query, p_space); \
-        m_pTrees.SearchTrees(m_pSamples, m_fComputeDistance, p_query, p_space, m_iNumberOfInitialDynamicPivots); \
+        m_pTrees.InitSearchTrees(fDistanceTo, p_space); \
+        m_pTrees.SearchTrees(fDistanceTo, p_space, m_iNumberOfInitialDynamicPivots); \
         const DimensionType checkPos = m_pGraph.m_iNeighborhoodSize - 1; \
+        p_space.ReserveBatch(m_pGraph.m_iNeighborhoodSize); \
         while (!p_space.m_NGQueue.empty()) { \
             COMMON::HeapCell gnode = p_space.m_NGQueue.pop(); \
+            if (p_space.m_termination.m_active && m_termination.ShouldStop(p_space.m_termination, p_space.m_iNumberOfCheckedLeaves, gnode.distance, p_query)) { \
+                p_space.m_terminationReason = TerminationReason::Adaptive; \
+                p_query.SortResult(); return; \
+            } \
+            p_space.m_iNumberOfHops++; \
+            if (p_space.DeadlinePassed()) { \
+                p_space.m_terminationReason = TerminationReason::Deadline; \
+                p_query.SortResult(); return; \
+            } \
             SizeType tmpNode = gnode.node; \
             const SizeType *node = m_pGraph[tmpNode]; \
             _mm_prefetch((const char *)node, _MM_HINT_T0); \
             for (DimensionType i = 0; i <= checkPos; i++) { \
-                _mm_prefetch((const char *)(m_pSamples)[node[i]], _MM_HINT_T0); \
+                _mm_prefetch((const char *)ScoredVector(node[i], p_mode), _MM_HINT_T0); \
             } \
             if (gnode.distance <= p_query.worstDist()) { \
                 SizeType checkNode = node[checkPos]; \
@@ -128,21 +168,29 @@ namespace SPTAG
             } else { \
                 p_space.m_iNumOfContinuousNoBetterPropagation++; \
                 if (p_space.m_iNumOfContinuousNoBetterPropagation > p_space.m_iContinuousLimit || p_space.m_iNumberOfCheckedLeaves > p_space.m_iMaxCheck) { \
+                    p_space.m_terminationReason = p_space.m_iNumOfContinuousNoBetterPropagation > p_space.m_iContinuousLimit ? TerminationReason::NoBetterPropagation : TerminationReason::MaxCheck; \
                     p_query.SortResult(); return; \
                 } \
             } \
+            int batchCount = 0; \
             for (DimensionType i = 0; i <= checkPos; i++) { \
                 SizeType nn_index = node[i]; \
                 if (nn_index < 0) break; \
                 if (p_space.CheckAndSet(nn_index)) continue; \
-                float distance2leaf = m_fComputeDistance(p_query.GetTarget(), (m_pSamples)[nn_index], GetFeatureDim()); \
-                p_space.m_iNumberOfCheckedLeaves++; \
-                p_space.m_NGQueue.insert(COMMON::HeapCell(nn_index, distance2leaf)); \
+                p_space.m_batchNodes[batchCount] = nn_index; \
+                p_space.m_batchVectors[batchCount++] = ScoredVector(nn_index, p_mode); \
+            } \
+            ScoreBatch(p_query, p_space, batchCount, p_mode); \
+            p_space.m_iNumberOfCheckedLeaves += batchCount; \
+            p_space.m_iNumberOfDistanceEvaluations += batchCount; \
+            for (int i = 0; i < batchCount; i++) { \
+                p_space.m_NGQueue.insert(COMMON::HeapCell(p_space.m_batchNodes[i], p_space.m_batchDists[i])); \
             } \
             if (p_space.m_NGQueue.Top().distance > p_space.m_SPTQueue.Top().distance) { \
-                m_pTrees.SearchTrees(m_pSamples, m_fComputeDistance, p_query, p_space, m_iNumberOfOtherDynamicPivots + p_space.m_iNumberOfCheckedLeaves); \
+                m_pTrees.SearchTrees(fDistanceTo, p_space, m_iNumberOfOtherDynamicPivots + p_space.m_iNumberOfCheckedLeaves); \
             } \
         } \
+        p_space.m_terminationReason = TerminationReason::QueueEmpty; \
         p_query.SortResult(); \
 /*
 #define Search(CheckDeleted, CheckDuplicated) \
@@ -203,9 +251,110 @@ namespace SPTAG
 */
 
         template <typename T>
-        void Index<T>::SearchIndex(COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space, bool p_searchDeleted, bool p_searchDuplicated) const
+        float Index<T>::ScoreVector(const COMMON::QueryResultSet<T> &p_query, const COMMON::WorkSpace &p_space, SizeType p_id, ScoreMode p_mode) const
+        {
+            switch (p_mode)
+            {
+            case ScoreMode::PQ:
+                return m_pQuantizer.ComputeDistance(p_space.m_adcTable.data(), m_pPQCodes[p_id]);
+            case ScoreMode::SQ8:
+                return m_pSQ8Quantizer.ComputeDistance(p_space.m_quantizedQuery.data(), m_pSQ8Codes[p_id]);
+            default:
+                return m_fComputeDistance(p_query.GetTarget(), m_pSamples[p_id], GetFeatureDim());
+            }
+        }
+
+        template <typename T>
+        const void* Index<T>::ScoredVector(SizeType p_id, ScoreMode p_mode) const
+        {
+            switch (p_mode)
+            {
+            case ScoreMode::PQ:
+                return m_pPQCodes[p_id];
+            case ScoreMode::SQ8:
+                return m_pSQ8Codes[p_id];
+            default:
+                return m_pSamples[p_id];
+            }
+        }
+
+        template <typename T>
+        size_t Index<T>::ScoredVectorSize(ScoreMode p_mode) const
+        {
+            switch (p_mode)
+            {
+            case ScoreMode::PQ:
+                return m_pPQCodes.C();
+            case ScoreMode::SQ8:
+                return m_pSQ8Codes.C();
+            default:
+                return sizeof(T) * GetFeatureDim();
+            }
+        }
+
+        // Scores p_space.m_batchVectors[0, p_count) into p_space.m_batchDists.
+        template <typename T>
+        void Index<T>::ScoreBatch(const COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space, int p_count, ScoreMode p_mode) const
         {
-            if (m_deletedID.Count() == 0 || p_searchDeleted)
+            switch (p_mode)
+            {
+            case ScoreMode::PQ:
+                m_pQuantizer.ComputeDistanceBatch(p_space.m_adcTable.data(), (const std::uint8_t* const*)p_space.m_batchVectors.data(), p_count, p_space.m_batchDists.data());
+                break;
+            case ScoreMode::SQ8:
+                m_pSQ8Quantizer.ComputeDistanceBatch(p_space.m_quantizedQuery.data(), (const std::uint8_t* const*)p_space.m_batchVectors.data(), p_count, p_space.m_batchDists.data());
+                break;
+            default:
+                // once the result set is full, candidates beyond its worst distance stop being scored early
+                if (EarlyAbandonEnabled() && p_query.worstDist() < MaxDist) {
+                    for (int i = 0; i < p_count; i++) p_space.m_batchDists[i] = ScoreVectorBounded(p_query, p_space, p_space.m_batchNodes[i], p_query.worstDist());
+                    break;
+                }
+                m_fComputeDistanceBatch(p_query.GetTarget(), (const T* const*)p_space.m_batchVectors.data(), p_count, GetFeatureDim(), p_space.m_batchDists.data());
+                break;
+            }
+        }
+
+        // Full precision distance to p_id, or a lower bound above p_bound when the computation is abandoned.
+        template <typename T>
+        float Index<T>::ScoreVectorBounded(const COMMON::QueryResultSet<T> &p_query, const COMMON::WorkSpace &p_space, SizeType p_id, float p_bound) const
+        {
+            switch (m_iDistCalcMethod)
+            {
+            case DistCalcMethod::Cosine:
+            case DistCalcMethod::InnerProduct:
+                return COMMON::DistanceUtils::ComputeDotDistanceBounded(p_query.GetTarget(), m_pSamples[p_id], GetFeatureDim(), p_bound,
+                    ChunkBase(), p_space.m_queryRestNorms.data(), std::sqrt(*m_pNorms[p_id]), m_fComputePartialDistance);
+            default:
+                return COMMON::DistanceUtils::ComputeMonotoneDistanceBounded(p_query.GetTarget(), m_pSamples[p_id], GetFeatureDim(), p_bound, m_fComputePartialDistance);
+            }
+        }
+
+        template <typename T>
+        void Index<T>::SearchIndex(COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space, bool p_searchDeleted, bool p_searchDuplicated, ScoreMode p_mode) const
+        {
+            // tree centers and graph neighbors are all scored on the p_mode representation
+            auto fDistanceTo = [&](SizeType p_id) {
+                return ScoreVector(p_query, p_space, p_id, p_mode);
+            };
+            if (p_mode == ScoreMode::Full && EarlyAbandonEnabled() && NormsCached()) {
+                COMMON::DistanceUtils::ComputeRestNorms(p_query.GetTarget(), GetFeatureDim(), ChunkBase(), m_fComputePartialDistance, p_space.m_queryRestNorms);
+            }
+
+            if (p_space.m_filter != nullptr)
+            {
+                // Rejected vectors still lead to their neighbors, but never reset the no better propagation count:
+                // results may fill slowly, so MaxCheck bounds the search.
+                if (p_searchDuplicated)
+                {
+                    Search(if (!p_space.m_filter->Allows(tmpNode) || (!p_searchDeleted && m_deletedID.Contains(tmpNode))) { if (p_space.m_iNumberOfCheckedLeaves > p_space.m_iMaxCheck) { p_space.m_terminationReason = TerminationReason::MaxCheck; p_query.SortResult(); return; } } else, if (!p_query.AddPoint(tmpNode, gnode.distance)))
+                }
+                else
+                {
+                    Search(if (!p_space.m_filter->Allows(tmpNode) || (!p_searchDeleted && m_deletedID.Contains(tmpNode))) { if (p_space.m_iNumberOfCheckedLeaves > p_space.m_iMaxCheck) { p_space.m_terminationReason = TerminationReason::MaxCheck; p_query.SortResult(); return; } } else, p_query.AddPoint(tmpNode, gnode.distance);)
+                }
+            }
+            else if (m_deletedID.Count() == 0 || p_searchDeleted)
             {
                 if (p_searchDuplicated)
                 {
@@ -229,18 +378,443 @@ namespace SPTAG
             }
         }
 
+        template <typename T>
+        void Index<T>::PrepareQuantizedQuery(const COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space, ScoreMode p_mode) const
+        {
+            if (p_mode == ScoreMode::PQ) {
+                p_space.m_adcTable.resize(m_pQuantizer.ADCTableSize());
+                m_pQuantizer.BuildADCTable(p_query.GetTarget(), m_iDistCalcMethod, p_space.m_adcTable.data());
+            }
+            else {
+                p_space.m_quantizedQuery.resize(m_pSQ8Quantizer.CodeSize());
+                m_pSQ8Quantizer.Encode(p_query.GetTarget(), p_space.m_quantizedQuery.data());
+            }
+        }
+
+        // Ranks the quantized candidates of a traversal by their exact distances, returning how many were scored.
+        template <typename T>
+        int Index<T>::RerankCandidates(COMMON::QueryResultSet<T> &p_candidates, COMMON::QueryResultSet<T> &p_query) const
+        {
+            int scored = 0;
+            for (int i = 0; i < p_candidates.GetResultNum(); i++)
+            {
+                SizeType vid = p_candidates.GetResult(i)->VID;
+                if (vid < 0) continue;
+                p_query.AddPoint(vid, m_fComputeDistance(p_query.GetTarget(), m_pSamples[vid], GetFeatureDim()));
+                scored++;
+            }
+            p_query.SortResult();
+            return scored;
+        }
+
+        template <typename T>
+        void Index<T>::SearchIndexQuantized(COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space, bool p_searchDeleted, ScoreMode p_mode, int p_rerankNumber) const
+        {
+            PrepareQuantizedQuery(p_query, p_space, p_mode);
+
+            if (p_rerankNumber <= 0) {
+                SearchIndex(p_query, p_space, p_searchDeleted, true, p_mode);
+                return;
+            }
+
+            // the traversal only keeps the best quantized candidates, which are then ranked by their exact distances
+            COMMON::QueryResultSet<T> candidates(p_query.GetTarget(), max(p_query.GetResultNum(), p_rerankNumber));
+            SearchIndex(candidates, p_space, p_searchDeleted, true, p_mode);
+            p_space.m_iNumberOfDistanceEvaluations += RerankCandidates(candidates, p_query);
+        }
+
+        // Runs the Search loop above for every query of p_group in lockstep, with searchDuplicated set.
+        // Each round has two passes: the first expands the node every query popped in the previous round,
+        // whose graph row was prefetched meanwhile, and prefetches the unvisited neighbors; the second
+        // scores them and pops the next node. The other queries' work hides the latency of each prefetch,
+        // and every query takes the same steps, so it gets the same results as a SearchIndex call.
+        template <typename T>
+        void Index<T>::SearchIndexInterleaved(std::vector<InterleavedQuery>& p_group, bool p_searchDeleted, ScoreMode p_mode) const
+        {
+            std::shared_lock<std::shared_timed_mutex> lock(*(m_pTrees.m_lock));
+            const DimensionType checkPos = m_pGraph.m_iNeighborhoodSize - 1;
+            const bool checkDeleted = !p_searchDeleted && m_deletedID.Count() > 0;
+            const size_t vectorSize = ScoredVectorSize(p_mode);
+
+            auto popNode = [&](InterleavedQuery& p_entry) {
+                if (p_entry.m_space->m_NGQueue.empty()) {
+                    p_entry.m_space->m_terminationReason = TerminationReason::QueueEmpty;
+                    p_entry.m_query->SortResult();
+                    p_entry.m_active = false;
+                    return;
+                }
+                p_entry.m_node = p_entry.m_space->m_NGQueue.pop();
+                _mm_prefetch((const char *)m_pGraph[p_entry.m_node.node], _MM_HINT_T0);
+            };
+
+            int active = 0;
+            for (InterleavedQuery& entry : p_group)
+            {
+                COMMON::QueryResultSet<T>& query = *entry.m_query;
+                COMMON::WorkSpace& space = *entry.m_space;
+                auto fDistanceTo = [&](SizeType p_id) {
+                    return ScoreVector(query, space, p_id, p_mode);
+                };
+                if (p_mode == ScoreMode::Full && EarlyAbandonEnabled() && NormsCached()) {
+                    COMMON::DistanceUtils::ComputeRestNorms(query.GetTarget(), GetFeatureDim(), ChunkBase(), m_fComputePartialDistance, space.m_queryRestNorms);
+                }
+                m_pTrees.InitSearchTrees(fDistanceTo, space);
+                m_pTrees.SearchTrees(fDistanceTo, space, m_iNumberOfInitialDynamicPivots);
+                space.ReserveBatch(m_pGraph.m_iNeighborhoodSize);
+                entry.m_active = true;
+                popNode(entry);
+                if (entry.m_active) active++;
+            }
+
+            while (active > 0)
+            {
+                for (InterleavedQuery& entry : p_group)
+                {
+                    if (!entry.m_active) continue;
+
+                    COMMON::QueryResultSet<T>& query = *entry.m_query;
+                    COMMON::WorkSpace& space = *entry.m_space;
+                    const COMMON::HeapCell& gnode = entry.m_node;
+                    if (space.m_termination.m_active && m_termination.ShouldStop(space.m_termination, space.m_iNumberOfCheckedLeaves, gnode.distance, query)) {
+                        space.m_terminationReason = TerminationReason::Adaptive;
+                        query.SortResult();
+                        entry.m_active = false;
+                        active--;
+                        continue;
+                    }
+                    space.m_iNumberOfHops++;
+                    if (space.DeadlinePassed()) {
+                        space.m_terminationReason = TerminationReason::Deadline;
+                        query.SortResult();
+                        entry.m_active = false;
+                        active--;
+                        continue;
+                    }
+                    SizeType tmpNode = gnode.node;
+                    const SizeType *node = m_pGraph[tmpNode];
+                    if (gnode.distance <= query.worstDist()) {
+                        SizeType checkNode = node[checkPos];
+                        if (checkNode < -1) {
+                            const COMMON::BKTNode& tnode = m_pTrees[-2 - checkNode];
+                            SizeType i = -tnode.childStart;
+                            do {
+                                if (!checkDeleted || !m_deletedID.Contains(tmpNode))
+                                {
+                                    space.m_iNumOfContinuousNoBetterPropagation = 0;
+                                    if (!query.AddPoint(tmpNode, gnode.distance)) break;
+                                }
+                                tmpNode = m_pTrees[i].centerid;
+                            } while (i++ < tnode.childEnd);
+                        } else if (!checkDeleted || !m_deletedID.Contains(tmpNode)) {
+                            space.m_iNumOfContinuousNoBetterPropagation = 0;
+                            query.AddPoint(tmpNode, gnode.distance);
+                        }
+                    } else {
+                        space.m_iNumOfContinuousNoBetterPropagation++;
+                        if (space.m_iNumOfContinuousNoBetterPropagation > space.m_iContinuousLimit || space.m_iNumberOfCheckedLeaves > space.m_iMaxCheck) {
+                            space.m_terminationReason = space.m_iNumOfContinuousNoBetterPropagation > space.m_iContinuousLimit ? TerminationReason::NoBetterPropagation : TerminationReason::MaxCheck;
+                            query.SortResult();
+                            entry.m_active = false;
+                            active--;
+                            continue;
+                        }
+                    }
+
+                    int batchCount = 0;
+                    for (DimensionType i = 0; i <= checkPos; i++) {
+                        SizeType nn_index = node[i];
+                        if (nn_index < 0) break;
+                        if (space.CheckAndSet(nn_index)) continue;
+                        space.m_batchNodes[batchCount] = nn_index;
+                        space.m_batchVectors[batchCount] = ScoredVector(nn_index, p_mode);
+                        COMMON::Utils::PrefetchRange(space.m_batchVectors[batchCount++], vectorSize);
+                    }
+                    entry.m_batchCount = batchCount;
+                }
+
+                for (InterleavedQuery& entry : p_group)
+                {
+                    if (!entry.m_active) continue;
+
+                    COMMON::QueryResultSet<T>& query = *entry.m_query;
+                    COMMON::WorkSpace& space = *entry.m_space;
+                    ScoreBatch(query, space, entry.m_batchCount, p_mode);
+                    space.m_iNumberOfCheckedLeaves += entry.m_batchCount;
+                    space.m_iNumberOfDistanceEvaluations += entry.m_batchCount;
+                    for (int i = 0; i < entry.m_batchCount; i++) {
+                        space.m_NGQueue.insert(COMMON::HeapCell(space.m_batchNodes[i], space.m_batchDists[i]));
+                    }
+                    if (space.m_NGQueue.Top().distance > space.m_SPTQueue.Top().distance) {
+                        auto fDistanceTo = [&](SizeType p_id) {
+                            return ScoreVector(query, space, p_id, p_mode);
+                        };
+                        m_pTrees.SearchTrees(fDistanceTo, space, m_iNumberOfOtherDynamicPivots + space.m_iNumberOfCheckedLeaves);
+                    }
+                    popNode(entry);
+                    if (!entry.m_active) active--;
+                }
+            }
+        }
+
         template<typename T>
         ErrorCode Index<T>::SearchIndex(QueryResult &p_query, bool p_searchDeleted) const
+        {
+            return SearchQuery(p_query, p_searchDeleted, nullptr, true, nullptr);
+        }
+
+        template<typename T>
+        ErrorCode Index<T>::SearchIndexTrace(QueryResult &p_query, std::vector<COMMON::TerminationTracePoint>& p_trace) const
+        {
+            return SearchQuery(p_query, false, nullptr, true, &p_trace);
+        }
+
+        template<typename T>
+        ErrorCode Index<T>::SearchQuery(QueryResult &p_query, bool p_searchDeleted, const SearchFilter* p_filter, bool p_adaptive, std::vector<COMMON::TerminationTracePoint>* p_trace) const
         {
             if (!m_bReady) return ErrorCode::EmptyIndex;
 
+            auto start = std::chrono::steady_clock::now();
             auto workSpace = m_workSpacePool->Rent();
             workSpace->Reset(m_iMaxCheck);
+            workSpace->m_deadline = p_query.GetDeadline();
+            workSpace->m_termination.Reset(p_adaptive && m_termination.Enabled(), p_trace);
+            workSpace->m_filter = p_filter;
+
+            if (m_pQuantizer.Available())
+                SearchIndexQuantized(*((COMMON::QueryResultSet<T>*)&p_query), *workSpace, p_searchDeleted, ScoreMode::PQ, m_iPQRerankNumber);
+            else if (m_pSQ8Quantizer.Available())
+                SearchIndexQuantized(*((COMMON::QueryResultSet<T>*)&p_query), *workSpace, p_searchDeleted, ScoreMode::SQ8, m_bQuantizedOnly ? 0 : m_iSQ8RerankNumber);
+            else
+                SearchIndex(*((COMMON::QueryResultSet<T>*)&p_query), *workSpace, p_searchDeleted, true);
+
+            if (p_trace != nullptr)
+                COMMON::TerminationPredictor::Finish(workSpace->m_termination, workSpace->m_iNumberOfCheckedLeaves, *((COMMON::QueryResultSet<T>*)&p_query));
+            SearchStats stats = workSpace->Stats();
+            m_workSpacePool->Return(std::move(workSpace));
+
+            SetResultMetadata(p_query);
+            stats.m_wallTimeMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+            p_query.SetStats(stats);
+            return ErrorCode::Success;
+        }
+
+        template<typename T>
+        ErrorCode Index<T>::SearchIndexRange(QueryResult &p_query, float p_radius, int p_maxResults, bool p_searchDeleted) const
+        {
+            if (!m_bReady) return ErrorCode::EmptyIndex;
+            if (p_maxResults <= 0) return ErrorCode::Fail;
+
+            // A k-NN search whose k doubles until its worst result falls outside the radius, so the ball is known to
+            // be complete. Seeding the slots with the radius instead would prune the traversal before it reaches
+            // members only connected through vectors outside the ball.
+            int capacity = min(p_maxResults, max(p_query.GetResultNum(), c_rangeSearchInitialResults));
+            std::unique_ptr<COMMON::QueryResultSet<T>> range;
+            SearchStats stats;
+            while (true)
+            {
+                range.reset(new COMMON::QueryResultSet<T>((const T*)p_query.GetTarget(), capacity));
+                range->SetDeadline(p_query.GetDeadline());
+                SearchQuery(*range, p_searchDeleted, nullptr, false, nullptr);
+                stats.Accumulate(range->GetStats());
+                const BasicResult* worst = range->GetResult(capacity - 1);
+                if (range->IsTruncated() || capacity == p_maxResults || worst->VID < 0 || worst->Dist > p_radius) break;
+                capacity = (int)min((std::int64_t)p_maxResults, (std::int64_t)capacity * 2);
+            }
+
+            int found = 0;
+            while (found < capacity && range->GetResult(found)->VID >= 0 && range->GetResult(found)->Dist <= p_radius) found++;
+            p_query.Init(p_query.GetTarget(), found, p_query.WithMeta());
+            for (int i = 0; i < found; i++) p_query.SetResult(i, range->GetResult(i)->VID, range->GetResult(i)->Dist);
+            SetResultMetadata(p_query);
+            p_query.SetStats(stats);
+            return ErrorCode::Success;
+        }
+
+        template<typename T>
+        ErrorCode Index<T>::SearchIndexFiltered(QueryResult &p_query, const SearchFilter& p_filter, bool p_searchDeleted) const
+        {
+            // The termination model is fitted on unfiltered searches, whose results fill up far sooner.
+            return SearchQuery(p_query, p_searchDeleted, &p_filter, false, nullptr);
+        }
+
+        // Best-first traversal kept alive between pages in a leased workspace. Popped candidates wait in m_ready
+        // until no queued candidate is closer, so every page comes out closest first.
+        template <typename T>
+        class Index<T>::SearchIterator : public ResultIterator
+        {
+        public:
+            SearchIterator(const Index<T>* p_index, const void* p_target, bool p_searchDeleted)
+                : m_index(p_index), m_pool(p_index->m_workSpacePool), m_searchDeleted(p_searchDeleted),
+                m_target((const T*)p_target, (const T*)p_target + p_index->m_pSamples.C())
+            {
+                m_lease = m_pool->Lease(p_index->m_iIteratorTimeout);
+                m_lease->m_workSpace->Reset(p_index->m_iMaxCheck);
+            }
+
+            ~SearchIterator()
+            {
+                Close();
+            }
+
+            void Close()
+            {
+                m_pool->Release(*m_lease);
+            }
+
+            ErrorCode Next(QueryResult& p_results)
+            {
+                std::lock_guard<std::mutex> leaseLock(m_lease->m_lock);
+                if (m_lease->m_workSpace == nullptr) return ErrorCode::SearchExpired;
+                m_lease->m_lastUse = std::chrono::steady_clock::now();
+
+                COMMON::WorkSpace& space = *(m_lease->m_workSpace);
+                std::shared_lock<std::shared_timed_mutex> lock(*(m_index->m_pTrees.m_lock));
+                auto fDistanceTo = [&](SizeType p_id) {
+                    return m_index->m_fComputeDistance(m_target.data(), m_index->m_pSamples[p_id], m_index->GetFeatureDim());
+                };
+                if (!m_started)
+                {
+                    m_index->m_pTrees.InitSearchTrees(fDistanceTo, space);
+                    m_index->m_pTrees.SearchTrees(fDistanceTo, space, m_index->m_iNumberOfInitialDynamicPivots);
+                    m_started = true;
+                }
+
+                // A page checks about MaxCheck vectors; past the visited set's limit the queue is only drained.
+                const DimensionType checkPos = m_index->m_pGraph.m_iNeighborhoodSize - 1;
+                const int pageLimit = space.m_iNumberOfCheckedLeaves + m_index->m_iMaxCheck;
+                const SizeType visitLimit = space.VisitLimit();
+                space.ReserveBatch(m_index->m_pGraph.m_iNeighborhoodSize);
+                int found = 0;
+                while (found < p_results.GetResultNum())
+                {
+                    while (!space.m_NGQueue.empty() && (m_ready.empty() || space.m_NGQueue.Top().distance < m_ready.top().distance))
+                    {
+                        bool expand = space.m_iNumberOfCheckedLeaves < visitLimit;
+                        if (expand && !m_ready.empty() && space.m_iNumberOfCheckedLeaves >= pageLimit) break;
+
+                        COMMON::HeapCell gnode = space.m_NGQueue.pop();
+                        const SizeType* node = m_index->m_pGraph[gnode.node];
+                        if (m_searchDeleted || !m_index->m_deletedID.Contains(gnode.node)) m_ready.push(gnode);
+                        SizeType checkNode = node[checkPos];
+                        if (checkNode < -1)
+                        {
+                            // duplicates of the vector, listed under its tree node
+                            const COMMON::BKTNode& tnode = m_index->m_pTrees[-2 - checkNode];
+                            for (SizeType i = -tnode.childStart; i < tnode.childEnd; i++)
+                            {
+                                SizeType duplicate = m_index->m_pTrees[i].centerid;
+                                if (space.CheckAndSet(duplicate)) continue;
+                                if (m_searchDeleted || !m_index->m_deletedID.Contains(duplicate)) m_ready.push(COMMON::HeapCell(duplicate, gnode.distance));
+                            }
+                        }
+                        if (!expand) continue;
+
+                        int batchCount = 0;
+                        for (DimensionType i = 0; i <= checkPos; i++)
+                        {
+                            SizeType nn_index = node[i];
+                            if (nn_index < 0) break;
+                            if (space.CheckAndSet(nn_index)) continue;
+                            space.m_batchNodes[batchCount] = nn_index;
+                            space.m_batchVectors[batchCount++] = m_index->m_pSamples[nn_index];
+                        }
+                        m_index->m_fComputeDistanceBatch(m_target.data(), (const T* const*)space.m_batchVectors.data(), batchCount, m_index->GetFeatureDim(), space.m_batchDists.data());
+                        space.m_iNumberOfCheckedLeaves += batchCount;
+                        for (int i = 0; i < batchCount; i++) space.m_NGQueue.insert(COMMON::HeapCell(space.m_batchNodes[i], space.m_batchDists[i]));
+                        if (!space.m_SPTQueue.empty() && (space.m_NGQueue.empty() || space.m_NGQueue.Top().distance > space.m_SPTQueue.Top().distance))
+                            m_index->m_pTrees.SearchTrees(fDistanceTo, space, m_index->m_iNumberOfOtherDynamicPivots + space.m_iNumberOfCheckedLeaves);
+                    }
+                    if (m_ready.empty()) break;
+                    p_results.SetResult(found++, m_ready.top().node, m_ready.top().distance);
+                    m_ready.pop();
+                }
+                for (int i = found; i < p_results.GetResultNum(); i++) p_results.SetResult(i, -1, MaxDist);
+                m_index->SetResultMetadata(p_results);
+                return ErrorCode::Success;
+            }
+
+        private:
+            const Index<T>* m_index;
+            std::shared_ptr<COMMON::WorkSpacePool> m_pool;
+            std::shared_ptr<COMMON::WorkSpaceLease> m_lease;
+            bool m_searchDeleted;
+            bool m_started = false;
+            std::vector<T> m_target;
+            std::priority_queue<COMMON::HeapCell, std::vector<COMMON::HeapCell>, std::greater<COMMON::HeapCell>> m_ready;
+        };
+
+        template<typename T>
+        ErrorCode Index<T>::BeginSearch(const void* p_target, std::shared_ptr<ResultIterator>& p_iterator, bool p_searchDeleted) const
+        {
+            if (!m_bReady) return ErrorCode::EmptyIndex;
+            if (!CheckFullVectors()) return ErrorCode::Fail;
+
+            p_iterator.reset(new SearchIterator(this, p_target, p_searchDeleted));
+            return ErrorCode::Success;
+        }
+
+        template<typename T>
+        ErrorCode Index<T>::SearchIndexBatch(QueryResult* p_queries, int p_count, bool p_searchDeleted) const
+        {
+            if (!m_bReady) return ErrorCode::EmptyIndex;
+            if (m_iSearchGroupSize <= 1) return VectorIndex::SearchIndexBatch(p_queries, p_count, p_searchDeleted);
+
+            ScoreMode mode = ScoreMode::Full;
+            int rerankNumber = 0;
+            if (m_pQuantizer.Available()) {
+                mode = ScoreMode::PQ;
+                rerankNumber = m_iPQRerankNumber;
+            }
+            else if (m_pSQ8Quantizer.Available()) {
+                mode = ScoreMode::SQ8;
+                rerankNumber = m_bQuantizedOnly ? 0 : m_iSQ8RerankNumber;
+            }
+
+            std::vector<std::unique_ptr<COMMON::WorkSpace>> workSpaces;
+            std::vector<std::unique_ptr<COMMON::QueryResultSet<T>>> candidates;
+            std::vector<InterleavedQuery> group;
+            for (int start = 0; start < p_count; start += m_iSearchGroupSize)
+            {
+                int end = min(start + m_iSearchGroupSize, p_count);
+                workSpaces.clear();
+                candidates.clear();
+                group.clear();
+                for (int i = start; i < end; i++)
+                {
+                    COMMON::QueryResultSet<T>* query = (COMMON::QueryResultSet<T>*)(p_queries + i);
+                    workSpaces.push_back(m_workSpacePool->Rent());
+                    workSpaces.back()->Reset(m_iMaxCheck);
+                    workSpaces.back()->m_deadline = p_queries[i].GetDeadline();
+                    workSpaces.back()->m_termination.Reset(m_termination.Enabled());
+                    if (mode != ScoreMode::Full) PrepareQuantizedQuery(*query, *workSpaces.back(), mode);
+                    if (rerankNumber > 0) {
+                        candidates.emplace_back(new COMMON::QueryResultSet<T>(query->GetTarget(), max(query->GetResultNum(), rerankNumber)));
+                        query = candidates.back().get();
+                    }
+                    group.push_back({ query, workSpaces.back().get(), COMMON::HeapCell(), 0, false });
+                }
 
-            SearchIndex(*((COMMON::QueryResultSet<T>*)&p_query), *workSpace, p_searchDeleted, true);
+                // the group's queries run in lockstep, so each is charged the whole group's time
+                auto groupStart = std::chrono::steady_clock::now();
+                SearchIndexInterleaved(group, p_searchDeleted, mode);
+                float groupTimeMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - groupStart).count();
 
-            m_workSpacePool->Return(workSpace);
+                for (int i = start; i < end; i++)
+                {
+                    if (rerankNumber > 0) workSpaces[i - start]->m_iNumberOfDistanceEvaluations += RerankCandidates(*candidates[i - start], *((COMMON::QueryResultSet<T>*)(p_queries + i)));
+                    SearchStats stats = workSpaces[i - start]->Stats();
+                    stats.m_wallTimeMs = groupTimeMs;
+                    p_queries[i].SetStats(stats);
+                    m_workSpacePool->Return(std::move(workSpaces[i - start]));
+                    SetResultMetadata(p_queries[i]);
+                }
+            }
+            return ErrorCode::Success;
+        }
 
+        template<typename T>
+        void Index<T>::SetResultMetadata(QueryResult &p_query) const
+        {
             if (p_query.WithMeta() && nullptr != m_pMetadata)
             {
                 for (int i = 0; i < p_query.GetResultNum(); ++i)
@@ -249,24 +823,41 @@ namespace SPTAG
                     p_query.SetMetadata(i, (result < 0) ? ByteArray::c_empty : m_pMetadata->GetMetadataCopy(result));
                 }
             }
-            return ErrorCode::Success;
         }
 
         template<typename T>
         ErrorCode Index<T>::RefineSearchIndex(QueryResult &p_query, bool p_searchDeleted) const
         {
+            if (!CheckFullVectors()) return ErrorCode::Fail;
+
             auto workSpace = m_workSpacePool->Rent();
             workSpace->Reset(m_pGraph.m_iMaxCheckForRefineGraph);
 
             SearchIndex(*((COMMON::QueryResultSet<T>*)&p_query), *workSpace, p_searchDeleted, false);
 
-            m_workSpacePool->Return(workSpace);
+            m_workSpacePool->Return(std::move(workSpace));
+
+            if (DistCalcMethod::InnerProduct == m_iDistCalcMethod)
+            {
+                // graph refinement compares data points, so rescore in the norm-augmented space
+                const T* target = (const T*)p_query.GetTarget();
+                float targetNorm = -m_fComputeDistance(target, target, GetFeatureDim());
+                BasicResult* results = p_query.GetResults();
+                for (int i = 0; i < p_query.GetResultNum(); i++)
+                {
+                    if (results[i].VID >= 0) results[i].Dist = COMMON::DistanceUtils::ComputeNormAugmentedDistance(
+                        m_fComputeDistance(target, m_pSamples[results[i].VID], GetFeatureDim()), targetNorm, *m_pNorms[results[i].VID], m_fMaxNormSquare);
+                }
+                std::sort(results, results + p_query.GetResultNum(), COMMON::Compare);
+            }
             return ErrorCode::Success;
         }
 
         template <typename T>
         ErrorCode Index<T>::SearchTree(QueryResult& p_query) const
         {
+            if (!CheckFullVectors()) return ErrorCode::Fail;
+
             auto workSpace = m_workSpacePool->Rent();
             workSpace->Reset(m_pGraph.m_iMaxCheckForRefineGraph);
 
@@ -280,7 +871,7 @@ namespace SPTAG
                 res[i].VID = cell.node;
                 res[i].Dist = cell.distance;
             }
-            m_workSpacePool->Return(workSpace);
+            m_workSpacePool->Return(std::move(workSpace));
             return ErrorCode::Success;
         }
 #pragma endregion
@@ -294,6 +885,7 @@ namespace SPTAG
 
             m_pSamples.Initialize(p_vectorNum, p_dimension, (T*)p_data, false);
             m_deletedID.Initialize(p_vectorNum);
+            SelectDistanceKernels();
 
             if (DistCalcMethod::Cosine == m_iDistCalcMethod)
             {
@@ -303,11 +895,30 @@ namespace SPTAG
                     COMMON::Utils::Normalize(m_pSamples[i], GetFeatureDim(), base);
                 }
             }
+            UpdateNorms(0, GetNumSamples());
 
-            m_workSpacePool.reset(new COMMON::WorkSpacePool(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), GetNumSamples(), m_iHashTableExp));
+            m_workSpacePool.reset(new COMMON::WorkSpacePool(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), GetNumSamples(), m_iHashTableExp, m_bEpochVisitedSet));
             m_workSpacePool->Init(m_iNumberOfThreads);
             m_threadPool.init();
 
+            if (m_iPQSubvectors > 0 && DistCalcMethod::Hamming == m_iDistCalcMethod) {
+                LOG(Helper::LogLevel::LL_Warning, "PQ codebooks cannot approximate Hamming distances, PQSubvectors ignored!\n");
+            }
+            else if (m_iPQSubvectors > 0 && m_pQuantizer.Train(m_pSamples, m_iPQSubvectors))
+            {
+                m_pPQCodes.Initialize(GetNumSamples(), m_pQuantizer.GetNumSubvectors());
+                EncodePQ(0, GetNumSamples());
+            }
+            if (m_bSQ8 && !SQ8Enabled()) {
+                LOG(Helper::LogLevel::LL_Warning, "SQ8 only applies to non-Hamming Float indexes without PQSubvectors, ignored!\n");
+            }
+            else if (m_bSQ8) {
+                m_pSQ8Quantizer.SetDistCalcMethod(m_iDistCalcMethod);
+                m_pSQ8Quantizer.Train(m_pSamples);
+                m_pSQ8Codes.Initialize(GetNumSamples(), m_pSQ8Quantizer.CodeSize());
+                EncodeSQ8(0, GetNumSamples());
+            }
+
             auto t1 = std::chrono::high_resolution_clock::now();
             m_pTrees.BuildTrees<T>(m_pSamples, m_iDistCalcMethod, m_iNumberOfThreads);
             auto t2 = std::chrono::high_resolution_clock::now();
@@ -324,6 +935,8 @@ namespace SPTAG
         template <typename T>
         ErrorCode Index<T>::RefineIndex(std::shared_ptr<VectorIndex>& p_newIndex)
         {
+            if (!CheckFullVectors()) return ErrorCode::Fail;
+
             p_newIndex.reset(new Index<T>());
             Index<T>* ptr = (Index<T>*)p_newIndex.get();
 
@@ -333,6 +946,14 @@ namespace SPTAG
 #include "inc/Core/BKT/ParameterDefinitionList.h"
 #undef DefineBKTParameter
 
+            ptr->m_fComputeDistance = m_fComputeDistance;
+            ptr->m_fComputeDistanceBatch = m_fComputeDistanceBatch;
+            ptr->m_fComputePartialDistance = m_fComputePartialDistance;
+            ptr->m_iBaseSquare = m_iBaseSquare;
+            ptr->m_fMaxNormSquare = m_fMaxNormSquare;
+            ptr->m_pQuantizer = m_pQuantizer;
+            ptr->m_pSQ8Quantizer = m_pSQ8Quantizer;
+
             std::lock_guard<std::mutex> lock(m_dataAddLock);
             std::unique_lock<std::shared_timed_mutex> uniquelock(m_dataDeleteLock);
 
@@ -357,12 +978,15 @@ namespace SPTAG
             LOG(Helper::LogLevel::LL_Info, "Refine... from %d -> %d\n", GetNumSamples(), newR);
             if (newR == 0) return ErrorCode::EmptyIndex;
 
-            ptr->m_workSpacePool.reset(new COMMON::WorkSpacePool(m_workSpacePool->GetMaxCheck(), newR, m_iHashTableExp));
+            ptr->m_workSpacePool.reset(new COMMON::WorkSpacePool(m_workSpacePool->GetMaxCheck(), newR, m_iHashTableExp, m_bEpochVisitedSet));
             ptr->m_workSpacePool->Init(m_iNumberOfThreads);
             ptr->m_threadPool.init();
 
             ErrorCode ret = ErrorCode::Success;
             if ((ret = m_pSamples.Refine(indices, ptr->m_pSamples)) != ErrorCode::Success) return ret;
+            if (m_pQuantizer.Available() && (ret = m_pPQCodes.Refine(indices, ptr->m_pPQCodes)) != ErrorCode::Success) return ret;
+            if (m_pSQ8Quantizer.Available() && (ret = m_pSQ8Codes.Refine(indices, ptr->m_pSQ8Codes)) != ErrorCode::Success) return ret;
+            if (NormsCached() && (ret = m_pNorms.Refine(indices, ptr->m_pNorms)) != ErrorCode::Success) return ret;
             if (nullptr != m_pMetadata && (ret = m_pMetadata->RefineMetadata(indices, ptr->m_pMetadata)) != ErrorCode::Success) return ret;
 
             ptr->m_deletedID.Initialize(newR);
@@ -377,6 +1001,8 @@ namespace SPTAG
         template <typename T>
         ErrorCode Index<T>::RefineIndex(const std::vector<std::shared_ptr<Helper::DiskPriorityIO>>& p_indexStreams, IAbortOperation* p_abort)
         {
+            if (!CheckFullVectors()) return ErrorCode::Fail;
+
             std::lock_guard<std::mutex> lock(m_dataAddLock);
             std::unique_lock<std::shared_timed_mutex> uniquelock(m_dataDeleteLock);
 
@@ -417,15 +1043,31 @@ namespace SPTAG
             COMMON::Labelset newDeletedID;
             newDeletedID.Initialize(newR);
             if ((ret = newDeletedID.Save(p_indexStreams[3])) != ErrorCode::Success) return ret;
+
+            size_t metaStream = 4;
+            if (m_iPQSubvectors > 0) {
+                if (p_indexStreams.size() <= metaStream) return ErrorCode::LackOfInputs;
+                if ((ret = m_pQuantizer.SaveQuantizer(p_indexStreams[metaStream])) != ErrorCode::Success) return ret;
+                if (m_pQuantizer.Available() && (ret = m_pPQCodes.Refine(indices, p_indexStreams[metaStream])) != ErrorCode::Success) return ret;
+                metaStream++;
+            }
+            if (m_bSQ8) {
+                if (p_indexStreams.size() <= metaStream) return ErrorCode::LackOfInputs;
+                if ((ret = m_pSQ8Quantizer.SaveQuantizer(p_indexStreams[metaStream])) != ErrorCode::Success) return ret;
+                if (m_pSQ8Quantizer.Available() && (ret = m_pSQ8Codes.Refine(indices, p_indexStreams[metaStream])) != ErrorCode::Success) return ret;
+                metaStream++;
+            }
             if (nullptr != m_pMetadata) {
-                if (p_indexStreams.size() < 6) return ErrorCode::LackOfInputs;
-                if ((ret = m_pMetadata->RefineMetadata(indices, p_indexStreams[4], p_indexStreams[5])) != ErrorCode::Success) return ret;
+                if (p_indexStreams.size() < metaStream + 2) return ErrorCode::LackOfInputs;
+                if ((ret = m_pMetadata->RefineMetadata(indices, p_indexStreams[metaStream], p_indexStreams[metaStream + 1])) != ErrorCode::Success) return ret;
             }
             return ret;
         }
 
         template <typename T>
         ErrorCode Index<T>::DeleteIndex(const void* p_vectors, SizeType p_vectorNum) {
+            if (!CheckFullVectors()) return ErrorCode::Fail;
+
             const T* ptr_v = (const T*)p_vectors;
 #pragma omp parallel for schedule(dynamic)
             for (SizeType i = 0; i < p_vectorNum; i++) {
@@ -433,8 +1075,9 @@ namespace SPTAG
                 SearchIndex(query);
 
                 for (int i = 0; i < m_pGraph.m_iCEF; i++) {
-                    if (query.GetResult(i)->Dist < 1e-6) {
-                        DeleteIndex(query.GetResult(i)->VID);
+                    const BasicResult* res = query.GetResult(i);
+                    if (res->VID >= 0 && ComputeDistance(query.GetTarget(), m_pSamples[res->VID]) < 1e-6) {
+                        DeleteIndex(res->VID);
                     }
                 }
             }
@@ -452,6 +1095,7 @@ namespace SPTAG
         ErrorCode Index<T>::AddIndex(const void* p_data, SizeType p_vectorNum, DimensionType p_dimension, std::shared_ptr<MetadataSet> p_metadataSet, bool p_withMetaIndex)
         {
             if (p_data == nullptr || p_vectorNum == 0 || p_dimension == 0) return ErrorCode::EmptyData;
+            if (!CheckFullVectors()) return ErrorCode::Fail;
 
             SizeType begin, end;
             ErrorCode ret;
@@ -475,11 +1119,17 @@ namespace SPTAG
 
                 if (m_pSamples.AddBatch((const T*)p_data, p_vectorNum) != ErrorCode::Success || 
                     m_pGraph.AddBatch(p_vectorNum) != ErrorCode::Success || 
-                    m_deletedID.AddBatch(p_vectorNum) != ErrorCode::Success) {
+                    m_deletedID.AddBatch(p_vectorNum) != ErrorCode::Success ||
+                    (m_pQuantizer.Available() && m_pPQCodes.AddBatch(p_vectorNum) != ErrorCode::Success) ||
+                    (m_pSQ8Quantizer.Available() && m_pSQ8Codes.AddBatch(p_vectorNum) != ErrorCode::Success) ||
+                    (NormsCached() && m_pNorms.AddBatch(p_vectorNum) != ErrorCode::Success)) {
                     LOG(Helper::LogLevel::LL_Error, "Memory Error: Cannot alloc space for vectors!\n");
                     m_pSamples.SetR(begin);
                     m_pGraph.SetR(begin);
                     m_deletedID.SetR(begin);
+                    if (m_pQuantizer.Available()) m_pPQCodes.SetR(begin);
+                    if (m_pSQ8Quantizer.Available()) m_pSQ8Codes.SetR(begin);
+                    if (NormsCached()) m_pNorms.SetR(begin);
                     return ErrorCode::MemoryOverFlow;
                 }
                 if (DistCalcMethod::Cosine == m_iDistCalcMethod)
@@ -489,6 +1139,9 @@ namespace SPTAG
                         COMMON::Utils::Normalize((T*)m_pSamples[i], GetFeatureDim(), base);
                     }
                 }
+                UpdateNorms(begin, end);
+                if (m_pQuantizer.Available()) EncodePQ(begin, end);
+                if (m_pSQ8Quantizer.Available()) EncodeSQ8(begin, end);
 
                 if (m_pMetadata != nullptr) {
                     m_pMetadata->AddBatch(*p_metadataSet);
@@ -514,12 +1167,141 @@ namespace SPTAG
             return ErrorCode::Success;
         }
 
+        template <typename T>
+        void Index<T>::UpdateNorms(SizeType p_start, SizeType p_end)
+        {
+            if (!NormsCached() || m_bQuantizedOnly) return;
+
+            // p_start == 0 recomputes from scratch, otherwise AddIndex has already grown m_pNorms
+            // and the InnerProduct bound only grows with the new vectors
+            if (p_start == 0 && m_pNorms.R() != p_end) {
+                m_pNorms.SetR(0);
+                m_pNorms.Initialize(p_end, 1);
+            }
+            float baseSquare = (DistCalcMethod::Cosine == m_iDistCalcMethod) ? (float)m_iBaseSquare : 0;
+#pragma omp parallel for
+            for (SizeType i = p_start; i < p_end; i++) {
+                *m_pNorms[i] = baseSquare - m_fComputeDistance(m_pSamples[i], m_pSamples[i], GetFeatureDim());
+            }
+
+            float maxNormSquare = (p_start == 0) ? 0 : m_fMaxNormSquare;
+            for (SizeType i = p_start; i < p_end; i++) maxNormSquare = max(maxNormSquare, *m_pNorms[i]);
+            m_fMaxNormSquare = maxNormSquare;
+        }
+
+        template <typename T>
+        void Index<T>::EncodePQ(SizeType p_start, SizeType p_end)
+        {
+#pragma omp parallel for
+            for (SizeType i = p_start; i < p_end; i++) {
+                m_pQuantizer.Encode(m_pSamples[i], m_pPQCodes[i]);
+            }
+        }
+
+        template <typename T>
+        std::uint64_t Index<T>::PQBufferSize() const
+        {
+            return m_pQuantizer.BufferSize() + (m_pQuantizer.Available() ? m_pPQCodes.BufferSize() : 0);
+        }
+
+        // The PQ file holds the codebooks followed by the codes, which are left out when no codebook was trained.
+        template <typename T>
+        ErrorCode Index<T>::SavePQ(std::shared_ptr<Helper::DiskPriorityIO> p_out) const
+        {
+            ErrorCode ret = ErrorCode::Success;
+            if ((ret = m_pQuantizer.SaveQuantizer(p_out)) != ErrorCode::Success) return ret;
+            if (m_pQuantizer.Available() && (ret = m_pPQCodes.Save(p_out)) != ErrorCode::Success) return ret;
+            return ret;
+        }
+
+        template <typename T>
+        ErrorCode Index<T>::LoadPQ(std::shared_ptr<Helper::DiskPriorityIO> p_input)
+        {
+            ErrorCode ret = ErrorCode::Success;
+            if ((ret = m_pQuantizer.LoadQuantizer(p_input)) != ErrorCode::Success) return ret;
+            if (!m_pQuantizer.Available()) return ret;
+            if ((ret = m_pPQCodes.Load(p_input)) != ErrorCode::Success) return ret;
+            if (m_pPQCodes.R() != GetNumSamples() || m_pQuantizer.GetFeatureDim() != GetFeatureDim()) return ErrorCode::FailedParseValue;
+            return ret;
+        }
+
+        template <typename T>
+        ErrorCode Index<T>::LoadPQ(char* p_pqMemFile)
+        {
+            ErrorCode ret = ErrorCode::Success;
+            if ((ret = m_pQuantizer.LoadQuantizer(p_pqMemFile)) != ErrorCode::Success) return ret;
+            if (!m_pQuantizer.Available()) return ret;
+            if ((ret = m_pPQCodes.Load(p_pqMemFile + m_pQuantizer.BufferSize())) != ErrorCode::Success) return ret;
+            if (m_pPQCodes.R() != GetNumSamples() || m_pQuantizer.GetFeatureDim() != GetFeatureDim()) return ErrorCode::FailedParseValue;
+            return ret;
+        }
+
+        template <typename T>
+        void Index<T>::EncodeSQ8(SizeType p_start, SizeType p_end)
+        {
+#pragma omp parallel for
+            for (SizeType i = p_start; i < p_end; i++) {
+                m_pSQ8Quantizer.Encode(m_pSamples[i], m_pSQ8Codes[i]);
+            }
+        }
+
+        template <typename T>
+        std::uint64_t Index<T>::SQ8BufferSize() const
+        {
+            return m_pSQ8Quantizer.BufferSize() + (m_pSQ8Quantizer.Available() ? m_pSQ8Codes.BufferSize() : 0);
+        }
+
+        // Same layout as the PQ file: the scales, then the code rows when the quantizer was trained.
+        template <typename T>
+        ErrorCode Index<T>::SaveSQ8(std::shared_ptr<Helper::DiskPriorityIO> p_out) const
+        {
+            ErrorCode ret = ErrorCode::Success;
+            if ((ret = m_pSQ8Quantizer.SaveQuantizer(p_out)) != ErrorCode::Success) return ret;
+            if (m_pSQ8Quantizer.Available() && (ret = m_pSQ8Codes.Save(p_out)) != ErrorCode::Success) return ret;
+            return ret;
+        }
+
+        template <typename T>
+        ErrorCode Index<T>::LoadSQ8(std::shared_ptr<Helper::DiskPriorityIO> p_input)
+        {
+            ErrorCode ret = ErrorCode::Success;
+            if ((ret = m_pSQ8Quantizer.LoadQuantizer(p_input)) != ErrorCode::Success) return ret;
+            if (!m_pSQ8Quantizer.Available()) return m_bQuantizedOnly ? ErrorCode::FailedParseValue : ret;
+            if ((ret = m_pSQ8Codes.Load(p_input)) != ErrorCode::Success) return ret;
+            if (m_pSQ8Codes.R() != m_pGraph.R() || m_pSQ8Codes.C() != m_pSQ8Quantizer.CodeSize() ||
+                (!m_bQuantizedOnly && m_pSQ8Quantizer.GetFeatureDim() != m_pSamples.C())) return ErrorCode::FailedParseValue;
+            m_pSQ8Quantizer.SetDistCalcMethod(m_iDistCalcMethod);
+            return ret;
+        }
+
+        template <typename T>
+        ErrorCode Index<T>::LoadSQ8(char* p_sq8MemFile)
+        {
+            ErrorCode ret = ErrorCode::Success;
+            if ((ret = m_pSQ8Quantizer.LoadQuantizer(p_sq8MemFile)) != ErrorCode::Success) return ret;
+            if (!m_pSQ8Quantizer.Available()) return m_bQuantizedOnly ? ErrorCode::FailedParseValue : ret;
+            if ((ret = m_pSQ8Codes.Load(p_sq8MemFile + m_pSQ8Quantizer.BufferSize())) != ErrorCode::Success) return ret;
+            if (m_pSQ8Codes.R() != m_pGraph.R() || m_pSQ8Codes.C() != m_pSQ8Quantizer.CodeSize() ||
+                (!m_bQuantizedOnly && m_pSQ8Quantizer.GetFeatureDim() != m_pSamples.C())) return ErrorCode::FailedParseValue;
+            m_pSQ8Quantizer.SetDistCalcMethod(m_iDistCalcMethod);
+            return ret;
+        }
+
+        // Indexes served from SQ8 codes alone can only be searched.
+        template <typename T>
+        bool Index<T>::CheckFullVectors() const
+        {
+            if (!m_bQuantizedOnly) return true;
+            LOG(Helper::LogLevel::LL_Error, "Index was loaded without its full vectors (SQ8RerankNumber=0) and is read-only!\n");
+            return false;
+        }
+
         template <typename T>
         ErrorCode
             Index<T>::UpdateIndex()
         {
             omp_set_num_threads(m_iNumberOfThreads);
-            m_workSpacePool.reset(new COMMON::WorkSpacePool(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), GetNumSamples(), m_iHashTableExp));
+            m_workSpacePool.reset(new COMMON::WorkSpacePool(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), GetNumSamples(), m_iHashTableExp, m_bEpochVisitedSet));
             m_workSpacePool->Init(m_iNumberOfThreads);
             return ErrorCode::Success;
         }
@@ -545,8 +1327,15 @@ namespace SPTAG
 #undef DefineBKTParameter
 
             if (SPTAG::Helper::StrUtils::StrEqualIgnoreCase(p_param, "DistCalcMethod")) {
-                m_fComputeDistance = COMMON::DistanceCalcSelector<T>(m_iDistCalcMethod);
-                m_iBaseSquare = (m_iDistCalcMethod == DistCalcMethod::Cosine) ? COMMON::Utils::GetBase<T>() * COMMON::Utils::GetBase<T>() : 1;
+                SelectDistanceKernels();
+                UpdateNorms(0, GetNumSamples());
+                m_pSQ8Quantizer.SetDistCalcMethod(m_iDistCalcMethod);
+            }
+            else if (SPTAG::Helper::StrUtils::StrEqualIgnoreCase(p_param, "AdaptiveModel") || SPTAG::Helper::StrUtils::StrEqualIgnoreCase(p_param, "AdaptiveThreshold")) {
+                if (!m_termination.Load(m_sAdaptiveModel, m_fAdaptiveThreshold)) {
+                    LOG(Helper::LogLevel::LL_Error, "Invalid AdaptiveModel %s with AdaptiveThreshold %f!\n", m_sAdaptiveModel.c_str(), m_fAdaptiveThreshold);
+                    return ErrorCode::Fail;
+                }
             }
             return ErrorCode::Success;
         }
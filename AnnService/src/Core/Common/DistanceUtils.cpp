@@ -0,0 +1,858 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "inc/Core/Common/DistanceUtils.h"
+
+#include <cstring>
+#include <type_traits>
+
+using namespace SPTAG;
+using namespace SPTAG::COMMON;
+
+// This file is compiled with AVX-512 code generation enabled; the kernels below are only
+// reached through DistanceCalcSelector after InstructionSet has confirmed CPU and OS support.
+namespace
+{
+    // Integer accumulators are flushed to float after this many elements so that a 32-bit
+    // lane never overflows, even for 8-bit vectors with many thousands of dimensions.
+    const DimensionType c_intBlock = 64 * 1024;
+
+    inline __mmask64 TailMask8(std::int64_t p_remain)
+    {
+        return (__mmask64)((((std::uint64_t)1) << p_remain) - 1);
+    }
+
+    inline __mmask32 TailMask16(std::int64_t p_remain)
+    {
+        return (__mmask32)((((std::uint32_t)1) << p_remain) - 1);
+    }
+
+    inline __mmask16 TailMask32(std::int64_t p_remain)
+    {
+        return (__mmask16)((1U << p_remain) - 1);
+    }
+
+    inline __m512i _mm512_lo_epi8_epi16(__m512i X) { return _mm512_cvtepi8_epi16(_mm512_castsi512_si256(X)); }
+    inline __m512i _mm512_hi_epi8_epi16(__m512i X) { return _mm512_cvtepi8_epi16(_mm512_extracti64x4_epi64(X, 1)); }
+    inline __m512i _mm512_lo_epu8_epi16(__m512i X) { return _mm512_cvtepu8_epi16(_mm512_castsi512_si256(X)); }
+    inline __m512i _mm512_hi_epu8_epi16(__m512i X) { return _mm512_cvtepu8_epi16(_mm512_extracti64x4_epi64(X, 1)); }
+
+    inline __m512 _mm512_sqdf_epi8(__m512i X, __m512i Y)
+    {
+        __m512i dlo = _mm512_sub_epi16(_mm512_lo_epi8_epi16(X), _mm512_lo_epi8_epi16(Y));
+        __m512i dhi = _mm512_sub_epi16(_mm512_hi_epi8_epi16(X), _mm512_hi_epi8_epi16(Y));
+        return _mm512_cvtepi32_ps(_mm512_add_epi32(_mm512_madd_epi16(dlo, dlo), _mm512_madd_epi16(dhi, dhi)));
+    }
+
+    inline __m512 _mm512_mul_epi8(__m512i X, __m512i Y)
+    {
+        return _mm512_cvtepi32_ps(_mm512_add_epi32(_mm512_madd_epi16(_mm512_lo_epi8_epi16(X), _mm512_lo_epi8_epi16(Y)),
+            _mm512_madd_epi16(_mm512_hi_epi8_epi16(X), _mm512_hi_epi8_epi16(Y))));
+    }
+
+    inline __m512 _mm512_sqdf_epu8(__m512i X, __m512i Y)
+    {
+        __m512i dlo = _mm512_sub_epi16(_mm512_lo_epu8_epi16(X), _mm512_lo_epu8_epi16(Y));
+        __m512i dhi = _mm512_sub_epi16(_mm512_hi_epu8_epi16(X), _mm512_hi_epu8_epi16(Y));
+        return _mm512_cvtepi32_ps(_mm512_add_epi32(_mm512_madd_epi16(dlo, dlo), _mm512_madd_epi16(dhi, dhi)));
+    }
+
+    inline __m512 _mm512_mul_epu8(__m512i X, __m512i Y)
+    {
+        return _mm512_cvtepi32_ps(_mm512_add_epi32(_mm512_madd_epi16(_mm512_lo_epu8_epi16(X), _mm512_lo_epu8_epi16(Y)),
+            _mm512_madd_epi16(_mm512_hi_epu8_epi16(X), _mm512_hi_epu8_epi16(Y))));
+    }
+
+    inline __m512 _mm512_sqdf_epi16(__m512i X, __m512i Y)
+    {
+        __m512 dlo = _mm512_cvtepi32_ps(_mm512_sub_epi32(_mm512_cvtepi16_epi32(_mm512_castsi512_si256(X)), _mm512_cvtepi16_epi32(_mm512_castsi512_si256(Y))));
+        __m512 dhi = _mm512_cvtepi32_ps(_mm512_sub_epi32(_mm512_cvtepi16_epi32(_mm512_extracti64x4_epi64(X, 1)), _mm512_cvtepi16_epi32(_mm512_extracti64x4_epi64(Y, 1))));
+        return _mm512_fmadd_ps(dlo, dlo, _mm512_mul_ps(dhi, dhi));
+    }
+
+    inline __m512 _mm512_mul_epi16(__m512i X, __m512i Y)
+    {
+        return _mm512_cvtepi32_ps(_mm512_madd_epi16(X, Y));
+    }
+
+    // 16 half precision values widened to float lanes; the masked loads zero the lanes past the tail.
+    inline __m512 LoadHalf(const Float16* p) { return _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)p)); }
+    inline __m512 LoadHalf(const BFloat16* p) { return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i*)p)), 16)); }
+    inline __m512 MaskLoadHalf(__mmask32 mask, const Float16* p) { return _mm512_cvtph_ps(_mm512_castsi512_si256(_mm512_maskz_loadu_epi16(mask, p))); }
+    inline __m512 MaskLoadHalf(__mmask32 mask, const BFloat16* p) { return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_cvtepu16_epi32(_mm512_castsi512_si256(_mm512_maskz_loadu_epi16(mask, p))), 16)); }
+
+    template <bool L2>
+    inline __m512 AccumulateHalf(__m512 acc, __m512 X, __m512 Y)
+    {
+        if (L2) {
+            __m512 d = _mm512_sub_ps(X, Y);
+            return _mm512_fmadd_ps(d, d, acc);
+        }
+        return _mm512_fmadd_ps(X, Y, acc);
+    }
+
+    template <bool L2, typename T>
+    inline float ComputeHalf_AVX512(const T* pX, const T* pY, DimensionType length)
+    {
+        const T* pEnd32 = pX + ((length >> 5) << 5);
+        const T* pEnd16 = pX + ((length >> 4) << 4);
+        const T* pEnd1 = pX + length;
+
+        __m512 diff512 = _mm512_setzero_ps();
+        __m512 diff512b = _mm512_setzero_ps();
+        while (pX < pEnd32) {
+            diff512 = AccumulateHalf<L2>(diff512, LoadHalf(pX), LoadHalf(pY));
+            diff512b = AccumulateHalf<L2>(diff512b, LoadHalf(pX + 16), LoadHalf(pY + 16));
+            pX += 32; pY += 32;
+        }
+        if (pX < pEnd16) {
+            diff512 = AccumulateHalf<L2>(diff512, LoadHalf(pX), LoadHalf(pY));
+            pX += 16; pY += 16;
+        }
+        if (pX < pEnd1) {
+            __mmask32 mask = TailMask16(pEnd1 - pX);
+            diff512b = AccumulateHalf<L2>(diff512b, MaskLoadHalf(mask, pX), MaskLoadHalf(mask, pY));
+        }
+        return _mm512_reduce_add_ps(_mm512_add_ps(diff512, diff512b));
+    }
+
+    inline __m512bh AsBF16(__m512i X)
+    {
+        __m512bh r;
+        std::memcpy(&r, &X, sizeof(r));
+        return r;
+    }
+}
+
+float DistanceUtils::ComputeL2Distance_AVX512(const std::int8_t* pX, const std::int8_t* pY, DimensionType length)
+{
+    const std::int8_t* pEnd64 = pX + ((length >> 6) << 6);
+    const std::int8_t* pEnd1 = pX + length;
+
+    __m512 diff512 = _mm512_setzero_ps();
+    while (pX < pEnd64) {
+        diff512 = _mm512_add_ps(diff512, _mm512_sqdf_epi8(_mm512_loadu_si512(pX), _mm512_loadu_si512(pY)));
+        pX += 64; pY += 64;
+    }
+    if (pX < pEnd1) {
+        __mmask64 mask = TailMask8(pEnd1 - pX);
+        diff512 = _mm512_add_ps(diff512, _mm512_sqdf_epi8(_mm512_maskz_loadu_epi8(mask, pX), _mm512_maskz_loadu_epi8(mask, pY)));
+    }
+    return _mm512_reduce_add_ps(diff512);
+}
+
+float DistanceUtils::ComputeL2Distance_AVX512(const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length)
+{
+    const std::uint8_t* pEnd64 = pX + ((length >> 6) << 6);
+    const std::uint8_t* pEnd1 = pX + length;
+
+    __m512 diff512 = _mm512_setzero_ps();
+    while (pX < pEnd64) {
+        diff512 = _mm512_add_ps(diff512, _mm512_sqdf_epu8(_mm512_loadu_si512(pX), _mm512_loadu_si512(pY)));
+        pX += 64; pY += 64;
+    }
+    if (pX < pEnd1) {
+        __mmask64 mask = TailMask8(pEnd1 - pX);
+        diff512 = _mm512_add_ps(diff512, _mm512_sqdf_epu8(_mm512_maskz_loadu_epi8(mask, pX), _mm512_maskz_loadu_epi8(mask, pY)));
+    }
+    return _mm512_reduce_add_ps(diff512);
+}
+
+float DistanceUtils::ComputeL2Distance_AVX512(const std::int16_t* pX, const std::int16_t* pY, DimensionType length)
+{
+    const std::int16_t* pEnd32 = pX + ((length >> 5) << 5);
+    const std::int16_t* pEnd1 = pX + length;
+
+    __m512 diff512 = _mm512_setzero_ps();
+    while (pX < pEnd32) {
+        diff512 = _mm512_add_ps(diff512, _mm512_sqdf_epi16(_mm512_loadu_si512(pX), _mm512_loadu_si512(pY)));
+        pX += 32; pY += 32;
+    }
+    if (pX < pEnd1) {
+        __mmask32 mask = TailMask16(pEnd1 - pX);
+        diff512 = _mm512_add_ps(diff512, _mm512_sqdf_epi16(_mm512_maskz_loadu_epi16(mask, pX), _mm512_maskz_loadu_epi16(mask, pY)));
+    }
+    return _mm512_reduce_add_ps(diff512);
+}
+
+float DistanceUtils::ComputeL2Distance_AVX512(const float* pX, const float* pY, DimensionType length)
+{
+    const float* pEnd32 = pX + ((length >> 5) << 5);
+    const float* pEnd16 = pX + ((length >> 4) << 4);
+    const float* pEnd1 = pX + length;
+
+    // two independent accumulators hide the FMA latency
+    __m512 diff512 = _mm512_setzero_ps();
+    __m512 diff512b = _mm512_setzero_ps();
+    while (pX < pEnd32) {
+        __m512 d1 = _mm512_sub_ps(_mm512_loadu_ps(pX), _mm512_loadu_ps(pY));
+        __m512 d2 = _mm512_sub_ps(_mm512_loadu_ps(pX + 16), _mm512_loadu_ps(pY + 16));
+        diff512 = _mm512_fmadd_ps(d1, d1, diff512);
+        diff512b = _mm512_fmadd_ps(d2, d2, diff512b);
+        pX += 32; pY += 32;
+    }
+    if (pX < pEnd16) {
+        __m512 d = _mm512_sub_ps(_mm512_loadu_ps(pX), _mm512_loadu_ps(pY));
+        diff512 = _mm512_fmadd_ps(d, d, diff512);
+        pX += 16; pY += 16;
+    }
+    if (pX < pEnd1) {
+        __mmask16 mask = TailMask32(pEnd1 - pX);
+        __m512 d = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, pX), _mm512_maskz_loadu_ps(mask, pY));
+        diff512b = _mm512_fmadd_ps(d, d, diff512b);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(diff512, diff512b));
+}
+
+float DistanceUtils::ComputeL2Distance_AVX512(const Float16* pX, const Float16* pY, DimensionType length)
+{
+    return ComputeHalf_AVX512<true>(pX, pY, length);
+}
+
+float DistanceUtils::ComputeL2Distance_AVX512(const BFloat16* pX, const BFloat16* pY, DimensionType length)
+{
+    return ComputeHalf_AVX512<true>(pX, pY, length);
+}
+
+float DistanceUtils::ComputeDotProduct_AVX512(const std::int8_t* pX, const std::int8_t* pY, DimensionType length)
+{
+    const std::int8_t* pEnd64 = pX + ((length >> 6) << 6);
+    const std::int8_t* pEnd1 = pX + length;
+
+    __m512 diff512 = _mm512_setzero_ps();
+    while (pX < pEnd64) {
+        diff512 = _mm512_add_ps(diff512, _mm512_mul_epi8(_mm512_loadu_si512(pX), _mm512_loadu_si512(pY)));
+        pX += 64; pY += 64;
+    }
+    if (pX < pEnd1) {
+        __mmask64 mask = TailMask8(pEnd1 - pX);
+        diff512 = _mm512_add_ps(diff512, _mm512_mul_epi8(_mm512_maskz_loadu_epi8(mask, pX), _mm512_maskz_loadu_epi8(mask, pY)));
+    }
+    return _mm512_reduce_add_ps(diff512);
+}
+
+float DistanceUtils::ComputeDotProduct_AVX512(const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length)
+{
+    const std::uint8_t* pEnd64 = pX + ((length >> 6) << 6);
+    const std::uint8_t* pEnd1 = pX + length;
+
+    __m512 diff512 = _mm512_setzero_ps();
+    while (pX < pEnd64) {
+        diff512 = _mm512_add_ps(diff512, _mm512_mul_epu8(_mm512_loadu_si512(pX), _mm512_loadu_si512(pY)));
+        pX += 64; pY += 64;
+    }
+    if (pX < pEnd1) {
+        __mmask64 mask = TailMask8(pEnd1 - pX);
+        diff512 = _mm512_add_ps(diff512, _mm512_mul_epu8(_mm512_maskz_loadu_epi8(mask, pX), _mm512_maskz_loadu_epi8(mask, pY)));
+    }
+    return _mm512_reduce_add_ps(diff512);
+}
+
+float DistanceUtils::ComputeDotProduct_AVX512(const std::int16_t* pX, const std::int16_t* pY, DimensionType length)
+{
+    const std::int16_t* pEnd32 = pX + ((length >> 5) << 5);
+    const std::int16_t* pEnd1 = pX + length;
+
+    __m512 diff512 = _mm512_setzero_ps();
+    while (pX < pEnd32) {
+        diff512 = _mm512_add_ps(diff512, _mm512_mul_epi16(_mm512_loadu_si512(pX), _mm512_loadu_si512(pY)));
+        pX += 32; pY += 32;
+    }
+    if (pX < pEnd1) {
+        __mmask32 mask = TailMask16(pEnd1 - pX);
+        diff512 = _mm512_add_ps(diff512, _mm512_mul_epi16(_mm512_maskz_loadu_epi16(mask, pX), _mm512_maskz_loadu_epi16(mask, pY)));
+    }
+    return _mm512_reduce_add_ps(diff512);
+}
+
+float DistanceUtils::ComputeDotProduct_AVX512(const float* pX, const float* pY, DimensionType length)
+{
+    const float* pEnd32 = pX + ((length >> 5) << 5);
+    const float* pEnd16 = pX + ((length >> 4) << 4);
+    const float* pEnd1 = pX + length;
+
+    __m512 diff512 = _mm512_setzero_ps();
+    __m512 diff512b = _mm512_setzero_ps();
+    while (pX < pEnd32) {
+        diff512 = _mm512_fmadd_ps(_mm512_loadu_ps(pX), _mm512_loadu_ps(pY), diff512);
+        diff512b = _mm512_fmadd_ps(_mm512_loadu_ps(pX + 16), _mm512_loadu_ps(pY + 16), diff512b);
+        pX += 32; pY += 32;
+    }
+    if (pX < pEnd16) {
+        diff512 = _mm512_fmadd_ps(_mm512_loadu_ps(pX), _mm512_loadu_ps(pY), diff512);
+        pX += 16; pY += 16;
+    }
+    if (pX < pEnd1) {
+        __mmask16 mask = TailMask32(pEnd1 - pX);
+        diff512b = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, pX), _mm512_maskz_loadu_ps(mask, pY), diff512b);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(diff512, diff512b));
+}
+
+float DistanceUtils::ComputeDotProduct_AVX512(const Float16* pX, const Float16* pY, DimensionType length)
+{
+    return ComputeHalf_AVX512<false>(pX, pY, length);
+}
+
+float DistanceUtils::ComputeDotProduct_AVX512(const BFloat16* pX, const BFloat16* pY, DimensionType length)
+{
+    return ComputeHalf_AVX512<false>(pX, pY, length);
+}
+
+float DistanceUtils::ComputeL2Distance_AVX512VNNI(const std::int8_t* pX, const std::int8_t* pY, DimensionType length)
+{
+    const std::int8_t* pEnd64 = pX + ((length >> 6) << 6);
+    const std::int8_t* pEnd1 = pX + length;
+
+    __m512 diff512 = _mm512_setzero_ps();
+    while (pX < pEnd64) {
+        const std::int8_t* pBlockEnd = (pEnd64 - pX > c_intBlock) ? pX + c_intBlock : pEnd64;
+        __m512i acc = _mm512_setzero_si512();
+        while (pX < pBlockEnd) {
+            __m512i X = _mm512_loadu_si512(pX), Y = _mm512_loadu_si512(pY);
+            __m512i dlo = _mm512_sub_epi16(_mm512_lo_epi8_epi16(X), _mm512_lo_epi8_epi16(Y));
+            __m512i dhi = _mm512_sub_epi16(_mm512_hi_epi8_epi16(X), _mm512_hi_epi8_epi16(Y));
+            acc = _mm512_dpwssd_epi32(acc, dlo, dlo);
+            acc = _mm512_dpwssd_epi32(acc, dhi, dhi);
+            pX += 64; pY += 64;
+        }
+        diff512 = _mm512_add_ps(diff512, _mm512_cvtepi32_ps(acc));
+    }
+    if (pX < pEnd1) {
+        __mmask64 mask = TailMask8(pEnd1 - pX);
+        diff512 = _mm512_add_ps(diff512, _mm512_sqdf_epi8(_mm512_maskz_loadu_epi8(mask, pX), _mm512_maskz_loadu_epi8(mask, pY)));
+    }
+    return _mm512_reduce_add_ps(diff512);
+}
+
+float DistanceUtils::ComputeL2Distance_AVX512VNNI(const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length)
+{
+    const std::uint8_t* pEnd64 = pX + ((length >> 6) << 6);
+    const std::uint8_t* pEnd1 = pX + length;
+
+    __m512 diff512 = _mm512_setzero_ps();
+    while (pX < pEnd64) {
+        const std::uint8_t* pBlockEnd = (pEnd64 - pX > c_intBlock) ? pX + c_intBlock : pEnd64;
+        __m512i acc = _mm512_setzero_si512();
+        while (pX < pBlockEnd) {
+            __m512i X = _mm512_loadu_si512(pX), Y = _mm512_loadu_si512(pY);
+            __m512i dlo = _mm512_sub_epi16(_mm512_lo_epu8_epi16(X), _mm512_lo_epu8_epi16(Y));
+            __m512i dhi = _mm512_sub_epi16(_mm512_hi_epu8_epi16(X), _mm512_hi_epu8_epi16(Y));
+            acc = _mm512_dpwssd_epi32(acc, dlo, dlo);
+            acc = _mm512_dpwssd_epi32(acc, dhi, dhi);
+            pX += 64; pY += 64;
+        }
+        diff512 = _mm512_add_ps(diff512, _mm512_cvtepi32_ps(acc));
+    }
+    if (pX < pEnd1) {
+        __mmask64 mask = TailMask8(pEnd1 - pX);
+        diff512 = _mm512_add_ps(diff512, _mm512_sqdf_epu8(_mm512_maskz_loadu_epi8(mask, pX), _mm512_maskz_loadu_epi8(mask, pY)));
+    }
+    return _mm512_reduce_add_ps(diff512);
+}
+
+float DistanceUtils::ComputeDotProduct_AVX512VNNI(const std::int8_t* pX, const std::int8_t* pY, DimensionType length)
+{
+    // vpdpbusd multiplies unsigned by signed bytes, so x is biased to x + 128 (x ^ 0x80)
+    // and 128 * sum(y) is subtracted afterwards: x.y = (x + 128).y - 128.y
+    const std::int8_t* pEnd64 = pX + ((length >> 6) << 6);
+    const std::int8_t* pEnd1 = pX + length;
+    const __m512i bias = _mm512_set1_epi8((char)0x80);
+
+    __m512 diff512 = _mm512_setzero_ps();
+    while (pX < pEnd1) {
+        const std::int8_t* pBlockEnd = (pEnd64 - pX > c_intBlock) ? pX + c_intBlock : pEnd64;
+        __m512i acc = _mm512_setzero_si512();
+        __m512i corr = _mm512_setzero_si512();
+        while (pX < pBlockEnd) {
+            __m512i Y = _mm512_loadu_si512(pY);
+            acc = _mm512_dpbusd_epi32(acc, _mm512_xor_si512(_mm512_loadu_si512(pX), bias), Y);
+            corr = _mm512_dpbusd_epi32(corr, bias, Y);
+            pX += 64; pY += 64;
+        }
+        if (pX < pEnd1 && pBlockEnd == pEnd64) {
+            // masked-out lanes load zero for y, so they contribute nothing to either sum
+            __mmask64 mask = TailMask8(pEnd1 - pX);
+            __m512i Y = _mm512_maskz_loadu_epi8(mask, pY);
+            acc = _mm512_dpbusd_epi32(acc, _mm512_xor_si512(_mm512_maskz_loadu_epi8(mask, pX), bias), Y);
+            corr = _mm512_dpbusd_epi32(corr, bias, Y);
+            pX = pEnd1;
+        }
+        diff512 = _mm512_add_ps(diff512, _mm512_cvtepi32_ps(_mm512_sub_epi32(acc, corr)));
+    }
+    return _mm512_reduce_add_ps(diff512);
+}
+
+float DistanceUtils::ComputeDotProduct_AVX512VNNI(const std::uint8_t* pX, const std::uint8_t* pY, DimensionType length)
+{
+    // y is biased to the signed range y - 128 (y ^ 0x80) and 128 * sum(x) is added back:
+    // x.y = x.(y - 128) - x.(-128)
+    const std::uint8_t* pEnd64 = pX + ((length >> 6) << 6);
+    const std::uint8_t* pEnd1 = pX + length;
+    const __m512i bias = _mm512_set1_epi8((char)0x80);
+
+    __m512 diff512 = _mm512_setzero_ps();
+    while (pX < pEnd1) {
+        const std::uint8_t* pBlockEnd = (pEnd64 - pX > c_intBlock) ? pX + c_intBlock : pEnd64;
+        __m512i acc = _mm512_setzero_si512();
+        __m512i corr = _mm512_setzero_si512();
+        while (pX < pBlockEnd) {
+            __m512i X = _mm512_loadu_si512(pX);
+            acc = _mm512_dpbusd_epi32(acc, X, _mm512_xor_si512(_mm512_loadu_si512(pY), bias));
+            corr = _mm512_dpbusd_epi32(corr, X, bias);
+            pX += 64; pY += 64;
+        }
+        if (pX < pEnd1 && pBlockEnd == pEnd64) {
+            // masked-out lanes load zero for x, so they contribute nothing to either sum
+            __mmask64 mask = TailMask8(pEnd1 - pX);
+            __m512i X = _mm512_maskz_loadu_epi8(mask, pX);
+            acc = _mm512_dpbusd_epi32(acc, X, _mm512_xor_si512(_mm512_maskz_loadu_epi8(mask, pY), bias));
+            corr = _mm512_dpbusd_epi32(corr, X, bias);
+            pX = pEnd1;
+        }
+        diff512 = _mm512_add_ps(diff512, _mm512_cvtepi32_ps(_mm512_sub_epi32(acc, corr)));
+    }
+    return _mm512_reduce_add_ps(diff512);
+}
+
+float DistanceUtils::ComputeDotProduct_AVX512BF16(const BFloat16* pX, const BFloat16* pY, DimensionType length)
+{
+    // vdpbf16ps multiplies 32 bfloat16 pairs and adds adjacent products into 16 float lanes
+    const BFloat16* pEnd64 = pX + ((length >> 6) << 6);
+    const BFloat16* pEnd32 = pX + ((length >> 5) << 5);
+    const BFloat16* pEnd1 = pX + length;
+
+    __m512 diff512 = _mm512_setzero_ps();
+    __m512 diff512b = _mm512_setzero_ps();
+    while (pX < pEnd64) {
+        diff512 = _mm512_dpbf16_ps(diff512, AsBF16(_mm512_loadu_si512(pX)), AsBF16(_mm512_loadu_si512(pY)));
+        diff512b = _mm512_dpbf16_ps(diff512b, AsBF16(_mm512_loadu_si512(pX + 32)), AsBF16(_mm512_loadu_si512(pY + 32)));
+        pX += 64; pY += 64;
+    }
+    if (pX < pEnd32) {
+        diff512 = _mm512_dpbf16_ps(diff512, AsBF16(_mm512_loadu_si512(pX)), AsBF16(_mm512_loadu_si512(pY)));
+        pX += 32; pY += 32;
+    }
+    if (pX < pEnd1) {
+        __mmask32 mask = TailMask16(pEnd1 - pX);
+        diff512b = _mm512_dpbf16_ps(diff512b, AsBF16(_mm512_maskz_loadu_epi16(mask, pX)), AsBF16(_mm512_maskz_loadu_epi16(mask, pY)));
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(diff512, diff512b));
+}
+
+namespace
+{
+    // Per-chunk operations for the one-to-many kernels. Each Op consumes one 64-byte chunk of the
+    // query and of a candidate; Reduce is called at least every c_intBlock elements so integer
+    // accumulators cannot overflow. The kernels produce squared L2 distances or dot products.
+    template <typename T> struct Chunk;
+
+    template <> struct Chunk<float>
+    {
+        typedef __m512 Vec;
+        static const int Width = 16;
+        static Vec Load(const float* p) { return _mm512_loadu_ps(p); }
+        static Vec MaskLoad(std::int64_t remain, const float* p) { return _mm512_maskz_loadu_ps(TailMask32(remain), p); }
+    };
+
+    template <> struct Chunk<Float16>
+    {
+        typedef __m512 Vec;
+        static const int Width = 16;
+        static Vec Load(const Float16* p) { return LoadHalf(p); }
+        static Vec MaskLoad(std::int64_t remain, const Float16* p) { return MaskLoadHalf(TailMask16(remain), p); }
+    };
+
+    template <> struct Chunk<BFloat16>
+    {
+        typedef __m512 Vec;
+        static const int Width = 16;
+        static Vec Load(const BFloat16* p) { return LoadHalf(p); }
+        static Vec MaskLoad(std::int64_t remain, const BFloat16* p) { return MaskLoadHalf(TailMask16(remain), p); }
+    };
+
+    template <> struct Chunk<std::int16_t>
+    {
+        typedef __m512i Vec;
+        static const int Width = 32;
+        static Vec Load(const std::int16_t* p) { return _mm512_loadu_si512(p); }
+        static Vec MaskLoad(std::int64_t remain, const std::int16_t* p) { return _mm512_maskz_loadu_epi16(TailMask16(remain), p); }
+    };
+
+    template <> struct Chunk<std::int8_t>
+    {
+        typedef __m512i Vec;
+        static const int Width = 64;
+        static Vec Load(const std::int8_t* p) { return _mm512_loadu_si512(p); }
+        static Vec MaskLoad(std::int64_t remain, const std::int8_t* p) { return _mm512_maskz_loadu_epi8(TailMask8(remain), p); }
+    };
+
+    template <> struct Chunk<std::uint8_t>
+    {
+        typedef __m512i Vec;
+        static const int Width = 64;
+        static Vec Load(const std::uint8_t* p) { return _mm512_loadu_si512(p); }
+        static Vec MaskLoad(std::int64_t remain, const std::uint8_t* p) { return _mm512_maskz_loadu_epi8(TailMask8(remain), p); }
+    };
+
+    // Ops accumulating straight into float lanes; Func wraps one of the chunk helpers above.
+    template <typename T, typename Func>
+    struct FloatOp : public Chunk<T>
+    {
+        typedef __m512 Acc;
+        static Acc Zero() { return _mm512_setzero_ps(); }
+        static Acc Accumulate(Acc acc, typename Chunk<T>::Vec q, typename Chunk<T>::Vec c) { return _mm512_add_ps(acc, Func::Apply(q, c)); }
+        static float Reduce(Acc acc) { return _mm512_reduce_add_ps(acc); }
+    };
+
+#define DefineChunkFunc(Name, Helper) \
+    struct Name { static __m512 Apply(__m512i X, __m512i Y) { return Helper(X, Y); } };
+
+    DefineChunkFunc(SqdfEpi8, _mm512_sqdf_epi8)
+    DefineChunkFunc(SqdfEpu8, _mm512_sqdf_epu8)
+    DefineChunkFunc(SqdfEpi16, _mm512_sqdf_epi16)
+    DefineChunkFunc(MulEpi8, _mm512_mul_epi8)
+    DefineChunkFunc(MulEpu8, _mm512_mul_epu8)
+    DefineChunkFunc(MulEpi16, _mm512_mul_epi16)
+#undef DefineChunkFunc
+
+    template <typename T>
+    struct L2FloatOp : public Chunk<T>
+    {
+        typedef __m512 Acc;
+        static Acc Zero() { return _mm512_setzero_ps(); }
+        static Acc Accumulate(Acc acc, __m512 q, __m512 c) { __m512 d = _mm512_sub_ps(q, c); return _mm512_fmadd_ps(d, d, acc); }
+        static float Reduce(Acc acc) { return _mm512_reduce_add_ps(acc); }
+    };
+
+    template <typename T>
+    struct DotFloatOp : public Chunk<T>
+    {
+        typedef __m512 Acc;
+        static Acc Zero() { return _mm512_setzero_ps(); }
+        static Acc Accumulate(Acc acc, __m512 q, __m512 c) { return _mm512_fmadd_ps(q, c, acc); }
+        static float Reduce(Acc acc) { return _mm512_reduce_add_ps(acc); }
+    };
+
+    template <typename T>
+    struct L2VNNIOp : public Chunk<T>
+    {
+        static const bool Unsigned = std::is_same<T, std::uint8_t>::value;
+        typedef __m512i Acc;
+        static Acc Zero() { return _mm512_setzero_si512(); }
+        static Acc Accumulate(Acc acc, __m512i q, __m512i c)
+        {
+            __m512i dlo = Unsigned ? _mm512_sub_epi16(_mm512_lo_epu8_epi16(q), _mm512_lo_epu8_epi16(c)) : _mm512_sub_epi16(_mm512_lo_epi8_epi16(q), _mm512_lo_epi8_epi16(c));
+            __m512i dhi = Unsigned ? _mm512_sub_epi16(_mm512_hi_epu8_epi16(q), _mm512_hi_epu8_epi16(c)) : _mm512_sub_epi16(_mm512_hi_epi8_epi16(q), _mm512_hi_epi8_epi16(c));
+            return _mm512_dpwssd_epi32(_mm512_dpwssd_epi32(acc, dlo, dlo), dhi, dhi);
+        }
+        static float Reduce(Acc acc) { return _mm512_reduce_add_ps(_mm512_cvtepi32_ps(acc)); }
+    };
+
+    // Same bias trick as the single-candidate VNNI dot product kernels; both sums are kept per lane.
+    template <typename T>
+    struct DotVNNIOp : public Chunk<T>
+    {
+        static const bool Unsigned = std::is_same<T, std::uint8_t>::value;
+        struct Acc { __m512i dot; __m512i corr; };
+        static Acc Zero() { Acc acc; acc.dot = _mm512_setzero_si512(); acc.corr = _mm512_setzero_si512(); return acc; }
+        static Acc Accumulate(Acc acc, __m512i q, __m512i c)
+        {
+            const __m512i bias = _mm512_set1_epi8((char)0x80);
+            if (Unsigned) {
+                acc.dot = _mm512_dpbusd_epi32(acc.dot, q, _mm512_xor_si512(c, bias));
+                acc.corr = _mm512_dpbusd_epi32(acc.corr, q, bias);
+            }
+            else {
+                acc.dot = _mm512_dpbusd_epi32(acc.dot, _mm512_xor_si512(q, bias), c);
+                acc.corr = _mm512_dpbusd_epi32(acc.corr, bias, c);
+            }
+            return acc;
+        }
+        static float Reduce(Acc acc) { return _mm512_reduce_add_ps(_mm512_cvtepi32_ps(_mm512_sub_epi32(acc.dot, acc.corr))); }
+    };
+
+    // Raw bfloat16 pairs for vdpbf16ps, twice as many elements per chunk as the widening loads.
+    struct DotBF16Op
+    {
+        typedef __m512i Vec;
+        static const int Width = 32;
+        static Vec Load(const BFloat16* p) { return _mm512_loadu_si512(p); }
+        static Vec MaskLoad(std::int64_t remain, const BFloat16* p) { return _mm512_maskz_loadu_epi16(TailMask16(remain), p); }
+
+        typedef __m512 Acc;
+        static Acc Zero() { return _mm512_setzero_ps(); }
+        static Acc Accumulate(Acc acc, __m512i q, __m512i c) { return _mm512_dpbf16_ps(acc, AsBF16(q), AsBF16(c)); }
+        static float Reduce(Acc acc) { return _mm512_reduce_add_ps(acc); }
+    };
+
+    // Scores N candidates in one sweep over the query and prefetches the same chunk of the next candidates.
+    template <typename Op, int N, typename T>
+    inline void BatchPass(const T* pQuery, const T* const* pCandidates, const T* const* pNext, int nextCount, DimensionType length, float* pOut)
+    {
+        float sum[N];
+        typename Op::Acc acc[N];
+        for (int n = 0; n < N; n++) sum[n] = 0;
+
+        const DimensionType full = length - length % Op::Width;
+        for (DimensionType start = 0; start < full; start += c_intBlock) {
+            const DimensionType end = (full - start > c_intBlock) ? start + c_intBlock : full;
+            for (int n = 0; n < N; n++) acc[n] = Op::Zero();
+            for (DimensionType d = start; d < end; d += Op::Width) {
+                typename Op::Vec q = Op::Load(pQuery + d);
+                for (int n = 0; n < N; n++) acc[n] = Op::Accumulate(acc[n], q, Op::Load(pCandidates[n] + d));
+                for (int n = 0; n < nextCount; n++) _mm_prefetch((const char*)(pNext[n] + d), _MM_HINT_T0);
+            }
+            for (int n = 0; n < N; n++) sum[n] += Op::Reduce(acc[n]);
+        }
+        if (full < length) {
+            typename Op::Vec q = Op::MaskLoad(length - full, pQuery + full);
+            for (int n = 0; n < N; n++) sum[n] += Op::Reduce(Op::Accumulate(Op::Zero(), q, Op::MaskLoad(length - full, pCandidates[n] + full)));
+        }
+        for (int n = 0; n < N; n++) pOut[n] = sum[n];
+    }
+
+    template <typename Op, typename T>
+    inline void Batch(const T* pQuery, const T* const* pCandidates, int count, DimensionType length, float* pOut)
+    {
+        int i = 0;
+        for (; i + 4 <= count; i += 4) {
+            int nextCount = count - i - 4;
+            BatchPass<Op, 4>(pQuery, pCandidates + i, pCandidates + i + 4, (nextCount > 4) ? 4 : nextCount, length, pOut + i);
+        }
+        for (; i < count; i++) BatchPass<Op, 1>(pQuery, pCandidates + i, pCandidates + i, 0, length, pOut + i);
+    }
+}
+
+void DistanceUtils::ComputeL2DistanceBatch_AVX512(const std::int8_t* pQuery, const std::int8_t* const* pCandidates, int count, DimensionType length, float* pOut)
+{
+    Batch<FloatOp<std::int8_t, SqdfEpi8>>(pQuery, pCandidates, count, length, pOut);
+}
+
+void DistanceUtils::ComputeL2DistanceBatch_AVX512(const std::uint8_t* pQuery, const std::uint8_t* const* pCandidates, int count, DimensionType length, float* pOut)
+{
+    Batch<FloatOp<std::uint8_t, SqdfEpu8>>(pQuery, pCandidates, count, length, pOut);
+}
+
+void DistanceUtils::ComputeL2DistanceBatch_AVX512(const std::int16_t* pQuery, const std::int16_t* const* pCandidates, int count, DimensionType length, float* pOut)
+{
+    Batch<FloatOp<std::int16_t, SqdfEpi16>>(pQuery, pCandidates, count, length, pOut);
+}
+
+void DistanceUtils::ComputeL2DistanceBatch_AVX512(const float* pQuery, const float* const* pCandidates, int count, DimensionType length, float* pOut)
+{
+    Batch<L2FloatOp<float>>(pQuery, pCandidates, count, length, pOut);
+}
+
+void DistanceUtils::ComputeL2DistanceBatch_AVX512(const Float16* pQuery, const Float16* const* pCandidates, int count, DimensionType length, float* pOut)
+{
+    Batch<L2FloatOp<Float16>>(pQuery, pCandidates, count, length, pOut);
+}
+
+void DistanceUtils::ComputeL2DistanceBatch_AVX512(const BFloat16* pQuery, const BFloat16* const* pCandidates, int count, DimensionType length, float* pOut)
+{
+    Batch<L2FloatOp<BFloat16>>(pQuery, pCandidates, count, length, pOut);
+}
+
+void DistanceUtils::ComputeDotProductBatch_AVX512(const std::int8_t* pQuery, const std::int8_t* const* pCandidates, int count, DimensionType length, float* pOut)
+{
+    Batch<FloatOp<std::int8_t, MulEpi8>>(pQuery, pCandidates, count, length, pOut);
+}
+
+void DistanceUtils::ComputeDotProductBatch_AVX512(const std::uint8_t* pQuery, const std::uint8_t* const* pCandidates, int count, DimensionType length, float* pOut)
+{
+    Batch<FloatOp<std::uint8_t, MulEpu8>>(pQuery, pCandidates, count, length, pOut);
+}
+
+void DistanceUtils::ComputeDotProductBatch_AVX512(const std::int16_t* pQuery, const std::int16_t* const* pCandidates, int count, DimensionType length, float* pOut)
+{
+    Batch<FloatOp<std::int16_t, MulEpi16>>(pQuery, pCandidates, count, length, pOut);
+}
+
+void DistanceUtils::ComputeDotProductBatch_AVX512(const float* pQuery, const float* const* pCandidates, int count, DimensionType length, float* pOut)
+{
+    Batch<DotFloatOp<float>>(pQuery, pCandidates, count, length, pOut);
+}
+
+void DistanceUtils::ComputeDotProductBatch_AVX512(const Float16* pQuery, const Float16* const* pCandidates, int count, DimensionType length, float* pOut)
+{
+    Batch<DotFloatOp<Float16>>(pQuery, pCandidates, count, length, pOut);
+}
+
+void DistanceUtils::ComputeDotProductBatch_AVX512(const BFloat16* pQuery, const BFloat16* const* pCandidates, int count, DimensionType length, float* pOut)
+{
+    Batch<DotFloatOp<BFloat16>>(pQuery, pCandidates, count, length, pOut);
+}
+
+void DistanceUtils::ComputeL2DistanceBatch_AVX512VNNI(const std::int8_t* pQuery, const std::int8_t* const* pCandidates, int count, DimensionType length, float* pOut)
+{
+    Batch<L2VNNIOp<std::int8_t>>(pQuery, pCandidates, count, length, pOut);
+}
+
+void DistanceUtils::ComputeL2DistanceBatch_AVX512VNNI(const std::uint8_t* pQuery, const std::uint8_t* const* pCandidates, int count, DimensionType length, float* pOut)
+{
+    Batch<L2VNNIOp<std::uint8_t>>(pQuery, pCandidates, count, length, pOut);
+}
+
+void DistanceUtils::ComputeDotProductBatch_AVX512VNNI(const std::int8_t* pQuery, const std::int8_t* const* pCandidates, int count, DimensionType length, float* pOut)
+{
+    Batch<DotVNNIOp<std::int8_t>>(pQuery, pCandidates, count, length, pOut);
+}
+
+void DistanceUtils::ComputeDotProductBatch_AVX512VNNI(const std::uint8_t* pQuery, const std::uint8_t* const* pCandidates, int count, DimensionType length, float* pOut)
+{
+    Batch<DotVNNIOp<std::uint8_t>>(pQuery, pCandidates, count, length, pOut);
+}
+
+void DistanceUtils::ComputeDotProductBatch_AVX512BF16(const BFloat16* pQuery, const BFloat16* const* pCandidates, int count, DimensionType length, float* pOut)
+{
+    Batch<DotBF16Op>(pQuery, pCandidates, count, length, pOut);
+}
+
+float DistanceUtils::ComputeADCDistance_AVX512(const float* pTable, const std::uint8_t* pCode, DimensionType subvectors)
+{
+    const __m512i offsets = _mm512_mullo_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15), _mm512_set1_epi32(PQADCTableWidth));
+    __m512 diff512 = _mm512_setzero_ps();
+    DimensionType m = 0;
+    for (; m + 16 <= subvectors; m += 16)
+    {
+        __m512i idx = _mm512_add_epi32(_mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(pCode + m))), offsets);
+        diff512 = _mm512_add_ps(diff512, _mm512_i32gather_ps(idx, pTable + (size_t)m * PQADCTableWidth, 4));
+    }
+    if (m < subvectors)
+    {
+        // the masked byte load would need AVX512VL, so the last codes go through a zeroed buffer
+        std::uint8_t tail[16] = { 0 };
+        std::memcpy(tail, pCode + m, subvectors - m);
+        __m512i idx = _mm512_add_epi32(_mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)tail)), offsets);
+        diff512 = _mm512_add_ps(diff512, _mm512_mask_i32gather_ps(_mm512_setzero_ps(), TailMask32(subvectors - m), idx, pTable + (size_t)m * PQADCTableWidth, 4));
+    }
+    return _mm512_reduce_add_ps(diff512);
+}
+
+namespace
+{
+    template <bool IsXor>
+    inline __m512i CombineBits512(__m512i X, __m512i Y)
+    {
+        return IsXor ? _mm512_xor_si512(X, Y) : _mm512_and_si512(X, Y);
+    }
+
+    // per-byte popcounts from two nibble lookups, summed into the 64-bit lanes by vpsadbw
+    inline __m512i PopcountBytes512(__m512i X)
+    {
+        const __m512i lookup = _mm512_broadcast_i32x4(_mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4));
+        const __m512i low = _mm512_set1_epi8(0x0F);
+        __m512i lo = _mm512_shuffle_epi8(lookup, _mm512_and_si512(X, low));
+        __m512i hi = _mm512_shuffle_epi8(lookup, _mm512_and_si512(_mm512_srli_epi16(X, 4), low));
+        return _mm512_sad_epu8(_mm512_add_epi8(lo, hi), _mm512_setzero_si512());
+    }
+}
+
+template <bool IsXor>
+std::uint64_t DistanceUtils::CountBits_AVX512(const std::uint8_t* pX, const std::uint8_t* pY, std::size_t bytes)
+{
+    __m512i count = _mm512_setzero_si512();
+    std::size_t i = 0;
+    for (; i + 64 <= bytes; i += 64)
+    {
+        count = _mm512_add_epi64(count, PopcountBytes512(CombineBits512<IsXor>(_mm512_loadu_si512(pX + i), _mm512_loadu_si512(pY + i))));
+    }
+    if (i < bytes)
+    {
+        __mmask64 mask = TailMask8(bytes - i);
+        count = _mm512_add_epi64(count, PopcountBytes512(CombineBits512<IsXor>(_mm512_maskz_loadu_epi8(mask, pX + i), _mm512_maskz_loadu_epi8(mask, pY + i))));
+    }
+    return (std::uint64_t)_mm512_reduce_add_epi64(count);
+}
+
+template <bool IsXor>
+std::uint64_t DistanceUtils::CountBits_AVX512VPOPCNTDQ(const std::uint8_t* pX, const std::uint8_t* pY, std::size_t bytes)
+{
+    __m512i count = _mm512_setzero_si512();
+    std::size_t i = 0;
+    for (; i + 64 <= bytes; i += 64)
+    {
+        count = _mm512_add_epi64(count, _mm512_popcnt_epi64(CombineBits512<IsXor>(_mm512_loadu_si512(pX + i), _mm512_loadu_si512(pY + i))));
+    }
+    if (i < bytes)
+    {
+        __mmask64 mask = TailMask8(bytes - i);
+        count = _mm512_add_epi64(count, _mm512_popcnt_epi64(CombineBits512<IsXor>(_mm512_maskz_loadu_epi8(mask, pX + i), _mm512_maskz_loadu_epi8(mask, pY + i))));
+    }
+    return (std::uint64_t)_mm512_reduce_add_epi64(count);
+}
+
+template std::uint64_t DistanceUtils::CountBits_AVX512<true>(const std::uint8_t*, const std::uint8_t*, std::size_t);
+template std::uint64_t DistanceUtils::CountBits_AVX512<false>(const std::uint8_t*, const std::uint8_t*, std::size_t);
+template std::uint64_t DistanceUtils::CountBits_AVX512VPOPCNTDQ<true>(const std::uint8_t*, const std::uint8_t*, std::size_t);
+template std::uint64_t DistanceUtils::CountBits_AVX512VPOPCNTDQ<false>(const std::uint8_t*, const std::uint8_t*, std::size_t);
+
+template <DimensionType D>
+float DistanceUtils::ComputeL2DistanceFixed_AVX512(const float* pX, const float* pY, DimensionType /*length*/)
+{
+    __m512 diff512 = _mm512_setzero_ps();
+    __m512 diff512b = _mm512_setzero_ps();
+    UNROLL_FULLY
+    for (DimensionType i = 0; i < D / 32; i++) {
+        __m512 d1 = _mm512_sub_ps(_mm512_loadu_ps(pX), _mm512_loadu_ps(pY));
+        __m512 d2 = _mm512_sub_ps(_mm512_loadu_ps(pX + 16), _mm512_loadu_ps(pY + 16));
+        diff512 = _mm512_fmadd_ps(d1, d1, diff512);
+        diff512b = _mm512_fmadd_ps(d2, d2, diff512b);
+        pX += 32; pY += 32;
+    }
+    if (D % 32 >= 16) {
+        __m512 d = _mm512_sub_ps(_mm512_loadu_ps(pX), _mm512_loadu_ps(pY));
+        diff512 = _mm512_fmadd_ps(d, d, diff512);
+        pX += 16; pY += 16;
+    }
+    if (D % 16 > 0) {
+        __mmask16 mask = TailMask32(D % 16);
+        __m512 d = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, pX), _mm512_maskz_loadu_ps(mask, pY));
+        diff512b = _mm512_fmadd_ps(d, d, diff512b);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(diff512, diff512b));
+}
+
+template <DimensionType D>
+float DistanceUtils::ComputeDotProductFixed_AVX512(const float* pX, const float* pY, DimensionType /*length*/)
+{
+    __m512 diff512 = _mm512_setzero_ps();
+    __m512 diff512b = _mm512_setzero_ps();
+    UNROLL_FULLY
+    for (DimensionType i = 0; i < D / 32; i++) {
+        diff512 = _mm512_fmadd_ps(_mm512_loadu_ps(pX), _mm512_loadu_ps(pY), diff512);
+        diff512b = _mm512_fmadd_ps(_mm512_loadu_ps(pX + 16), _mm512_loadu_ps(pY + 16), diff512b);
+        pX += 32; pY += 32;
+    }
+    if (D % 32 >= 16) {
+        diff512 = _mm512_fmadd_ps(_mm512_loadu_ps(pX), _mm512_loadu_ps(pY), diff512);
+        pX += 16; pY += 16;
+    }
+    if (D % 16 > 0) {
+        __mmask16 mask = TailMask32(D % 16);
+        diff512b = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, pX), _mm512_maskz_loadu_ps(mask, pY), diff512b);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(diff512, diff512b));
+}
+
+// The unrolled kernels inline into the candidate loop, so short queries stay in registers across candidates.
+template <DimensionType D>
+void DistanceUtils::ComputeL2DistanceBatchFixed_AVX512(const float* pQuery, const float* const* pCandidates, int count, DimensionType length, float* pOut)
+{
+    ComputeDistanceBatch_Loop<float, &ComputeL2DistanceFixed_AVX512<D>>(pQuery, pCandidates, count, length, pOut);
+}
+
+template <DimensionType D>
+void DistanceUtils::ComputeDotProductBatchFixed_AVX512(const float* pQuery, const float* const* pCandidates, int count, DimensionType length, float* pOut)
+{
+    ComputeDistanceBatch_Loop<float, &ComputeDotProductFixed_AVX512<D>>(pQuery, pCandidates, count, length, pOut);
+}
+
+#define DefineFixedDimension(D) \
+template float DistanceUtils::ComputeL2DistanceFixed_AVX512<D>(const float*, const float*, DimensionType); \
+template float DistanceUtils::ComputeDotProductFixed_AVX512<D>(const float*, const float*, DimensionType); \
+template void DistanceUtils::ComputeL2DistanceBatchFixed_AVX512<D>(const float*, const float* const*, int, DimensionType, float*); \
+template void DistanceUtils::ComputeDotProductBatchFixed_AVX512<D>(const float*, const float* const*, int, DimensionType, float*);
+FIXED_DIMENSIONS(DefineFixedDimension)
+#undef DefineFixedDimension
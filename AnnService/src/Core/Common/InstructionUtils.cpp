@@ -1,31 +1,81 @@
 #include "inc/Core/Common/InstructionUtils.h"
-#include "inc/Core/common.h"
+#include "inc/Core/Common.h"
+
+#include <cctype>
+#include <cstdlib>
 
 #ifndef _MSC_VER
 void cpuid(int info[4], int InfoType) {
     __cpuid_count(InfoType, 0, info[0], info[1], info[2], info[3]);
 }
+
+static void cpuidex(int info[4], int InfoType, int SubType) {
+    __cpuid_count(InfoType, SubType, info[0], info[1], info[2], info[3]);
+}
+
+static unsigned long long xgetbv(unsigned int index) {
+    unsigned int eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(index));
+    return ((unsigned long long)edx << 32) | eax;
+}
+#else
+#include <immintrin.h>
+#define xgetbv(index) _xgetbv(index)
+#define cpuidex(info, x, sub) __cpuidex(info, x, sub)
 #endif
 
 namespace SPTAG {
     namespace COMMON {
+        InstructionSet::Level InstructionSet::s_maxLevel = InstructionSet::Level::AVX512BF16;
         const InstructionSet::InstructionSet_Internal InstructionSet::CPU_Rep;
 
-        bool InstructionSet::SSE(void) { return CPU_Rep.HW_SSE; }
-        bool InstructionSet::SSE2(void) { return CPU_Rep.HW_SSE2; }
-        bool InstructionSet::AVX(void) { return CPU_Rep.HW_AVX; }
-        bool InstructionSet::AVX2(void) { return CPU_Rep.HW_AVX2; }
+        bool InstructionSet::SSE(void) { return CPU_Rep.HW_SSE && s_maxLevel >= Level::SSE; }
+        bool InstructionSet::SSE2(void) { return CPU_Rep.HW_SSE2 && s_maxLevel >= Level::SSE2; }
+        bool InstructionSet::AVX(void) { return CPU_Rep.HW_AVX && s_maxLevel >= Level::AVX; }
+        bool InstructionSet::AVX2(void) { return CPU_Rep.HW_AVX2 && s_maxLevel >= Level::AVX2; }
+        bool InstructionSet::AVX512(void) { return CPU_Rep.HW_AVX512 && s_maxLevel >= Level::AVX512; }
+        bool InstructionSet::AVX512VNNI(void) { return CPU_Rep.HW_AVX512VNNI && s_maxLevel >= Level::AVX512VNNI; }
+        bool InstructionSet::AVX512BF16(void) { return CPU_Rep.HW_AVX512BF16 && s_maxLevel >= Level::AVX512BF16; }
+        bool InstructionSet::F16C(void) { return CPU_Rep.HW_F16C && s_maxLevel >= Level::AVX; }
+        bool InstructionSet::AVX512VPOPCNTDQ(void) { return CPU_Rep.HW_AVX512VPOPCNTDQ && s_maxLevel >= Level::AVX512VNNI; }
+
+        void InstructionSet::SetMaxLevel(Level p_level) { s_maxLevel = p_level; }
+        InstructionSet::Level InstructionSet::GetMaxLevel(void) { return s_maxLevel; }
+
+        bool InstructionSet::ParseLevel(const char* p_str, Level& p_level)
+        {
+            static const char* c_names[] = { "NONE", "SSE", "SSE2", "AVX", "AVX2", "AVX512", "AVX512VNNI", "AVX512BF16" };
+            if (p_str == nullptr) return false;
+
+            std::string name(p_str);
+            for (char& c : name) c = (char)std::toupper((unsigned char)c);
+            for (int i = 0; i < (int)(sizeof(c_names) / sizeof(c_names[0])); i++)
+            {
+                if (name == c_names[i])
+                {
+                    p_level = (Level)i;
+                    return true;
+                }
+            }
+            return false;
+        }
 
         // from https://stackoverflow.com/a/7495023/5053214
         InstructionSet::InstructionSet_Internal::InstructionSet_Internal() :
             HW_SSE{ false },
             HW_SSE2{ false },
             HW_AVX{ false },
-            HW_AVX2{ false }
+            HW_AVX2{ false },
+            HW_AVX512{ false },
+            HW_AVX512VNNI{ false },
+            HW_AVX512BF16{ false },
+            HW_F16C{ false },
+            HW_AVX512VPOPCNTDQ{ false }
         {
             int info[4];
             cpuid(info, 0);
             int nIds = info[0];
+            bool osZmmState = false;
 
             //  Detect Features
             if (nIds >= 0x00000001) {
@@ -33,18 +83,46 @@ namespace SPTAG {
                 HW_SSE = (info[3] & ((int)1 << 25)) != 0;
                 HW_SSE2 = (info[3] & ((int)1 << 26)) != 0;
                 HW_AVX = (info[2] & ((int)1 << 28)) != 0;
+                HW_F16C = HW_AVX && (info[2] & ((int)1 << 29)) != 0;
+
+                // OSXSAVE: the OS must save opmask and ZMM state (XCR0 bits 1,2,5,6,7) for AVX-512 to be usable.
+                if ((info[2] & ((int)1 << 27)) != 0) {
+                    osZmmState = (xgetbv(0) & 0xE6) == 0xE6;
+                }
             }
             if (nIds >= 0x00000007) {
                 cpuid(info, 0x00000007);
                 HW_AVX2 = (info[1] & ((int)1 << 5)) != 0;
+
+                // AVX512F (ebx bit 16) and AVX512BW (ebx bit 30) are both required by the 512-bit kernels.
+                HW_AVX512 = osZmmState && (info[1] & ((int)1 << 16)) != 0 && (info[1] & ((int)1 << 30)) != 0;
+                HW_AVX512VNNI = HW_AVX512 && (info[2] & ((int)1 << 11)) != 0;
+                HW_AVX512VPOPCNTDQ = HW_AVX512 && (info[2] & ((int)1 << 14)) != 0;
+
+                // AVX512_BF16 is reported in leaf 7 sub-leaf 1, eax bit 5.
+                if (info[0] >= 1) {
+                    cpuidex(info, 0x00000007, 1);
+                    HW_AVX512BF16 = HW_AVX512 && (info[0] & ((int)1 << 5)) != 0;
+                }
             }
-            if (HW_AVX2)
+
+            const char* envLevel = std::getenv("SPTAG_INSTRUCTION_SET");
+            if (envLevel != nullptr && !ParseLevel(envLevel, s_maxLevel))
+                LOG(Helper::LogLevel::LL_Error, "Unknown SPTAG_INSTRUCTION_SET value %s, ignored!\n", envLevel);
+
+            if (HW_AVX512BF16 && s_maxLevel >= Level::AVX512BF16)
+                LOG(Helper::LogLevel::LL_Info, "Using AVX512BF16 InstructionSet!\n");
+            else if (HW_AVX512VNNI && s_maxLevel >= Level::AVX512VNNI)
+                LOG(Helper::LogLevel::LL_Info, "Using AVX512VNNI InstructionSet!\n");
+            else if (HW_AVX512 && s_maxLevel >= Level::AVX512)
+                LOG(Helper::LogLevel::LL_Info, "Using AVX512 InstructionSet!\n");
+            else if (HW_AVX2 && s_maxLevel >= Level::AVX2)
                 LOG(Helper::LogLevel::LL_Info, "Using AVX2 InstructionSet!\n");
-            else if (HW_AVX)
+            else if (HW_AVX && s_maxLevel >= Level::AVX)
                 LOG(Helper::LogLevel::LL_Info, "Using AVX InstructionSet!\n");
-            else if (HW_SSE2)
+            else if (HW_SSE2 && s_maxLevel >= Level::SSE2)
                 LOG(Helper::LogLevel::LL_Info, "Using SSE2 InstructionSet!\n");
-            else if (HW_SSE)
+            else if (HW_SSE && s_maxLevel >= Level::SSE)
                 LOG(Helper::LogLevel::LL_Info, "Using SSE InstructionSet!\n");
             else
                 LOG(Helper::LogLevel::LL_Info, "Using NONE InstructionSet!\n");
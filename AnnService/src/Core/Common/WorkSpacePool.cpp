@@ -6,62 +6,181 @@
 using namespace SPTAG;
 using namespace SPTAG::COMMON;
 
+namespace
+{
+    std::atomic<std::uint64_t> s_nextPoolId(1);
+
+    // The workspace a thread last returned, to the pool m_poolId as long as m_pool has not expired.
+    struct ThreadCache
+    {
+        std::uint64_t m_poolId = 0;
+        std::weak_ptr<char> m_pool;
+        std::unique_ptr<WorkSpace> m_workSpace;
+    };
 
-WorkSpacePool::WorkSpacePool(int p_maxCheck, SizeType p_vectorCount, int p_hashExp)
-    : m_maxCheck(p_maxCheck),
+    thread_local ThreadCache t_cache;
+}
+
+
+WorkSpacePool::WorkSpacePool(int p_maxCheck, SizeType p_vectorCount, int p_hashExp, bool p_epochVisited)
+    : m_id(s_nextPoolId.fetch_add(1)),
+      m_liveness(new char(0)),
+      m_leaseCount(0),
+      m_maxCheck(p_maxCheck),
       m_vectorCount(p_vectorCount),
-      m_hashExp(p_hashExp)
+      m_hashExp(p_hashExp),
+      m_epochVisited(p_epochVisited)
 {
 }
 
 
 WorkSpacePool::~WorkSpacePool()
 {
-    for (auto& workSpace : m_workSpacePool)
-        workSpace.reset();
-    m_workSpacePool.clear();
+    for (int i = 0; i < m_freeListSize; i++)
+        delete m_freeList[i].exchange(nullptr);
 }
 
 
-std::shared_ptr<WorkSpace>
+std::unique_ptr<WorkSpace>
 WorkSpacePool::Rent()
 {
-    std::shared_ptr<WorkSpace> workSpace;
+    ThreadCache& cache = t_cache;
+    if (cache.m_poolId == m_id && cache.m_workSpace != nullptr) return std::move(cache.m_workSpace);
+
+    WorkSpace* workSpace = Pop();
+    if (workSpace == nullptr && ReclaimLeases()) workSpace = Pop();
+    if (workSpace != nullptr) return std::unique_ptr<WorkSpace>(workSpace);
+    return Create();
+}
+
+
+void
+WorkSpacePool::Return(std::unique_ptr<WorkSpace> p_workSpace)
+{
+    // rented from the pool this one replaced, so sized for its MaxCheck
+    if (p_workSpace == nullptr || p_workSpace->m_poolId != m_id) return;
 
+    // The thread keeps its cache for one pool until that pool is destroyed, so a thread searching several
+    // indexes in turn does not free a workspace on every switch.
+    ThreadCache& cache = t_cache;
+    if (cache.m_poolId != m_id && (cache.m_workSpace == nullptr || cache.m_pool.expired()))
     {
-        std::lock_guard<std::mutex> lock(m_workSpacePoolMutex);
-        if (!m_workSpacePool.empty())
-        {
-            workSpace = m_workSpacePool.front();
-            m_workSpacePool.pop_front();
-        }
-        else
-        {
-            workSpace.reset(new WorkSpace);
-            workSpace->Initialize(m_maxCheck, m_vectorCount, m_hashExp);
-        }
+        cache.m_workSpace.reset();
+        cache.m_poolId = m_id;
+        cache.m_pool = m_liveness;
     }
-    return workSpace;
+    if (cache.m_poolId == m_id && cache.m_workSpace == nullptr)
+    {
+        cache.m_workSpace = std::move(p_workSpace);
+        return;
+    }
+    Push(p_workSpace.release());
 }
 
 
-void
-WorkSpacePool::Return(const std::shared_ptr<WorkSpace>& p_workSpace)
+std::shared_ptr<WorkSpaceLease>
+WorkSpacePool::Lease(int p_timeoutSeconds)
 {
+    std::shared_ptr<WorkSpaceLease> lease(new WorkSpaceLease);
+    lease->m_workSpace = Rent();
+    lease->m_lastUse = std::chrono::steady_clock::now();
+    lease->m_timeout = std::chrono::seconds(p_timeoutSeconds);
     {
-        std::lock_guard<std::mutex> lock(m_workSpacePoolMutex);
-        m_workSpacePool.push_back(p_workSpace);
+        std::lock_guard<std::mutex> lock(m_leaseMutex);
+        m_leases.push_back(lease);
+        m_leaseCount++;
     }
+    return lease;
+}
+
+
+void
+WorkSpacePool::Release(WorkSpaceLease& p_lease)
+{
+    std::lock_guard<std::mutex> lock(p_lease.m_lock);
+    if (p_lease.m_workSpace != nullptr) Return(std::move(p_lease.m_workSpace));
 }
 
 
 void
 WorkSpacePool::Init(int size)
 {
-    for (int i = 0; i < size; i++) 
+    m_freeListSize = max(size * 2, 64);
+    m_freeList.reset(new std::atomic<WorkSpace*>[m_freeListSize]);
+    for (int i = 0; i < m_freeListSize; i++) m_freeList[i].store(nullptr);
+
+    for (int i = 0; i < size; i++) Push(Create().release());
+}
+
+
+std::unique_ptr<WorkSpace>
+WorkSpacePool::Create() const
+{
+    std::unique_ptr<WorkSpace> workSpace(new WorkSpace);
+    workSpace->Initialize(m_maxCheck, m_vectorCount, m_hashExp, m_epochVisited);
+    workSpace->m_poolId = m_id;
+    return workSpace;
+}
+
+
+WorkSpace*
+WorkSpacePool::Pop()
+{
+    for (int i = 0; i < m_freeListSize; i++)
+    {
+        if (m_freeList[i].load(std::memory_order_relaxed) == nullptr) continue;
+        WorkSpace* workSpace = m_freeList[i].exchange(nullptr, std::memory_order_acquire);
+        if (workSpace != nullptr) return workSpace;
+    }
+    return nullptr;
+}
+
+
+void
+WorkSpacePool::Push(WorkSpace* p_workSpace)
+{
+    for (int i = 0; i < m_freeListSize; i++)
     {
-        std::shared_ptr<WorkSpace> workSpace(new WorkSpace);
-        workSpace->Initialize(m_maxCheck, m_vectorCount, m_hashExp);
-        m_workSpacePool.push_back(std::move(workSpace));
+        WorkSpace* empty = nullptr;
+        if (m_freeList[i].load(std::memory_order_relaxed) == nullptr
+            && m_freeList[i].compare_exchange_strong(empty, p_workSpace, std::memory_order_release, std::memory_order_relaxed)) return;
     }
-}
\ No newline at end of file
+    delete p_workSpace;
+}
+
+
+bool
+WorkSpacePool::ReclaimLeases()
+{
+    if (m_leaseCount.load(std::memory_order_relaxed) == 0) return false;
+
+    bool reclaimed = false;
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(m_leaseMutex);
+    for (auto iter = m_leases.begin(); iter != m_leases.end();)
+    {
+        std::shared_ptr<WorkSpaceLease> lease = iter->lock();
+        if (lease == nullptr)
+        {
+            iter = m_leases.erase(iter);
+            m_leaseCount--;
+            continue;
+        }
+
+        // A lease in use is not idle; skipping it also keeps the lock order of Release.
+        std::unique_lock<std::mutex> leaseLock(lease->m_lock, std::try_to_lock);
+        if (leaseLock.owns_lock() && (lease->m_workSpace == nullptr || now - lease->m_lastUse > lease->m_timeout))
+        {
+            if (lease->m_workSpace != nullptr)
+            {
+                Push(lease->m_workSpace.release());
+                reclaimed = true;
+            }
+            iter = m_leases.erase(iter);
+            m_leaseCount--;
+            continue;
+        }
+        ++iter;
+    }
+    return reclaimed;
+}
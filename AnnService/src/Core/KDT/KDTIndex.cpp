@@ -3,6 +3,7 @@
 
 #include "inc/Core/KDT/Index.h"
 #include <chrono>
+#include <queue>
 
 #pragma warning(disable:4242)  // '=' : conversion from 'int' to 'short', possible loss of data
 #pragma warning(disable:4244)  // '=' : conversion from 'int' to 'short', possible loss of data
@@ -36,8 +37,10 @@ namespace SPTAG
             if (m_pGraph.LoadGraph((char*)p_indexBlobs[2].Data()) != ErrorCode::Success) return ErrorCode::FailedParseValue;
             if (p_indexBlobs.size() > 3 && m_deletedID.Load((char*)p_indexBlobs[3].Data()) != ErrorCode::Success) return ErrorCode::FailedParseValue;
 
+            SelectDistanceKernels();
+            UpdateMaxNormSquare(0, GetNumSamples());
             omp_set_num_threads(m_iNumberOfThreads);
-            m_workSpacePool.reset(new COMMON::WorkSpacePool(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), GetNumSamples(), m_iHashTableExp));
+            m_workSpacePool.reset(new COMMON::WorkSpacePool(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), GetNumSamples(), m_iHashTableExp, m_bEpochVisitedSet));
             m_workSpacePool->Init(m_iNumberOfThreads);
             m_threadPool.init();
             return ErrorCode::Success;
@@ -54,8 +57,10 @@ namespace SPTAG
             if ((ret = m_pGraph.LoadGraph(p_indexStreams[2])) != ErrorCode::Success) return ret;
             if (p_indexStreams.size() > 3 && (ret = m_deletedID.Load(p_indexStreams[3])) != ErrorCode::Success) return ret;
 
+            SelectDistanceKernels();
+            UpdateMaxNormSquare(0, GetNumSamples());
             omp_set_num_threads(m_iNumberOfThreads);
-            m_workSpacePool.reset(new COMMON::WorkSpacePool(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), GetNumSamples(), m_iHashTableExp));
+            m_workSpacePool.reset(new COMMON::WorkSpacePool(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), GetNumSamples(), m_iHashTableExp, m_bEpochVisitedSet));
             m_workSpacePool->Init(m_iNumberOfThreads);
             m_threadPool.init();
             return ret;
@@ -96,27 +101,45 @@ namespace SPTAG
         std::shared_lock<std::shared_timed_mutex> lock(*(m_pTrees.m_lock)); \
         m_pTrees.InitSearchTrees(m_pSamples, m_fComputeDistance, p_query, p_space); \
         m_pTrees.SearchTrees(m_pSamples, m_fComputeDistance, p_query, p_space, m_iNumberOfInitialDynamicPivots); \
+        p_space.ReserveBatch(m_pGraph.m_iNeighborhoodSize); \
         while (!p_space.m_NGQueue.empty()) { \
             COMMON::HeapCell gnode = p_space.m_NGQueue.pop(); \
+            if (p_space.m_termination.m_active && m_termination.ShouldStop(p_space.m_termination, p_space.m_iNumberOfCheckedLeaves, gnode.distance, p_query)) { \
+                p_space.m_terminationReason = TerminationReason::Adaptive; \
+                p_query.SortResult(); return; \
+            } \
+            p_space.m_iNumberOfHops++; \
+            if (p_space.DeadlinePassed()) { \
+                p_space.m_terminationReason = TerminationReason::Deadline; \
+                p_query.SortResult(); return; \
+            } \
             const SizeType *node = m_pGraph[gnode.node]; \
             _mm_prefetch((const char *)node, _MM_HINT_T0); \
             for (DimensionType i = 0; i < m_pGraph.m_iNeighborhoodSize; i++) \
                 _mm_prefetch((const char *)(m_pSamples)[node[i]], _MM_HINT_T0); \
             CheckDeleted { \
                 if (!p_query.AddPoint(gnode.node, gnode.distance) && p_space.m_iNumberOfCheckedLeaves > p_space.m_iMaxCheck) { \
+                    p_space.m_terminationReason = TerminationReason::MaxCheck; \
                     p_query.SortResult(); return; \
                 } \
             } \
             float upperBound = max(p_query.worstDist(), gnode.distance); \
             bool bLocalOpt = true; \
+            int batchCount = 0; \
             for (DimensionType i = 0; i < m_pGraph.m_iNeighborhoodSize; i++) { \
                 SizeType nn_index = node[i]; \
                 if (nn_index < 0) break; \
                 if (p_space.CheckAndSet(nn_index)) continue; \
-                float distance2leaf = m_fComputeDistance(p_query.GetTarget(), (m_pSamples)[nn_index], GetFeatureDim()); \
+                p_space.m_batchNodes[batchCount] = nn_index; \
+                p_space.m_batchVectors[batchCount++] = (m_pSamples)[nn_index]; \
+            } \
+            m_fComputeDistanceBatch(p_query.GetTarget(), (const T* const*)p_space.m_batchVectors.data(), batchCount, GetFeatureDim(), p_space.m_batchDists.data()); \
+            p_space.m_iNumberOfCheckedLeaves += batchCount; \
+            p_space.m_iNumberOfDistanceEvaluations += batchCount; \
+            for (int i = 0; i < batchCount; i++) { \
+                float distance2leaf = p_space.m_batchDists[i]; \
                 if (distance2leaf <= upperBound) bLocalOpt = false; \
-                p_space.m_iNumberOfCheckedLeaves++; \
-                p_space.m_NGQueue.insert(COMMON::HeapCell(nn_index, distance2leaf)); \
+                p_space.m_NGQueue.insert(COMMON::HeapCell(p_space.m_batchNodes[i], distance2leaf)); \
             } \
             if (bLocalOpt) p_space.m_iNumOfContinuousNoBetterPropagation++; \
             else p_space.m_iNumOfContinuousNoBetterPropagation = 0; \
@@ -124,10 +147,12 @@ namespace SPTAG
                 if (p_space.m_iNumberOfTreeCheckedLeaves <= p_space.m_iNumberOfCheckedLeaves / 10) { \
                     m_pTrees.SearchTrees(m_pSamples, m_fComputeDistance, p_query, p_space, m_iNumberOfOtherDynamicPivots + p_space.m_iNumberOfCheckedLeaves); \
                 } else if (gnode.distance > p_query.worstDist()) { \
-                    break; \
+                    p_space.m_terminationReason = TerminationReason::NoBetterPropagation; \
+                    p_query.SortResult(); return; \
                 } \
             } \
         } \
+        p_space.m_terminationReason = TerminationReason::QueueEmpty; \
         p_query.SortResult(); \
 
         template <typename T>
@@ -142,22 +167,351 @@ namespace SPTAG
             Search(;)
         }
 
+        // Rejected vectors still lead to their neighbors; results may fill slowly, so MaxCheck bounds the search.
+        template <typename T>
+        void Index<T>::SearchIndexWithFilter(COMMON::QueryResultSet<T> &p_query, COMMON::WorkSpace &p_space, bool p_searchDeleted) const
+        {
+            Search(if (!p_space.m_filter->Allows(gnode.node) || (!p_searchDeleted && m_deletedID.Contains(gnode.node))) { if (p_space.m_iNumberOfCheckedLeaves > p_space.m_iMaxCheck) { p_space.m_terminationReason = TerminationReason::MaxCheck; p_query.SortResult(); return; } } else)
+        }
+
+        // Runs the Search loop above for every query of p_group in lockstep. Each round has two passes:
+        // the first expands the node every query popped in the previous round, whose graph row was
+        // prefetched meanwhile, and prefetches the unvisited neighbors; the second scores them and pops
+        // the next node. Every query takes the same steps, so it gets the same results as SearchIndex.
+        template <typename T>
+        void Index<T>::SearchIndexInterleaved(std::vector<InterleavedQuery>& p_group, bool p_searchDeleted) const
+        {
+            std::shared_lock<std::shared_timed_mutex> lock(*(m_pTrees.m_lock));
+            const bool checkDeleted = !p_searchDeleted && m_deletedID.Count() > 0;
+            const size_t vectorSize = sizeof(T) * GetFeatureDim();
+
+            auto popNode = [&](InterleavedQuery& p_entry) {
+                if (p_entry.m_space->m_NGQueue.empty()) {
+                    p_entry.m_space->m_terminationReason = TerminationReason::QueueEmpty;
+                    p_entry.m_query->SortResult();
+                    p_entry.m_active = false;
+                    return;
+                }
+                p_entry.m_node = p_entry.m_space->m_NGQueue.pop();
+                _mm_prefetch((const char *)m_pGraph[p_entry.m_node.node], _MM_HINT_T0);
+            };
+
+            int active = 0;
+            for (InterleavedQuery& entry : p_group)
+            {
+                m_pTrees.InitSearchTrees(m_pSamples, m_fComputeDistance, *entry.m_query, *entry.m_space);
+                m_pTrees.SearchTrees(m_pSamples, m_fComputeDistance, *entry.m_query, *entry.m_space, m_iNumberOfInitialDynamicPivots);
+                entry.m_space->ReserveBatch(m_pGraph.m_iNeighborhoodSize);
+                entry.m_active = true;
+                popNode(entry);
+                if (entry.m_active) active++;
+            }
+
+            while (active > 0)
+            {
+                for (InterleavedQuery& entry : p_group)
+                {
+                    if (!entry.m_active) continue;
+
+                    COMMON::QueryResultSet<T>& query = *entry.m_query;
+                    COMMON::WorkSpace& space = *entry.m_space;
+                    if (space.m_termination.m_active && m_termination.ShouldStop(space.m_termination, space.m_iNumberOfCheckedLeaves, entry.m_node.distance, query)) {
+                        space.m_terminationReason = TerminationReason::Adaptive;
+                        query.SortResult();
+                        entry.m_active = false;
+                        active--;
+                        continue;
+                    }
+                    space.m_iNumberOfHops++;
+                    if (space.DeadlinePassed()) {
+                        space.m_terminationReason = TerminationReason::Deadline;
+                        query.SortResult();
+                        entry.m_active = false;
+                        active--;
+                        continue;
+                    }
+                    const SizeType *node = m_pGraph[entry.m_node.node];
+                    if (!checkDeleted || !m_deletedID.Contains(entry.m_node.node)) {
+                        if (!query.AddPoint(entry.m_node.node, entry.m_node.distance) && space.m_iNumberOfCheckedLeaves > space.m_iMaxCheck) {
+                            space.m_terminationReason = TerminationReason::MaxCheck;
+                            query.SortResult();
+                            entry.m_active = false;
+                            active--;
+                            continue;
+                        }
+                    }
+
+                    int batchCount = 0;
+                    for (DimensionType i = 0; i < m_pGraph.m_iNeighborhoodSize; i++) {
+                        SizeType nn_index = node[i];
+                        if (nn_index < 0) break;
+                        if (space.CheckAndSet(nn_index)) continue;
+                        space.m_batchNodes[batchCount] = nn_index;
+                        space.m_batchVectors[batchCount] = (m_pSamples)[nn_index];
+                        COMMON::Utils::PrefetchRange(space.m_batchVectors[batchCount++], vectorSize);
+                    }
+                    entry.m_batchCount = batchCount;
+                }
+
+                for (InterleavedQuery& entry : p_group)
+                {
+                    if (!entry.m_active) continue;
+
+                    COMMON::QueryResultSet<T>& query = *entry.m_query;
+                    COMMON::WorkSpace& space = *entry.m_space;
+                    float upperBound = max(query.worstDist(), entry.m_node.distance);
+                    bool bLocalOpt = true;
+                    m_fComputeDistanceBatch(query.GetTarget(), (const T* const*)space.m_batchVectors.data(), entry.m_batchCount, GetFeatureDim(), space.m_batchDists.data());
+                    space.m_iNumberOfCheckedLeaves += entry.m_batchCount;
+                    space.m_iNumberOfDistanceEvaluations += entry.m_batchCount;
+                    for (int i = 0; i < entry.m_batchCount; i++) {
+                        float distance2leaf = space.m_batchDists[i];
+                        if (distance2leaf <= upperBound) bLocalOpt = false;
+                        space.m_NGQueue.insert(COMMON::HeapCell(space.m_batchNodes[i], distance2leaf));
+                    }
+                    if (bLocalOpt) space.m_iNumOfContinuousNoBetterPropagation++;
+                    else space.m_iNumOfContinuousNoBetterPropagation = 0;
+                    if (space.m_iNumOfContinuousNoBetterPropagation > m_iThresholdOfNumberOfContinuousNoBetterPropagation) {
+                        if (space.m_iNumberOfTreeCheckedLeaves <= space.m_iNumberOfCheckedLeaves / 10) {
+                            m_pTrees.SearchTrees(m_pSamples, m_fComputeDistance, query, space, m_iNumberOfOtherDynamicPivots + space.m_iNumberOfCheckedLeaves);
+                        } else if (entry.m_node.distance > query.worstDist()) {
+                            space.m_terminationReason = TerminationReason::NoBetterPropagation;
+                            query.SortResult();
+                            entry.m_active = false;
+                            active--;
+                            continue;
+                        }
+                    }
+                    popNode(entry);
+                    if (!entry.m_active) active--;
+                }
+            }
+        }
+
         template<typename T>
         ErrorCode
             Index<T>::SearchIndex(QueryResult &p_query, bool p_searchDeleted) const
+        {
+            return SearchQuery(p_query, p_searchDeleted, nullptr, true, nullptr);
+        }
+
+        template<typename T>
+        ErrorCode Index<T>::SearchIndexTrace(QueryResult &p_query, std::vector<COMMON::TerminationTracePoint>& p_trace) const
+        {
+            return SearchQuery(p_query, false, nullptr, true, &p_trace);
+        }
+
+        template<typename T>
+        ErrorCode Index<T>::SearchQuery(QueryResult &p_query, bool p_searchDeleted, const SearchFilter* p_filter, bool p_adaptive, std::vector<COMMON::TerminationTracePoint>* p_trace) const
         {
             if (!m_bReady) return ErrorCode::EmptyIndex;
 
+            auto start = std::chrono::steady_clock::now();
             auto workSpace = m_workSpacePool->Rent();
             workSpace->Reset(m_iMaxCheck);
+            workSpace->m_deadline = p_query.GetDeadline();
+            workSpace->m_termination.Reset(p_adaptive && m_termination.Enabled(), p_trace);
+            workSpace->m_filter = p_filter;
 
-            if (m_deletedID.Count() == 0 || p_searchDeleted)
+            if (p_filter != nullptr)
+                SearchIndexWithFilter(*((COMMON::QueryResultSet<T>*)&p_query), *workSpace, p_searchDeleted);
+            else if (m_deletedID.Count() == 0 || p_searchDeleted)
                 SearchIndexWithDeleted(*((COMMON::QueryResultSet<T>*)&p_query), *workSpace);
             else
                 SearchIndexWithoutDeleted(*((COMMON::QueryResultSet<T>*)&p_query), *workSpace);
 
-            m_workSpacePool->Return(workSpace);
+            if (p_trace != nullptr)
+                COMMON::TerminationPredictor::Finish(workSpace->m_termination, workSpace->m_iNumberOfCheckedLeaves, *((COMMON::QueryResultSet<T>*)&p_query));
+            SearchStats stats = workSpace->Stats();
+            m_workSpacePool->Return(std::move(workSpace));
+
+            SetResultMetadata(p_query);
+            stats.m_wallTimeMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+            p_query.SetStats(stats);
+            return ErrorCode::Success;
+        }
+
+        template<typename T>
+        ErrorCode Index<T>::SearchIndexRange(QueryResult &p_query, float p_radius, int p_maxResults, bool p_searchDeleted) const
+        {
+            if (!m_bReady) return ErrorCode::EmptyIndex;
+            if (p_maxResults <= 0) return ErrorCode::Fail;
+
+            // A k-NN search whose k doubles until its worst result falls outside the radius, so the ball is known to
+            // be complete. Seeding the slots with the radius instead would prune the traversal before it reaches
+            // members only connected through vectors outside the ball.
+            int capacity = min(p_maxResults, max(p_query.GetResultNum(), c_rangeSearchInitialResults));
+            std::unique_ptr<COMMON::QueryResultSet<T>> range;
+            SearchStats stats;
+            while (true)
+            {
+                range.reset(new COMMON::QueryResultSet<T>((const T*)p_query.GetTarget(), capacity));
+                range->SetDeadline(p_query.GetDeadline());
+                SearchQuery(*range, p_searchDeleted, nullptr, false, nullptr);
+                stats.Accumulate(range->GetStats());
+                const BasicResult* worst = range->GetResult(capacity - 1);
+                if (range->IsTruncated() || capacity == p_maxResults || worst->VID < 0 || worst->Dist > p_radius) break;
+                capacity = (int)min((std::int64_t)p_maxResults, (std::int64_t)capacity * 2);
+            }
+
+            int found = 0;
+            while (found < capacity && range->GetResult(found)->VID >= 0 && range->GetResult(found)->Dist <= p_radius) found++;
+            p_query.Init(p_query.GetTarget(), found, p_query.WithMeta());
+            for (int i = 0; i < found; i++) p_query.SetResult(i, range->GetResult(i)->VID, range->GetResult(i)->Dist);
+            SetResultMetadata(p_query);
+            p_query.SetStats(stats);
+            return ErrorCode::Success;
+        }
 
+        template<typename T>
+        ErrorCode Index<T>::SearchIndexFiltered(QueryResult &p_query, const SearchFilter& p_filter, bool p_searchDeleted) const
+        {
+            // The termination model is fitted on unfiltered searches, whose results fill up far sooner.
+            return SearchQuery(p_query, p_searchDeleted, &p_filter, false, nullptr);
+        }
+
+        // Best-first traversal kept alive between pages in a leased workspace. Popped candidates wait in m_ready
+        // until no queued candidate is closer, so every page comes out closest first.
+        template <typename T>
+        class Index<T>::SearchIterator : public ResultIterator
+        {
+        public:
+            SearchIterator(const Index<T>* p_index, const void* p_target, bool p_searchDeleted)
+                : m_index(p_index), m_pool(p_index->m_workSpacePool), m_searchDeleted(p_searchDeleted),
+                m_target((const T*)p_target, (const T*)p_target + p_index->m_pSamples.C()), m_query(m_target.data(), 1)
+            {
+                m_lease = m_pool->Lease(p_index->m_iIteratorTimeout);
+                m_lease->m_workSpace->Reset(p_index->m_iMaxCheck);
+            }
+
+            ~SearchIterator()
+            {
+                Close();
+            }
+
+            void Close()
+            {
+                m_pool->Release(*m_lease);
+            }
+
+            ErrorCode Next(QueryResult& p_results)
+            {
+                std::lock_guard<std::mutex> leaseLock(m_lease->m_lock);
+                if (m_lease->m_workSpace == nullptr) return ErrorCode::SearchExpired;
+                m_lease->m_lastUse = std::chrono::steady_clock::now();
+
+                COMMON::WorkSpace& space = *(m_lease->m_workSpace);
+                std::shared_lock<std::shared_timed_mutex> lock(*(m_index->m_pTrees.m_lock));
+                if (!m_started)
+                {
+                    m_index->m_pTrees.InitSearchTrees(m_index->m_pSamples, m_index->m_fComputeDistance, m_query, space);
+                    m_index->m_pTrees.SearchTrees(m_index->m_pSamples, m_index->m_fComputeDistance, m_query, space, m_index->m_iNumberOfInitialDynamicPivots);
+                    m_started = true;
+                }
+
+                // A page checks about MaxCheck vectors; past the visited set's limit the queue is only drained.
+                const int pageLimit = space.m_iNumberOfCheckedLeaves + m_index->m_iMaxCheck;
+                const SizeType visitLimit = space.VisitLimit();
+                space.ReserveBatch(m_index->m_pGraph.m_iNeighborhoodSize);
+                int found = 0;
+                while (found < p_results.GetResultNum())
+                {
+                    while (!space.m_NGQueue.empty() && (m_ready.empty() || space.m_NGQueue.Top().distance < m_ready.top().distance))
+                    {
+                        bool expand = space.m_iNumberOfCheckedLeaves < visitLimit;
+                        if (expand && !m_ready.empty() && space.m_iNumberOfCheckedLeaves >= pageLimit) break;
+
+                        COMMON::HeapCell gnode = space.m_NGQueue.pop();
+                        if (m_searchDeleted || !m_index->m_deletedID.Contains(gnode.node)) m_ready.push(gnode);
+                        if (!expand) continue;
+
+                        const SizeType* node = m_index->m_pGraph[gnode.node];
+                        int batchCount = 0;
+                        for (DimensionType i = 0; i < m_index->m_pGraph.m_iNeighborhoodSize; i++)
+                        {
+                            SizeType nn_index = node[i];
+                            if (nn_index < 0) break;
+                            if (space.CheckAndSet(nn_index)) continue;
+                            space.m_batchNodes[batchCount] = nn_index;
+                            space.m_batchVectors[batchCount++] = m_index->m_pSamples[nn_index];
+                        }
+                        m_index->m_fComputeDistanceBatch(m_target.data(), (const T* const*)space.m_batchVectors.data(), batchCount, m_index->GetFeatureDim(), space.m_batchDists.data());
+                        space.m_iNumberOfCheckedLeaves += batchCount;
+                        for (int i = 0; i < batchCount; i++) space.m_NGQueue.insert(COMMON::HeapCell(space.m_batchNodes[i], space.m_batchDists[i]));
+                        if (!space.m_SPTQueue.empty() && (space.m_NGQueue.empty() || space.m_NGQueue.Top().distance > space.m_SPTQueue.Top().distance))
+                            m_index->m_pTrees.SearchTrees(m_index->m_pSamples, m_index->m_fComputeDistance, m_query, space, m_index->m_iNumberOfOtherDynamicPivots + space.m_iNumberOfCheckedLeaves);
+                    }
+                    if (m_ready.empty()) break;
+                    p_results.SetResult(found++, m_ready.top().node, m_ready.top().distance);
+                    m_ready.pop();
+                }
+                for (int i = found; i < p_results.GetResultNum(); i++) p_results.SetResult(i, -1, MaxDist);
+                m_index->SetResultMetadata(p_results);
+                return ErrorCode::Success;
+            }
+
+        private:
+            const Index<T>* m_index;
+            std::shared_ptr<COMMON::WorkSpacePool> m_pool;
+            std::shared_ptr<COMMON::WorkSpaceLease> m_lease;
+            bool m_searchDeleted;
+            bool m_started = false;
+            std::vector<T> m_target;
+            COMMON::QueryResultSet<T> m_query;
+            std::priority_queue<COMMON::HeapCell, std::vector<COMMON::HeapCell>, std::greater<COMMON::HeapCell>> m_ready;
+        };
+
+        template<typename T>
+        ErrorCode Index<T>::BeginSearch(const void* p_target, std::shared_ptr<ResultIterator>& p_iterator, bool p_searchDeleted) const
+        {
+            if (!m_bReady) return ErrorCode::EmptyIndex;
+
+            p_iterator.reset(new SearchIterator(this, p_target, p_searchDeleted));
+            return ErrorCode::Success;
+        }
+
+        template<typename T>
+        ErrorCode Index<T>::SearchIndexBatch(QueryResult* p_queries, int p_count, bool p_searchDeleted) const
+        {
+            if (!m_bReady) return ErrorCode::EmptyIndex;
+            if (m_iSearchGroupSize <= 1) return VectorIndex::SearchIndexBatch(p_queries, p_count, p_searchDeleted);
+
+            std::vector<std::unique_ptr<COMMON::WorkSpace>> workSpaces;
+            std::vector<InterleavedQuery> group;
+            for (int start = 0; start < p_count; start += m_iSearchGroupSize)
+            {
+                int end = min(start + m_iSearchGroupSize, p_count);
+                workSpaces.clear();
+                group.clear();
+                for (int i = start; i < end; i++)
+                {
+                    workSpaces.push_back(m_workSpacePool->Rent());
+                    workSpaces.back()->Reset(m_iMaxCheck);
+                    workSpaces.back()->m_deadline = p_queries[i].GetDeadline();
+                    workSpaces.back()->m_termination.Reset(m_termination.Enabled());
+                    group.push_back({ (COMMON::QueryResultSet<T>*)(p_queries + i), workSpaces.back().get(), COMMON::HeapCell(), 0, false });
+                }
+
+                // the group's queries run in lockstep, so each is charged the whole group's time
+                auto groupStart = std::chrono::steady_clock::now();
+                SearchIndexInterleaved(group, p_searchDeleted);
+                float groupTimeMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - groupStart).count();
+
+                for (int i = start; i < end; i++)
+                {
+                    SearchStats stats = workSpaces[i - start]->Stats();
+                    stats.m_wallTimeMs = groupTimeMs;
+                    p_queries[i].SetStats(stats);
+                    m_workSpacePool->Return(std::move(workSpaces[i - start]));
+                    SetResultMetadata(p_queries[i]);
+                }
+            }
+            return ErrorCode::Success;
+        }
+
+        template<typename T>
+        void Index<T>::SetResultMetadata(QueryResult &p_query) const
+        {
             if (p_query.WithMeta() && nullptr != m_pMetadata)
             {
                 for (int i = 0; i < p_query.GetResultNum(); ++i)
@@ -166,7 +520,6 @@ namespace SPTAG
                     p_query.SetMetadata(i, (result < 0) ? ByteArray::c_empty : m_pMetadata->GetMetadataCopy(result));
                 }
             }
-            return ErrorCode::Success;
         }
 
         template <typename T>
@@ -180,7 +533,18 @@ namespace SPTAG
             else
                 SearchIndexWithoutDeleted(*((COMMON::QueryResultSet<T>*)&p_query), *workSpace);
 
-            m_workSpacePool->Return(workSpace);
+            m_workSpacePool->Return(std::move(workSpace));
+
+            if (DistCalcMethod::InnerProduct == m_iDistCalcMethod)
+            {
+                // graph refinement compares data points, so rescore in the norm-augmented space
+                BasicResult* results = p_query.GetResults();
+                for (int i = 0; i < p_query.GetResultNum(); i++)
+                {
+                    if (results[i].VID >= 0) results[i].Dist = ComputeDistance(p_query.GetTarget(), m_pSamples[results[i].VID]);
+                }
+                std::sort(results, results + p_query.GetResultNum(), COMMON::Compare);
+            }
             return ErrorCode::Success;
         }
 
@@ -200,7 +564,7 @@ namespace SPTAG
                 res[i].VID = cell.node;
                 res[i].Dist = cell.distance;
             }
-            m_workSpacePool->Return(workSpace);
+            m_workSpacePool->Return(std::move(workSpace));
             return ErrorCode::Success;
         }
 #pragma endregion
@@ -214,6 +578,7 @@ namespace SPTAG
 
             m_pSamples.Initialize(p_vectorNum, p_dimension, (T*)p_data, false);
             m_deletedID.Initialize(p_vectorNum);
+            SelectDistanceKernels();
 
             if (DistCalcMethod::Cosine == m_iDistCalcMethod)
             {
@@ -223,8 +588,9 @@ namespace SPTAG
                     COMMON::Utils::Normalize(m_pSamples[i], GetFeatureDim(), base);
                 }
             }
+            UpdateMaxNormSquare(0, GetNumSamples());
 
-            m_workSpacePool.reset(new COMMON::WorkSpacePool(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), GetNumSamples(), m_iHashTableExp));
+            m_workSpacePool.reset(new COMMON::WorkSpacePool(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), GetNumSamples(), m_iHashTableExp, m_bEpochVisitedSet));
             m_workSpacePool->Init(m_iNumberOfThreads);
             m_threadPool.init();
 
@@ -253,6 +619,11 @@ namespace SPTAG
 #include "inc/Core/KDT/ParameterDefinitionList.h"
 #undef DefineKDTParameter
 
+            ptr->m_fComputeDistance = m_fComputeDistance;
+            ptr->m_fComputeDistanceBatch = m_fComputeDistanceBatch;
+            ptr->m_iBaseSquare = m_iBaseSquare;
+            ptr->m_fMaxNormSquare = m_fMaxNormSquare;
+
             std::lock_guard<std::mutex> lock(m_dataAddLock);
             std::unique_lock<std::shared_timed_mutex> uniquelock(m_dataDeleteLock);
 
@@ -277,7 +648,7 @@ namespace SPTAG
             LOG(Helper::LogLevel::LL_Info, "Refine... from %d -> %d\n", GetNumSamples(), newR);
             if (newR == 0) return ErrorCode::EmptyIndex;
 
-            ptr->m_workSpacePool.reset(new COMMON::WorkSpacePool(m_workSpacePool->GetMaxCheck(), newR, m_iHashTableExp));
+            ptr->m_workSpacePool.reset(new COMMON::WorkSpacePool(m_workSpacePool->GetMaxCheck(), newR, m_iHashTableExp, m_bEpochVisitedSet));
             ptr->m_workSpacePool->Init(m_iNumberOfThreads);
             ptr->m_threadPool.init();
 
@@ -361,8 +732,9 @@ namespace SPTAG
                 SearchIndex(query);
 
                 for (int i = 0; i < m_pGraph.m_iCEF; i++) {
-                    if (query.GetResult(i)->Dist < 1e-6) {
-                        DeleteIndex(query.GetResult(i)->VID);
+                    const BasicResult* res = query.GetResult(i);
+                    if (res->VID >= 0 && ComputeDistance(query.GetTarget(), m_pSamples[res->VID]) < 1e-6) {
+                        DeleteIndex(res->VID);
                     }
                 }
             }
@@ -417,6 +789,7 @@ namespace SPTAG
                         COMMON::Utils::Normalize((T*)m_pSamples[i], GetFeatureDim(), base);
                     }
                 }
+                UpdateMaxNormSquare(begin, end);
 
                 if (m_pMetadata != nullptr) {
                     m_pMetadata->AddBatch(*p_metadataSet);
@@ -442,12 +815,25 @@ namespace SPTAG
             return ErrorCode::Success;
         }
 
+        template <typename T>
+        void Index<T>::UpdateMaxNormSquare(SizeType p_start, SizeType p_end)
+        {
+            if (DistCalcMethod::InnerProduct != m_iDistCalcMethod) return;
+
+            // p_start == 0 recomputes from scratch, otherwise the bound only grows with the new vectors
+            float maxNormSquare = (p_start == 0) ? 0 : m_fMaxNormSquare;
+            for (SizeType i = p_start; i < p_end; i++) {
+                maxNormSquare = max(maxNormSquare, -m_fComputeDistance(m_pSamples[i], m_pSamples[i], GetFeatureDim()));
+            }
+            m_fMaxNormSquare = maxNormSquare;
+        }
+
         template <typename T>
         ErrorCode
             Index<T>::UpdateIndex()
         {
             omp_set_num_threads(m_iNumberOfThreads);
-            m_workSpacePool.reset(new COMMON::WorkSpacePool(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), GetNumSamples(), m_iHashTableExp));
+            m_workSpacePool.reset(new COMMON::WorkSpacePool(max(m_iMaxCheck, m_pGraph.m_iMaxCheckForRefineGraph), GetNumSamples(), m_iHashTableExp, m_bEpochVisitedSet));
             m_workSpacePool->Init(m_iNumberOfThreads);
             return ErrorCode::Success;
         }
@@ -473,8 +859,14 @@ namespace SPTAG
 #undef DefineKDTParameter
 
             if (SPTAG::Helper::StrUtils::StrEqualIgnoreCase(p_param, "DistCalcMethod")) {
-                m_fComputeDistance = COMMON::DistanceCalcSelector<T>(m_iDistCalcMethod);
-                m_iBaseSquare = (m_iDistCalcMethod == DistCalcMethod::Cosine) ? COMMON::Utils::GetBase<T>() * COMMON::Utils::GetBase<T>() : 1;
+                SelectDistanceKernels();
+                UpdateMaxNormSquare(0, GetNumSamples());
+            }
+            else if (SPTAG::Helper::StrUtils::StrEqualIgnoreCase(p_param, "AdaptiveModel") || SPTAG::Helper::StrUtils::StrEqualIgnoreCase(p_param, "AdaptiveThreshold")) {
+                if (!m_termination.Load(m_sAdaptiveModel, m_fAdaptiveThreshold)) {
+                    LOG(Helper::LogLevel::LL_Error, "Invalid AdaptiveModel %s with AdaptiveThreshold %f!\n", m_sAdaptiveModel.c_str(), m_fAdaptiveThreshold);
+                    return ErrorCode::Fail;
+                }
             }
             return ErrorCode::Success;
         }
@@ -2,6 +2,7 @@
 // Licensed under the MIT License.
 
 #include "inc/Core/VectorIndex.h"
+#include "inc/Core/AttributeSet.h"
 #include "inc/Helper/CommonHelper.h"
 #include "inc/Helper/StringConvert.h"
 #include "inc/Helper/SimpleIniReader.h"
@@ -27,7 +28,7 @@ std::unique_ptr<Helper::Logger> SPTAG::g_pLogger(new Helper::SimpleLogger(Helper
 
 std::shared_ptr<Helper::DiskPriorityIO>(*SPTAG::f_createIO)() = []() -> std::shared_ptr<Helper::DiskPriorityIO> { return std::shared_ptr<Helper::DiskPriorityIO>(new Helper::SimpleFileIO()); };
 
-VectorIndex::VectorIndex()
+VectorIndex::VectorIndex() : m_pAttributes(new AttributeSet)
 {
 }
 
@@ -95,6 +96,7 @@ VectorIndex::LoadIndexConfig(Helper::IniReader& p_reader)
         m_sMetadataFile = p_reader.GetParameter(metadataSection, "MetaDataFilePath", std::string());
         m_sMetadataIndexFile = p_reader.GetParameter(metadataSection, "MetaDataIndexPath", std::string());
     }
+    m_sAttributesFile = p_reader.GetParameter("Attributes", "AttributesFilePath", m_sAttributesFile);
 
     if (DistCalcMethod::Undefined == p_reader.GetParameter("Index", "DistCalcMethod", DistCalcMethod::Undefined))
     {
@@ -219,6 +221,22 @@ VectorIndex::SaveIndex(const std::string& p_folderPath)
         auto configFile = SPTAG::f_createIO();
         if (configFile == nullptr || !configFile->Initialize((folderPath + "indexloader.ini").c_str(), std::ios::out)) return ErrorCode::FailedCreateFile;
         if ((ret = SaveIndexConfig(configFile)) != ErrorCode::Success) return ret;
+
+        // Only folders keep the attributes, so the section is left out of the shared config. Refining renumbers
+        // the vectors, which would leave them on the wrong ones.
+        if (!m_pAttributes->Empty() && NeedRefine())
+        {
+            LOG(Helper::LogLevel::LL_Warning, "Attributes are not saved with an index refined on save.\n");
+        }
+        else if (!m_pAttributes->Empty())
+        {
+            IOSTRING(configFile, WriteString, "\n[Attributes]\n");
+            IOSTRING(configFile, WriteString, ("AttributesFilePath=" + m_sAttributesFile + "\n").c_str());
+
+            auto attributesFile = SPTAG::f_createIO();
+            if (attributesFile == nullptr || !attributesFile->Initialize((folderPath + m_sAttributesFile).c_str(), std::ios::binary | std::ios::out)) return ErrorCode::FailedCreateFile;
+            if ((ret = m_pAttributes->Save(attributesFile)) != ErrorCode::Success) return ret;
+        }
     }
 
     std::shared_ptr<std::vector<std::string>> indexfiles = GetIndexFiles();
@@ -309,15 +327,75 @@ VectorIndex::BuildIndex(std::shared_ptr<VectorSet> p_vectorSet,
 ErrorCode
 VectorIndex::SearchIndex(const void* p_vector, int p_vectorCount, int p_neighborCount, bool p_withMeta, BasicResult* p_results) const {
     size_t vectorSize = GetValueTypeSize(GetVectorValueType()) * GetFeatureDim();
-#pragma omp parallel for schedule(dynamic,10)
-    for (int i = 0; i < p_vectorCount; i++) {
-        QueryResult res((char*)p_vector + i * vectorSize, p_neighborCount, p_withMeta, p_results + i * p_neighborCount);
-        SearchIndex(res);
+    // every thread takes a few queries at a time, so SearchIndexBatch has a group to interleave
+    int queriesPerTask = max(1, min(16, (p_vectorCount + omp_get_max_threads() - 1) / omp_get_max_threads()));
+#pragma omp parallel for schedule(dynamic,1)
+    for (int start = 0; start < p_vectorCount; start += queriesPerTask) {
+        int end = min(start + queriesPerTask, p_vectorCount);
+        std::vector<QueryResult> queries;
+        queries.reserve(end - start);
+        for (int i = start; i < end; i++) {
+            queries.emplace_back((char*)p_vector + i * vectorSize, p_neighborCount, p_withMeta, p_results + ((size_t)i) * p_neighborCount);
+        }
+        SearchIndexBatch(queries.data(), end - start);
     }
     return ErrorCode::Success;
 }
 
 
+ErrorCode
+VectorIndex::SearchIndexBatch(QueryResult* p_queries, int p_count, bool p_searchDeleted) const {
+    for (int i = 0; i < p_count; i++) {
+        ErrorCode ret = SearchIndex(p_queries[i], p_searchDeleted);
+        if (ret != ErrorCode::Success) return ret;
+    }
+    return ErrorCode::Success;
+}
+
+
+ErrorCode
+VectorIndex::SearchIndexTrace(QueryResult& p_query, std::vector<COMMON::TerminationTracePoint>& p_trace) const {
+    return ErrorCode::Undefined;
+}
+
+
+ErrorCode
+VectorIndex::SearchIndexRange(QueryResult& p_query, float p_radius, int p_maxResults, bool p_searchDeleted) const {
+    return ErrorCode::Undefined;
+}
+
+
+ErrorCode
+VectorIndex::SearchIndexFiltered(QueryResult& p_query, const SearchFilter& p_filter, bool p_searchDeleted) const {
+    return ErrorCode::Undefined;
+}
+
+
+ErrorCode
+VectorIndex::BeginSearch(const void* p_target, std::shared_ptr<ResultIterator>& p_iterator, bool p_searchDeleted) const {
+    return ErrorCode::Undefined;
+}
+
+
+ErrorCode
+VectorIndex::SetAttribute(SizeType p_vectorID, const std::string& p_column, const std::string& p_value) {
+    if (p_vectorID < 0 || p_vectorID >= GetNumSamples()) return ErrorCode::VectorNotFound;
+    return m_pAttributes->SetAttribute(p_column, p_vectorID, p_value);
+}
+
+
+std::string
+VectorIndex::GetAttribute(SizeType p_vectorID, const std::string& p_column) const {
+    return m_pAttributes->GetAttribute(p_column, p_vectorID);
+}
+
+
+ErrorCode
+VectorIndex::AddAttributeFilter(SearchFilter& p_filter, const std::string& p_column, const std::vector<std::string>& p_values) const {
+    return m_pAttributes->AddFilter(p_filter, p_column, p_values);
+}
+
+
 ErrorCode 
 VectorIndex::AddIndex(std::shared_ptr<VectorSet> p_vectorSet, std::shared_ptr<MetadataSet> p_metadataSet, bool p_withMetaIndex) {
     if (nullptr == p_vectorSet || p_vectorSet->GetValueType() != GetVectorValueType())
@@ -486,6 +564,17 @@ VectorIndex::LoadIndex(const std::string& p_loaderFilePath, std::shared_ptr<Vect
             p_vectorIndex->BuildMetaMapping();
         }
     }
+
+    if (iniReader.DoesSectionExist("Attributes"))
+    {
+        auto attributesFile = SPTAG::f_createIO();
+        if (attributesFile == nullptr || !attributesFile->Initialize((folderPath + p_vectorIndex->m_sAttributesFile).c_str(), std::ios::binary | std::ios::in)) return ErrorCode::FailedOpenFile;
+        if ((ret = p_vectorIndex->m_pAttributes->Load(attributesFile)) != ErrorCode::Success)
+        {
+            LOG(Helper::LogLevel::LL_Error, "Error: Failed to load attributes.\n");
+            return ret;
+        }
+    }
     p_vectorIndex->m_bReady = true;
     return ErrorCode::Success;
 }
@@ -5,6 +5,7 @@
 #include "inc/Helper/SimpleIniReader.h"
 #include "inc/Helper/CommonHelper.h"
 #include "inc/Core/Common/CommonUtils.h"
+#include "inc/Core/Common/TerminationPredictor.h"
 #include "inc/Core/VectorIndex.h"
 #include <omp.h>
 #include <algorithm>
@@ -26,6 +27,8 @@ public:
         AddOptionalOption(m_withMeta, "-a", "--withmeta", "Output metadata instead of vector id.");
         AddOptionalOption(m_K, "-k", "--KNN", "K nearest neighbors for search.");
         AddOptionalOption(m_batch, "-b", "--batchsize", "Batch query size.");
+        AddOptionalOption(m_searchGroup, "-g", "--searchgroup", "Queries each thread searches together through SearchIndexBatch.");
+        AddOptionalOption(m_calibrate, "-c", "--calibrate", "Target recall to fit AdaptiveModel for on the first batch and truth, 0 to disable.");
     }
 
     ~SearcherOptions() {}
@@ -45,6 +48,10 @@ public:
     int m_K = 32;
 
     int m_batch = 10000;
+
+    int m_searchGroup = 1;
+
+    float m_calibrate = 0;
 };
 
 template <typename T>
@@ -96,6 +103,62 @@ void LoadTruth(std::ifstream& fp, std::vector<std::set<SizeType>>& truth, SizeTy
     }
 }
 
+// Traces the batch searched to the last MaxCheck, fits the termination model to reach the target recall and applies it.
+bool CalibrateTermination(std::shared_ptr<SearcherOptions> options, VectorIndex& index, const std::string& maxCheck,
+    std::vector<QueryResult>& results, const std::vector<std::set<SizeType>>& truth, SizeType NumQuerys)
+{
+    index.SetParameter("AdaptiveModel", "");
+    index.SetParameter("MaxCheck", maxCheck.c_str());
+
+    std::vector<std::vector<COMMON::TerminationTracePoint>> traces(NumQuerys);
+    bool traced = true;
+#pragma omp parallel for schedule(dynamic)
+    for (SizeType i = 0; i < NumQuerys; i++)
+    {
+        results[i].Reset();
+        if (ErrorCode::Success != index.SearchIndexTrace(results[i], traces[i]))
+        {
+            traced = false;
+            continue;
+        }
+        for (auto& point : traces[i])
+        {
+            int hits = 0;
+            for (SizeType vid : point.m_results) hits += (int)truth[i].count(vid);
+            point.m_recall = (float)hits / options->m_K;
+        }
+    }
+    if (!traced)
+    {
+        LOG(Helper::LogLevel::LL_Error, "ERROR: %s index does not support adaptive termination!\n", Helper::Convert::ConvertToString(index.GetIndexAlgoType()).c_str());
+        return false;
+    }
+
+    float fullRecall = 0, fullChecked = 0;
+    for (const auto& trace : traces)
+    {
+        if (trace.empty()) continue;
+        fullRecall += trace.back().m_recall;
+        fullChecked += trace.back().m_checked;
+    }
+
+    std::string model;
+    float threshold = 0, recall = 0, checked = 0;
+    if (!COMMON::TerminationPredictor::Calibrate(traces, options->m_calibrate, model, threshold, recall, checked))
+    {
+        LOG(Helper::LogLevel::LL_Error, "ERROR: Cannot reach recall %.4f before MaxCheck %s (full search recall %.4f)!\n", options->m_calibrate, maxCheck.c_str(), fullRecall / NumQuerys);
+        return false;
+    }
+
+    std::string thresholdValue = Helper::Convert::ConvertToString(threshold);
+    LOG(Helper::LogLevel::LL_Info, "Calibrated Index.AdaptiveModel=%s Index.AdaptiveThreshold=%s\n", model.c_str(), thresholdValue.c_str());
+    LOG(Helper::LogLevel::LL_Info, "Expected recall %.4f checking %.0f vectors per query, full search recall %.4f checking %.0f\n",
+        recall, checked, fullRecall / NumQuerys, fullChecked / NumQuerys);
+    index.SetParameter("AdaptiveModel", model.c_str());
+    index.SetParameter("AdaptiveThreshold", thresholdValue.c_str());
+    return true;
+}
+
 template <typename T>
 int Process(std::shared_ptr<SearcherOptions> options, VectorIndex& index)
 {
@@ -125,6 +188,12 @@ int Process(std::shared_ptr<SearcherOptions> options, VectorIndex& index)
         }
     }
 
+    if (options->m_calibrate > 0 && !ftruth.is_open())
+    {
+        LOG(Helper::LogLevel::LL_Error, "ERROR: Calibration needs a truth file!\n");
+        exit(1);
+    }
+
     std::ofstream fp;
     if (options->m_resultFile != "")
     {
@@ -139,8 +208,9 @@ int Process(std::shared_ptr<SearcherOptions> options, VectorIndex& index)
 
     std::vector<std::set<SizeType>> truth(options->m_batch);
     std::vector<QueryResult> results(options->m_batch, QueryResult(NULL, options->m_K, options->m_withMeta != 0));
-    std::vector<clock_t> latencies(options->m_batch + 1, 0);
+    std::vector<clock_t> latencies(options->m_batch, 0);
     int baseSquare = SPTAG::COMMON::Utils::GetBase<T>() * SPTAG::COMMON::Utils::GetBase<T>();
+    SizeType searchGroup = max(options->m_searchGroup, 1);
 
     LOG(Helper::LogLevel::LL_Info, "[query]\t\t[maxcheck]\t[avg] \t[99%] \t[95%] \t[recall] \t[mem]\n");
     std::vector<float> totalAvg(maxCheck.size(), 0.0), total99(maxCheck.size(), 0.0), total95(maxCheck.size(), 0.0), totalRecall(maxCheck.size(), 0.0);
@@ -149,6 +219,7 @@ int Process(std::shared_ptr<SearcherOptions> options, VectorIndex& index)
         int numQuerys = min(options->m_batch, queryVectors->Count() - startQuery);
         for (SizeType i = 0; i < numQuerys; i++) results[i].SetTarget(queryVectors->GetVector(startQuery + i));
         if (ftruth.is_open()) LoadTruth(ftruth, truth, numQuerys, options->m_K);
+        if (startQuery == 0 && options->m_calibrate > 0 && !CalibrateTermination(options, index, maxCheck.back(), results, truth, numQuerys)) exit(1);
 
         SizeType subSize = (numQuerys - 1) / omp_get_num_threads() + 1;
         for (int mc = 0; mc < maxCheck.size(); mc++)
@@ -161,21 +232,23 @@ int Process(std::shared_ptr<SearcherOptions> options, VectorIndex& index)
             {
                 SizeType start = tid * subSize;
                 SizeType end = min((tid + 1) * subSize, numQuerys);
-                for (SizeType i = start; i < end; i++)
+                for (SizeType i = start; i < end; i += searchGroup)
                 {
-                    latencies[i] = clock();
-                    index.SearchIndex(results[i]);
+                    // queries searched together all wait for the whole group
+                    SizeType groupEnd = min(i + searchGroup, end);
+                    clock_t groupStart = clock();
+                    if (searchGroup == 1)
+                        index.SearchIndex(results[i]);
+                    else
+                        index.SearchIndexBatch(results.data() + i, groupEnd - i);
+                    clock_t groupTime = clock() - groupStart;
+                    for (SizeType j = i; j < groupEnd; j++) latencies[j] = groupTime;
                 }
             }
-            latencies[numQuerys] = clock();
 
             float timeMean = 0, timeMin = MaxDist, timeMax = 0, timeStd = 0;
             for (SizeType i = 0; i < numQuerys; i++)
             {
-                if (latencies[i + 1] >= latencies[i])
-                    latencies[i] = latencies[i + 1] - latencies[i];
-                else
-                    latencies[i] = latencies[numQuerys] - latencies[i];
                 timeMean += latencies[i];
                 if (latencies[i] > timeMax) timeMax = (float)latencies[i];
                 if (latencies[i] < timeMin) timeMin = (float)latencies[i];
@@ -13,7 +13,9 @@ SearchExecutionContext::SearchExecutionContext(const std::shared_ptr<const Servi
       m_vectorDimension(0),
       m_inputValueType(VectorValueType::Undefined),
       m_extractMetadata(false),
-      m_resultNum(p_serviceSettings->m_defaultMaxResultNumber)
+      m_resultNum(p_serviceSettings->m_defaultMaxResultNumber),
+      m_rangeSearch(false),
+      m_radius(0)
 {
 }
 
@@ -71,6 +73,10 @@ SearchExecutionContext::ExtractOption()
         {
             Helper::Convert::ConvertStringTo<SizeType>(optionPair.second, m_resultNum);
         }
+        else if (Helper::StrUtils::StrEqualIgnoreCase(optionPair.first, "radius"))
+        {
+            m_rangeSearch = Helper::Convert::ConvertStringTo<float>(optionPair.second, m_radius);
+        }
     }
 
     return ErrorCode::Success;
@@ -185,3 +191,17 @@ SearchExecutionContext::GetExtractMetadata() const
 {
     return m_extractMetadata;
 }
+
+
+const bool
+SearchExecutionContext::IsRangeSearch() const
+{
+    return m_rangeSearch;
+}
+
+
+const float
+SearchExecutionContext::GetRadius() const
+{
+    return m_radius;
+}
@@ -9,10 +9,12 @@ using namespace SPTAG::Service;
 
 SearchExecutor::SearchExecutor(std::string p_queryString,
                                std::shared_ptr<ServiceContext> p_serviceContext,
-                               const CallBack& p_callback)
+                               const CallBack& p_callback,
+                               std::chrono::steady_clock::time_point p_deadline)
     : m_callback(p_callback),
       c_serviceContext(std::move(p_serviceContext)),
-      m_queryString(std::move(p_queryString))
+      m_queryString(std::move(p_queryString)),
+      m_deadline(p_deadline)
 {
 }
 
@@ -63,6 +65,7 @@ SearchExecutor::ExecuteInternal()
     QueryResult query(m_executionContext->GetVector().Data(),
                       m_executionContext->GetResultNum(),
                       m_executionContext->GetExtractMetadata());
+    query.SetDeadline(m_deadline);
 
     for (const auto& vectorIndex : m_selectedIndex)
     {
@@ -73,7 +76,10 @@ SearchExecutor::ExecuteInternal()
         }
 
         query.Reset();
-        if (ErrorCode::Success == vectorIndex->SearchIndex(query))
+        ErrorCode ret = m_executionContext->IsRangeSearch()
+            ? vectorIndex->SearchIndexRange(query, m_executionContext->GetRadius(), m_executionContext->GetResultNum())
+            : vectorIndex->SearchIndex(query);
+        if (ErrorCode::Success == ret)
         {
             m_executionContext->AddResults(vectorIndex->GetIndexName(), query);
         }
@@ -6,6 +6,7 @@
 #include "inc/Socket/RemoteSearchQuery.h"
 #include "inc/Helper/CommonHelper.h"
 #include "inc/Helper/ArgumentsParser.h"
+#include "inc/Helper/StringConvert.h"
 
 #include <iostream>
 
@@ -193,6 +194,14 @@ SearchService::RunInteractiveMode()
                     std::cout << std::endl;
                     ++idx;
                 }
+
+                const auto& stats = result.m_results.GetStats();
+                std::cout << "------------------" << std::endl;
+                std::cout << "DistanceEvaluations: " << stats.m_distanceEvaluations
+                          << " GraphHops: " << stats.m_graphHops
+                          << " TreeNodesVisited: " << stats.m_treeNodesVisited
+                          << " Termination: " << Helper::Convert::ConvertToString(stats.m_termination)
+                          << " WallTime(ms): " << stats.m_wallTimeMs << std::endl;
             }
         };
 
@@ -218,6 +227,12 @@ SearchService::SearchHanlder(Socket::ConnectionID p_localConnectionID, Socket::P
     Socket::RemoteQuery remoteQuery;
     remoteQuery.Read(p_packet.Body());
 
+    auto deadline = (std::chrono::steady_clock::time_point::max)();
+    if (remoteQuery.m_deadlineMilliseconds > 0)
+    {
+        deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(remoteQuery.m_deadlineMilliseconds);
+    }
+
     auto callback = std::bind(&SearchService::SearchHanlderCallback,
                               this,
                               std::placeholders::_1,
@@ -225,7 +240,8 @@ SearchService::SearchHanlder(Socket::ConnectionID p_localConnectionID, Socket::P
 
     SearchExecutor executor(std::move(remoteQuery.m_queryString),
                             m_serviceContext,
-                            callback);
+                            callback,
+                            deadline);
     executor.Execute();
 }
 
@@ -9,7 +9,8 @@ using namespace SPTAG::Socket;
 
 
 RemoteQuery::RemoteQuery()
-    : m_type(QueryType::String)
+    : m_type(QueryType::String),
+      m_deadlineMilliseconds(0)
 {
 }
 
@@ -22,6 +23,7 @@ RemoteQuery::EstimateBufferSize() const
     sum += SimpleSerialization::EstimateBufferSize(MirrorVersion());
     sum += SimpleSerialization::EstimateBufferSize(m_type);
     sum += SimpleSerialization::EstimateBufferSize(m_queryString);
+    sum += SimpleSerialization::EstimateBufferSize(m_deadlineMilliseconds);
 
     return sum;
 }
@@ -35,6 +37,7 @@ RemoteQuery::Write(std::uint8_t* p_buffer) const
 
     p_buffer = SimpleSerialization::SimpleWriteBuffer(m_type, p_buffer);
     p_buffer = SimpleSerialization::SimpleWriteBuffer(m_queryString, p_buffer);
+    p_buffer = SimpleSerialization::SimpleWriteBuffer(m_deadlineMilliseconds, p_buffer);
 
     return p_buffer;
 }
@@ -56,6 +59,12 @@ RemoteQuery::Read(const std::uint8_t* p_buffer)
     p_buffer = SimpleSerialization::SimpleReadBuffer(p_buffer, m_type);
     p_buffer = SimpleSerialization::SimpleReadBuffer(p_buffer, m_queryString);
 
+    m_deadlineMilliseconds = 0;
+    if (mirrorVer >= 1)
+    {
+        p_buffer = SimpleSerialization::SimpleReadBuffer(p_buffer, m_deadlineMilliseconds);
+    }
+
     return p_buffer;
 }
 
@@ -121,6 +130,16 @@ RemoteSearchResult::EstimateBufferSize() const
         }
     }
 
+    for (const auto& indexRes : m_allIndexResults)
+    {
+        const SearchStats& stats = indexRes.m_results.GetStats();
+        sum += SimpleSerialization::EstimateBufferSize(stats.m_distanceEvaluations);
+        sum += SimpleSerialization::EstimateBufferSize(stats.m_graphHops);
+        sum += SimpleSerialization::EstimateBufferSize(stats.m_treeNodesVisited);
+        sum += SimpleSerialization::EstimateBufferSize(stats.m_termination);
+        sum += SimpleSerialization::EstimateBufferSize(stats.m_wallTimeMs);
+    }
+
     return sum;
 }
 
@@ -155,6 +174,17 @@ RemoteSearchResult::Write(std::uint8_t* p_buffer) const
         }
     }
 
+    // after all the results, so readers of mirror version 0 stop before the stats
+    for (const auto& indexRes : m_allIndexResults)
+    {
+        const SearchStats& stats = indexRes.m_results.GetStats();
+        p_buffer = SimpleSerialization::SimpleWriteBuffer(stats.m_distanceEvaluations, p_buffer);
+        p_buffer = SimpleSerialization::SimpleWriteBuffer(stats.m_graphHops, p_buffer);
+        p_buffer = SimpleSerialization::SimpleWriteBuffer(stats.m_treeNodesVisited, p_buffer);
+        p_buffer = SimpleSerialization::SimpleWriteBuffer(stats.m_termination, p_buffer);
+        p_buffer = SimpleSerialization::SimpleWriteBuffer(stats.m_wallTimeMs, p_buffer);
+    }
+
     return p_buffer;
 }
 
@@ -206,5 +236,19 @@ RemoteSearchResult::Read(const std::uint8_t* p_buffer)
         }
     }
 
+    if (mirrorVer >= 1)
+    {
+        for (auto& indexRes : m_allIndexResults)
+        {
+            SearchStats stats;
+            p_buffer = SimpleSerialization::SimpleReadBuffer(p_buffer, stats.m_distanceEvaluations);
+            p_buffer = SimpleSerialization::SimpleReadBuffer(p_buffer, stats.m_graphHops);
+            p_buffer = SimpleSerialization::SimpleReadBuffer(p_buffer, stats.m_treeNodesVisited);
+            p_buffer = SimpleSerialization::SimpleReadBuffer(p_buffer, stats.m_termination);
+            p_buffer = SimpleSerialization::SimpleReadBuffer(p_buffer, stats.m_wallTimeMs);
+            indexRes.m_results.SetStats(stats);
+        }
+    }
+
     return p_buffer;
 }
@@ -0,0 +1,64 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _SPTAG_TEST_BENCHMARK_H_
+#define _SPTAG_TEST_BENCHMARK_H_
+
+#include "inc/Core/Common.h"
+#include "inc/Helper/CommonHelper.h"
+#include "inc/Helper/StringConvert.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace SPTAG
+{
+namespace Benchmark
+{
+
+// Suites, each parses its own options from the arguments after the suite name.
+int RunDistanceBenchmark(int p_argc, char** p_args);
+int RunHeapBenchmark(int p_argc, char** p_args);
+int RunSearchBenchmark(int p_argc, char** p_args);
+
+// Parses a comma separated list, logging the first item that does not convert.
+template<typename T>
+bool ParseList(const std::string& p_str, std::vector<T>& p_values)
+{
+    for (const std::string& item : Helper::StrUtils::SplitString(p_str, ","))
+    {
+        T value;
+        if (!Helper::Convert::ConvertStringTo<T>(item.c_str(), value))
+        {
+            LOG(Helper::LogLevel::LL_Error, "Cannot parse %s!\n", item.c_str());
+            return false;
+        }
+        p_values.push_back(value);
+    }
+    return true;
+}
+
+// Runs p_round once to warm up, then repeatedly until p_minSeconds have passed.
+// p_round returns the number of operations it did; returns nanoseconds per operation.
+template<typename Func>
+double MeasureNanoseconds(Func p_round, double p_minSeconds)
+{
+    p_round();
+
+    std::uint64_t ops = 0;
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0;
+    do
+    {
+        ops += p_round();
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (elapsed < p_minSeconds);
+    return elapsed * 1e9 / ops;
+}
+
+} // namespace Benchmark
+} // namespace SPTAG
+
+#endif // _SPTAG_TEST_BENCHMARK_H_
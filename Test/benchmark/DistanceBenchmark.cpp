@@ -0,0 +1,291 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "benchmark/Benchmark.h"
+#include "inc/Core/Common.h"
+#include "inc/Core/Common/Dataset.h"
+#include "inc/Core/Common/DistanceUtils.h"
+#include "inc/Helper/ArgumentsParser.h"
+#include "inc/Helper/CommonHelper.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+using namespace SPTAG;
+using SPTAG::COMMON::InstructionSet;
+
+namespace
+{
+    class DistanceBenchmarkOptions : public Helper::ArgumentsParser
+    {
+    public:
+        DistanceBenchmarkOptions()
+        {
+            AddOptionalOption(m_valueTypes, "-v", "--valuetypes", "Comma separated value types, all if empty.");
+            AddOptionalOption(m_methods, "-m", "--methods", "Comma separated distance methods, all if empty.");
+            AddOptionalOption(m_levels, "-i", "--instructionsets", "Comma separated instruction set levels, all supported if empty.");
+            AddOptionalOption(m_dimensions, "-d", "--dimensions", "Comma separated dimensions.");
+            AddOptionalOption(m_cacheKB, "-c", "--cachekb", "Cache resident working set in KB.");
+            AddOptionalOption(m_dramMB, "-r", "--drammb", "DRAM resident working set in MB, 0 to skip.");
+            AddOptionalOption(m_seconds, "-t", "--seconds", "Minimum seconds to time each kernel.");
+            AddOptionalSwitch(m_help, "-h", "--help", "Print the options.", true);
+        }
+
+        std::string m_valueTypes;
+        std::string m_methods;
+        std::string m_levels;
+        std::string m_dimensions = "64,96,100,128,256,384,512,768,1024";
+        int m_cacheKB = 16;
+        int m_dramMB = 512;
+        float m_seconds = 0.1f;
+        bool m_help = false;
+    };
+
+    const char* c_levelNames[] = { "NONE", "SSE", "SSE2", "AVX", "AVX2", "AVX512", "AVX512VNNI", "AVX512BF16" };
+
+    // True when the CPU has p_level, so capping the selectors at it picks a path of its own.
+    bool LevelSupported(InstructionSet::Level p_level)
+    {
+        InstructionSet::SetMaxLevel(p_level);
+        switch (p_level)
+        {
+        case InstructionSet::Level::NONE: return true;
+        case InstructionSet::Level::SSE: return InstructionSet::SSE();
+        case InstructionSet::Level::SSE2: return InstructionSet::SSE2();
+        case InstructionSet::Level::AVX: return InstructionSet::AVX();
+        case InstructionSet::Level::AVX2: return InstructionSet::AVX2();
+        case InstructionSet::Level::AVX512: return InstructionSet::AVX512();
+        case InstructionSet::Level::AVX512VNNI: return InstructionSet::AVX512VNNI();
+        case InstructionSet::Level::AVX512BF16: return InstructionSet::AVX512BF16();
+        }
+        return false;
+    }
+
+    template<typename T>
+    std::pair<float, float> ValueRange() { return std::make_pair(-1.0f, 1.0f); }
+
+    template<>
+    std::pair<float, float> ValueRange<std::int8_t>() { return std::make_pair(-127.0f, 127.0f); }
+
+    template<>
+    std::pair<float, float> ValueRange<std::uint8_t>() { return std::make_pair(0.0f, 255.0f); }
+
+    template<>
+    std::pair<float, float> ValueRange<std::int16_t>() { return std::make_pair(-1024.0f, 1024.0f); }
+
+    template<>
+    std::pair<float, float> ValueRange<PackedBits>() { return std::make_pair(0.0f, 255.0f); }
+
+    // Aligned buffer of p_bytes, but at least one vector of p_dimension, filled with random values.
+    // Only the first block is random and the rest repeats it, which keeps setup fast while the
+    // working set still spans p_bytes.
+    template<typename T>
+    class VectorBuffer
+    {
+    public:
+        VectorBuffer(std::size_t p_bytes, DimensionType p_dimension, std::mt19937& p_rng)
+            : m_count(std::max<std::size_t>(p_bytes / sizeof(T), p_dimension))
+        {
+            m_data = (T*)aligned_malloc(m_count * sizeof(T), ALIGN);
+            std::size_t seedCount = std::min(m_count, c_seedCount);
+            auto range = ValueRange<T>();
+            std::uniform_real_distribution<float> dist(range.first, range.second);
+            for (std::size_t i = 0; i < seedCount; i++) m_data[i] = T(dist(p_rng));
+            for (std::size_t i = seedCount; i < m_count; i += seedCount)
+                std::memcpy(m_data + i, m_data, std::min(seedCount, m_count - i) * sizeof(T));
+        }
+
+        ~VectorBuffer() { aligned_free(m_data); }
+
+        std::size_t Count(DimensionType p_dimension) const { return m_count / p_dimension; }
+        const T* At(std::size_t p_index, DimensionType p_dimension) const { return m_data + p_index * p_dimension; }
+
+    private:
+        static const std::size_t c_seedCount = 1 << 16;
+
+        std::size_t m_count;
+        T* m_data;
+    };
+
+    struct KernelTiming
+    {
+        double m_singleNs;
+        double m_batchNs;
+    };
+
+    // Times both kernels over p_candidates. The batch kernel gets neighborhood sized groups,
+    // as the graph expansion passes them.
+    template<typename T>
+    KernelTiming TimeKernels(float(*p_single)(const T*, const T*, DimensionType),
+        void(*p_batch)(const T*, const T* const*, int, DimensionType, float*),
+        const T* p_query, const std::vector<const T*>& p_candidates, DimensionType p_dimension, double p_seconds)
+    {
+        const int groupSize = 32;
+        std::vector<float> out(groupSize);
+        volatile float sink = 0;
+
+        KernelTiming timing;
+        timing.m_singleNs = Benchmark::MeasureNanoseconds([&]() {
+            float sum = 0;
+            for (const T* candidate : p_candidates) sum += p_single(p_query, candidate, p_dimension);
+            sink = sum;
+            return (std::uint64_t)p_candidates.size();
+        }, p_seconds);
+
+        timing.m_batchNs = Benchmark::MeasureNanoseconds([&]() {
+            float sum = 0;
+            std::size_t count = p_candidates.size();
+            for (std::size_t i = 0; i < count; i += groupSize)
+            {
+                int n = (int)std::min<std::size_t>(groupSize, count - i);
+                p_batch(p_query, p_candidates.data() + i, n, p_dimension, out.data());
+                sum += out[0];
+            }
+            sink = sum;
+            return (std::uint64_t)count;
+        }, p_seconds);
+        (void)sink;
+        return timing;
+    }
+
+    // Candidates cycle through the cache set in order, and visit the DRAM set in a random
+    // permutation so the prefetcher cannot hide the misses, as in a graph walk.
+    template<typename T>
+    std::vector<const T*> Candidates(const VectorBuffer<T>& p_buffer, DimensionType p_dimension, bool p_shuffle, std::mt19937& p_rng)
+    {
+        std::size_t count = p_buffer.Count(p_dimension);
+        std::vector<const T*> candidates(count);
+        for (std::size_t i = 0; i < count; i++) candidates[i] = p_buffer.At(i, p_dimension);
+        if (p_shuffle) std::shuffle(candidates.begin(), candidates.end(), p_rng);
+        return candidates;
+    }
+
+    template<typename T>
+    void RunValueType(VectorValueType p_valueType, const DistanceBenchmarkOptions& p_options,
+        const std::vector<DistCalcMethod>& p_methods, const std::vector<InstructionSet::Level>& p_levels,
+        const std::vector<DimensionType>& p_dimensions)
+    {
+        std::mt19937 rng(7);
+        DimensionType maxDimension = *std::max_element(p_dimensions.begin(), p_dimensions.end());
+        VectorBuffer<T> cacheSet((std::size_t)p_options.m_cacheKB << 10, maxDimension, rng);
+        std::unique_ptr<VectorBuffer<T>> dramSet;
+        if (p_options.m_dramMB > 0) dramSet.reset(new VectorBuffer<T>((std::size_t)p_options.m_dramMB << 20, maxDimension, rng));
+
+        for (DimensionType dimension : p_dimensions)
+        {
+            std::vector<T> query(dimension);
+            auto range = ValueRange<T>();
+            std::uniform_real_distribution<float> dist(range.first, range.second);
+            for (T& value : query) value = T(dist(rng));
+
+            std::vector<std::pair<const char*, std::vector<const T*>>> sets;
+            sets.emplace_back("cache", Candidates(cacheSet, dimension, false, rng));
+            if (dramSet) sets.emplace_back("dram", Candidates(*dramSet, dimension, true, rng));
+
+            for (DistCalcMethod method : p_methods)
+            {
+                // Levels the CPU maps to the same kernels as a lower level are reported once.
+                std::set<std::pair<void*, void*>> seen;
+                for (InstructionSet::Level level : p_levels)
+                {
+                    InstructionSet::SetMaxLevel(level);
+                    auto single = COMMON::DistanceCalcSelector<T>(method, dimension);
+                    auto batch = COMMON::DistanceBatchCalcSelector<T>(method, dimension);
+                    if (single == nullptr || batch == nullptr || !seen.emplace((void*)single, (void*)batch).second) continue;
+                    const char* kernel = (single == COMMON::DistanceCalcSelector<T>(method)) ? "generic" : "fixed";
+
+                    for (auto& set : sets)
+                    {
+                        KernelTiming timing = TimeKernels<T>(single, batch, query.data(), set.second, dimension, p_options.m_seconds);
+                        double bytes = (double)dimension * sizeof(T);
+                        std::printf("%-10s %-12s %-10s %6d %-7s %-5s %10.2f %8.2f %10.2f %8.2f\n",
+                            Helper::Convert::ConvertToString(p_valueType).c_str(),
+                            Helper::Convert::ConvertToString(method).c_str(),
+                            c_levelNames[(int)level], dimension, kernel, set.first,
+                            timing.m_singleNs, bytes / timing.m_singleNs, timing.m_batchNs, bytes / timing.m_batchNs);
+                        std::fflush(stdout);
+                    }
+                }
+            }
+        }
+    }
+}
+
+int Benchmark::RunDistanceBenchmark(int p_argc, char** p_args)
+{
+    DistanceBenchmarkOptions options;
+    if (!options.Parse(p_argc, p_args)) return 1;
+    if (options.m_help)
+    {
+        options.PrintHelp();
+        return 0;
+    }
+
+    std::vector<VectorValueType> valueTypes;
+    std::vector<DistCalcMethod> methods;
+    std::vector<InstructionSet::Level> levels;
+    std::vector<DimensionType> dimensions;
+    if (!Benchmark::ParseList(options.m_valueTypes, valueTypes) || !Benchmark::ParseList(options.m_methods, methods) || !Benchmark::ParseList(options.m_dimensions, dimensions)) return 1;
+    if (dimensions.empty() || *std::min_element(dimensions.begin(), dimensions.end()) <= 0)
+    {
+        LOG(Helper::LogLevel::LL_Error, "Dimensions must be positive!\n");
+        return 1;
+    }
+    for (const std::string& item : Helper::StrUtils::SplitString(options.m_levels, ","))
+    {
+        InstructionSet::Level level;
+        if (!InstructionSet::ParseLevel(item.c_str(), level))
+        {
+            LOG(Helper::LogLevel::LL_Error, "Unknown instruction set %s!\n", item.c_str());
+            return 1;
+        }
+        levels.push_back(level);
+    }
+
+    if (valueTypes.empty())
+    {
+#define DefineVectorValueType(Name, Type) valueTypes.push_back(VectorValueType::Name);
+#include "inc/Core/DefinitionList.h"
+#undef DefineVectorValueType
+    }
+    if (methods.empty())
+    {
+#define DefineDistCalcMethod(Name) methods.push_back(DistCalcMethod::Name);
+#include "inc/Core/DefinitionList.h"
+#undef DefineDistCalcMethod
+    }
+
+    InstructionSet::Level original = InstructionSet::GetMaxLevel();
+    if (levels.empty())
+    {
+        for (int i = 0; i <= (int)InstructionSet::Level::AVX512BF16; i++) levels.push_back((InstructionSet::Level)i);
+    }
+    levels.erase(std::remove_if(levels.begin(), levels.end(), [](InstructionSet::Level level) { return !LevelSupported(level); }), levels.end());
+
+    std::printf("%-10s %-12s %-10s %6s %-7s %-5s %10s %8s %10s %8s\n",
+        "ValueType", "Method", "ISA", "Dim", "Kernel", "Set", "ns/dist", "GB/s", "batch ns", "GB/s");
+    for (VectorValueType valueType : valueTypes)
+    {
+        switch (valueType)
+        {
+#define DefineVectorValueType(Name, Type) \
+        case VectorValueType::Name: \
+            RunValueType<Type>(valueType, options, methods, levels, dimensions); \
+            break;
+
+#include "inc/Core/DefinitionList.h"
+#undef DefineVectorValueType
+
+        default: break;
+        }
+    }
+
+    InstructionSet::SetMaxLevel(original);
+    return 0;
+}
@@ -0,0 +1,93 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "benchmark/Benchmark.h"
+#include "inc/Core/Common/WorkSpace.h"
+#include "inc/Helper/ArgumentsParser.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace SPTAG;
+
+namespace
+{
+    class HeapBenchmarkOptions : public Helper::ArgumentsParser
+    {
+    public:
+        HeapBenchmarkOptions()
+        {
+            AddOptionalOption(m_maxChecks, "-m", "--maxchecks", "Comma separated MaxCheck values.");
+            AddOptionalOption(m_neighbors, "-n", "--neighbors", "Candidates pushed per expanded node.");
+            AddOptionalOption(m_scale, "-s", "--scale", "Queue length as a multiple of MaxCheck, 30 is m_NGQueue.");
+            AddOptionalOption(m_seconds, "-t", "--seconds", "Minimum seconds to time each queue.");
+            AddOptionalSwitch(m_help, "-h", "--help", "Print the options.", true);
+        }
+
+        std::string m_maxChecks = "1024,8192,32768";
+        int m_neighbors = 32;
+        int m_scale = 30;
+        float m_seconds = 0.5f;
+        bool m_help = false;
+    };
+
+    // One search's worth of queue traffic: MaxCheck rounds of popping the closest candidate
+    // and pushing p_neighbors new ones, with distances replayed from p_distances.
+    template<typename Queue>
+    std::uint64_t ReplaySearch(Queue& p_queue, int p_maxCheck, int p_neighbors, const std::vector<float>& p_distances)
+    {
+        p_queue.clear();
+        std::size_t next = 0;
+        p_queue.insert(COMMON::HeapCell(0, p_distances[next++]));
+        for (int check = 0; check < p_maxCheck && !p_queue.empty(); check++)
+        {
+            COMMON::HeapCell cell = p_queue.pop();
+            for (int i = 0; i < p_neighbors; i++)
+            {
+                // Candidates found later in a search are mostly no closer than the one being expanded.
+                p_queue.insert(COMMON::HeapCell(cell.node + i + 1, cell.distance + p_distances[next++]));
+            }
+        }
+        return (std::uint64_t)p_maxCheck * (p_neighbors + 1);
+    }
+}
+
+
+int Benchmark::RunHeapBenchmark(int p_argc, char** p_args)
+{
+    HeapBenchmarkOptions options;
+    if (!options.Parse(p_argc, p_args)) return 1;
+    if (options.m_help)
+    {
+        options.PrintHelp();
+        return 0;
+    }
+
+    std::vector<int> maxChecks;
+    if (!ParseList(options.m_maxChecks, maxChecks)) return 1;
+    if (maxChecks.empty() || *std::min_element(maxChecks.begin(), maxChecks.end()) <= 0 || options.m_neighbors <= 0 || options.m_scale <= 0)
+    {
+        LOG(Helper::LogLevel::LL_Error, "MaxCheck, neighbors and scale must be positive!\n");
+        return 1;
+    }
+
+    std::printf("%8s %10s %10s %14s %14s %8s\n", "MaxCheck", "Length", "Neighbors", "Heap ns/op", "MinMax ns/op", "Speedup");
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+    for (int maxCheck : maxChecks)
+    {
+        int length = maxCheck * options.m_scale;
+        std::vector<float> distances((std::size_t)maxCheck * options.m_neighbors + 1);
+        for (float& d : distances) d = dist(rng);
+
+        COMMON::Heap<COMMON::HeapCell> heap(length);
+        COMMON::MinMaxHeap<COMMON::HeapCell> minMaxHeap(length);
+        double heapNs = MeasureNanoseconds([&]() { return ReplaySearch(heap, maxCheck, options.m_neighbors, distances); }, options.m_seconds);
+        double minMaxNs = MeasureNanoseconds([&]() { return ReplaySearch(minMaxHeap, maxCheck, options.m_neighbors, distances); }, options.m_seconds);
+        std::printf("%8d %10d %10d %14.2f %14.2f %7.2fx\n", maxCheck, length, options.m_neighbors, heapNs, minMaxNs, heapNs / minMaxNs);
+        std::fflush(stdout);
+    }
+    return 0;
+}
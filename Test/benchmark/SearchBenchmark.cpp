@@ -0,0 +1,164 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "benchmark/Benchmark.h"
+#include "inc/Core/VectorIndex.h"
+#include "inc/Helper/ArgumentsParser.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <omp.h>
+#include <random>
+#include <vector>
+
+using namespace SPTAG;
+
+namespace
+{
+    class SearchBenchmarkOptions : public Helper::ArgumentsParser
+    {
+    public:
+        SearchBenchmarkOptions()
+        {
+            AddOptionalOption(m_algo, "-a", "--algo", "Index algorithm.");
+            AddOptionalOption(m_count, "-n", "--count", "Number of generated vectors.");
+            AddOptionalOption(m_dimension, "-d", "--dimension", "Dimension of generated vectors.");
+            AddOptionalOption(m_queryCount, "-q", "--queries", "Number of queries.");
+            AddOptionalOption(m_k, "-k", "--k", "Results per query.");
+            AddOptionalOption(m_maxChecks, "-m", "--maxchecks", "Comma separated MaxCheck values.");
+            AddOptionalOption(m_params, "-p", "--params", "Comma separated Name=Value index parameters applied before the build.");
+            AddOptionalOption(m_folder, "-f", "--folder", "Index folder: loaded if it exists, otherwise saved after the build, so runs can share a graph.");
+            AddOptionalSwitch(m_help, "-h", "--help", "Print the options.", true);
+        }
+
+        IndexAlgoType m_algo = IndexAlgoType::BKT;
+        SizeType m_count = 20000;
+        DimensionType m_dimension = 64;
+        int m_queryCount = 200;
+        int m_k = 10;
+        std::string m_maxChecks = "1024,8192,32768";
+        std::string m_params = "TPTNumber=4,CEF=256,RefineIterations=1";
+        std::string m_folder;
+        bool m_help = false;
+    };
+
+    // Gaussian clusters, so the graph has the local structure real embeddings have.
+    void GenerateClustered(std::vector<float>& p_data, SizeType p_count, DimensionType p_dimension, std::mt19937& p_rng)
+    {
+        const int clusters = 100;
+        std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+        std::normal_distribution<float> noise(0.0f, 0.3f);
+        std::vector<float> centers((std::size_t)clusters * p_dimension);
+        for (float& v : centers) v = uniform(p_rng);
+
+        p_data.resize((std::size_t)p_count * p_dimension);
+        for (SizeType i = 0; i < p_count; i++)
+        {
+            const float* center = centers.data() + (std::size_t)(p_rng() % clusters) * p_dimension;
+            for (DimensionType j = 0; j < p_dimension; j++) p_data[(std::size_t)i * p_dimension + j] = center[j] + noise(p_rng);
+        }
+    }
+}
+
+
+int Benchmark::RunSearchBenchmark(int p_argc, char** p_args)
+{
+    SearchBenchmarkOptions options;
+    if (!options.Parse(p_argc, p_args)) return 1;
+    if (options.m_help)
+    {
+        options.PrintHelp();
+        return 0;
+    }
+
+    std::vector<int> maxChecks;
+    if (!ParseList(options.m_maxChecks, maxChecks)) return 1;
+    if (maxChecks.empty() || options.m_count <= 0 || options.m_dimension <= 0 || options.m_queryCount <= 0 || options.m_k <= 0 || options.m_k > options.m_count)
+    {
+        LOG(Helper::LogLevel::LL_Error, "Counts, dimension and k must be positive, with k at most the vector count!\n");
+        return 1;
+    }
+
+    std::mt19937 rng(0);
+    std::vector<float> data, queries;
+    GenerateClustered(data, options.m_count, options.m_dimension, rng);
+    GenerateClustered(queries, options.m_queryCount, options.m_dimension, rng);
+
+    std::shared_ptr<VectorIndex> index;
+    auto start = std::chrono::steady_clock::now();
+    if (!options.m_folder.empty() && fileexists(options.m_folder.c_str()))
+    {
+        if (ErrorCode::Success != VectorIndex::LoadIndex(options.m_folder, index) || index->GetNumSamples() != options.m_count || index->GetFeatureDim() != options.m_dimension)
+        {
+            LOG(Helper::LogLevel::LL_Error, "Cannot load a %d x %d index from %s!\n", options.m_count, options.m_dimension, options.m_folder.c_str());
+            return 1;
+        }
+    }
+    else
+    {
+        index = VectorIndex::CreateInstance(options.m_algo, VectorValueType::Float);
+        if (index == nullptr) return 1;
+        index->SetParameter("DistCalcMethod", "L2");
+        index->SetParameter("NumberOfThreads", std::to_string(omp_get_max_threads()));
+        for (const std::string& param : Helper::StrUtils::SplitString(options.m_params, ","))
+        {
+            std::size_t split = param.find('=');
+            if (split == std::string::npos || ErrorCode::Success != index->SetParameter(param.substr(0, split), param.substr(split + 1)))
+            {
+                LOG(Helper::LogLevel::LL_Error, "Cannot set parameter %s!\n", param.c_str());
+                return 1;
+            }
+        }
+        if (ErrorCode::Success != index->BuildIndex(data.data(), options.m_count, options.m_dimension)) return 1;
+        if (!options.m_folder.empty() && ErrorCode::Success != index->SaveIndex(options.m_folder)) return 1;
+    }
+    double buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Exact neighbors to score recall against.
+    std::vector<std::vector<SizeType>> truth(options.m_queryCount);
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < options.m_queryCount; i++)
+    {
+        std::vector<std::pair<float, SizeType>> dists(options.m_count);
+        for (SizeType j = 0; j < options.m_count; j++)
+            dists[j] = std::make_pair(index->ComputeDistance(queries.data() + (std::size_t)i * options.m_dimension, index->GetSample(j)), j);
+        std::partial_sort(dists.begin(), dists.begin() + options.m_k, dists.end());
+        for (int j = 0; j < options.m_k; j++) truth[i].push_back(dists[j].second);
+    }
+
+    std::printf("%s index of %d x %d ready in %.1f s\n", Helper::Convert::ConvertToString(index->GetIndexAlgoType()).c_str(), options.m_count, options.m_dimension, buildSeconds);
+    std::printf("%8s %12s %12s %10s\n", "MaxCheck", "mean us", "p99 us", "recall");
+    for (int maxCheck : maxChecks)
+    {
+        index->SetParameter("MaxCheck", std::to_string(maxCheck));
+        index->UpdateIndex();
+
+        std::vector<double> latencies;
+        std::size_t hits = 0;
+        for (int pass = 0; pass < 2; pass++)
+        {
+            // The first pass warms the workspace pool and caches.
+            latencies.clear();
+            hits = 0;
+            for (int i = 0; i < options.m_queryCount; i++)
+            {
+                QueryResult result(queries.data() + (std::size_t)i * options.m_dimension, options.m_k, false);
+                auto begin = std::chrono::steady_clock::now();
+                index->SearchIndex(result);
+                latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count());
+                for (int j = 0; j < options.m_k; j++)
+                    hits += std::count(truth[i].begin(), truth[i].end(), result.GetResult(j)->VID);
+            }
+        }
+
+        double mean = 0;
+        for (double latency : latencies) mean += latency;
+        mean /= latencies.size();
+        std::sort(latencies.begin(), latencies.end());
+        std::printf("%8d %12.1f %12.1f %10.4f\n", maxCheck, mean, latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)],
+            (double)hits / ((std::size_t)options.m_queryCount * options.m_k));
+        std::fflush(stdout);
+    }
+    return 0;
+}
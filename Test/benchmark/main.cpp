@@ -0,0 +1,48 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "benchmark/Benchmark.h"
+
+#include <cstdio>
+#include <cstring>
+
+using namespace SPTAG;
+
+namespace
+{
+    struct Suite
+    {
+        const char* m_name;
+        int (*m_run)(int, char**);
+        const char* m_description;
+    };
+
+    const Suite c_suites[] = {
+        { "distance", &Benchmark::RunDistanceBenchmark, "Distance kernels per value type, method, instruction set and dimension." },
+        { "heap", &Benchmark::RunHeapBenchmark, "Bounded search queues filled the way graph expansion fills them." },
+        { "search", &Benchmark::RunSearchBenchmark, "Search latency and recall per MaxCheck on a generated index." },
+    };
+
+    void PrintUsage(const char* p_program)
+    {
+        std::printf("Usage: %s <suite> [options]\nSuites:\n", p_program);
+        for (const Suite& suite : c_suites) std::printf("  %-12s %s\n", suite.m_name, suite.m_description);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    for (const Suite& suite : c_suites)
+    {
+        if (std::strcmp(argv[1], suite.m_name) == 0) return suite.m_run(argc - 2, argv + 2);
+    }
+
+    PrintUsage(argv[0]);
+    return 1;
+}
@@ -4,10 +4,21 @@
 #include "inc/Test.h"
 #include "inc/Helper/SimpleIniReader.h"
 #include "inc/Core/VectorIndex.h"
+#include "inc/Core/SearchFilter.h"
 #include "inc/Core/Common/CommonUtils.h"
+#include "inc/Core/Common/DistanceUtils.h"
+#include "inc/Core/Common/WorkSpace.h"
+#include "inc/Core/Common/WorkSpacePool.h"
+#include "inc/Core/Common/TerminationPredictor.h"
+#include "inc/Helper/StringConvert.h"
 
 #include <unordered_set>
+#include <set>
+#include <algorithm>
 #include <ctime>
+#include <cfloat>
+#include <chrono>
+#include <thread>
 
 template <typename T>
 void Build(SPTAG::IndexAlgoType algo, std::string distCalcMethod, std::shared_ptr<SPTAG::VectorSet>& vec, std::shared_ptr<SPTAG::MetadataSet>& meta, const std::string out)
@@ -176,6 +187,821 @@ void Test(SPTAG::IndexAlgoType algo, std::string distCalcMethod)
     Search<float>("testindices", query.data(), q, k, truthmeta6);
 }
 
+// The top result must be the vector with the largest dot product, which is not the nearest one in L2.
+template <typename T>
+void TestInnerProduct(SPTAG::IndexAlgoType algo)
+{
+    SPTAG::SizeType n = 1000, q = 5;
+    SPTAG::DimensionType m = 16;
+    std::vector<T> vec(n * m), query(q * m);
+    for (T& v : vec) v = (T)(std::rand() / (float)RAND_MAX * 2 - 1);
+    for (T& v : query) v = (T)(std::rand() / (float)RAND_MAX * 2 - 1);
+
+    std::shared_ptr<SPTAG::VectorSet> vecset(new SPTAG::BasicVectorSet(
+        SPTAG::ByteArray((std::uint8_t*)vec.data(), sizeof(T) * n * m, false),
+        SPTAG::GetEnumValueType<T>(), m, n));
+
+    std::shared_ptr<SPTAG::VectorIndex> vecIndex = SPTAG::VectorIndex::CreateInstance(algo, SPTAG::GetEnumValueType<T>());
+    BOOST_CHECK(nullptr != vecIndex);
+    vecIndex->SetParameter("DistCalcMethod", "InnerProduct");
+    vecIndex->SetParameter("NumberOfThreads", "16");
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->BuildIndex(vecset, nullptr));
+    // with k = 1 the default early termination trades away exactness, which this check needs
+    vecIndex->SetParameter("ThresholdOfNumberOfContinuousNoBetterPropagation", "64");
+
+    for (SPTAG::SizeType i = 0; i < q; i++)
+    {
+        const T* target = query.data() + i * m;
+        SPTAG::SizeType best = 0;
+        float bestDot = -FLT_MAX;
+        for (SPTAG::SizeType j = 0; j < n; j++)
+        {
+            float dot = 0;
+            for (SPTAG::DimensionType d = 0; d < m; d++) dot += target[d] * vec[j * m + d];
+            if (dot > bestDot) { bestDot = dot; best = j; }
+        }
+
+        SPTAG::QueryResult res(target, 1, false);
+        vecIndex->SearchIndex(res);
+        BOOST_CHECK_EQUAL(res.GetResult(0)->VID, best);
+        BOOST_CHECK_CLOSE_FRACTION(res.GetResult(0)->Dist, -bestDot, 1e-4);
+    }
+}
+
+// The sample id distances read cached norms, which must match recomputing them from the vectors
+// after a build, an add and a reload.
+template <typename T>
+void TestCachedNorms(SPTAG::IndexAlgoType algo, std::string distCalcMethod)
+{
+    SPTAG::SizeType n = 1000, added = 100;
+    SPTAG::DimensionType m = 16;
+    std::vector<T> vec((n + added) * m);
+    for (T& v : vec) v = (T)(std::rand() / (float)RAND_MAX * 2 - 1);
+
+    std::shared_ptr<SPTAG::VectorSet> vecset(new SPTAG::BasicVectorSet(
+        SPTAG::ByteArray((std::uint8_t*)vec.data(), sizeof(T) * n * m, false),
+        SPTAG::GetEnumValueType<T>(), m, n));
+    std::shared_ptr<SPTAG::MetadataSet> metaset;
+    Build<T>(algo, distCalcMethod, vecset, metaset, "testindices");
+
+    std::shared_ptr<SPTAG::VectorIndex> vecIndex;
+    BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex("testindices", vecIndex));
+    BOOST_CHECK(nullptr != vecIndex);
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->AddIndex(vec.data() + n * m, added, m, nullptr));
+
+    for (int i = 0; i < 200; i++)
+    {
+        SPTAG::SizeType x = std::rand() % (n + added), y = std::rand() % (n + added);
+        BOOST_CHECK_SMALL(vecIndex->AccurateDistance(x, y) - vecIndex->AccurateDistance(vecIndex->GetSample(x), vecIndex->GetSample(y)), 1e-4f);
+        BOOST_CHECK_SMALL(vecIndex->ComputeDistance(x, y) - vecIndex->ComputeDistance(vecIndex->GetSample(x), vecIndex->GetSample(y)), 1e-4f);
+    }
+}
+
+// Early abandoned candidates never enter the results, so the returned distances stay exact and
+// recall matches brute force on high dimensional data.
+template <typename T>
+void TestEarlyAbandon(SPTAG::IndexAlgoType algo, SPTAG::DistCalcMethod distCalcMethod)
+{
+    SPTAG::SizeType n = 1000, q = 20;
+    SPTAG::DimensionType m = 512;
+    int k = 10;
+    std::vector<T> vec(n * m), query(q * m);
+    for (T& v : vec) v = (T)(std::rand() / (float)RAND_MAX * 2 - 1);
+    for (T& v : query) v = (T)(std::rand() / (float)RAND_MAX * 2 - 1);
+
+    std::shared_ptr<SPTAG::VectorSet> vecset(new SPTAG::BasicVectorSet(
+        SPTAG::ByteArray((std::uint8_t*)vec.data(), sizeof(T) * n * m, false),
+        SPTAG::GetEnumValueType<T>(), m, n));
+    std::shared_ptr<SPTAG::VectorIndex> vecIndex = SPTAG::VectorIndex::CreateInstance(algo, SPTAG::GetEnumValueType<T>());
+    BOOST_CHECK(nullptr != vecIndex);
+    vecIndex->SetParameter("DistCalcMethod", SPTAG::Helper::Convert::ConvertToString(distCalcMethod));
+    vecIndex->SetParameter("NumberOfThreads", "16");
+    vecIndex->SetParameter("EarlyAbandonDimension", "256");
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->BuildIndex(vecset, nullptr));
+
+    int hits = 0;
+    for (SPTAG::SizeType i = 0; i < q; i++)
+    {
+        const T* target = query.data() + i * m;
+        std::vector<std::pair<float, SPTAG::SizeType>> truth(n);
+        for (SPTAG::SizeType j = 0; j < n; j++) truth[j] = std::make_pair(vecIndex->AccurateDistance(target, vecIndex->GetSample(j)), j);
+        std::partial_sort(truth.begin(), truth.begin() + k, truth.end());
+
+        SPTAG::QueryResult res(target, k, false);
+        vecIndex->SearchIndex(res);
+        std::unordered_set<SPTAG::SizeType> found;
+        for (int j = 0; j < k; j++)
+        {
+            const SPTAG::BasicResult* result = res.GetResult(j);
+            BOOST_CHECK(result->VID >= 0);
+            if (result->VID < 0) continue;
+            found.insert(result->VID);
+            BOOST_CHECK_SMALL(result->Dist - vecIndex->AccurateDistance(target, vecIndex->GetSample(result->VID)), 1e-3f);
+        }
+        for (int j = 0; j < k; j++) hits += (int)found.count(truth[j].second);
+    }
+    BOOST_CHECK_GE(hits, (int)(0.9 * q * k));
+}
+
+// Every stored vector must come back as its own nearest neighbor after a save and reload.
+template <typename T>
+void TestHalfPrecision(SPTAG::IndexAlgoType algo)
+{
+    SPTAG::SizeType n = 1000, q = 20;
+    SPTAG::DimensionType m = 32;
+    std::vector<T> vec(n * m);
+    for (T& v : vec) v = (T)(std::rand() / (float)RAND_MAX * 2 - 1);
+
+    std::shared_ptr<SPTAG::VectorSet> vecset(new SPTAG::BasicVectorSet(
+        SPTAG::ByteArray((std::uint8_t*)vec.data(), sizeof(T) * n * m, false),
+        SPTAG::GetEnumValueType<T>(), m, n));
+    std::shared_ptr<SPTAG::MetadataSet> metaset;
+    Build<T>(algo, "L2", vecset, metaset, "testindices");
+
+    std::shared_ptr<SPTAG::VectorIndex> vecIndex;
+    BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex("testindices", vecIndex));
+    BOOST_CHECK(nullptr != vecIndex);
+    BOOST_CHECK(SPTAG::GetEnumValueType<T>() == vecIndex->GetVectorValueType());
+
+    for (SPTAG::SizeType i = 0; i < q; i++)
+    {
+        SPTAG::QueryResult res(vec.data() + i * m, 1, false);
+        vecIndex->SearchIndex(res);
+        BOOST_CHECK_EQUAL(res.GetResult(0)->VID, i);
+        BOOST_CHECK_SMALL(res.GetResult(0)->Dist, 1e-6f);
+    }
+}
+
+// Product quantized search reranks its candidates exactly, so the returned distances are the true ones
+// and recall against brute force stays high; the codes must survive a save and reload.
+template <typename T>
+void TestProductQuantization(SPTAG::IndexAlgoType algo, SPTAG::DistCalcMethod distCalcMethod)
+{
+    SPTAG::SizeType n = 2000, q = 20;
+    SPTAG::DimensionType m = 32;
+    int k = 10;
+    std::vector<T> vec(n * m), query(q * m);
+    for (T& v : vec) v = (T)(std::rand() / (float)RAND_MAX * 2 - 1);
+    for (T& v : query) v = (T)(std::rand() / (float)RAND_MAX * 2 - 1);
+
+    std::shared_ptr<SPTAG::VectorSet> vecset(new SPTAG::BasicVectorSet(
+        SPTAG::ByteArray((std::uint8_t*)vec.data(), sizeof(T) * n * m, false),
+        SPTAG::GetEnumValueType<T>(), m, n));
+
+    std::shared_ptr<SPTAG::VectorIndex> vecIndex = SPTAG::VectorIndex::CreateInstance(algo, SPTAG::GetEnumValueType<T>());
+    BOOST_CHECK(nullptr != vecIndex);
+    vecIndex->SetParameter("DistCalcMethod", SPTAG::Helper::Convert::ConvertToString(distCalcMethod));
+    vecIndex->SetParameter("NumberOfThreads", "16");
+    vecIndex->SetParameter("PQSubvectors", "8");
+    vecIndex->SetParameter("PQRerankNumber", "100");
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->BuildIndex(vecset, nullptr));
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SaveIndex("testindices"));
+    vecIndex.reset();
+    BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex("testindices", vecIndex));
+    BOOST_CHECK(nullptr != vecIndex);
+
+    int hits = 0;
+    for (SPTAG::SizeType i = 0; i < q; i++)
+    {
+        const T* target = query.data() + i * m;
+        std::vector<std::pair<float, SPTAG::SizeType>> truth(n);
+        for (SPTAG::SizeType j = 0; j < n; j++) truth[j] = std::make_pair(SPTAG::COMMON::DistanceUtils::ComputeDistance(target, vec.data() + j * m, m, distCalcMethod), j);
+        std::partial_sort(truth.begin(), truth.begin() + k, truth.end());
+
+        SPTAG::QueryResult res(target, k, false);
+        vecIndex->SearchIndex(res);
+        std::unordered_set<SPTAG::SizeType> found;
+        for (int j = 0; j < k; j++)
+        {
+            const SPTAG::BasicResult* result = res.GetResult(j);
+            BOOST_CHECK(result->VID >= 0);
+            if (result->VID < 0) continue;
+            found.insert(result->VID);
+            BOOST_CHECK_CLOSE_FRACTION(result->Dist, SPTAG::COMMON::DistanceUtils::ComputeDistance(target, vec.data() + result->VID * m, m, distCalcMethod), 1e-4);
+        }
+        for (int j = 0; j < k; j++) hits += (int)found.count(truth[j].second);
+    }
+    BOOST_CHECK_GE(hits, (int)(0.9 * q * k));
+}
+
+template <typename T>
+void TestScalarQuantization(SPTAG::IndexAlgoType algo, SPTAG::DistCalcMethod distCalcMethod)
+{
+    SPTAG::SizeType n = 2000, q = 20;
+    SPTAG::DimensionType m = 32;
+    int k = 10;
+    std::vector<T> vec(n * m), query(q * m);
+    for (T& v : vec) v = (T)(std::rand() / (float)RAND_MAX * 2 - 1);
+    for (T& v : query) v = (T)(std::rand() / (float)RAND_MAX * 2 - 1);
+
+    std::shared_ptr<SPTAG::VectorSet> vecset(new SPTAG::BasicVectorSet(
+        SPTAG::ByteArray((std::uint8_t*)vec.data(), sizeof(T) * n * m, false),
+        SPTAG::GetEnumValueType<T>(), m, n));
+
+    std::shared_ptr<SPTAG::VectorIndex> vecIndex = SPTAG::VectorIndex::CreateInstance(algo, SPTAG::GetEnumValueType<T>());
+    BOOST_CHECK(nullptr != vecIndex);
+    vecIndex->SetParameter("DistCalcMethod", SPTAG::Helper::Convert::ConvertToString(distCalcMethod));
+    vecIndex->SetParameter("NumberOfThreads", "16");
+    vecIndex->SetParameter("SQ8", "true");
+    vecIndex->SetParameter("SQ8RerankNumber", "100");
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->BuildIndex(vecset, nullptr));
+
+    // a rescored search returns exact distances, a code-only one approximates them
+    auto check = [&](bool p_exact) {
+        int hits = 0;
+        for (SPTAG::SizeType i = 0; i < q; i++)
+        {
+            const T* target = query.data() + i * m;
+            std::vector<std::pair<float, SPTAG::SizeType>> truth(n);
+            for (SPTAG::SizeType j = 0; j < n; j++) truth[j] = std::make_pair(SPTAG::COMMON::DistanceUtils::ComputeDistance(target, vec.data() + j * m, m, distCalcMethod), j);
+            std::partial_sort(truth.begin(), truth.begin() + k, truth.end());
+
+            SPTAG::QueryResult res(target, k, false);
+            vecIndex->SearchIndex(res);
+            std::unordered_set<SPTAG::SizeType> found;
+            for (int j = 0; j < k; j++)
+            {
+                const SPTAG::BasicResult* result = res.GetResult(j);
+                BOOST_CHECK(result->VID >= 0);
+                if (result->VID < 0) continue;
+                found.insert(result->VID);
+                float exact = SPTAG::COMMON::DistanceUtils::ComputeDistance(target, vec.data() + result->VID * m, m, distCalcMethod);
+                if (p_exact) BOOST_CHECK_CLOSE_FRACTION(result->Dist, exact, 1e-4);
+                else BOOST_CHECK_SMALL(result->Dist - exact, 0.1f);
+            }
+            for (int j = 0; j < k; j++) hits += (int)found.count(truth[j].second);
+        }
+        BOOST_CHECK_GE(hits, (int)(0.9 * q * k));
+    };
+    check(true);
+
+    // without rescoring the saved index is served from the codes alone
+    vecIndex->SetParameter("SQ8RerankNumber", "0");
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SaveIndex("testindices"));
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SaveIndexToFile("testindices/sq8.index", nullptr));
+    for (int loader = 0; loader < 2; loader++)
+    {
+        vecIndex.reset();
+        if (loader == 0) BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex("testindices", vecIndex));
+        else BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndexFromFile("testindices/sq8.index", vecIndex));
+        BOOST_CHECK(nullptr != vecIndex);
+        BOOST_CHECK_EQUAL(vecIndex->GetNumSamples(), n);
+        BOOST_CHECK_EQUAL(vecIndex->GetFeatureDim(), m);
+        BOOST_CHECK(nullptr == vecIndex->GetSample(0));
+        BOOST_CHECK(SPTAG::ErrorCode::Success != vecIndex->AddIndex(query.data(), 1, m, nullptr));
+        check(false);
+    }
+}
+
+// Binary vectors drawn around a few random centers, so the bit-majority k-means has clusters to find.
+// Hamming distances are integers with many ties, so recall counts results within the k-th true distance.
+void TestBinaryVectors(SPTAG::IndexAlgoType algo)
+{
+    SPTAG::SizeType n = 2000, q = 20;
+    SPTAG::DimensionType m = 32;
+    int k = 10, clusters = 40;
+    std::vector<std::uint8_t> centers(clusters * m), vec(n * m), query(q * m);
+    for (std::uint8_t& v : centers) v = (std::uint8_t)(std::rand() & 0xff);
+    auto draw = [&](std::uint8_t* v) {
+        const std::uint8_t* center = centers.data() + (std::rand() % clusters) * m;
+        for (SPTAG::DimensionType j = 0; j < m; j++) {
+            std::uint8_t flips = 0;
+            for (int b = 0; b < 8; b++) if (std::rand() % 10 == 0) flips |= (std::uint8_t)(1 << b);
+            v[j] = center[j] ^ flips;
+        }
+    };
+    for (SPTAG::SizeType i = 0; i < n; i++) draw(vec.data() + i * m);
+    for (SPTAG::SizeType i = 0; i < q; i++) draw(query.data() + i * m);
+
+    std::shared_ptr<SPTAG::VectorSet> vecset(new SPTAG::BasicVectorSet(
+        SPTAG::ByteArray(vec.data(), n * m, false), SPTAG::VectorValueType::PackedBits, m, n));
+    std::shared_ptr<SPTAG::MetadataSet> metaset;
+    Build<SPTAG::PackedBits>(algo, "Hamming", vecset, metaset, "testindices");
+
+    std::shared_ptr<SPTAG::VectorIndex> vecIndex;
+    BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex("testindices", vecIndex));
+    BOOST_CHECK(nullptr != vecIndex);
+    BOOST_CHECK(SPTAG::VectorValueType::PackedBits == vecIndex->GetVectorValueType());
+
+    const SPTAG::PackedBits* base = (const SPTAG::PackedBits*)vec.data();
+    int hits = 0;
+    for (SPTAG::SizeType i = 0; i < q; i++)
+    {
+        const SPTAG::PackedBits* target = (const SPTAG::PackedBits*)query.data() + i * m;
+        std::vector<float> truth(n);
+        for (SPTAG::SizeType j = 0; j < n; j++) truth[j] = SPTAG::COMMON::DistanceUtils::ComputeDistance(target, base + j * m, m, SPTAG::DistCalcMethod::Hamming);
+        std::nth_element(truth.begin(), truth.begin() + k - 1, truth.end());
+
+        SPTAG::QueryResult res(target, k, false);
+        vecIndex->SearchIndex(res);
+        for (int j = 0; j < k; j++)
+        {
+            const SPTAG::BasicResult* result = res.GetResult(j);
+            BOOST_CHECK(result->VID >= 0);
+            if (result->VID < 0) continue;
+            BOOST_CHECK_EQUAL(result->Dist, SPTAG::COMMON::DistanceUtils::ComputeDistance(target, base + result->VID * m, m, SPTAG::DistCalcMethod::Hamming));
+            if (result->Dist <= truth[k - 1]) hits++;
+        }
+    }
+    BOOST_CHECK_GE(hits, (int)(0.9 * q * k));
+}
+
+// Interleaved batch search takes the same steps per query as single query search, so both return the same results.
+template <typename T>
+void TestBatchSearch(SPTAG::IndexAlgoType algo, const std::vector<std::pair<std::string, std::string>>& params)
+{
+    SPTAG::SizeType n = 2000, q = 50;
+    SPTAG::DimensionType m = 64;
+    int k = 10;
+    std::vector<T> vec(n * m), query(q * m);
+    for (T& v : vec) v = (T)(std::rand() / (float)RAND_MAX * 2 - 1);
+    for (T& v : query) v = (T)(std::rand() / (float)RAND_MAX * 2 - 1);
+
+    std::shared_ptr<SPTAG::VectorSet> vecset(new SPTAG::BasicVectorSet(
+        SPTAG::ByteArray((std::uint8_t*)vec.data(), sizeof(T) * n * m, false),
+        SPTAG::GetEnumValueType<T>(), m, n));
+    std::shared_ptr<SPTAG::VectorIndex> vecIndex = SPTAG::VectorIndex::CreateInstance(algo, SPTAG::GetEnumValueType<T>());
+    BOOST_CHECK(nullptr != vecIndex);
+    vecIndex->SetParameter("DistCalcMethod", "L2");
+    vecIndex->SetParameter("NumberOfThreads", "16");
+    vecIndex->SetParameter("SearchGroupSize", "4");
+    for (auto& param : params) vecIndex->SetParameter(param.first, param.second);
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->BuildIndex(vecset, nullptr));
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->DeleteIndex(vec.data(), 20));
+
+    std::vector<SPTAG::QueryResult> single, batch;
+    for (SPTAG::SizeType i = 0; i < q; i++)
+    {
+        single.emplace_back(query.data() + i * m, k, false);
+        batch.emplace_back(query.data() + i * m, k, false);
+        BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SearchIndex(single.back()));
+    }
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SearchIndexBatch(batch.data(), q));
+    std::vector<SPTAG::BasicResult> all(q * k);
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SearchIndex(query.data(), q, k, false, all.data()));
+
+    for (SPTAG::SizeType i = 0; i < q; i++)
+    {
+        for (int j = 0; j < k; j++)
+        {
+            const SPTAG::BasicResult* expected = single[i].GetResult(j);
+            BOOST_CHECK(expected->VID >= 20);
+            BOOST_CHECK_EQUAL(batch[i].GetResult(j)->VID, expected->VID);
+            BOOST_CHECK_EQUAL(batch[i].GetResult(j)->Dist, expected->Dist);
+            BOOST_CHECK_EQUAL(all[i * k + j].VID, expected->VID);
+            BOOST_CHECK_EQUAL(all[i * k + j].Dist, expected->Dist);
+        }
+    }
+}
+
+template <typename T>
+void TestEpochVisitedSet(SPTAG::IndexAlgoType algo)
+{
+    SPTAG::COMMON::OptEpochPosVector visited;
+    visited.Init(4);
+    for (int round = 0; round < 70000; round++)
+    {
+        BOOST_CHECK(!visited.CheckAndSet(round % 4));
+        BOOST_CHECK(visited.CheckAndSet(round % 4));
+        visited.clear();
+    }
+    BOOST_CHECK(!visited.CheckAndSet(100));
+    BOOST_CHECK(visited.CheckAndSet(100));
+    BOOST_CHECK(!visited.CheckAndSet(99));
+
+    SPTAG::SizeType n = 2000, q = 50;
+    SPTAG::DimensionType m = 32;
+    int k = 10;
+    std::vector<T> vec(n * m), query(q * m);
+    for (T& v : vec) v = (T)(std::rand() / (float)RAND_MAX * 2 - 1);
+    for (T& v : query) v = (T)(std::rand() / (float)RAND_MAX * 2 - 1);
+
+    std::shared_ptr<SPTAG::VectorSet> vecset(new SPTAG::BasicVectorSet(
+        SPTAG::ByteArray((std::uint8_t*)vec.data(), sizeof(T) * n * m, false),
+        SPTAG::GetEnumValueType<T>(), m, n));
+    std::shared_ptr<SPTAG::VectorIndex> vecIndex = SPTAG::VectorIndex::CreateInstance(algo, SPTAG::GetEnumValueType<T>());
+    BOOST_CHECK(nullptr != vecIndex);
+    vecIndex->SetParameter("DistCalcMethod", "L2");
+    vecIndex->SetParameter("NumberOfThreads", "16");
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->BuildIndex(vecset, nullptr));
+
+    std::vector<SPTAG::BasicResult> hashed(q * k), stamped(q * k);
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SearchIndex(query.data(), q, k, false, hashed.data()));
+    vecIndex->SetParameter("EpochVisitedSet", "true");
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->UpdateIndex());
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SearchIndex(query.data(), q, k, false, stamped.data()));
+    for (int i = 0; i < q * k; i++)
+    {
+        BOOST_CHECK_EQUAL(stamped[i].VID, hashed[i].VID);
+        BOOST_CHECK_EQUAL(stamped[i].Dist, hashed[i].Dist);
+    }
+
+    // Vectors added after the workspaces were sized must still be found.
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->AddIndex(query.data(), q, m, nullptr));
+    for (SPTAG::SizeType i = 0; i < q; i++)
+    {
+        SPTAG::QueryResult result(query.data() + i * m, k, false);
+        BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SearchIndex(result));
+        BOOST_CHECK_EQUAL(result.GetResult(0)->VID, n + i);
+    }
+}
+
+template <typename T>
+void TestAdaptiveTermination(SPTAG::IndexAlgoType algo)
+{
+    SPTAG::SizeType n = 5000, q = 100;
+    SPTAG::DimensionType m = 32;
+    int k = 10;
+    std::vector<T> vec(n * m), query(q * m);
+    for (T& v : vec) v = (T)(std::rand() / (float)RAND_MAX * 2 - 1);
+    for (T& v : query) v = (T)(std::rand() / (float)RAND_MAX * 2 - 1);
+
+    std::shared_ptr<SPTAG::VectorSet> vecset(new SPTAG::BasicVectorSet(
+        SPTAG::ByteArray((std::uint8_t*)vec.data(), sizeof(T) * n * m, false),
+        SPTAG::GetEnumValueType<T>(), m, n));
+    std::shared_ptr<SPTAG::VectorIndex> vecIndex = SPTAG::VectorIndex::CreateInstance(algo, SPTAG::GetEnumValueType<T>());
+    BOOST_CHECK(nullptr != vecIndex);
+    vecIndex->SetParameter("DistCalcMethod", "L2");
+    vecIndex->SetParameter("NumberOfThreads", "16");
+    vecIndex->SetParameter("MaxCheck", "4096");
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->BuildIndex(vecset, nullptr));
+
+    std::vector<std::set<SPTAG::SizeType>> truth(q);
+    for (SPTAG::SizeType i = 0; i < q; i++)
+    {
+        std::vector<std::pair<float, SPTAG::SizeType>> dists(n);
+        for (SPTAG::SizeType j = 0; j < n; j++) dists[j] = std::make_pair(vecIndex->ComputeDistance(query.data() + i * m, vec.data() + j * m), j);
+        std::partial_sort(dists.begin(), dists.begin() + k, dists.end());
+        for (int j = 0; j < k; j++) truth[i].insert(dists[j].second);
+    }
+
+    std::vector<std::vector<SPTAG::COMMON::TerminationTracePoint>> traces(q);
+    float fullRecall = 0, fullChecked = 0;
+    for (SPTAG::SizeType i = 0; i < q; i++)
+    {
+        SPTAG::QueryResult result(query.data() + i * m, k, false);
+        BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SearchIndexTrace(result, traces[i]));
+        BOOST_CHECK(!traces[i].empty());
+        for (std::size_t j = 0; j < traces[i].size(); j++)
+        {
+            if (j > 0) BOOST_CHECK(traces[i][j].m_checked >= traces[i][j - 1].m_checked);
+            int hits = 0;
+            for (SPTAG::SizeType vid : traces[i][j].m_results) hits += (int)truth[i].count(vid);
+            traces[i][j].m_recall = (float)hits / k;
+        }
+        fullRecall += traces[i].back().m_recall / q;
+        fullChecked += (float)traces[i].back().m_checked / q;
+    }
+
+    std::string model;
+    float threshold, recall, checked;
+    BOOST_CHECK(SPTAG::COMMON::TerminationPredictor::Calibrate(traces, fullRecall * 0.95f, model, threshold, recall, checked));
+    BOOST_CHECK(recall >= fullRecall * 0.95f);
+    BOOST_CHECK(checked <= fullChecked);
+    BOOST_CHECK(!SPTAG::COMMON::TerminationPredictor::Calibrate(traces, 1.01f, model, threshold, recall, checked));
+
+    BOOST_CHECK(SPTAG::ErrorCode::Fail == vecIndex->SetParameter("AdaptiveModel", "1,2,3"));
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SetParameter("AdaptiveModel", model));
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SetParameter("AdaptiveThreshold", SPTAG::Helper::Convert::ConvertToString(threshold)));
+    BOOST_CHECK(SPTAG::ErrorCode::Fail == vecIndex->SetParameter("AdaptiveThreshold", "1"));
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SetParameter("AdaptiveThreshold", SPTAG::Helper::Convert::ConvertToString(threshold)));
+
+    // Stopped searches still agree between single and batch search and keep close to the calibrated recall.
+    std::vector<SPTAG::QueryResult> results(q, SPTAG::QueryResult(nullptr, k, false));
+    for (SPTAG::SizeType i = 0; i < q; i++) results[i].SetTarget(query.data() + i * m);
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SearchIndexBatch(results.data(), q));
+    float adaptiveRecall = 0;
+    for (SPTAG::SizeType i = 0; i < q; i++)
+    {
+        SPTAG::QueryResult single(query.data() + i * m, k, false);
+        BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SearchIndex(single));
+        for (int j = 0; j < k; j++)
+        {
+            BOOST_CHECK_EQUAL(single.GetResult(j)->VID, results[i].GetResult(j)->VID);
+            adaptiveRecall += (float)truth[i].count(single.GetResult(j)->VID) / (q * k);
+        }
+    }
+    BOOST_CHECK(adaptiveRecall >= fullRecall * 0.95f - 0.02f);
+}
+
+// Range search must grow past its initial buffer to return whole clusters of near duplicates.
+template <typename T>
+void TestRangeSearch(SPTAG::IndexAlgoType algo)
+{
+    SPTAG::SizeType random = 2000, clusters = 20, duplicates = 150;
+    SPTAG::SizeType n = random + clusters * (duplicates + 1);
+    SPTAG::DimensionType m = 32;
+    std::vector<T> vec(n * m);
+    for (SPTAG::SizeType i = 0; i < random * m; i++) vec[i] = (T)(std::rand() / (float)RAND_MAX * 2 - 1);
+    for (SPTAG::SizeType c = 0; c < clusters; c++)
+    {
+        T* center = vec.data() + (random + c * (duplicates + 1)) * m;
+        for (SPTAG::DimensionType j = 0; j < m; j++) center[j] = (T)(std::rand() / (float)RAND_MAX * 2 - 1);
+        for (SPTAG::SizeType d = 1; d <= duplicates; d++)
+            for (SPTAG::DimensionType j = 0; j < m; j++) center[d * m + j] = center[j] + (T)(std::rand() / (float)RAND_MAX * 0.02f - 0.01f);
+    }
+
+    std::shared_ptr<SPTAG::VectorSet> vecset(new SPTAG::BasicVectorSet(
+        SPTAG::ByteArray((std::uint8_t*)vec.data(), sizeof(T) * n * m, false),
+        SPTAG::GetEnumValueType<T>(), m, n));
+    std::shared_ptr<SPTAG::VectorIndex> vecIndex = SPTAG::VectorIndex::CreateInstance(algo, SPTAG::GetEnumValueType<T>());
+    BOOST_CHECK(nullptr != vecIndex);
+    vecIndex->SetParameter("DistCalcMethod", "L2");
+    vecIndex->SetParameter("NumberOfThreads", "16");
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->BuildIndex(vecset, nullptr));
+
+    int found = 0;
+    for (SPTAG::SizeType c = 0; c < clusters; c++)
+    {
+        SPTAG::SizeType first = random + c * (duplicates + 1);
+        SPTAG::QueryResult result(vec.data() + first * m, 0, false);
+        BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SearchIndexRange(result, 0.01f, 1000));
+        // Past the first buffer, so it had to grow; the graph may not reach every duplicate.
+        BOOST_CHECK(result.GetResultNum() > 64);
+        found += result.GetResultNum();
+        for (int i = 0; i < result.GetResultNum(); i++)
+        {
+            BOOST_CHECK(result.GetResult(i)->VID >= first && result.GetResult(i)->VID <= first + duplicates);
+            if (i > 0) BOOST_CHECK(result.GetResult(i)->Dist >= result.GetResult(i - 1)->Dist);
+        }
+
+        // A cap keeps the closest vectors.
+        SPTAG::QueryResult capped(vec.data() + first * m, 0, false);
+        BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SearchIndexRange(capped, 0.01f, 10));
+        BOOST_CHECK_EQUAL(capped.GetResultNum(), 10);
+        for (int i = 0; i < capped.GetResultNum() && i < result.GetResultNum(); i++) BOOST_CHECK_EQUAL(capped.GetResult(i)->Dist, result.GetResult(i)->Dist);
+    }
+    BOOST_CHECK(found >= clusters * (duplicates + 1) * 0.9);
+
+    // Radii around random queries: within the first buffer, the ball is what a k-NN search finds inside it.
+    std::vector<T> query(m);
+    for (int q = 0; q < 20; q++)
+    {
+        for (T& v : query) v = (T)(std::rand() / (float)RAND_MAX * 2 - 1);
+        std::vector<float> dists(n);
+        for (SPTAG::SizeType j = 0; j < n; j++) dists[j] = vecIndex->ComputeDistance(query.data(), vec.data() + j * m);
+        std::vector<float> sorted(dists);
+        std::nth_element(sorted.begin(), sorted.begin() + 20, sorted.end());
+        float radius = sorted[20];
+
+        SPTAG::QueryResult knn(query.data(), 64, false);
+        BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SearchIndex(knn));
+        int inside = 0;
+        for (int i = 0; i < knn.GetResultNum(); i++) if (knn.GetResult(i)->VID >= 0 && knn.GetResult(i)->Dist <= radius) inside++;
+
+        SPTAG::QueryResult result(query.data(), 0, false);
+        BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SearchIndexRange(result, radius, n));
+        BOOST_CHECK_EQUAL(result.GetResultNum(), inside);
+        for (int i = 0; i < result.GetResultNum(); i++) BOOST_CHECK(dists[result.GetResult(i)->VID] <= radius);
+
+        SPTAG::QueryResult empty(query.data(), 5, false);
+        BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SearchIndexRange(empty, *std::min_element(dists.begin(), dists.end()) / 2, n));
+        BOOST_CHECK_EQUAL(empty.GetResultNum(), 0);
+    }
+}
+
+// Filtered searches only return allowed vectors, still fill all k results, and keep their attributes across a save.
+template <typename T>
+void TestFilteredSearch(SPTAG::IndexAlgoType algo)
+{
+    SPTAG::SizeType n = 2000;
+    SPTAG::DimensionType m = 16;
+    int k = 10;
+    std::vector<T> vec(n * m);
+    for (auto& v : vec) v = (T)(std::rand() / (float)RAND_MAX * 2 - 1);
+
+    std::shared_ptr<SPTAG::VectorSet> vecset(new SPTAG::BasicVectorSet(
+        SPTAG::ByteArray((std::uint8_t*)vec.data(), sizeof(T) * n * m, false),
+        SPTAG::GetEnumValueType<T>(), m, n));
+    std::shared_ptr<SPTAG::VectorIndex> vecIndex = SPTAG::VectorIndex::CreateInstance(algo, SPTAG::GetEnumValueType<T>());
+    BOOST_CHECK(nullptr != vecIndex);
+    vecIndex->SetParameter("DistCalcMethod", "L2");
+    vecIndex->SetParameter("NumberOfThreads", "16");
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->BuildIndex(vecset, nullptr));
+
+    const char* markets[] = { "en-us", "fr-fr", "de-de", "ja-jp" };
+    for (SPTAG::SizeType i = 0; i < n; i++) BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SetAttribute(i, "market", markets[i % 4]));
+    BOOST_CHECK(SPTAG::ErrorCode::Success != vecIndex->SetAttribute(n, "market", "en-us"));
+
+    SPTAG::SearchFilter unknown;
+    BOOST_CHECK(SPTAG::ErrorCode::Success != vecIndex->AddAttributeFilter(unknown, "language", { "en" }));
+
+    auto check = [&](std::shared_ptr<SPTAG::VectorIndex>& index, const SPTAG::SearchFilter& filter, std::function<bool(SPTAG::SizeType)> allowed) {
+        int hits = 0;
+        std::vector<T> query(m);
+        for (int q = 0; q < 20; q++)
+        {
+            for (T& v : query) v = (T)(std::rand() / (float)RAND_MAX * 2 - 1);
+            std::vector<std::pair<float, SPTAG::SizeType>> truth;
+            for (SPTAG::SizeType j = 0; j < n; j++)
+                if (allowed(j)) truth.emplace_back(index->ComputeDistance(query.data(), vec.data() + j * m), j);
+            std::partial_sort(truth.begin(), truth.begin() + k, truth.end());
+
+            SPTAG::QueryResult result(query.data(), k, false);
+            BOOST_CHECK(SPTAG::ErrorCode::Success == index->SearchIndexFiltered(result, filter));
+            for (int i = 0; i < k; i++)
+            {
+                SPTAG::SizeType vid = result.GetResult(i)->VID;
+                BOOST_CHECK(vid >= 0 && allowed(vid));
+                for (int j = 0; j < k; j++) if (truth[j].second == vid) hits++;
+            }
+        }
+        BOOST_CHECK(hits >= 20 * k * 0.8);
+    };
+
+    SPTAG::SearchFilter byMarket;
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->AddAttributeFilter(byMarket, "market", { "en-us", "de-de", "xx-xx" }));
+    check(vecIndex, byMarket, [](SPTAG::SizeType id) { return id % 2 == 0; });
+
+    SPTAG::SearchFilter byList;
+    for (SPTAG::SizeType i = 0; i < n; i += 40) byList.Allow(i);
+    check(vecIndex, byList, [](SPTAG::SizeType id) { return id % 40 == 0; });
+
+    SPTAG::SearchFilter combined;
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->AddAttributeFilter(combined, "market", { "fr-fr" }));
+    combined.SetPredicate([](SPTAG::SizeType id) { return id < 1000; });
+    check(vecIndex, combined, [](SPTAG::SizeType id) { return id % 4 == 1 && id < 1000; });
+
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SaveIndex("testfiltered"));
+    std::shared_ptr<SPTAG::VectorIndex> loaded;
+    BOOST_CHECK(SPTAG::ErrorCode::Success == SPTAG::VectorIndex::LoadIndex("testfiltered", loaded));
+    BOOST_CHECK(loaded->GetAttribute(5, "market") == "fr-fr");
+    BOOST_CHECK(loaded->GetAttribute(5, "language").empty());
+    SPTAG::SearchFilter reloaded;
+    BOOST_CHECK(SPTAG::ErrorCode::Success == loaded->AddAttributeFilter(reloaded, "market", { "ja-jp" }));
+    check(loaded, reloaded, [](SPTAG::SizeType id) { return id % 4 == 3; });
+}
+
+// Pages from a search iterator hold the nearest neighbors without repeats, and idle iterators lose their workspace.
+template <typename T>
+void TestSearchIterator(SPTAG::IndexAlgoType algo)
+{
+    SPTAG::SizeType n = 2000;
+    SPTAG::DimensionType m = 16;
+    int pages = 5, pageSize = 10;
+    std::vector<T> vec(n * m);
+    for (auto& v : vec) v = (T)(std::rand() / (float)RAND_MAX * 2 - 1);
+
+    std::shared_ptr<SPTAG::VectorSet> vecset(new SPTAG::BasicVectorSet(
+        SPTAG::ByteArray((std::uint8_t*)vec.data(), sizeof(T) * n * m, false),
+        SPTAG::GetEnumValueType<T>(), m, n));
+    std::shared_ptr<SPTAG::VectorIndex> vecIndex = SPTAG::VectorIndex::CreateInstance(algo, SPTAG::GetEnumValueType<T>());
+    BOOST_CHECK(nullptr != vecIndex);
+    vecIndex->SetParameter("DistCalcMethod", "L2");
+    vecIndex->SetParameter("NumberOfThreads", "4");
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->BuildIndex(vecset, nullptr));
+
+    int hits = 0;
+    std::vector<T> query(m);
+    for (int q = 0; q < 20; q++)
+    {
+        for (T& v : query) v = (T)(std::rand() / (float)RAND_MAX * 2 - 1);
+        std::vector<std::pair<float, SPTAG::SizeType>> truth(n);
+        for (SPTAG::SizeType j = 0; j < n; j++) truth[j] = std::make_pair(vecIndex->ComputeDistance(query.data(), vec.data() + j * m), j);
+        std::partial_sort(truth.begin(), truth.begin() + pages * pageSize, truth.end());
+
+        std::shared_ptr<SPTAG::ResultIterator> iterator;
+        BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->BeginSearch(query.data(), iterator));
+        std::set<SPTAG::SizeType> seen;
+        for (int p = 0; p < pages; p++)
+        {
+            SPTAG::QueryResult page(query.data(), pageSize, false);
+            BOOST_CHECK(SPTAG::ErrorCode::Success == iterator->Next(page));
+            for (int i = 0; i < pageSize; i++)
+            {
+                SPTAG::SizeType vid = page.GetResult(i)->VID;
+                BOOST_CHECK(vid >= 0 && seen.insert(vid).second);
+                for (int j = 0; j < pages * pageSize; j++) if (truth[j].second == vid) hits++;
+            }
+        }
+        iterator->Close();
+        SPTAG::QueryResult closed(query.data(), pageSize, false);
+        BOOST_CHECK(SPTAG::ErrorCode::SearchExpired == iterator->Next(closed));
+    }
+    BOOST_CHECK(hits >= 20 * pages * pageSize * 0.9);
+
+    // More idle iterators than pooled workspaces: the next search to run out reclaims theirs.
+    vecIndex->SetParameter("IteratorTimeout", "1");
+    std::vector<std::shared_ptr<SPTAG::ResultIterator>> idle(8);
+    for (auto& iterator : idle) BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->BeginSearch(query.data(), iterator));
+    std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+    SPTAG::QueryResult result(query.data(), pageSize, false);
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SearchIndex(result));
+    BOOST_CHECK(SPTAG::ErrorCode::SearchExpired == idle[0]->Next(result));
+}
+
+template <typename T>
+void TestSearchStats(SPTAG::IndexAlgoType algo)
+{
+    SPTAG::SizeType n = 2000;
+    SPTAG::DimensionType m = 16;
+    int k = 10;
+    std::vector<T> vec(n * m);
+    for (auto& v : vec) v = (T)(std::rand() / (float)RAND_MAX * 2 - 1);
+
+    std::shared_ptr<SPTAG::VectorSet> vecset(new SPTAG::BasicVectorSet(
+        SPTAG::ByteArray((std::uint8_t*)vec.data(), sizeof(T) * n * m, false),
+        SPTAG::GetEnumValueType<T>(), m, n));
+    std::shared_ptr<SPTAG::VectorIndex> vecIndex = SPTAG::VectorIndex::CreateInstance(algo, SPTAG::GetEnumValueType<T>());
+    BOOST_CHECK(nullptr != vecIndex);
+    vecIndex->SetParameter("DistCalcMethod", "L2");
+    vecIndex->SetParameter("NumberOfThreads", "4");
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->BuildIndex(vecset, nullptr));
+
+    std::vector<T> query(m);
+    for (T& v : query) v = (T)(std::rand() / (float)RAND_MAX * 2 - 1);
+    SPTAG::QueryResult result(query.data(), k, false);
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SearchIndex(result));
+    const SPTAG::SearchStats& stats = result.GetStats();
+    BOOST_CHECK(stats.m_distanceEvaluations >= k);
+    BOOST_CHECK(stats.m_graphHops > 0);
+    BOOST_CHECK(stats.m_treeNodesVisited > 0);
+    BOOST_CHECK(stats.m_termination != SPTAG::TerminationReason::Undefined);
+    BOOST_CHECK(stats.m_wallTimeMs >= 0);
+
+    SPTAG::QueryResult copy(result);
+    BOOST_CHECK(copy.GetStats().m_distanceEvaluations == stats.m_distanceEvaluations);
+    BOOST_CHECK(copy.GetStats().m_termination == stats.m_termination);
+    copy.Reset();
+    BOOST_CHECK(copy.GetStats().m_distanceEvaluations == 0);
+
+    // The range search charges every k-NN round it ran.
+    SPTAG::QueryResult range(query.data(), 0, false);
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SearchIndexRange(range, SPTAG::MaxDist, 200));
+    BOOST_CHECK(range.GetStats().m_distanceEvaluations >= 200);
+    BOOST_CHECK(range.GetStats().m_termination != SPTAG::TerminationReason::Undefined);
+
+    vecIndex->SetParameter("SearchGroupSize", "4");
+    std::vector<SPTAG::QueryResult> batch(8, SPTAG::QueryResult(query.data(), k, false));
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SearchIndexBatch(batch.data(), (int)batch.size()));
+    for (const auto& res : batch)
+    {
+        BOOST_CHECK(res.GetStats().m_distanceEvaluations == stats.m_distanceEvaluations);
+        BOOST_CHECK(res.GetStats().m_graphHops == stats.m_graphHops);
+        BOOST_CHECK(res.GetStats().m_termination == stats.m_termination);
+    }
+}
+
+template <typename T>
+void TestDeadlineSearch(SPTAG::IndexAlgoType algo)
+{
+    SPTAG::SizeType n = 2000;
+    SPTAG::DimensionType m = 16;
+    int k = 10;
+    std::vector<T> vec(n * m);
+    for (auto& v : vec) v = (T)(std::rand() / (float)RAND_MAX * 2 - 1);
+
+    std::shared_ptr<SPTAG::VectorSet> vecset(new SPTAG::BasicVectorSet(
+        SPTAG::ByteArray((std::uint8_t*)vec.data(), sizeof(T) * n * m, false),
+        SPTAG::GetEnumValueType<T>(), m, n));
+    std::shared_ptr<SPTAG::VectorIndex> vecIndex = SPTAG::VectorIndex::CreateInstance(algo, SPTAG::GetEnumValueType<T>());
+    BOOST_CHECK(nullptr != vecIndex);
+    vecIndex->SetParameter("DistCalcMethod", "L2");
+    vecIndex->SetParameter("NumberOfThreads", "4");
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->BuildIndex(vecset, nullptr));
+
+    std::vector<T> query(m);
+    for (T& v : query) v = (T)(std::rand() / (float)RAND_MAX * 2 - 1);
+    SPTAG::QueryResult full(query.data(), k, false);
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SearchIndex(full));
+    BOOST_CHECK(!full.IsTruncated());
+
+    // A far deadline changes nothing.
+    SPTAG::QueryResult relaxed(query.data(), k, false);
+    relaxed.SetDeadline(std::chrono::steady_clock::now() + std::chrono::hours(1));
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SearchIndex(relaxed));
+    BOOST_CHECK(!relaxed.IsTruncated());
+    for (int i = 0; i < k; i++) BOOST_CHECK(relaxed.GetResult(i)->VID == full.GetResult(i)->VID);
+
+    // A passed deadline stops the search at its first check, with sorted results.
+    auto passed = std::chrono::steady_clock::now() - std::chrono::seconds(1);
+    SPTAG::QueryResult truncated(query.data(), k, false);
+    truncated.SetDeadline(passed);
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SearchIndex(truncated));
+    BOOST_CHECK(truncated.IsTruncated());
+    BOOST_CHECK(truncated.GetStats().m_graphHops < full.GetStats().m_graphHops);
+    BOOST_CHECK(truncated.GetResult(0)->VID >= 0);
+    for (int i = 1; i < k && truncated.GetResult(i)->VID >= 0; i++)
+        BOOST_CHECK(truncated.GetResult(i - 1)->Dist <= truncated.GetResult(i)->Dist);
+
+    // The deadline outlives Reset, and the range search stops doubling once it passes.
+    truncated.Reset();
+    BOOST_CHECK(!truncated.IsTruncated());
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SearchIndexRange(truncated, SPTAG::MaxDist, 1000));
+    BOOST_CHECK(truncated.IsTruncated());
+    BOOST_CHECK(truncated.GetResultNum() < 1000);
+
+    vecIndex->SetParameter("SearchGroupSize", "4");
+    std::vector<SPTAG::QueryResult> batch(8, SPTAG::QueryResult(query.data(), k, false));
+    for (int i = 0; i < (int)batch.size(); i += 2) batch[i].SetDeadline(passed);
+    BOOST_CHECK(SPTAG::ErrorCode::Success == vecIndex->SearchIndexBatch(batch.data(), (int)batch.size()));
+    for (int i = 0; i < (int)batch.size(); i++)
+    {
+        BOOST_CHECK(batch[i].IsTruncated() == (i % 2 == 0));
+        BOOST_CHECK(batch[i].GetResult(0)->VID >= 0);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE (AlgoTest)
 
 BOOST_AUTO_TEST_CASE(KDTTest)
@@ -188,4 +1014,175 @@ BOOST_AUTO_TEST_CASE(BKTTest)
     Test<float>(SPTAG::IndexAlgoType::BKT, "L2");
 }
 
+BOOST_AUTO_TEST_CASE(InnerProductTest)
+{
+    TestInnerProduct<float>(SPTAG::IndexAlgoType::BKT);
+    TestInnerProduct<float>(SPTAG::IndexAlgoType::KDT);
+}
+
+BOOST_AUTO_TEST_CASE(CachedNormTest)
+{
+    TestCachedNorms<float>(SPTAG::IndexAlgoType::BKT, "Cosine");
+    TestCachedNorms<float>(SPTAG::IndexAlgoType::BKT, "InnerProduct");
+    TestCachedNorms<float>(SPTAG::IndexAlgoType::KDT, "InnerProduct");
+}
+
+BOOST_AUTO_TEST_CASE(EarlyAbandonTest)
+{
+    TestEarlyAbandon<float>(SPTAG::IndexAlgoType::BKT, SPTAG::DistCalcMethod::L2);
+    TestEarlyAbandon<float>(SPTAG::IndexAlgoType::BKT, SPTAG::DistCalcMethod::InnerProduct);
+}
+
+BOOST_AUTO_TEST_CASE(ProductQuantizationTest)
+{
+    TestProductQuantization<float>(SPTAG::IndexAlgoType::BKT, SPTAG::DistCalcMethod::L2);
+    TestProductQuantization<float>(SPTAG::IndexAlgoType::BKT, SPTAG::DistCalcMethod::InnerProduct);
+}
+
+BOOST_AUTO_TEST_CASE(ScalarQuantizationTest)
+{
+    TestScalarQuantization<float>(SPTAG::IndexAlgoType::BKT, SPTAG::DistCalcMethod::L2);
+    TestScalarQuantization<float>(SPTAG::IndexAlgoType::BKT, SPTAG::DistCalcMethod::InnerProduct);
+}
+
+BOOST_AUTO_TEST_CASE(BinaryVectorTest)
+{
+    TestBinaryVectors(SPTAG::IndexAlgoType::BKT);
+    TestBinaryVectors(SPTAG::IndexAlgoType::KDT);
+}
+
+BOOST_AUTO_TEST_CASE(BatchSearchTest)
+{
+    TestBatchSearch<float>(SPTAG::IndexAlgoType::KDT, {});
+    TestBatchSearch<float>(SPTAG::IndexAlgoType::BKT, {});
+    TestBatchSearch<float>(SPTAG::IndexAlgoType::BKT, { { "DistCalcMethod", "InnerProduct" }, { "EarlyAbandonDimension", "32" } });
+    TestBatchSearch<float>(SPTAG::IndexAlgoType::BKT, { { "SQ8", "true" }, { "SQ8RerankNumber", "50" } });
+}
+
+BOOST_AUTO_TEST_CASE(MinMaxHeapTest)
+{
+    // Same pops and evictions as an exact bounded multiset, before and after the heap first fills up.
+    for (int length : { 1, 2, 3, 7, 64, 1000 })
+    {
+        SPTAG::COMMON::MinMaxHeap<SPTAG::COMMON::HeapCell> heap(length);
+        std::multiset<float> expected;
+        for (int i = 0; i < 20000; i++)
+        {
+            if (i == 10000)
+            {
+                heap.clear();
+                expected.clear();
+            }
+            if (std::rand() % 3 != 0)
+            {
+                float dist = (float)(std::rand() % 1000);
+                heap.insert(SPTAG::COMMON::HeapCell(i, dist));
+                if ((int)expected.size() < length) expected.insert(dist);
+                else if (dist <= *expected.rbegin())
+                {
+                    expected.erase(std::prev(expected.end()));
+                    expected.insert(dist);
+                }
+            }
+            else if (!expected.empty())
+            {
+                BOOST_CHECK_EQUAL(heap.pop().distance, *expected.begin());
+                expected.erase(expected.begin());
+            }
+            BOOST_CHECK_EQUAL(heap.size(), (int)expected.size());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(WorkSpacePoolTest)
+{
+    auto pool = std::make_shared<SPTAG::COMMON::WorkSpacePool>(1024, 10000, 12);
+    pool->Init(2);
+
+    // A thread gets back the workspace it returned last.
+    auto workSpace = pool->Rent();
+    SPTAG::COMMON::WorkSpace* cached = workSpace.get();
+    pool->Return(std::move(workSpace));
+    workSpace = pool->Rent();
+    BOOST_CHECK(workSpace.get() == cached);
+
+    // A workspace rented before the pool was rebuilt for a new MaxCheck never comes out of the new pool.
+    auto rebuilt = std::make_shared<SPTAG::COMMON::WorkSpacePool>(4096, 10000, 12);
+    rebuilt->Init(2);
+    rebuilt->Return(std::move(workSpace));
+    pool.reset();
+    for (int i = 0; i < 4; i++)
+    {
+        workSpace = rebuilt->Rent();
+        BOOST_CHECK_EQUAL(workSpace->m_iMaxCheck, 4096);
+        rebuilt->Return(std::move(workSpace));
+    }
+
+    std::vector<std::thread> threads;
+    std::atomic<int> wrong(0);
+    for (int t = 0; t < 8; t++)
+    {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < 10000; i++)
+            {
+                auto first = rebuilt->Rent();
+                auto second = rebuilt->Rent();
+                if (first == nullptr || second == nullptr || first.get() == second.get() || first->m_iMaxCheck != 4096) wrong++;
+                rebuilt->Return(std::move(second));
+                rebuilt->Return(std::move(first));
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    BOOST_CHECK_EQUAL(wrong.load(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(EpochVisitedSetTest)
+{
+    TestEpochVisitedSet<float>(SPTAG::IndexAlgoType::BKT);
+    TestEpochVisitedSet<float>(SPTAG::IndexAlgoType::KDT);
+}
+
+BOOST_AUTO_TEST_CASE(AdaptiveTerminationTest)
+{
+    TestAdaptiveTermination<float>(SPTAG::IndexAlgoType::BKT);
+    TestAdaptiveTermination<float>(SPTAG::IndexAlgoType::KDT);
+}
+
+BOOST_AUTO_TEST_CASE(RangeSearchTest)
+{
+    TestRangeSearch<float>(SPTAG::IndexAlgoType::BKT);
+    TestRangeSearch<float>(SPTAG::IndexAlgoType::KDT);
+}
+
+BOOST_AUTO_TEST_CASE(FilteredSearchTest)
+{
+    TestFilteredSearch<float>(SPTAG::IndexAlgoType::BKT);
+    TestFilteredSearch<float>(SPTAG::IndexAlgoType::KDT);
+}
+
+BOOST_AUTO_TEST_CASE(SearchIteratorTest)
+{
+    TestSearchIterator<float>(SPTAG::IndexAlgoType::BKT);
+    TestSearchIterator<float>(SPTAG::IndexAlgoType::KDT);
+}
+
+BOOST_AUTO_TEST_CASE(SearchStatsTest)
+{
+    TestSearchStats<float>(SPTAG::IndexAlgoType::BKT);
+    TestSearchStats<float>(SPTAG::IndexAlgoType::KDT);
+}
+
+BOOST_AUTO_TEST_CASE(DeadlineSearchTest)
+{
+    TestDeadlineSearch<float>(SPTAG::IndexAlgoType::BKT);
+    TestDeadlineSearch<float>(SPTAG::IndexAlgoType::KDT);
+}
+
+BOOST_AUTO_TEST_CASE(HalfPrecisionTest)
+{
+    TestHalfPrecision<SPTAG::Float16>(SPTAG::IndexAlgoType::BKT);
+    TestHalfPrecision<SPTAG::BFloat16>(SPTAG::IndexAlgoType::KDT);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
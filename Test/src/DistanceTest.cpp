@@ -4,6 +4,10 @@
 #include <bitset>
 #include "inc/Test.h"
 #include "inc/Core/Common/DistanceUtils.h"
+#include "inc/Core/Common/CommonUtils.h"
+
+#include <cmath>
+#include <vector>
 
 template<typename T>
 static float ComputeCosineDistance(const T *pX, const T *pY, SPTAG::DimensionType length) {
@@ -46,6 +50,210 @@ void test(int high) {
     delete[] Y;
 }
 
+// Checks every kernel the selector can pick against a double precision reference. The error bound
+// scales with sum(|x * y|) since the cosine result may cancel down to almost nothing.
+template<typename T>
+void testAllLevels(int high, int low) {
+    using SPTAG::COMMON::InstructionSet;
+    InstructionSet::Level original = InstructionSet::GetMaxLevel();
+    InstructionSet::Level levels[] = { InstructionSet::Level::NONE, InstructionSet::Level::AVX, InstructionSet::Level::AVX2,
+        InstructionSet::Level::AVX512, InstructionSet::Level::AVX512VNNI, InstructionSet::Level::AVX512BF16 };
+    SPTAG::DimensionType dimensions[] = { 1, 15, 64, 100, 129, 1000 };
+    double base = (double)SPTAG::COMMON::Utils::GetBase<T>() * SPTAG::COMMON::Utils::GetBase<T>();
+
+    for (SPTAG::DimensionType dimension : dimensions) {
+        std::vector<T> X(dimension), Y(dimension);
+        double l2 = 0, dot = 0, scale = 1;
+        for (SPTAG::DimensionType i = 0; i < dimension; i++) {
+            X[i] = random<T>(high, low);
+            Y[i] = random<T>(high, low);
+            double diff = (double)X[i] - (double)Y[i];
+            l2 += diff * diff;
+            dot += (double)X[i] * (double)Y[i];
+            scale += std::abs((double)X[i] * (double)Y[i]) + diff * diff;
+        }
+        for (InstructionSet::Level level : levels) {
+            InstructionSet::SetMaxLevel(level);
+            BOOST_CHECK_SMALL(SPTAG::COMMON::DistanceUtils::ComputeDistance(X.data(), Y.data(), dimension, SPTAG::DistCalcMethod::L2) - l2, 1e-5 * scale);
+            BOOST_CHECK_SMALL(SPTAG::COMMON::DistanceUtils::ComputeDistance(X.data(), Y.data(), dimension, SPTAG::DistCalcMethod::Cosine) - (base - dot), 1e-5 * (scale + base));
+            BOOST_CHECK_SMALL(SPTAG::COMMON::DistanceUtils::ComputeDistance(X.data(), Y.data(), dimension, SPTAG::DistCalcMethod::InnerProduct) + dot, 1e-5 * scale);
+        }
+    }
+    InstructionSet::SetMaxLevel(original);
+}
+
+// The batch kernels must agree with the single-candidate kernel of the same level for every candidate.
+template<typename T>
+void testBatch(int high, int low) {
+    using SPTAG::COMMON::InstructionSet;
+    InstructionSet::Level original = InstructionSet::GetMaxLevel();
+    InstructionSet::Level levels[] = { InstructionSet::Level::NONE, InstructionSet::Level::AVX2,
+        InstructionSet::Level::AVX512, InstructionSet::Level::AVX512VNNI, InstructionSet::Level::AVX512BF16 };
+    SPTAG::DimensionType dimensions[] = { 3, 64, 100, 768 };
+    SPTAG::DistCalcMethod methods[] = { SPTAG::DistCalcMethod::L2, SPTAG::DistCalcMethod::Cosine, SPTAG::DistCalcMethod::InnerProduct };
+    const int count = 11;
+
+    for (SPTAG::DimensionType dimension : dimensions) {
+        std::vector<T> data((count + 1) * dimension);
+        for (T& v : data) v = random<T>(high, low);
+        std::vector<const T*> candidates(count);
+        for (int i = 0; i < count; i++) candidates[i] = data.data() + (i + 1) * dimension;
+
+        for (InstructionSet::Level level : levels) {
+            InstructionSet::SetMaxLevel(level);
+            for (SPTAG::DistCalcMethod method : methods) {
+                float out[count];
+                SPTAG::COMMON::DistanceUtils::ComputeDistanceBatch(data.data(), candidates.data(), count, dimension, out, method);
+                for (int i = 0; i < count; i++) {
+                    float expected = SPTAG::COMMON::DistanceUtils::ComputeDistance(data.data(), candidates[i], dimension, method);
+                    BOOST_CHECK_SMALL(out[i] - expected, 1e-4f * (std::abs(expected) + 1));
+                }
+            }
+        }
+    }
+    InstructionSet::SetMaxLevel(original);
+}
+
+// The compile-time dimension kernels must agree with the generic ones, single and batched.
+void testFixedDimensions() {
+    using SPTAG::COMMON::InstructionSet;
+    InstructionSet::Level original = InstructionSet::GetMaxLevel();
+    InstructionSet::Level levels[] = { InstructionSet::Level::NONE, InstructionSet::Level::AVX, InstructionSet::Level::AVX512 };
+    SPTAG::DistCalcMethod methods[] = { SPTAG::DistCalcMethod::L2, SPTAG::DistCalcMethod::Cosine, SPTAG::DistCalcMethod::InnerProduct };
+    const int count = 5;
+
+#define DefineFixedDimension(D) D,
+    SPTAG::DimensionType dimensions[] = { FIXED_DIMENSIONS(DefineFixedDimension) };
+#undef DefineFixedDimension
+    for (SPTAG::DimensionType dimension : dimensions) {
+        std::vector<float> data((count + 1) * dimension);
+        for (float& v : data) v = random<float>(1, -1);
+        std::vector<const float*> candidates(count);
+        for (int i = 0; i < count; i++) candidates[i] = data.data() + (i + 1) * dimension;
+
+        for (InstructionSet::Level level : levels) {
+            InstructionSet::SetMaxLevel(level);
+            for (SPTAG::DistCalcMethod method : methods) {
+                auto fixed = SPTAG::COMMON::DistanceCalcSelector<float>(method, dimension);
+                auto fixedBatch = SPTAG::COMMON::DistanceBatchCalcSelector<float>(method, dimension);
+                float out[count];
+                fixedBatch(data.data(), candidates.data(), count, dimension, out);
+                for (int i = 0; i < count; i++) {
+                    float expected = SPTAG::COMMON::DistanceUtils::ComputeDistance(data.data(), candidates[i], dimension, method);
+                    BOOST_CHECK_SMALL(fixed(data.data(), candidates[i], dimension) - expected, 1e-4f * (std::abs(expected) + 1));
+                    BOOST_CHECK_SMALL(out[i] - expected, 1e-4f * (std::abs(expected) + 1));
+                }
+            }
+        }
+    }
+    InstructionSet::SetMaxLevel(original);
+}
+
+// The gather based ADC kernels must sum the same table entries as the scalar loop, including the
+// subvectors left over after the last full register.
+void testADC() {
+    using SPTAG::COMMON::InstructionSet;
+    InstructionSet::Level original = InstructionSet::GetMaxLevel();
+    InstructionSet::Level levels[] = { InstructionSet::Level::NONE, InstructionSet::Level::AVX2, InstructionSet::Level::AVX512 };
+    SPTAG::DimensionType subvectors[] = { 1, 7, 8, 16, 30, 64 };
+    const int width = SPTAG::COMMON::DistanceUtils::PQADCTableWidth, count = 5;
+
+    for (SPTAG::DimensionType m : subvectors) {
+        std::vector<float> table(m * width);
+        for (float& v : table) v = random<float>(1, -1);
+        std::vector<std::uint8_t> codes(count * m);
+        for (std::uint8_t& c : codes) c = (std::uint8_t)random<int>(width);
+        std::vector<const std::uint8_t*> pCodes(count);
+        for (int i = 0; i < count; i++) pCodes[i] = codes.data() + i * m;
+
+        for (InstructionSet::Level level : levels) {
+            InstructionSet::SetMaxLevel(level);
+            float out[count];
+            SPTAG::COMMON::ADCBatchCalcSelector()(table.data(), pCodes.data(), count, m, out);
+            for (int i = 0; i < count; i++) {
+                float expected = SPTAG::COMMON::DistanceUtils::ComputeADCDistance(table.data(), pCodes[i], m);
+                BOOST_CHECK_SMALL(SPTAG::COMMON::ADCCalcSelector()(table.data(), pCodes[i], m) - expected, 1e-4f);
+                BOOST_CHECK_SMALL(out[i] - expected, 1e-4f);
+            }
+        }
+    }
+    InstructionSet::SetMaxLevel(original);
+}
+
+// Hamming distances count differing bits of the raw bytes for every value type; PackedBits also maps
+// L2 to the Hamming distance and the dot product to the number of common set bits.
+template<typename T>
+void testHamming() {
+    using SPTAG::COMMON::InstructionSet;
+    InstructionSet::Level original = InstructionSet::GetMaxLevel();
+    InstructionSet::Level levels[] = { InstructionSet::Level::NONE, InstructionSet::Level::AVX2,
+        InstructionSet::Level::AVX512, InstructionSet::Level::AVX512VNNI };
+    SPTAG::DimensionType dimensions[] = { 1, 7, 8, 31, 64, 65, 200 };
+    const int count = 5;
+
+    for (SPTAG::DimensionType dimension : dimensions) {
+        std::vector<T> data((count + 1) * dimension);
+        std::uint8_t* bytes = (std::uint8_t*)data.data();
+        for (size_t i = 0; i < data.size() * sizeof(T); i++) bytes[i] = (std::uint8_t)random<int>(256);
+        std::vector<const T*> candidates(count);
+        for (int i = 0; i < count; i++) candidates[i] = data.data() + (i + 1) * dimension;
+
+        for (InstructionSet::Level level : levels) {
+            InstructionSet::SetMaxLevel(level);
+            float out[count];
+            SPTAG::COMMON::DistanceUtils::ComputeDistanceBatch(data.data(), candidates.data(), count, dimension, out, SPTAG::DistCalcMethod::Hamming);
+            for (int i = 0; i < count; i++) {
+                const std::uint8_t* x = (const std::uint8_t*)data.data();
+                const std::uint8_t* y = (const std::uint8_t*)candidates[i];
+                size_t hamming = 0, common = 0;
+                for (size_t j = 0; j < dimension * sizeof(T); j++) {
+                    hamming += std::bitset<8>(x[j] ^ y[j]).count();
+                    common += std::bitset<8>(x[j] & y[j]).count();
+                }
+                BOOST_CHECK_EQUAL(SPTAG::COMMON::DistanceUtils::ComputeDistance(data.data(), candidates[i], dimension, SPTAG::DistCalcMethod::Hamming), (float)hamming);
+                BOOST_CHECK_EQUAL(out[i], (float)hamming);
+                if (std::is_same<T, SPTAG::PackedBits>::value) {
+                    BOOST_CHECK_EQUAL(SPTAG::COMMON::DistanceUtils::ComputeDistance(data.data(), candidates[i], dimension, SPTAG::DistCalcMethod::L2), (float)hamming);
+                    BOOST_CHECK_EQUAL(SPTAG::COMMON::DistanceUtils::ComputeDistance(data.data(), candidates[i], dimension, SPTAG::DistCalcMethod::InnerProduct), -(float)common);
+                }
+            }
+        }
+    }
+    InstructionSet::SetMaxLevel(original);
+}
+
+// An abandoned bounded distance is a lower bound above the bound, an unabandoned one is exact.
+template<typename T>
+void testBounded(SPTAG::DistCalcMethod method)
+{
+    SPTAG::DimensionType dimension = 300;
+    std::vector<T> x(dimension), y(dimension);
+    for (SPTAG::DimensionType i = 0; i < dimension; i++) {
+        x[i] = random<T>(1, -1);
+        y[i] = random<T>(1, -1);
+    }
+    auto func = SPTAG::COMMON::DistanceCalcSelector<T>(method);
+    float exact = func(x.data(), y.data(), dimension);
+
+    std::vector<float> restNorms;
+    float chunkBase = (method == SPTAG::DistCalcMethod::Cosine) ? 1.0f : 0.0f, yNorm = 0;
+    if (method != SPTAG::DistCalcMethod::L2) {
+        SPTAG::COMMON::DistanceUtils::ComputeRestNorms(x.data(), dimension, chunkBase, func, restNorms);
+        yNorm = std::sqrt(chunkBase - func(y.data(), y.data(), dimension));
+    }
+    auto bounded = [&](float bound) {
+        if (method == SPTAG::DistCalcMethod::L2)
+            return SPTAG::COMMON::DistanceUtils::ComputeMonotoneDistanceBounded(x.data(), y.data(), dimension, bound, func);
+        return SPTAG::COMMON::DistanceUtils::ComputeDotDistanceBounded(x.data(), y.data(), dimension, bound, chunkBase, restNorms.data(), yNorm, func);
+    };
+
+    BOOST_CHECK_CLOSE_FRACTION(bounded(SPTAG::MaxDist), exact, 1e-4);
+    float bound = exact - std::abs(exact) * 0.5f - 1.0f;
+    float lowerBound = bounded(bound);
+    BOOST_CHECK_GT(lowerBound, bound);
+    BOOST_CHECK_LE(lowerBound, exact + 1e-4f);
+}
+
 BOOST_AUTO_TEST_SUITE(DistanceTest)
 
 BOOST_AUTO_TEST_CASE(TestDistanceComputation)
@@ -55,4 +263,68 @@ BOOST_AUTO_TEST_CASE(TestDistanceComputation)
     test<std::int16_t>(32767);
 }
 
+BOOST_AUTO_TEST_CASE(TestDistanceInstructionSetLevels)
+{
+    testAllLevels<float>(1, -1);
+    testAllLevels<std::int8_t>(127, -127);
+    testAllLevels<std::uint8_t>(255, 0);
+    testAllLevels<std::int16_t>(32767, -32767);
+    testAllLevels<SPTAG::Float16>(1, -1);
+    testAllLevels<SPTAG::BFloat16>(1, -1);
+}
+
+BOOST_AUTO_TEST_CASE(TestDistanceBatch)
+{
+    testBatch<float>(1, -1);
+    testBatch<std::int8_t>(127, -127);
+    testBatch<std::uint8_t>(255, 0);
+    testBatch<std::int16_t>(32767, -32767);
+    testBatch<SPTAG::Float16>(1, -1);
+    testBatch<SPTAG::BFloat16>(1, -1);
+}
+
+BOOST_AUTO_TEST_CASE(TestADCDistance)
+{
+    testADC();
+}
+
+BOOST_AUTO_TEST_CASE(TestHammingDistance)
+{
+    testHamming<SPTAG::PackedBits>();
+    testHamming<std::uint8_t>();
+    testHamming<float>();
+}
+
+BOOST_AUTO_TEST_CASE(TestFixedDimensionDistance)
+{
+    testFixedDimensions();
+}
+
+BOOST_AUTO_TEST_CASE(TestBoundedDistance)
+{
+    testBounded<float>(SPTAG::DistCalcMethod::L2);
+    testBounded<float>(SPTAG::DistCalcMethod::InnerProduct);
+    testBounded<float>(SPTAG::DistCalcMethod::Cosine);
+}
+
+BOOST_AUTO_TEST_CASE(TestHalfPrecisionConversion)
+{
+    BOOST_CHECK_EQUAL(SPTAG::Float16(1.0f).m_bits, 0x3C00);
+    BOOST_CHECK_EQUAL(SPTAG::Float16(-2.0f).m_bits, 0xC000);
+    BOOST_CHECK_EQUAL(SPTAG::Float16(65504.0f).m_bits, 0x7BFF);
+    BOOST_CHECK_EQUAL(SPTAG::Float16(65520.0f).m_bits, 0x7C00);
+    BOOST_CHECK_EQUAL(SPTAG::Float16(5.9604645e-08f).m_bits, 0x0001);
+    BOOST_CHECK_EQUAL(SPTAG::Float16(1.0f + 1.0f / 2048).m_bits, 0x3C00);
+    BOOST_CHECK_EQUAL(SPTAG::Float16(1.0f + 3.0f / 2048).m_bits, 0x3C02);
+    BOOST_CHECK(std::isnan((float)SPTAG::Float16(std::nanf(""))));
+    BOOST_CHECK_EQUAL((float)SPTAG::Float16(0.333333f), 0.33325195f);
+    BOOST_CHECK_EQUAL((float)SPTAG::Float16(6.0975552e-05f), 6.0975552e-05f);
+
+    BOOST_CHECK_EQUAL(SPTAG::BFloat16(1.0f).m_bits, 0x3F80);
+    BOOST_CHECK_EQUAL(SPTAG::BFloat16(1.0f + 1.0f / 256).m_bits, 0x3F80);
+    BOOST_CHECK_EQUAL(SPTAG::BFloat16(1.0f + 3.0f / 256).m_bits, 0x3F82);
+    BOOST_CHECK(std::isnan((float)SPTAG::BFloat16(std::nanf(""))));
+    BOOST_CHECK_EQUAL((float)SPTAG::BFloat16(-3.5f), -3.5f);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
@@ -21,19 +21,27 @@ public:
 
     void SetTimeoutMilliseconds(int p_timeout);
 
+    // The server stops searching after p_deadline milliseconds and returns what it found so far; 0 for no limit.
+    void SetSearchDeadlineMilliseconds(int p_deadline);
+
     void SetSearchParam(const char* p_name, const char* p_value);
 
     void ClearSearchParam();
 
     std::shared_ptr<RemoteSearchResult> Search(ByteArray p_data, int p_resultNum, const char* p_valueType, bool p_withMetaData);
 
+    std::shared_ptr<RemoteSearchResult> SearchRange(ByteArray p_data, float p_radius, int p_maxResultNum, const char* p_valueType, bool p_withMetaData);
+
     bool IsConnected() const;
 
 private:
+    std::shared_ptr<RemoteSearchResult> SendQuery(ByteArray p_data, int p_resultNum, const char* p_valueType, bool p_withMetaData, const std::string& p_options);
+
     std::string CreateSearchQuery(const ByteArray& p_data,
                                   int p_resultNum,
                                   bool p_extractMetadata,
-                                  SPTAG::VectorValueType p_valueType);
+                                  SPTAG::VectorValueType p_valueType,
+                                  const std::string& p_options);
 
     SPTAG::Socket::PacketHandlerMapPtr GetHandlerMap();
 
@@ -45,6 +53,8 @@ private:
 
     std::uint32_t m_timeoutInMilliseconds;
 
+    std::uint32_t m_searchDeadlineInMilliseconds;
+
     std::string m_server;
 
     std::string m_port;
@@ -32,6 +32,13 @@ public:
 
     std::shared_ptr<QueryResult> SearchWithMetaData(ByteArray p_data, int p_resultNum);
 
+    std::shared_ptr<QueryResult> SearchRange(ByteArray p_data, float p_radius, int p_maxResultNum, bool p_withMetaData);
+
+    // p_values is a '|' separated list of the p_column values to keep.
+    std::shared_ptr<QueryResult> SearchFiltered(ByteArray p_data, int p_resultNum, const char* p_column, const char* p_values, bool p_withMetaData);
+
+    bool SetAttribute(SizeType p_id, const char* p_column, const char* p_value);
+
     std::shared_ptr<QueryResult> BatchSearch(ByteArray p_data, int p_vectorNum, int p_resultNum, bool p_withMetaData);
 
     bool ReadyToServe() const;
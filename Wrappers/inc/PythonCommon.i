@@ -1,9 +1,29 @@
 #ifdef SWIGPYTHON
 
+%{
+#include "inc/Helper/StringConvert.h"
+
+static PyObject* SearchStatsToDict(const SPTAG::SearchStats& p_stats)
+{
+    auto dict = PyDict_New();
+    auto setItem = [dict](const char* p_key, PyObject* p_value)
+    {
+        PyDict_SetItemString(dict, p_key, p_value);
+        Py_DECREF(p_value);
+    };
+    setItem("distanceEvaluations", PyInt_FromLong(p_stats.m_distanceEvaluations));
+    setItem("graphHops", PyInt_FromLong(p_stats.m_graphHops));
+    setItem("treeNodesVisited", PyInt_FromLong(p_stats.m_treeNodesVisited));
+    setItem("termination", PyUnicode_FromString(SPTAG::Helper::Convert::ConvertToString(p_stats.m_termination).c_str()));
+    setItem("wallTimeMs", PyFloat_FromDouble(p_stats.m_wallTimeMs));
+    return dict;
+}
+%}
+
 %typemap(out) std::shared_ptr<QueryResult>
 %{
     {
-        $result = PyTuple_New(3);
+        $result = PyTuple_New(4);
         int resNum = $1->GetResultNum();
         auto dstVecIDs = PyList_New(resNum);
         auto dstVecDists = PyList_New(resNum);
@@ -29,18 +49,24 @@
         PyTuple_SetItem($result, 0, dstVecIDs);
         PyTuple_SetItem($result, 1, dstVecDists);
         PyTuple_SetItem($result, 2, dstMetadata);
+        PyTuple_SetItem($result, 3, SearchStatsToDict($1->GetStats()));
     }
 %}
 
 %typemap(out) std::shared_ptr<RemoteSearchResult>
 %{
     {
-        $result = PyTuple_New(3);
+        $result = PyTuple_New(4);
         auto dstVecIDs = PyList_New(0);
         auto dstVecDists = PyList_New(0);
         auto dstMetadata = PyList_New(0);
+        auto dstStats = PyList_New(0);
         for (const auto& indexRes : $1->m_allIndexResults)
         {
+            auto stats = SearchStatsToDict(indexRes.m_results.GetStats());
+            PyList_Append(dstStats, stats);
+            Py_DECREF(stats);
+
             for (const auto& res : indexRes.m_results)
             {
                 PyList_Append(dstVecIDs, PyInt_FromLong(res.VID));
@@ -60,6 +86,7 @@
         PyTuple_SetItem($result, 0, dstVecIDs);
         PyTuple_SetItem($result, 1, dstVecDists);
         PyTuple_SetItem($result, 2, dstMetadata);
+        PyTuple_SetItem($result, 3, dstStats);
     }
 %}
 
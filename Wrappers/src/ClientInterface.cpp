@@ -8,11 +8,13 @@
 #include "inc/Helper/StringConvert.h"
 
 #include <boost/asio.hpp>
+#include <iomanip>
 
 
 AnnClient::AnnClient(const char* p_serverAddr, const char* p_serverPort)
     : m_connectionID(SPTAG::Socket::c_invalidConnectionID),
-      m_timeoutInMilliseconds(9000)
+      m_timeoutInMilliseconds(9000),
+      m_searchDeadlineInMilliseconds(0)
 {
     using namespace SPTAG;
 
@@ -70,6 +72,13 @@ AnnClient::SetTimeoutMilliseconds(int p_timeout)
 }
 
 
+void
+AnnClient::SetSearchDeadlineMilliseconds(int p_deadline)
+{
+    m_searchDeadlineInMilliseconds = p_deadline > 0 ? static_cast<std::uint32_t>(p_deadline) : 0;
+}
+
+
 void
 AnnClient::SetSearchParam(const char* p_name, const char* p_value)
 {
@@ -103,6 +112,22 @@ AnnClient::ClearSearchParam()
 
 std::shared_ptr<RemoteSearchResult>
 AnnClient::Search(ByteArray p_data, int p_resultNum, const char* p_valueType, bool p_withMetaData)
+{
+    return SendQuery(p_data, p_resultNum, p_valueType, p_withMetaData, "");
+}
+
+
+std::shared_ptr<RemoteSearchResult>
+AnnClient::SearchRange(ByteArray p_data, float p_radius, int p_maxResultNum, const char* p_valueType, bool p_withMetaData)
+{
+    std::stringstream options;
+    options << std::setprecision(9) << " $radius:" << p_radius;
+    return SendQuery(p_data, p_maxResultNum, p_valueType, p_withMetaData, options.str());
+}
+
+
+std::shared_ptr<RemoteSearchResult>
+AnnClient::SendQuery(ByteArray p_data, int p_resultNum, const char* p_valueType, bool p_withMetaData, const std::string& p_options)
 {
     using namespace SPTAG;
 
@@ -157,7 +182,8 @@ AnnClient::Search(ByteArray p_data, int p_resultNum, const char* p_valueType, bo
             std::move(timeoutCallback));
 
         Socket::RemoteQuery query;
-        query.m_queryString = CreateSearchQuery(p_data, p_resultNum, p_withMetaData, valueType);
+        query.m_queryString = CreateSearchQuery(p_data, p_resultNum, p_withMetaData, valueType, p_options);
+        query.m_deadlineMilliseconds = m_searchDeadlineInMilliseconds;
 
         packet.Header().m_bodyLength = static_cast<std::uint32_t>(query.EstimateBufferSize());
         packet.AllocateBuffer(packet.Header().m_bodyLength);
@@ -230,7 +256,8 @@ std::string
 AnnClient::CreateSearchQuery(const ByteArray& p_data,
                              int p_resultNum,
                              bool p_extractMetadata,
-                             SPTAG::VectorValueType p_valueType)
+                             SPTAG::VectorValueType p_valueType,
+                             const std::string& p_options)
 {
     std::stringstream out;
 
@@ -241,6 +268,7 @@ AnnClient::CreateSearchQuery(const ByteArray& p_data,
     out << " $datatype:" << SPTAG::Helper::Convert::ConvertToString(p_valueType);
     out << " $resultnum:" << std::to_string(p_resultNum);
     out << " $extractmetadata:" << (p_extractMetadata ? "true" : "false");
+    out << p_options;
 
     {
         std::lock_guard<std::mutex> guard(m_paramMutex);
@@ -2,7 +2,9 @@
 // Licensed under the MIT License.
 
 #include "inc/CoreInterface.h"
+#include "inc/Helper/CommonHelper.h"
 #include "inc/Helper/StringConvert.h"
+#include "inc/Core/SearchFilter.h"
 
 
 AnnIndex::AnnIndex(DimensionType p_dimension)
@@ -131,6 +133,38 @@ AnnIndex::SearchWithMetaData(ByteArray p_data, int p_resultNum)
     return std::move(results);
 }
 
+std::shared_ptr<QueryResult>
+AnnIndex::SearchRange(ByteArray p_data, float p_radius, int p_maxResultNum, bool p_withMetaData)
+{
+    std::shared_ptr<QueryResult> results = std::make_shared<QueryResult>(p_data.Data(), 0, p_withMetaData);
+
+    if (nullptr != m_index && p_data.Length() == m_inputVectorSize)
+    {
+        m_index->SearchIndexRange(*results, p_radius, p_maxResultNum);
+    }
+    return std::move(results);
+}
+
+std::shared_ptr<QueryResult>
+AnnIndex::SearchFiltered(ByteArray p_data, int p_resultNum, const char* p_column, const char* p_values, bool p_withMetaData)
+{
+    std::shared_ptr<QueryResult> results = std::make_shared<QueryResult>(p_data.Data(), p_resultNum, p_withMetaData);
+
+    SPTAG::SearchFilter filter;
+    if (nullptr != m_index && p_data.Length() == m_inputVectorSize
+        && SPTAG::ErrorCode::Success == m_index->AddAttributeFilter(filter, p_column, SPTAG::Helper::StrUtils::SplitString(p_values, "|")))
+    {
+        m_index->SearchIndexFiltered(*results, filter);
+    }
+    return std::move(results);
+}
+
+bool
+AnnIndex::SetAttribute(SizeType p_id, const char* p_column, const char* p_value)
+{
+    return nullptr != m_index && SPTAG::ErrorCode::Success == m_index->SetAttribute(p_id, p_column, p_value);
+}
+
 std::shared_ptr<QueryResult>
 AnnIndex::BatchSearch(ByteArray p_data, int p_vectorNum, int p_resultNum, bool p_withMetaData)
 {